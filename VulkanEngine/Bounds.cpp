@@ -0,0 +1,48 @@
+/*
+*	File:		Bounds.cpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/*
+*	Axis-aligned bounding box stored as center and half size, which transforms and tests cheaper than min and max
+*	radius bounds a sphere around the same center, which is tighter than the box for round or rotated geometry
+*/
+struct Bounds {
+
+	glm::vec3		center			= glm::vec3(0.0f);
+	glm::vec3		extents			= glm::vec3(0.0f);
+	float			radius			= 0.0f;
+
+	static Bounds fromMinMax(const glm::vec3& min_, const glm::vec3& max_) {
+
+		Bounds result;
+		result.center		= (min_ + max_) * 0.5f;
+		result.extents		= (max_ - min_) * 0.5f;
+		result.radius		= glm::length(result.extents);
+		return result;
+
+	}
+
+	/*
+	*	Box around the transformed box, without transforming all eight corners
+	*/
+	Bounds transform(const glm::mat4& matrix_) const {
+
+		Bounds result;
+		result.center		= glm::vec3(matrix_ * glm::vec4(center, 1.0f));
+		result.extents		= glm::abs(glm::vec3(matrix_[0])) * extents.x
+							+ glm::abs(glm::vec3(matrix_[1])) * extents.y
+							+ glm::abs(glm::vec3(matrix_[2])) * extents.z;
+
+		// the largest axis scale bounds how far the sphere can grow
+		float maxScale		= glm::max(glm::max(glm::dot(glm::vec3(matrix_[0]), glm::vec3(matrix_[0])), glm::dot(glm::vec3(matrix_[1]), glm::vec3(matrix_[1]))), glm::dot(glm::vec3(matrix_[2]), glm::vec3(matrix_[2])));
+		result.radius		= radius * glm::sqrt(maxScale);
+		return result;
+
+	}
+
+};
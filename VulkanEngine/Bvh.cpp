@@ -0,0 +1,715 @@
+/*
+*	File:		Bvh.cpp
+*
+*
+*/
+#include "Bvh.hpp"
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+/*
+*	Centroid bins per axis when searching for the best split
+*/
+static const uint32_t BIN_COUNT				= 16;
+
+/*
+*	Largest leaf, one AVX2 culling step
+*/
+static const uint32_t MAX_LEAF_SIZE			= 8;
+
+/*
+*	Subtrees with at least this many items are built as separate jobs
+*/
+static const uint32_t PARALLEL_BUILD_SIZE	= 4096;
+
+/*
+*	Cost of visiting a node relative to testing one item
+*/
+static const float TRAVERSAL_COST			= 1.0f;
+
+/*
+*	The tree is rebuilt once refitting made it this much more expensive than it was when built
+*/
+static const float REBUILD_RATIO			= 1.5f;
+
+/*
+*	Function:		float halfArea(const glm::vec3& min_, const glm::vec3& max_)
+*	Purpose:		Returns half the surface area of a box, which is all SAH needs
+*
+*/
+static inline float halfArea(const glm::vec3& min_, const glm::vec3& max_) {
+
+	glm::vec3 size = glm::max(max_ - min_, glm::vec3(0.0f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+
+}
+
+/*
+*	Function:		bool intersectRay(const glm::vec3& min_, const glm::vec3& max_, const glm::vec3& origin_, const glm::vec3& inverseDirection_, float maxDistance_, float& distance_)
+*	Purpose:		Slab test, distance_ is where the ray enters the box or 0 if it starts inside
+*
+*/
+static inline bool intersectRay(const glm::vec3& min_, const glm::vec3& max_, const glm::vec3& origin_, const glm::vec3& inverseDirection_, float maxDistance_, float& distance_) {
+
+	glm::vec3 t0		= (min_ - origin_) * inverseDirection_;
+	glm::vec3 t1		= (max_ - origin_) * inverseDirection_;
+	glm::vec3 entries	= glm::min(t0, t1);
+	glm::vec3 exits		= glm::max(t0, t1);
+	float entry			= std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+	float exit			= std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance_));
+	distance_			= entry;
+	return entry <= exit;
+
+}
+
+/*
+*	Function:		Bvh()
+*	Purpose:		Default constructor
+*
+*/
+Bvh::Bvh(void) : nodeCount(0), builtCost(0.0f), cost(0.0f), structureVersion(0), transformVersion(0), built(false) {
+
+
+
+}
+
+/*
+*	Function:		void update(
+*
+*						JobSystem&					jobSystem_,
+*						const Bounds*				bounds_,
+*						size_t						count_,
+*						uint64_t					structureVersion_,
+*						uint64_t					transformVersion_
+*
+*					)
+*	Purpose:		Rebuilds the tree if the set of bounds changed, refits it if only the bounds moved and rebuilds it if refitting degraded it too far
+*
+*/
+void Bvh::update(
+
+	JobSystem&					jobSystem_,
+	const Bounds*				bounds_,
+	size_t						count_,
+	uint64_t					structureVersion_,
+	uint64_t					transformVersion_
+
+) {
+
+	if (!built || structureVersion_ != structureVersion || count_ != items.size()) {
+
+		build(jobSystem_, bounds_, count_);
+
+	}
+	else if (transformVersion_ != transformVersion) {
+
+		refit(jobSystem_, bounds_);
+		if (needsRebuild()) {
+
+			build(jobSystem_, bounds_, count_);
+
+		}
+
+	}
+
+	structureVersion	= structureVersion_;
+	transformVersion	= transformVersion_;
+
+}
+
+/*
+*	Function:		void build(JobSystem& jobSystem_, const Bounds* bounds_, size_t count_)
+*	Purpose:		Builds the tree from scratch over count_ bounds, the top levels are split across the job system
+*
+*/
+void Bvh::build(JobSystem& jobSystem_, const Bounds* bounds_, size_t count_) {
+
+	built = true;
+	items.resize(count_);
+	std::iota(items.begin(), items.end(), 0);
+	itemBounds.assign(bounds_, bounds_ + count_);
+	centroids.resize(count_);
+	for (size_t i = 0; i < count_; i++) {
+
+		centroids[i] = bounds_[i].center;
+
+	}
+
+	if (count_ == 0) {
+
+		nodes.clear();
+		nodeCount	= 0;
+		builtCost	= 0.0f;
+		cost		= 0.0f;
+		return;
+
+	}
+
+	// a binary tree with single item leaves is the largest the build can produce
+	nodes.resize(2 * count_ - 1);
+	nodeCount = 1;
+	buildNode(jobSystem_, 0, 0, static_cast< uint32_t >(count_));
+	nodes.resize(nodeCount);
+
+	// the build indexed the bounds through items, from now on they are kept in item order
+	for (size_t i = 0; i < count_; i++) {
+
+		itemBounds[i] = bounds_[items[i]];
+
+	}
+
+	builtCost	= computeCost();
+	cost		= builtCost;
+
+}
+
+/*
+*	Function:		void buildNode(JobSystem& jobSystem_, uint32_t node_, uint32_t first_, uint32_t count_)
+*	Purpose:		Fits node_ around the items first_ to first_ + count_ and splits them at the cheapest of BIN_COUNT planes per axis
+*
+*/
+void Bvh::buildNode(JobSystem& jobSystem_, uint32_t node_, uint32_t first_, uint32_t count_) {
+
+	glm::vec3 boxMin(FLT_MAX);
+	glm::vec3 boxMax(-FLT_MAX);
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (uint32_t i = first_; i < first_ + count_; i++) {
+
+		const Bounds& bounds	= itemBounds[items[i]];
+		boxMin					= glm::min(boxMin, bounds.center - bounds.extents);
+		boxMax					= glm::max(boxMax, bounds.center + bounds.extents);
+		centroidMin				= glm::min(centroidMin, centroids[items[i]]);
+		centroidMax				= glm::max(centroidMax, centroids[items[i]]);
+
+	}
+
+	BvhNode& node		= nodes[node_];
+	node.min			= boxMin;
+	node.max			= boxMax;
+	node.firstItem		= first_;
+	node.itemCount		= count_;
+	node.leftChild		= 0;
+
+	if (count_ <= 2) {
+
+		return;
+
+	}
+
+	struct Bin {
+
+		glm::vec3		min			= glm::vec3(FLT_MAX);
+		glm::vec3		max			= glm::vec3(-FLT_MAX);
+		uint32_t		count		= 0;
+
+	};
+
+	int bestAxis			= -1;
+	uint32_t bestSplit		= 0;
+	float bestCost			= FLT_MAX;
+	glm::vec3 extent		= centroidMax - centroidMin;
+	for (int axis = 0; axis < 3; axis++) {
+
+		if (extent[axis] <= 0.0f) {
+
+			continue;
+
+		}
+
+		Bin bins[BIN_COUNT];
+		float scale = BIN_COUNT / extent[axis];
+		for (uint32_t i = first_; i < first_ + count_; i++) {
+
+			const Bounds& bounds	= itemBounds[items[i]];
+			uint32_t bin			= std::min(static_cast< uint32_t >((centroids[items[i]][axis] - centroidMin[axis]) * scale), BIN_COUNT - 1);
+			bins[bin].min			= glm::min(bins[bin].min, bounds.center - bounds.extents);
+			bins[bin].max			= glm::max(bins[bin].max, bounds.center + bounds.extents);
+			bins[bin].count++;
+
+		}
+
+		// sweep from the left, then from the right, the split after bin i puts bins 0 to i on the left
+		float leftCosts[BIN_COUNT - 1];
+		glm::vec3 sweepMin(FLT_MAX);
+		glm::vec3 sweepMax(-FLT_MAX);
+		uint32_t sweepCount = 0;
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++) {
+
+			sweepMin		= glm::min(sweepMin, bins[i].min);
+			sweepMax		= glm::max(sweepMax, bins[i].max);
+			sweepCount		+= bins[i].count;
+			leftCosts[i]	= sweepCount == 0 ? -1.0f : halfArea(sweepMin, sweepMax) * sweepCount;
+
+		}
+
+		sweepMin	= glm::vec3(FLT_MAX);
+		sweepMax	= glm::vec3(-FLT_MAX);
+		sweepCount	= 0;
+		for (uint32_t i = BIN_COUNT - 1; i > 0; i--) {
+
+			sweepMin		= glm::min(sweepMin, bins[i].min);
+			sweepMax		= glm::max(sweepMax, bins[i].max);
+			sweepCount		+= bins[i].count;
+			if (sweepCount == 0 || leftCosts[i - 1] < 0.0f) {
+
+				continue;
+
+			}
+
+			float splitCost = leftCosts[i - 1] + halfArea(sweepMin, sweepMax) * sweepCount;
+			if (splitCost < bestCost) {
+
+				bestCost	= splitCost;
+				bestAxis	= axis;
+				bestSplit	= i - 1;
+
+			}
+
+		}
+
+	}
+
+	uint32_t middle;
+	if (bestAxis < 0) {
+
+		// all centroids coincide, there is nothing to gain from splitting other than keeping leaves small
+		if (count_ <= MAX_LEAF_SIZE) {
+
+			return;
+
+		}
+		middle = first_ + count_ / 2;
+
+	}
+	else {
+
+		float nodeArea = halfArea(boxMin, boxMax);
+		if (count_ <= MAX_LEAF_SIZE && (nodeArea <= 0.0f || TRAVERSAL_COST + bestCost / nodeArea >= static_cast< float >(count_))) {
+
+			return;
+
+		}
+
+		float scale		= BIN_COUNT / extent[bestAxis];
+		float minimum	= centroidMin[bestAxis];
+		auto split		= std::partition(items.begin() + first_, items.begin() + first_ + count_, [&] (uint32_t item_) {
+
+			return std::min(static_cast< uint32_t >((centroids[item_][bestAxis] - minimum) * scale), BIN_COUNT - 1) <= bestSplit;
+
+		});
+		middle			= static_cast< uint32_t >(split - items.begin());
+
+	}
+
+	uint32_t left		= nodeCount.fetch_add(2);
+	node.leftChild		= left;
+
+	if (count_ >= PARALLEL_BUILD_SIZE) {
+
+		JobCounter counter;
+		jobSystem_.run([this, &jobSystem_, left, first_, middle] () {
+
+			buildNode(jobSystem_, left, first_, middle - first_);
+
+		}, &counter);
+		buildNode(jobSystem_, left + 1, middle, first_ + count_ - middle);
+		jobSystem_.wait(&counter);
+
+	}
+	else {
+
+		buildNode(jobSystem_, left, first_, middle - first_);
+		buildNode(jobSystem_, left + 1, middle, first_ + count_ - middle);
+
+	}
+
+}
+
+/*
+*	Function:		void refit(JobSystem& jobSystem_, const Bounds* bounds_)
+*	Purpose:		Copies the moved bounds into item order and refits every box bottom-up, keeping the topology
+*					Children are always allocated after their parent, so walking the nodes backwards visits children first
+*
+*/
+void Bvh::refit(JobSystem& jobSystem_, const Bounds* bounds_) {
+
+	JobCounter counter;
+	jobSystem_.parallelFor(0, items.size(), PARALLEL_BUILD_SIZE, [this, bounds_] (size_t first_, size_t last_) {
+
+		for (size_t i = first_; i < last_; i++) {
+
+			itemBounds[i] = bounds_[items[i]];
+
+		}
+
+	}, &counter);
+	jobSystem_.wait(&counter);
+
+	for (size_t i = nodes.size(); i-- > 0;) {
+
+		BvhNode& node = nodes[i];
+		if (node.leftChild == 0) {
+
+			glm::vec3 boxMin(FLT_MAX);
+			glm::vec3 boxMax(-FLT_MAX);
+			for (uint32_t j = node.firstItem; j < node.firstItem + node.itemCount; j++) {
+
+				boxMin		= glm::min(boxMin, itemBounds[j].center - itemBounds[j].extents);
+				boxMax		= glm::max(boxMax, itemBounds[j].center + itemBounds[j].extents);
+
+			}
+			node.min	= boxMin;
+			node.max	= boxMax;
+
+		}
+		else {
+
+			node.min	= glm::min(nodes[node.leftChild].min, nodes[node.leftChild + 1].min);
+			node.max	= glm::max(nodes[node.leftChild].max, nodes[node.leftChild + 1].max);
+
+		}
+
+	}
+
+	cost = computeCost();
+
+}
+
+/*
+*	Function:		bool needsRebuild()
+*	Purpose:		Returns whether refitting made the tree so much worse that rebuilding pays off
+*
+*/
+bool Bvh::needsRebuild(void) const {
+
+	return cost > builtCost * REBUILD_RATIO;
+
+}
+
+/*
+*	Function:		float computeCost()
+*	Purpose:		Returns the SAH cost of the tree, the expected work of a query relative to testing one item
+*
+*/
+float Bvh::computeCost(void) const {
+
+	if (nodes.empty()) {
+
+		return 0.0f;
+
+	}
+
+	float rootArea = halfArea(nodes[0].min, nodes[0].max);
+	if (rootArea <= 0.0f) {
+
+		return 0.0f;
+
+	}
+
+	float total = 0.0f;
+	for (const BvhNode& node : nodes) {
+
+		total += halfArea(node.min, node.max) * (node.leftChild == 0 ? static_cast< float >(node.itemCount) : TRAVERSAL_COST);
+
+	}
+	return total / rootArea;
+
+}
+
+/*
+*	Function:		void cullFrustum(const Frustum& frustum_, std::vector< uint32_t >& visible_)
+*	Purpose:		Appends the items intersecting the frustum to visible_ in tree order
+*					Subtrees completely inside are appended without further tests, straddling leaves are tested with the SIMD kernels
+*
+*/
+void Bvh::cullFrustum(const Frustum& frustum_, std::vector< uint32_t >& visible_) const {
+
+	if (nodes.empty()) {
+
+		return;
+
+	}
+
+	// the mask holds the planes the node still straddles, children are never outside the planes their parent is inside of
+	std::vector< std::pair< uint32_t, uint32_t > > stack;
+	stack.reserve(64);
+	stack.push_back({ 0, 0x3F });
+	while (!stack.empty()) {
+
+		uint32_t index		= stack.back().first;
+		uint32_t mask		= stack.back().second;
+		stack.pop_back();
+
+		const BvhNode& node	= nodes[index];
+		glm::vec3 center	= (node.min + node.max) * 0.5f;
+		glm::vec3 extents	= (node.max - node.min) * 0.5f;
+		bool outside		= false;
+		for (uint32_t p = 0; p < 6 && !outside; p++) {
+
+			if (!(mask & (1u << p))) {
+
+				continue;
+
+			}
+
+			glm::vec3 normal	= glm::vec3(frustum_.planes[p]);
+			float distance		= glm::dot(normal, center) + frustum_.planes[p].w;
+			float radius		= glm::dot(glm::abs(normal), extents);
+			outside				= distance + radius < 0.0f;
+			if (distance - radius >= 0.0f) {
+
+				mask &= ~(1u << p);
+
+			}
+
+		}
+
+		if (outside) {
+
+			continue;
+
+		}
+
+		if (mask == 0) {
+
+			visible_.insert(visible_.end(), items.begin() + node.firstItem, items.begin() + node.firstItem + node.itemCount);
+
+		}
+		else if (node.leftChild == 0) {
+
+			uint8_t visibility[MAX_LEAF_SIZE];
+			SimdMath::cullBounds(frustum_, &itemBounds[node.firstItem], visibility, node.itemCount);
+			for (uint32_t i = 0; i < node.itemCount; i++) {
+
+				if (visibility[i]) {
+
+					visible_.push_back(items[node.firstItem + i]);
+
+				}
+
+			}
+
+		}
+		else {
+
+			stack.push_back({ node.leftChild + 1, mask });
+			stack.push_back({ node.leftChild, mask });
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		BvhHit raycast(
+*
+*						const glm::vec3&			origin_,
+*						const glm::vec3&			direction_,
+*						float						maxDistance_
+*
+*					) const
+*	Purpose:		Returns the item whose box the ray enters first, distances are in multiples of direction_
+*					Nearer children are visited first and subtrees behind the closest hit so far are skipped
+*
+*/
+BvhHit Bvh::raycast(
+
+	const glm::vec3&			origin_,
+	const glm::vec3&			direction_,
+	float						maxDistance_
+
+) const {
+
+	BvhHit hit;
+	hit.distance = maxDistance_;
+
+	float rootDistance;
+	glm::vec3 inverseDirection = 1.0f / direction_;
+	if (nodes.empty() || !intersectRay(nodes[0].min, nodes[0].max, origin_, inverseDirection, maxDistance_, rootDistance)) {
+
+		return hit;
+
+	}
+
+	std::vector< std::pair< uint32_t, float > > stack;
+	stack.reserve(64);
+	stack.push_back({ 0, rootDistance });
+	while (!stack.empty()) {
+
+		uint32_t index		= stack.back().first;
+		float entry			= stack.back().second;
+		stack.pop_back();
+		if (entry > hit.distance) {
+
+			continue;
+
+		}
+
+		const BvhNode& node	= nodes[index];
+		if (node.leftChild == 0) {
+
+			for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+
+				float distance;
+				const Bounds& bounds = itemBounds[i];
+				if (intersectRay(bounds.center - bounds.extents, bounds.center + bounds.extents, origin_, inverseDirection, hit.distance, distance) && (hit.item == UINT32_MAX || distance < hit.distance)) {
+
+					hit.item		= items[i];
+					hit.distance	= distance;
+
+				}
+
+			}
+			continue;
+
+		}
+
+		float leftDistance;
+		float rightDistance;
+		const BvhNode& left		= nodes[node.leftChild];
+		const BvhNode& right	= nodes[node.leftChild + 1];
+		bool leftHit			= intersectRay(left.min, left.max, origin_, inverseDirection, hit.distance, leftDistance);
+		bool rightHit			= intersectRay(right.min, right.max, origin_, inverseDirection, hit.distance, rightDistance);
+		if (leftHit && rightHit) {
+
+			// the nearer child goes on top
+			if (leftDistance < rightDistance) {
+
+				stack.push_back({ node.leftChild + 1, rightDistance });
+				stack.push_back({ node.leftChild, leftDistance });
+
+			}
+			else {
+
+				stack.push_back({ node.leftChild, leftDistance });
+				stack.push_back({ node.leftChild + 1, rightDistance });
+
+			}
+
+		}
+		else if (leftHit) {
+
+			stack.push_back({ node.leftChild, leftDistance });
+
+		}
+		else if (rightHit) {
+
+			stack.push_back({ node.leftChild + 1, rightDistance });
+
+		}
+
+	}
+
+	if (hit.item == UINT32_MAX) {
+
+		hit.distance = 0.0f;
+
+	}
+	return hit;
+
+}
+
+/*
+*	Function:		void querySphere(
+*
+*						const glm::vec3&			center_,
+*						float						radius_,
+*						std::vector< uint32_t >&	result_
+*
+*					) const
+*	Purpose:		Appends the items whose box and bounding sphere both overlap the sphere to result_
+*
+*/
+void Bvh::querySphere(
+
+	const glm::vec3&			center_,
+	float						radius_,
+	std::vector< uint32_t >&	result_
+
+) const {
+
+	if (nodes.empty()) {
+
+		return;
+
+	}
+
+	float radiusSquared = radius_ * radius_;
+	std::vector< uint32_t > stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty()) {
+
+		const BvhNode& node	= nodes[stack.back()];
+		stack.pop_back();
+
+		glm::vec3 offset	= center_ - glm::clamp(center_, node.min, node.max);
+		if (glm::dot(offset, offset) > radiusSquared) {
+
+			continue;
+
+		}
+
+		if (node.leftChild != 0) {
+
+			stack.push_back(node.leftChild + 1);
+			stack.push_back(node.leftChild);
+			continue;
+
+		}
+
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+
+			const Bounds& bounds	= itemBounds[i];
+			glm::vec3 boxOffset		= center_ - glm::clamp(center_, bounds.center - bounds.extents, bounds.center + bounds.extents);
+			glm::vec3 centerOffset	= center_ - bounds.center;
+			float reach				= radius_ + bounds.radius;
+			if (glm::dot(boxOffset, boxOffset) <= radiusSquared && glm::dot(centerOffset, centerOffset) <= reach * reach) {
+
+				result_.push_back(items[i]);
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		size_t size()
+*	Purpose:		Returns the number of items in the tree
+*
+*/
+size_t Bvh::size(void) const {
+
+	return items.size();
+
+}
+
+/*
+*	Function:		size_t getNodeCount()
+*	Purpose:		Returns the number of nodes in the tree
+*
+*/
+size_t Bvh::getNodeCount(void) const {
+
+	return nodes.size();
+
+}
+
+/*
+*	Function:		~Bvh()
+*	Purpose:		Default destructor
+*
+*/
+Bvh::~Bvh() {
+
+
+
+}
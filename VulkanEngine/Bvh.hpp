@@ -0,0 +1,89 @@
+/*
+*	File:		Bvh.hpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.cpp"
+#include "Frustum.cpp"
+#include "JobSystem.hpp"
+
+struct BvhNode {
+
+	glm::vec3		min;
+	uint32_t		firstItem;					// first entry of the subtree in the item order, subtrees are contiguous
+	glm::vec3		max;
+	uint32_t		itemCount;
+	uint32_t		leftChild;					// the right child follows it, 0 for leaves since the root is never a child
+
+};
+
+struct BvhHit {
+
+	uint32_t		item			= UINT32_MAX;	// index into the bounds the tree was built from, UINT32_MAX if nothing was hit
+	float			distance		= 0.0f;
+
+};
+
+/*
+*	Class:			Bvh
+*	Purpose:		Bounding volume hierarchy over an array of bounds, built top-down with binned SAH on the job system
+*					Moving bounds only refit the boxes, the tree is rebuilt once the refitted tree got too much worse than the built one
+*
+*/
+class Bvh {
+public:
+	Bvh(void);
+	void update(
+
+		JobSystem&					jobSystem_,
+		const Bounds*				bounds_,
+		size_t						count_,
+		uint64_t					structureVersion_,
+		uint64_t					transformVersion_
+
+	);
+	void build(JobSystem& jobSystem_, const Bounds* bounds_, size_t count_);
+	void refit(JobSystem& jobSystem_, const Bounds* bounds_);
+	bool needsRebuild(void) const;
+	void cullFrustum(const Frustum& frustum_, std::vector< uint32_t >& visible_) const;
+	BvhHit raycast(
+
+		const glm::vec3&			origin_,
+		const glm::vec3&			direction_,
+		float						maxDistance_
+
+	) const;
+	void querySphere(
+
+		const glm::vec3&			center_,
+		float						radius_,
+		std::vector< uint32_t >&	result_
+
+	) const;
+	size_t size(void) const;
+	size_t getNodeCount(void) const;
+	~Bvh();
+private:
+	std::vector< BvhNode >						nodes;
+	std::vector< uint32_t >						items;
+	std::vector< Bounds >						itemBounds;		// copies of the bounds in item order, so every leaf is one contiguous run
+	std::vector< glm::vec3 >					centroids;
+	std::atomic< uint32_t >						nodeCount;
+	float										builtCost;
+	float										cost;
+	uint64_t									structureVersion;
+	uint64_t									transformVersion;
+	bool										built;
+
+	void buildNode(JobSystem& jobSystem_, uint32_t node_, uint32_t first_, uint32_t count_);
+	float computeCost(void) const;
+
+};
@@ -0,0 +1,869 @@
+/*
+*	File:		ClusteredLighting.cpp
+*
+*
+*/
+#include "ClusteredLighting.hpp"
+#include "SimdMath.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+	#define CLUSTERED_LIGHTING_X86
+	#include <immintrin.h>
+#endif
+
+extern Engine engine;
+
+/*
+*	Room every buffer has from the start, a multiple of 8 lights keeps the cluster range 256 byte aligned
+*/
+static const size_t INITIAL_LIGHT_CAPACITY		= 64;
+static const size_t INITIAL_INDEX_CAPACITY		= 4096;
+
+/*
+*	Sphere kernels of one instruction set
+*	overlapBox writes the positions of the spheres in [0, count) touching the box [min, max] into result and returns how many it wrote, in ascending order
+*/
+struct LightKernels {
+
+	size_t (*overlapBox)(const float*, const float*, const float*, const float*, size_t, const float*, const float*, uint32_t*);
+
+};
+
+/*
+*	Squared distance from the sphere centers to the box against their squared radius, the positions [first_, last_) are tested
+*/
+static size_t overlapBoxRange(const float* x_, const float* y_, const float* z_, const float* radius_, size_t first_, size_t last_, const float* min_, const float* max_, uint32_t* result_) {
+
+	size_t found = 0;
+	for (size_t i = first_; i < last_; i++) {
+
+		float dx	= std::max(std::max(min_[0] - x_[i], x_[i] - max_[0]), 0.0f);
+		float dy	= std::max(std::max(min_[1] - y_[i], y_[i] - max_[1]), 0.0f);
+		float dz	= std::max(std::max(min_[2] - z_[i], z_[i] - max_[2]), 0.0f);
+		if (dx * dx + dy * dy + dz * dz <= radius_[i] * radius_[i]) {
+
+			result_[found++] = static_cast< uint32_t >(i);
+
+		}
+
+	}
+	return found;
+
+}
+
+static size_t overlapBoxScalar(const float* x_, const float* y_, const float* z_, const float* radius_, size_t count_, const float* min_, const float* max_, uint32_t* result_) {
+
+	return overlapBoxRange(x_, y_, z_, radius_, 0, count_, min_, max_, result_);
+
+}
+
+static const LightKernels scalarKernels = {
+
+	overlapBoxScalar
+
+};
+
+#if defined CLUSTERED_LIGHTING_X86
+static size_t overlapBoxSse2(const float* x_, const float* y_, const float* z_, const float* radius_, size_t count_, const float* min_, const float* max_, uint32_t* result_) {
+
+	const __m128 zero		= _mm_setzero_ps();
+	const __m128 minX		= _mm_set1_ps(min_[0]);
+	const __m128 minY		= _mm_set1_ps(min_[1]);
+	const __m128 minZ		= _mm_set1_ps(min_[2]);
+	const __m128 maxX		= _mm_set1_ps(max_[0]);
+	const __m128 maxY		= _mm_set1_ps(max_[1]);
+	const __m128 maxZ		= _mm_set1_ps(max_[2]);
+
+	size_t found			= 0;
+	size_t i				= 0;
+	for (; i + 4 <= count_; i += 4) {
+
+		__m128 px			= _mm_loadu_ps(x_ + i);
+		__m128 py			= _mm_loadu_ps(y_ + i);
+		__m128 pz			= _mm_loadu_ps(z_ + i);
+		__m128 radius		= _mm_loadu_ps(radius_ + i);
+		__m128 dx			= _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, px), _mm_sub_ps(px, maxX)), zero);
+		__m128 dy			= _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, py), _mm_sub_ps(py, maxY)), zero);
+		__m128 dz			= _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, pz), _mm_sub_ps(pz, maxZ)), zero);
+		__m128 distance		= _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(radius, radius)));
+		for (int k = 0; mask != 0; k++, mask >>= 1) {
+
+			if (mask & 1) {
+
+				result_[found++] = static_cast< uint32_t >(i + k);
+
+			}
+
+		}
+
+	}
+
+	return found + overlapBoxRange(x_, y_, z_, radius_, i, count_, min_, max_, result_ + found);
+
+}
+
+static const LightKernels sse2Kernels = {
+
+	overlapBoxSse2
+
+};
+
+SIMD_TARGET_AVX2 static size_t overlapBoxAvx2(const float* x_, const float* y_, const float* z_, const float* radius_, size_t count_, const float* min_, const float* max_, uint32_t* result_) {
+
+	const __m256 zero		= _mm256_setzero_ps();
+	const __m256 minX		= _mm256_set1_ps(min_[0]);
+	const __m256 minY		= _mm256_set1_ps(min_[1]);
+	const __m256 minZ		= _mm256_set1_ps(min_[2]);
+	const __m256 maxX		= _mm256_set1_ps(max_[0]);
+	const __m256 maxY		= _mm256_set1_ps(max_[1]);
+	const __m256 maxZ		= _mm256_set1_ps(max_[2]);
+
+	size_t found			= 0;
+	size_t i				= 0;
+	for (; i + 8 <= count_; i += 8) {
+
+		__m256 px			= _mm256_loadu_ps(x_ + i);
+		__m256 py			= _mm256_loadu_ps(y_ + i);
+		__m256 pz			= _mm256_loadu_ps(z_ + i);
+		__m256 radius		= _mm256_loadu_ps(radius_ + i);
+		__m256 dx			= _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minX, px), _mm256_sub_ps(px, maxX)), zero);
+		__m256 dy			= _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minY, py), _mm256_sub_ps(py, maxY)), zero);
+		__m256 dz			= _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minZ, pz), _mm256_sub_ps(pz, maxZ)), zero);
+		__m256 distance		= _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(radius, radius), _CMP_LE_OQ));
+		for (int k = 0; mask != 0; k++, mask >>= 1) {
+
+			if (mask & 1) {
+
+				result_[found++] = static_cast< uint32_t >(i + k);
+
+			}
+
+		}
+
+	}
+
+	return found + overlapBoxRange(x_, y_, z_, radius_, i, count_, min_, max_, result_ + found);
+
+}
+
+static const LightKernels avx2Kernels = {
+
+	overlapBoxAvx2
+
+};
+#endif
+
+/*
+*	Function:		const LightKernels& getKernels()
+*	Purpose:		Returns the kernels of the path SimdMath runs on, there are no NEON kernels yet so ARM uses scalar
+*
+*/
+static const LightKernels& getKernels(void) {
+
+#if defined CLUSTERED_LIGHTING_X86
+	switch (SimdMath::getPath()) {
+
+	case SIMD_PATH_AVX2:
+		return avx2Kernels;
+	case SIMD_PATH_SSE2:
+		return sse2Kernels;
+	default:
+		break;
+
+	}
+#endif
+	return scalarKernels;
+
+}
+
+/*
+*	Function:		void getTileExtent(float ndcMin_, float ndcMax_, float scale_, float near_, float far_, float* min_, float* max_)
+*	Purpose:		View space range covered by the screen range [ndcMin_, ndcMax_] between the depths near_ and far_
+*					scale_ is the view space offset per unit of depth at the screen edge, the range is linear in depth so its corners bound it
+*
+*/
+static void getTileExtent(float ndcMin_, float ndcMax_, float scale_, float near_, float far_, float* min_, float* max_) {
+
+	float a		= ndcMin_ * scale_ * near_;
+	float b		= ndcMax_ * scale_ * near_;
+	float c		= ndcMin_ * scale_ * far_;
+	float d		= ndcMax_ * scale_ * far_;
+	*min_		= std::min(std::min(a, b), std::min(c, d));
+	*max_		= std::max(std::max(a, b), std::max(c, d));
+
+}
+
+/*
+*	Function:		void resize(size_t count_)
+*	Purpose:		Makes room for count_ lights
+*
+*/
+void ClusteredLighting::LightSet::resize(size_t count_) {
+
+	x.resize(count_);
+	y.resize(count_);
+	z.resize(count_);
+	radius.resize(count_);
+	index.resize(count_);
+
+}
+
+/*
+*	Function:		void gather(const LightSet& from_, const uint32_t* found_, size_t count_)
+*	Purpose:		Copies the lights at the positions found_ of from_ to the front of the set
+*
+*/
+void ClusteredLighting::LightSet::gather(const LightSet& from_, const uint32_t* found_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		uint32_t j	= found_[i];
+		x[i]		= from_.x[j];
+		y[i]		= from_.y[j];
+		z[i]		= from_.z[j];
+		radius[i]	= from_.radius[j];
+		index[i]	= from_.index[j];
+
+	}
+
+}
+
+/*
+*	Function:		ClusteredLighting()
+*	Purpose:		Default constructor
+*
+*/
+ClusteredLighting::ClusteredLighting(void) : nearPlane(0.1f), farPlane(100.0f), tanHalfFov(1.0f), slices(CLUSTERS_Z), clusters(CLUSTER_COUNT, glm::uvec2(0)) {
+
+	resetStats();
+
+}
+
+/*
+*	Function:		void init(uint32_t frames_)
+*	Purpose:		Creates one buffer per frame in flight, so they can be bound before the first assignment
+*
+*/
+void ClusteredLighting::init(uint32_t frames_) {
+
+	frames.resize(frames_);
+	for (FrameBuffer& frame : frames) {
+
+		frame.mapped			= nullptr;
+		frame.lightCapacity		= 0;
+		frame.indexCapacity		= 0;
+		reserve(frame, INITIAL_LIGHT_CAPACITY, INITIAL_INDEX_CAPACITY);
+
+	}
+
+}
+
+/*
+*	Function:		void assign(JobSystem& jobSystem_, const PointLight* lights_, size_t count_, const glm::mat4& view_, const glm::mat4& projection_, float near_, float far_)
+*	Purpose:		Lists the lights touching every cluster of the frustum of view_ and projection_, which has to be a symmetric perspective projection
+*					Only the CPU side lists are built, update() copies them into the buffer of a frame
+*
+*/
+void ClusteredLighting::assign(
+
+	JobSystem&					jobSystem_,
+	const PointLight*			lights_,
+	size_t						count_,
+	const glm::mat4&			view_,
+	const glm::mat4&			projection_,
+	float						near_,
+	float						far_
+
+) {
+
+	auto start		= std::chrono::high_resolution_clock::now();
+
+	nearPlane		= near_;
+	farPlane		= far_;
+	tanHalfFov		= glm::vec2(1.0f / projection_[0][0], 1.0f / projection_[1][1]);
+
+	lights.assign(lights_, lights_ + count_);
+	viewLights.resize(count_);
+	for (size_t i = 0; i < count_; i++) {
+
+		glm::vec4 position		= view_ * glm::vec4(lights_[i].position, 1.0f);
+		viewLights.x[i]			= position.x;
+		viewLights.y[i]			= position.y;
+		viewLights.z[i]			= position.z;
+		viewLights.radius[i]	= lights_[i].radius;
+		viewLights.index[i]		= static_cast< uint32_t >(i);
+
+	}
+
+	for (Slice& slice : slices) {
+
+		slice.sliceLights.resize(count_);
+		slice.rowLights.resize(count_);
+		slice.found.resize(count_);
+
+	}
+
+	JobCounter counter;
+	jobSystem_.parallelFor(0, CLUSTERS_Z, 1, [this] (size_t first_, size_t last_) {
+
+		for (size_t z = first_; z < last_; z++) {
+
+			assignSlice(static_cast< uint32_t >(z));
+
+		}
+
+	}, &counter);
+	jobSystem_.wait(&counter);
+
+	// every slice listed its clusters from zero, put the slices behind each other
+	uint32_t offset			= 0;
+	uint32_t maxPerCluster	= 0;
+	for (uint32_t z = 0; z < CLUSTERS_Z; z++) {
+
+		for (uint32_t i = z * CLUSTERS_X * CLUSTERS_Y; i < (z + 1) * CLUSTERS_X * CLUSTERS_Y; i++) {
+
+			clusters[i].x	+= offset;
+			maxPerCluster	= std::max(maxPerCluster, clusters[i].y);
+
+		}
+		offset += static_cast< uint32_t >(slices[z].indices.size());
+
+	}
+
+	indices.resize(offset);
+	offset = 0;
+	for (const Slice& slice : slices) {
+
+		std::copy(slice.indices.begin(), slice.indices.end(), indices.begin() + offset);
+		offset += static_cast< uint32_t >(slice.indices.size());
+
+	}
+
+	auto end				= std::chrono::high_resolution_clock::now();
+	totalLights				+= static_cast< double >(count_);
+	totalIndices			+= static_cast< double >(indices.size());
+	totalMaxPerCluster		+= static_cast< double >(maxPerCluster);
+	totalAssignTime			+= std::chrono::duration< double >(end - start).count();
+	statFrames++;
+
+}
+
+/*
+*	Function:		bool update(uint32_t frame_)
+*	Purpose:		Copies the lights and lists of the last assignment into the buffer of frame_, call once the frame is done on the GPU
+*					Returns true if the buffer had to grow, its descriptors have to be rewritten then
+*
+*/
+bool ClusteredLighting::update(uint32_t frame_) {
+
+	FrameBuffer& frame		= frames[frame_];
+	bool reallocated		= false;
+	if (lights.size() > frame.lightCapacity || indices.size() > frame.indexCapacity) {
+
+		reserve(frame, lights.size(), indices.size());
+		reallocated			= true;
+
+	}
+
+	VkDeviceSize clusterOffset		= sizeof(PointLight) * frame.lightCapacity;
+	VkDeviceSize indexOffset		= clusterOffset + sizeof(glm::uvec2) * CLUSTER_COUNT;
+	memcpy(frame.mapped, lights.data(), sizeof(PointLight) * lights.size());
+	memcpy(frame.mapped + clusterOffset, clusters.data(), sizeof(glm::uvec2) * CLUSTER_COUNT);
+	memcpy(frame.mapped + indexOffset, indices.data(), sizeof(uint32_t) * indices.size());
+	return reallocated;
+
+}
+
+/*
+*	Function:		glm::uvec2 getCluster(uint32_t x_, uint32_t y_, uint32_t z_)
+*	Purpose:		Returns the offset into the light indices and the light count of a cluster of the last assignment
+*
+*/
+glm::uvec2 ClusteredLighting::getCluster(uint32_t x_, uint32_t y_, uint32_t z_) const {
+
+	return clusters[x_ + CLUSTERS_X * (y_ + CLUSTERS_Y * z_)];
+
+}
+
+/*
+*	Function:		const uint32_t* getLightIndices()
+*	Purpose:		Returns the light index lists of all clusters of the last assignment
+*
+*/
+const uint32_t* ClusteredLighting::getLightIndices(void) const {
+
+	return indices.data();
+
+}
+
+/*
+*	Function:		glm::vec4 getClusterScale(float width_, float height_)
+*	Purpose:		Returns what the fragment shader finds its cluster with on a framebuffer of width_ by height_ pixels
+*					x and y are clusters per pixel, the depth slice is log(depth) * z + w
+*
+*/
+glm::vec4 ClusteredLighting::getClusterScale(float width_, float height_) const {
+
+	float logRange = std::log(farPlane / nearPlane);
+	return glm::vec4(
+
+		CLUSTERS_X / width_,
+		CLUSTERS_Y / height_,
+		CLUSTERS_Z / logRange,
+		-(CLUSTERS_Z * std::log(nearPlane)) / logRange
+
+	);
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getLightBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the range of the lights in the buffer of frame_
+*
+*/
+VkDescriptorBufferInfo ClusteredLighting::getLightBufferInfo(uint32_t frame_) const {
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frames[frame_].buffer;
+	bufferInfo.offset					= 0;
+	bufferInfo.range					= sizeof(PointLight) * frames[frame_].lightCapacity;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getClusterBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the range of the cluster offsets and counts in the buffer of frame_
+*
+*/
+VkDescriptorBufferInfo ClusteredLighting::getClusterBufferInfo(uint32_t frame_) const {
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frames[frame_].buffer;
+	bufferInfo.offset					= sizeof(PointLight) * frames[frame_].lightCapacity;
+	bufferInfo.range					= sizeof(glm::uvec2) * CLUSTER_COUNT;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getIndexBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the range of the light index lists in the buffer of frame_
+*
+*/
+VkDescriptorBufferInfo ClusteredLighting::getIndexBufferInfo(uint32_t frame_) const {
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frames[frame_].buffer;
+	bufferInfo.offset					= sizeof(PointLight) * frames[frame_].lightCapacity + sizeof(glm::uvec2) * CLUSTER_COUNT;
+	bufferInfo.range					= sizeof(uint32_t) * frames[frame_].indexCapacity;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		ClusteredLightingStats getStats()
+*	Purpose:		Returns the averages since the last resetStats()
+*
+*/
+ClusteredLightingStats ClusteredLighting::getStats(void) const {
+
+	double count					= statFrames > 0 ? static_cast< double >(statFrames) : 1.0;
+
+	ClusteredLightingStats stats;
+	stats.averageLights				= totalLights / count;
+	stats.averageIndices			= totalIndices / count;
+	stats.averageMaxPerCluster		= totalMaxPerCluster / count;
+	stats.averageAssignTime			= totalAssignTime / count;
+	stats.frames					= statFrames;
+	return stats;
+
+}
+
+/*
+*	Function:		void resetStats()
+*	Purpose:		Starts a new measuring period
+*
+*/
+void ClusteredLighting::resetStats(void) {
+
+	totalLights				= 0.0;
+	totalIndices			= 0.0;
+	totalMaxPerCluster		= 0.0;
+	totalAssignTime			= 0.0;
+	statFrames				= 0;
+
+}
+
+/*
+*	Shading of one fragment as the object fragment shader does it, without the material and ambient terms
+*/
+static glm::vec3 shadeLight(const PointLight& light_, const glm::vec3& position_, const glm::vec3& normal_, const glm::vec3& viewDir_) {
+
+	glm::vec3 toLight		= light_.position - position_;
+	float distance			= glm::length(toLight);
+	float ratio				= distance / light_.radius;
+	float falloff			= glm::clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+	glm::vec3 lightDir		= toLight / std::max(distance, 0.0001f);
+	float diff				= std::max(glm::dot(normal_, lightDir), 0.0f);
+	float spec				= std::pow(std::max(glm::dot(viewDir_, glm::reflect(-lightDir, normal_)), 0.0f), 32.0f);
+	return (diff + spec) * falloff * falloff * light_.intensity * light_.color;
+
+}
+
+/*
+*	Function:		void benchmark(JobSystem& jobSystem_)
+*	Purpose:		Assigns 1 to 1024 lights scattered through the view and shades a grid of fragments with their cluster's lights and with all lights
+*					Prints the assignment cost on every path the CPU supports, the CPU shading cost and lights evaluated per fragment of both loops and how many fragments differ
+*					Shading runs on the CPU as a stand-in for the fragment shader, what it shows is how the work per fragment scales
+*
+*/
+void ClusteredLighting::benchmark(JobSystem& jobSystem_) {
+
+	SimdPath previousPath		= SimdMath::getPath();
+	const size_t counts[]		= { 1, 4, 16, 64, 256, 1024 };
+	const SimdPath paths[]		= { SIMD_PATH_SCALAR, SIMD_PATH_SSE2, SIMD_PATH_AVX2 };
+	const int runs				= 20;
+	const int shadingRuns		= 2;
+	const uint32_t width		= 160;
+	const uint32_t height		= 90;
+	const float nearPlane		= 0.1f;
+	const float farPlane		= 100.0f;
+
+	// same camera as the other benchmarks, looking down +x with z up
+	glm::mat4 projection		= glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, nearPlane, farPlane);
+	projection[1][1]			*= -1;
+	glm::mat4 view				= glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::mat4 inverseView		= glm::inverse(view);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution< float > distanceDistribution(2.0f, 60.0f);
+	std::uniform_real_distribution< float > sideDistribution(-0.9f, 0.9f);
+	std::uniform_real_distribution< float > radiusDistribution(2.0f, 6.0f);
+	std::uniform_real_distribution< float > colorDistribution(0.2f, 1.0f);
+
+	// one fragment per pixel of a low resolution framebuffer at a random depth, facing the camera
+	std::vector< glm::vec3 > positions(width * height);
+	std::vector< glm::vec3 > normals(width * height);
+	std::vector< glm::uvec3 > cells(width * height);
+	ClusteredLighting clustered;
+	clustered.nearPlane		= nearPlane;
+	clustered.farPlane		= farPlane;
+	glm::vec4 scale			= clustered.getClusterScale(static_cast< float >(width), static_cast< float >(height));
+	for (uint32_t y = 0; y < height; y++) {
+
+		for (uint32_t x = 0; x < width; x++) {
+
+			float depth				= distanceDistribution(random);
+			glm::vec2 ndc			= glm::vec2((x + 0.5f) / width, (y + 0.5f) / height) * 2.0f - 1.0f;
+			glm::vec4 viewPosition	= glm::vec4(ndc.x * depth / projection[0][0], ndc.y * depth / projection[1][1], -depth, 1.0f);
+			size_t i				= y * width + x;
+			positions[i]			= glm::vec3(inverseView * viewPosition);
+			normals[i]				= glm::normalize(-positions[i]);
+			cells[i]				= glm::uvec3(
+
+				std::min(static_cast< uint32_t >((x + 0.5f) * scale.x), CLUSTERS_X - 1),
+				std::min(static_cast< uint32_t >((y + 0.5f) * scale.y), CLUSTERS_Y - 1),
+				static_cast< uint32_t >(glm::clamp(std::log(depth) * scale.z + scale.w, 0.0f, static_cast< float >(CLUSTERS_Z - 1)))
+
+			);
+
+		}
+
+	}
+
+	std::cout << "Clustered lighting benchmark, " << CLUSTERS_X << "x" << CLUSTERS_Y << "x" << CLUSTERS_Z << " clusters, " << width * height << " fragments" << std::endl;
+
+	for (size_t count : counts) {
+
+		std::vector< PointLight > lights(count);
+		for (PointLight& light : lights) {
+
+			float distance		= distanceDistribution(random);
+			light.position		= glm::vec3(distance, sideDistribution(random) * distance, sideDistribution(random) * distance * 9.0f / 16.0f);
+			light.radius		= radiusDistribution(random);
+			light.color			= glm::vec3(colorDistribution(random), colorDistribution(random), colorDistribution(random));
+			light.intensity		= 1.0f;
+
+		}
+
+		std::vector< glm::uvec2 > referenceClusters;
+		std::vector< uint32_t > referenceIndices;
+		for (SimdPath path : paths) {
+
+			// paths the CPU lacks fall back to scalar, which was measured already
+			SimdMath::setPath(path);
+			if (SimdMath::getPath() != path) {
+
+				continue;
+
+			}
+
+			clustered.resetStats();
+			for (int run = 0; run < runs; run++) {
+
+				clustered.assign(jobSystem_, lights.data(), lights.size(), view, projection, nearPlane, farPlane);
+
+			}
+			ClusteredLightingStats stats = clustered.getStats();
+
+			bool matches = true;
+			if (path == SIMD_PATH_SCALAR) {
+
+				referenceClusters	= clustered.clusters;
+				referenceIndices	= clustered.indices;
+
+			}
+			else {
+
+				matches = referenceClusters == clustered.clusters && referenceIndices == clustered.indices;
+
+			}
+
+			std::cout << "  " << count << " lights\t" << SimdMath::getPathName(path) << ":\tassign " << 1000.0 * stats.averageAssignTime << " ms, "
+				<< stats.averageIndices / CLUSTER_COUNT << " lights per cluster, at most " << stats.averageMaxPerCluster << ", "
+				<< (matches ? "same" : "different") << " lists as scalar" << std::endl;
+
+		}
+
+		size_t naiveEvaluated		= 0;
+		size_t clusteredEvaluated	= 0;
+		size_t mismatches			= 0;
+		std::vector< glm::vec3 > naiveResults(positions.size());
+
+		auto naiveStart = std::chrono::high_resolution_clock::now();
+		for (int run = 0; run < shadingRuns; run++) {
+
+			for (size_t i = 0; i < positions.size(); i++) {
+
+				glm::vec3 viewDir	= glm::normalize(-positions[i]);
+				glm::vec3 result	= glm::vec3(0.0f);
+				for (const PointLight& light : lights) {
+
+					result += shadeLight(light, positions[i], normals[i], viewDir);
+
+				}
+				naiveResults[i]		= result;
+
+			}
+			naiveEvaluated += positions.size() * lights.size();
+
+		}
+		auto naiveEnd = std::chrono::high_resolution_clock::now();
+
+		auto clusteredStart = std::chrono::high_resolution_clock::now();
+		for (int run = 0; run < shadingRuns; run++) {
+
+			mismatches = 0;
+			for (size_t i = 0; i < positions.size(); i++) {
+
+				glm::vec3 viewDir		= glm::normalize(-positions[i]);
+				glm::vec3 result		= glm::vec3(0.0f);
+				glm::uvec2 cluster		= clustered.getCluster(cells[i].x, cells[i].y, cells[i].z);
+				const uint32_t* list	= clustered.getLightIndices() + cluster.x;
+				for (uint32_t j = 0; j < cluster.y; j++) {
+
+					result += shadeLight(lights[list[j]], positions[i], normals[i], viewDir);
+
+				}
+				clusteredEvaluated		+= cluster.y;
+				mismatches				+= glm::all(glm::lessThanEqual(glm::abs(result - naiveResults[i]), glm::vec3(1e-4f))) ? 0 : 1;
+
+			}
+
+		}
+		auto clusteredEnd = std::chrono::high_resolution_clock::now();
+
+		double fragments = static_cast< double >(positions.size()) * shadingRuns;
+		std::cout << "  " << count << " lights\tshading:\tall lights " << 1000.0 * std::chrono::duration< double >(naiveEnd - naiveStart).count() / shadingRuns << " ms, "
+			<< naiveEvaluated / fragments << " lights per fragment, clustered " << 1000.0 * std::chrono::duration< double >(clusteredEnd - clusteredStart).count() / shadingRuns << " ms, "
+			<< clusteredEvaluated / fragments << " lights per fragment, " << mismatches << " fragments differ" << std::endl;
+
+	}
+
+	SimdMath::setPath(previousPath);
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the buffers
+*
+*/
+void ClusteredLighting::destroy(void) {
+
+	frames.clear();
+
+}
+
+/*
+*	Function:		~ClusteredLighting()
+*	Purpose:		Default destructor
+*
+*/
+ClusteredLighting::~ClusteredLighting() {
+
+
+
+}
+
+/*
+*	Function:		float getSliceDepth(uint32_t slice_)
+*	Purpose:		Returns the view depth the slice slice_ starts at, slices get exponentially deeper so froxels stay roughly cubic
+*
+*/
+float ClusteredLighting::getSliceDepth(uint32_t slice_) const {
+
+	return nearPlane * std::pow(farPlane / nearPlane, static_cast< float >(slice_) / CLUSTERS_Z);
+
+}
+
+/*
+*	Function:		void assignSlice(uint32_t slice_)
+*	Purpose:		Lists the lights of every cluster in the depth slice slice_, the offsets start at zero for every slice
+*					Lights are narrowed down to the ones touching the slice, then a tile row, then a tile, keeping their order
+*
+*/
+void ClusteredLighting::assignSlice(uint32_t slice_) {
+
+	const LightKernels& kernels	= getKernels();
+	Slice& slice				= slices[slice_];
+	float sliceNear				= getSliceDepth(slice_);
+	float sliceFar				= getSliceDepth(slice_ + 1);
+	slice.indices.clear();
+
+	// view space looks down -z
+	float boxMin[3];
+	float boxMax[3];
+	boxMin[2]					= -sliceFar;
+	boxMax[2]					= -sliceNear;
+	getTileExtent(-1.0f, 1.0f, tanHalfFov.x, sliceNear, sliceFar, &boxMin[0], &boxMax[0]);
+	getTileExtent(-1.0f, 1.0f, tanHalfFov.y, sliceNear, sliceFar, &boxMin[1], &boxMax[1]);
+
+	size_t sliceCount = kernels.overlapBox(
+
+		viewLights.x.data(),
+		viewLights.y.data(),
+		viewLights.z.data(),
+		viewLights.radius.data(),
+		viewLights.x.size(),
+		boxMin,
+		boxMax,
+		slice.found.data()
+
+	);
+	slice.sliceLights.gather(viewLights, slice.found.data(), sliceCount);
+
+	for (uint32_t y = 0; y < CLUSTERS_Y; y++) {
+
+		float rowMin	= -1.0f + 2.0f * y / CLUSTERS_Y;
+		float rowMax	= -1.0f + 2.0f * (y + 1) / CLUSTERS_Y;
+		getTileExtent(-1.0f, 1.0f, tanHalfFov.x, sliceNear, sliceFar, &boxMin[0], &boxMax[0]);
+		getTileExtent(rowMin, rowMax, tanHalfFov.y, sliceNear, sliceFar, &boxMin[1], &boxMax[1]);
+
+		size_t rowCount = kernels.overlapBox(
+
+			slice.sliceLights.x.data(),
+			slice.sliceLights.y.data(),
+			slice.sliceLights.z.data(),
+			slice.sliceLights.radius.data(),
+			sliceCount,
+			boxMin,
+			boxMax,
+			slice.found.data()
+
+		);
+		slice.rowLights.gather(slice.sliceLights, slice.found.data(), rowCount);
+
+		for (uint32_t x = 0; x < CLUSTERS_X; x++) {
+
+			getTileExtent(-1.0f + 2.0f * x / CLUSTERS_X, -1.0f + 2.0f * (x + 1) / CLUSTERS_X, tanHalfFov.x, sliceNear, sliceFar, &boxMin[0], &boxMax[0]);
+
+			size_t tileCount = kernels.overlapBox(
+
+				slice.rowLights.x.data(),
+				slice.rowLights.y.data(),
+				slice.rowLights.z.data(),
+				slice.rowLights.radius.data(),
+				rowCount,
+				boxMin,
+				boxMax,
+				slice.found.data()
+
+			);
+
+			clusters[x + CLUSTERS_X * (y + CLUSTERS_Y * slice_)] = glm::uvec2(static_cast< uint32_t >(slice.indices.size()), static_cast< uint32_t >(tileCount));
+			for (size_t i = 0; i < tileCount; i++) {
+
+				slice.indices.push_back(slice.rowLights.index[slice.found[i]]);
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		void reserve(FrameBuffer& frame_, size_t lightCount_, size_t indexCount_)
+*	Purpose:		Replaces the buffer of a frame by one with room for at least lightCount_ lights and indexCount_ light indices, the old one is retired
+*					Lights come first, the cluster offsets and counts and the light indices behind them
+*
+*/
+void ClusteredLighting::reserve(FrameBuffer& frame_, size_t lightCount_, size_t indexCount_) {
+
+	size_t lightCapacity		= std::max(frame_.lightCapacity, INITIAL_LIGHT_CAPACITY);
+	while (lightCapacity < lightCount_) {
+
+		lightCapacity *= 2;
+
+	}
+	size_t indexCapacity		= std::max(frame_.indexCapacity, INITIAL_INDEX_CAPACITY);
+	while (indexCapacity < indexCount_) {
+
+		indexCapacity *= 2;
+
+	}
+	VkDeviceSize bufferSize		= sizeof(PointLight) * lightCapacity + sizeof(glm::uvec2) * CLUSTER_COUNT + sizeof(uint32_t) * indexCapacity;
+
+	engine.createBuffer(
+
+		bufferSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame_.buffer.replace(engine.device),
+		frame_.memory.replace(engine.device)
+
+	);
+
+	void* data;
+	vkMapMemory(
+
+		engine.device,
+		frame_.memory,
+		0,
+		bufferSize,
+		0,
+		&data
+
+	);
+	frame_.mapped				= static_cast< uint8_t* >(data);
+	frame_.lightCapacity		= lightCapacity;
+	frame_.indexCapacity		= indexCapacity;
+
+}
@@ -0,0 +1,134 @@
+/*
+*	File:		ClusteredLighting.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VulkanHandle.hpp"
+#include "JobSystem.hpp"
+#include "PointLight.cpp"
+
+/*
+*	Size of the froxel grid, screen tiles along x and y and exponential depth slices along z
+*/
+static const uint32_t CLUSTERS_X		= 16;
+static const uint32_t CLUSTERS_Y		= 9;
+static const uint32_t CLUSTERS_Z		= 24;
+static const uint32_t CLUSTER_COUNT		= CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+struct ClusteredLightingStats {
+
+	double			averageLights;				// lights assigned per frame
+	double			averageIndices;				// light indices written per frame, every light once per cluster it touches
+	double			averageMaxPerCluster;		// lights of the fullest cluster per frame
+	double			averageAssignTime;			// seconds spent assigning per frame
+	uint64_t		frames;
+
+};
+
+/*
+*	Class:			ClusteredLighting
+*	Purpose:		Splits the view frustum into froxels and lists the point lights touching each of them, so a fragment only shades the lights of its froxel
+*					Lights are assigned on the CPU every frame, slice by slice on the job system: a slice, then a tile row, then a tile narrow down the lights with the widest instruction set SimdMath picked
+*					Every frame in flight has its own buffer with the lights, an offset and count per cluster and the compact light index lists behind them
+*
+*/
+class ClusteredLighting {
+public:
+	ClusteredLighting(void);
+	void init(uint32_t frames_);
+	void assign(
+
+		JobSystem&					jobSystem_,
+		const PointLight*			lights_,
+		size_t						count_,
+		const glm::mat4&			view_,
+		const glm::mat4&			projection_,
+		float						near_,
+		float						far_
+
+	);
+	bool update(uint32_t frame_);
+	glm::uvec2 getCluster(uint32_t x_, uint32_t y_, uint32_t z_) const;
+	const uint32_t* getLightIndices(void) const;
+	glm::vec4 getClusterScale(float width_, float height_) const;
+	VkDescriptorBufferInfo getLightBufferInfo(uint32_t frame_) const;
+	VkDescriptorBufferInfo getClusterBufferInfo(uint32_t frame_) const;
+	VkDescriptorBufferInfo getIndexBufferInfo(uint32_t frame_) const;
+	ClusteredLightingStats getStats(void) const;
+	void resetStats(void);
+	static void benchmark(JobSystem& jobSystem_);
+	void destroy(void);
+	~ClusteredLighting();
+private:
+	/*
+	*	View space lights as separate arrays for the kernels, index maps back into the light list
+	*/
+	struct LightSet {
+
+		std::vector< float >		x;
+		std::vector< float >		y;
+		std::vector< float >		z;
+		std::vector< float >		radius;
+		std::vector< uint32_t >		index;
+
+		void resize(size_t count_);
+		void gather(const LightSet& from_, const uint32_t* found_, size_t count_);
+
+	};
+
+	/*
+	*	Per slice scratch, only touched by the job assigning that slice
+	*/
+	struct Slice {
+
+		LightSet					sliceLights;
+		LightSet					rowLights;
+		std::vector< uint32_t >		found;
+		std::vector< uint32_t >		indices;
+
+	};
+
+	struct FrameBuffer {
+
+		UniqueBuffer				buffer;
+		UniqueDeviceMemory			memory;
+		uint8_t*					mapped;
+		size_t						lightCapacity;
+		size_t						indexCapacity;
+
+	};
+
+	float											nearPlane;
+	float											farPlane;
+	glm::vec2										tanHalfFov;				// view space x and y per unit of depth at the screen edge, signed like the projection
+	std::vector< PointLight >						lights;
+	LightSet										viewLights;
+	std::vector< Slice >							slices;
+	std::vector< glm::uvec2 >						clusters;				// offset into indices and light count per cluster
+	std::vector< uint32_t >							indices;
+	std::vector< FrameBuffer >						frames;
+	double											totalLights;
+	double											totalIndices;
+	double											totalMaxPerCluster;
+	double											totalAssignTime;
+	uint64_t										statFrames;
+
+	float getSliceDepth(uint32_t slice_) const;
+	void assignSlice(uint32_t slice_);
+	void reserve(FrameBuffer& frame_, size_t lightCount_, size_t indexCount_);
+
+};
@@ -48,133 +48,31 @@ const CubeVertex vert[] = {
 };
 
 /*
-*	Function:		Cube(Pipeline* pipeline_))
-*	Purpose:		Default constructor
+*	Function:		Cube()
+*	Purpose:		Default constructor, uploads the unit cube and drops the CPU copy
 *
 */
-Cube::Cube(Pipeline* pipeline_) {
-
-	pipeline = pipeline_;
+Cube::Cube(void) {
 
 	vertices = std::vector(vert, vert + sizeof(vert) / sizeof(vert[0]));
 
-	createVertexBuffer();
-
-}
-
-/*
-*	Function:		void draw(
-*
-*						VkCommandBuffer			commandBuffer_,
-*						VkDeviceSize*			vertexOffsets_,
-*						VkDeviceSize			indexOffset_,
-*						VkIndexType				indexType_,
-*						uint32_t				descriptorSetIndex_
-*
-*					)
-*	Purpose:		Overrides inherited draw function to draw without an index buffer	
-*
-*/
-void Cube::draw(
-
-	VkCommandBuffer			commandBuffer_,
-	VkDeviceSize*			vertexOffsets_,
-	VkDeviceSize			indexOffset_,
-	VkIndexType				indexType_,
-	uint32_t				descriptorSetIndex_
-
-) {
-
-	pipeline->bind(commandBuffer_, &(pipeline->descriptorSets[descriptorSetIndex_]));
+	geometry				= engine.geometryPool.upload(
 
-	bindVBO(commandBuffer_, vertexOffsets_);
-
-	vkCmdDraw(
-
-		commandBuffer_,
+		vertices.data(),
 		static_cast< uint32_t >(vertices.size()),
-		1,
-		0,
+		sizeof(CubeVertex),
+		nullptr,
 		0
 
 	);
 
-}
-
-/*
-*	Function:		void createVertexBuffer()
-*	Purpose:		Creates a valid VkBuffer handle with correct layout from the vertices vector
-*
-*/
-void Cube::createVertexBuffer() {
-
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-	VkBuffer					stagingBuffer;
-	VkDeviceMemory				stagingBufferMemory;
-
-	engine.createBuffer(
-
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory
-
-	);
-
-	void* data;
-	vkMapMemory(
-
-		engine.device,
-		stagingBufferMemory,
-		0,
-		bufferSize,
-		0,
-		&data
-
-	);
-	memcpy(
-
-		data,
-		vertices.data(),
-		(size_t)bufferSize
-
-	);
-	vkUnmapMemory(engine.device, stagingBufferMemory);
-
-	engine.createBuffer(
-
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBuffer,
-		vertexBufferMemory
-
-	);
-
-	engine.copyBuffer(
-
-		stagingBuffer,
-		vertexBuffer,
-		bufferSize
-
-	);
-
-	vkDestroyBuffer(
-
-		engine.device,
-		stagingBuffer,
-		nullptr
-
-	);
-	vkFreeMemory(
-
-		engine.device,
-		stagingBufferMemory,
-		nullptr
+	// drawn without an index buffer
+	meshInfo.vertexCount	= static_cast< uint32_t >(vertices.size());
+	meshInfo.bounds			= Bounds::fromMinMax(glm::vec3(-0.5f), glm::vec3(0.5f));
+	occluderMesh			= OccluderMesh::fromBox(glm::vec3(-0.5f), glm::vec3(0.5f));
+	updateMeshInfo();
 
-	);
+	std::vector< CubeVertex >().swap(vertices);
 
 }
 
@@ -6,21 +6,10 @@
 class Cube :
 	public Object {
 public:
-	Cube(Pipeline* pipeline_);
-	void draw(
-		
-		VkCommandBuffer			commandBuffer_,
-		VkDeviceSize*			vertexOffsets_,
-		VkDeviceSize			indexOffset_,
-		VkIndexType				indexType_,
-		uint32_t				descriptorSetIndex_
-	
-	);
+	Cube(void);
 	~Cube();
 private:
 	std::vector< CubeVertex > vertices;
 
-	void createVertexBuffer(void);
-
 };
 
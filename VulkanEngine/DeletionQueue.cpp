@@ -0,0 +1,116 @@
+/*
+*	File:		DeletionQueue.cpp
+*
+*
+*/
+#include "DeletionQueue.hpp"
+
+/*
+*	Function:		DeletionQueue()
+*	Purpose:		Default constructor
+*
+*/
+DeletionQueue::DeletionQueue(void) {
+
+
+
+}
+
+/*
+*	Function:		void push(uint64_t value_, std::function< void() > deleter_)
+*	Purpose:		Queues deleter_ to run once the timeline has reached value_
+*					Values are expected to grow, an entry behind a larger value is only freed together with it
+*
+*/
+void DeletionQueue::push(uint64_t value_, std::function< void() > deleter_) {
+
+	std::lock_guard< std::mutex > lock(mutex);
+	entries.push_back({ value_, std::move(deleter_) });
+
+}
+
+/*
+*	Function:		void collect(uint64_t completedValue_)
+*	Purpose:		Runs all deleters whose value is not larger than completedValue_
+*
+*/
+void DeletionQueue::collect(uint64_t completedValue_) {
+
+	std::vector< std::function< void() > > ready;
+	{
+
+		std::lock_guard< std::mutex > lock(mutex);
+		while (!entries.empty() && entries.front().value <= completedValue_) {
+
+			ready.push_back(std::move(entries.front().deleter));
+			entries.pop_front();
+
+		}
+
+	}
+
+	run(ready);
+
+}
+
+/*
+*	Function:		void flush()
+*	Purpose:		Runs all deleters regardless of their value, the GPU has to be idle
+*
+*/
+void DeletionQueue::flush(void) {
+
+	std::vector< std::function< void() > > ready;
+	{
+
+		std::lock_guard< std::mutex > lock(mutex);
+		for (auto& entry : entries) {
+
+			ready.push_back(std::move(entry.deleter));
+
+		}
+		entries.clear();
+
+	}
+
+	run(ready);
+
+}
+
+/*
+*	Function:		size_t size()
+*	Purpose:		Returns the number of pending deleters
+*
+*/
+size_t DeletionQueue::size(void) {
+
+	std::lock_guard< std::mutex > lock(mutex);
+	return entries.size();
+
+}
+
+/*
+*	Function:		~DeletionQueue()
+*	Purpose:		Default destructor
+*
+*/
+DeletionQueue::~DeletionQueue() {
+
+
+
+}
+
+/*
+*	Function:		void run(std::vector< std::function< void() > >& deleters_)
+*	Purpose:		Runs deleters_ in the order they were queued, outside of the lock so they may queue more
+*
+*/
+void DeletionQueue::run(std::vector< std::function< void() > >& deleters_) {
+
+	for (auto& deleter : deleters_) {
+
+		deleter();
+
+	}
+
+}
@@ -0,0 +1,39 @@
+/*
+*	File:		DeletionQueue.hpp
+*
+*
+*/
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+*	Class:			DeletionQueue
+*	Purpose:		Holds on to destruction of GPU resources until the timeline value they were last used with has been reached
+*
+*/
+class DeletionQueue {
+public:
+	DeletionQueue(void);
+	void push(uint64_t value_, std::function< void() > deleter_);
+	void collect(uint64_t completedValue_);
+	void flush(void);
+	size_t size(void);
+	~DeletionQueue();
+private:
+	struct Entry {
+
+		uint64_t					value;
+		std::function< void() >		deleter;
+
+	};
+
+	std::mutex									mutex;
+	std::deque< Entry >							entries;
+
+	void run(std::vector< std::function< void() > >& deleters_);
+
+};
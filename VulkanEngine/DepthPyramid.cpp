@@ -0,0 +1,484 @@
+/*
+*	File:		DepthPyramid.cpp
+*
+*
+*/
+#include "DepthPyramid.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <array>
+
+extern Engine engine;
+
+/*
+*	Matches local_size_x and local_size_y of the depth pyramid shader
+*/
+static const uint32_t WORKGROUP_SIZE		= 8;
+
+/*
+*	Function:		DepthPyramid()
+*	Purpose:		Default constructor
+*
+*/
+DepthPyramid::DepthPyramid(void) : depthSamples(VK_SAMPLE_COUNT_1_BIT), depthImage(VK_NULL_HANDLE), depthAspect(0), depthExtent({ 0, 0 }), levelCount(0), version(0) {
+
+
+
+}
+
+/*
+*	Function:		void init(VkSampleCountFlagBits depthSamples_)
+*	Purpose:		Creates the reduction pipelines, depthSamples_ is the sample count of the depth buffers the pyramid is built from
+*
+*/
+void DepthPyramid::init(VkSampleCountFlagBits depthSamples_) {
+
+	depthSamples = depthSamples_;
+
+	std::array< VkDescriptorSetLayoutBinding, 2 > bindings		= {};
+	bindings[0].binding											= 0;
+	bindings[0].descriptorCount									= 1;
+	bindings[0].descriptorType									= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].pImmutableSamplers								= nullptr;
+	bindings[0].stageFlags										= VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding											= 1;
+	bindings[1].descriptorCount									= 1;
+	bindings[1].descriptorType									= VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].pImmutableSamplers								= nullptr;
+	bindings[1].stageFlags										= VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo					= {};
+	layoutInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount										= static_cast< uint32_t >(bindings.size());
+	layoutInfo.pBindings										= bindings.data();
+
+	if (vkCreateDescriptorSetLayout(
+
+		engine.device,
+		&layoutInfo,
+		nullptr,
+		&descriptorSetLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid descriptor set layout!");
+
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo				= {};
+	pipelineLayoutInfo.sType									= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount							= 1;
+	pipelineLayoutInfo.pSetLayouts								= descriptorSetLayout.address();
+
+	if (vkCreatePipelineLayout(
+
+		engine.device,
+		&pipelineLayoutInfo,
+		nullptr,
+		&pipelineLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid pipeline layout!");
+
+	}
+
+	// a multisampled depth buffer is reduced over all of its samples on the way to level 0
+	depthPipeline	= UniquePipeline(engine.device, createPipeline(depthSamples == VK_SAMPLE_COUNT_1_BIT ? "shaders/depthPyramidShaders/comp.spv" : "shaders/depthPyramidShaders/multisampled.spv"));
+	pipeline		= UniquePipeline(engine.device, createPipeline("shaders/depthPyramidShaders/comp.spv"));
+
+	// only ever read with texelFetch, the sampler is just required by the descriptor type
+	VkSamplerCreateInfo samplerInfo								= {};
+	samplerInfo.sType											= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter										= VK_FILTER_NEAREST;
+	samplerInfo.minFilter										= VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode										= VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU									= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV									= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW									= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod											= 0.0f;
+	samplerInfo.maxLod											= VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(
+
+		engine.device,
+		&samplerInfo,
+		nullptr,
+		&sampler.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid sampler!");
+
+	}
+
+}
+
+/*
+*	Function:		void create(
+*
+*						VkImage						depthImage_,
+*						VkImageView					depthImageView_,
+*						VkImageAspectFlags			depthAspect_,
+*						VkExtent2D					depthExtent_
+*
+*					)
+*	Purpose:		(Re)creates the pyramid for the given depth buffer, which needs to be sampled and stored by the render pass drawing it
+*					The old pyramid is retired, descriptors pointing at it have to be rewritten once getVersion() changed
+*
+*/
+void DepthPyramid::create(
+
+	VkImage						depthImage_,
+	VkImageView					depthImageView_,
+	VkImageAspectFlags			depthAspect_,
+	VkExtent2D					depthExtent_
+
+) {
+
+	depthImage			= depthImage_;
+	depthAspect			= depthAspect_;
+	depthExtent			= depthExtent_;
+
+	uint32_t width		= std::max((depthExtent.width + 1) / 2, 1u);
+	uint32_t height		= std::max((depthExtent.height + 1) / 2, 1u);
+	levelCount			= 1;
+	while ((std::max(width, height) >> levelCount) > 0) {
+
+		levelCount++;
+
+	}
+
+	engine.createImage(
+
+		width,
+		height,
+		levelCount,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_FORMAT_R32_SFLOAT,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		image.replace(engine.device),
+		imageMemory.replace(engine.device)
+
+	);
+
+	VkImageViewCreateInfo viewInfo						= {};
+	viewInfo.sType										= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image										= image;
+	viewInfo.viewType									= VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format										= VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask				= VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel				= 0;
+	viewInfo.subresourceRange.levelCount				= levelCount;
+	viewInfo.subresourceRange.baseArrayLayer			= 0;
+	viewInfo.subresourceRange.layerCount				= 1;
+
+	if (vkCreateImageView(engine.device, &viewInfo, nullptr, &imageView.replace(engine.device)) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid image view!");
+
+	}
+
+	// one view per level, every level is written through one and read through it by the next
+	levelViews.clear();
+	levelViews.resize(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++) {
+
+		viewInfo.subresourceRange.baseMipLevel			= i;
+		viewInfo.subresourceRange.levelCount			= 1;
+
+		if (vkCreateImageView(engine.device, &viewInfo, nullptr, &levelViews[i].replace(engine.device)) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to create depth pyramid level view!");
+
+		}
+
+	}
+
+	// a fresh pool every time, the frames in flight keep using the sets of the old one until it is retired
+	std::array< VkDescriptorPoolSize, 2 > poolSizes		= {};
+	poolSizes[0].type									= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount						= levelCount;
+	poolSizes[1].type									= VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount						= levelCount;
+
+	VkDescriptorPoolCreateInfo poolInfo					= {};
+	poolInfo.sType										= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount								= static_cast< uint32_t >(poolSizes.size());
+	poolInfo.pPoolSizes									= poolSizes.data();
+	poolInfo.maxSets									= levelCount;
+
+	if (vkCreateDescriptorPool(
+
+		engine.device,
+		&poolInfo,
+		nullptr,
+		&descriptorPool.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid descriptor pool!");
+
+	}
+
+	std::vector< VkDescriptorSetLayout > layouts(levelCount, descriptorSetLayout.get());
+	descriptorSets.resize(levelCount);
+
+	VkDescriptorSetAllocateInfo allocInfo				= {};
+	allocInfo.sType										= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool							= descriptorPool;
+	allocInfo.descriptorSetCount						= levelCount;
+	allocInfo.pSetLayouts								= layouts.data();
+
+	if (vkAllocateDescriptorSets(
+
+		engine.device,
+		&allocInfo,
+		descriptorSets.data()
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to allocate depth pyramid descriptor sets!");
+
+	}
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+
+		VkDescriptorImageInfo sourceInfo							= {};
+		sourceInfo.sampler											= sampler;
+		sourceInfo.imageView										= i == 0 ? depthImageView_ : levelViews[i - 1].get();
+		sourceInfo.imageLayout										= i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo						= {};
+		destinationInfo.imageView									= levelViews[i];
+		destinationInfo.imageLayout									= VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array< VkWriteDescriptorSet, 2 > descriptorWrites		= {};
+		descriptorWrites[0].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet									= descriptorSets[i];
+		descriptorWrites[0].dstBinding								= 0;
+		descriptorWrites[0].dstArrayElement							= 0;
+		descriptorWrites[0].descriptorType							= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].descriptorCount							= 1;
+		descriptorWrites[0].pImageInfo								= &sourceInfo;
+		descriptorWrites[1].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet									= descriptorSets[i];
+		descriptorWrites[1].dstBinding								= 1;
+		descriptorWrites[1].dstArrayElement							= 0;
+		descriptorWrites[1].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].descriptorCount							= 1;
+		descriptorWrites[1].pImageInfo								= &destinationInfo;
+
+		vkUpdateDescriptorSets(
+
+			engine.device,
+			static_cast< uint32_t >(descriptorWrites.size()),
+			descriptorWrites.data(),
+			0,
+			nullptr
+
+		);
+
+	}
+
+	version++;
+
+}
+
+/*
+*	Function:		void record(VkCommandBuffer commandBuffer_)
+*	Purpose:		Records building the whole pyramid, the depth buffer has to be in DEPTH_STENCIL_ATTACHMENT_OPTIMAL and is left in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+*
+*/
+void DepthPyramid::record(VkCommandBuffer commandBuffer_) {
+
+	std::array< VkImageMemoryBarrier, 2 > imageBarriers		= {};
+	imageBarriers[0].sType										= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarriers[0].srcAccessMask								= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	imageBarriers[0].dstAccessMask								= VK_ACCESS_SHADER_READ_BIT;
+	imageBarriers[0].oldLayout									= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	imageBarriers[0].newLayout									= VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	imageBarriers[0].srcQueueFamilyIndex						= VK_QUEUE_FAMILY_IGNORED;
+	imageBarriers[0].dstQueueFamilyIndex						= VK_QUEUE_FAMILY_IGNORED;
+	imageBarriers[0].image										= depthImage;
+	imageBarriers[0].subresourceRange.aspectMask				= depthAspect;
+	imageBarriers[0].subresourceRange.baseMipLevel				= 0;
+	imageBarriers[0].subresourceRange.levelCount				= 1;
+	imageBarriers[0].subresourceRange.baseArrayLayer			= 0;
+	imageBarriers[0].subresourceRange.layerCount				= 1;
+
+	// the old contents are never needed, the previous frame may still be reading them though
+	imageBarriers[1].sType										= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarriers[1].srcAccessMask								= 0;
+	imageBarriers[1].dstAccessMask								= VK_ACCESS_SHADER_WRITE_BIT;
+	imageBarriers[1].oldLayout									= VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarriers[1].newLayout									= VK_IMAGE_LAYOUT_GENERAL;
+	imageBarriers[1].srcQueueFamilyIndex						= VK_QUEUE_FAMILY_IGNORED;
+	imageBarriers[1].dstQueueFamilyIndex						= VK_QUEUE_FAMILY_IGNORED;
+	imageBarriers[1].image										= image;
+	imageBarriers[1].subresourceRange.aspectMask				= VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarriers[1].subresourceRange.baseMipLevel				= 0;
+	imageBarriers[1].subresourceRange.levelCount				= levelCount;
+	imageBarriers[1].subresourceRange.baseArrayLayer			= 0;
+	imageBarriers[1].subresourceRange.layerCount				= 1;
+
+	vkCmdPipelineBarrier(
+
+		commandBuffer_,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast< uint32_t >(imageBarriers.size()),
+		imageBarriers.data()
+
+	);
+
+	VkMemoryBarrier levelBarrier		= {};
+	levelBarrier.sType					= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	levelBarrier.srcAccessMask			= VK_ACCESS_SHADER_WRITE_BIT;
+	levelBarrier.dstAccessMask			= VK_ACCESS_SHADER_READ_BIT;
+
+	uint32_t width						= std::max((depthExtent.width + 1) / 2, 1u);
+	uint32_t height						= std::max((depthExtent.height + 1) / 2, 1u);
+	for (uint32_t i = 0; i < levelCount; i++) {
+
+		if (i < 2) {
+
+			vkCmdBindPipeline(commandBuffer_, VK_PIPELINE_BIND_POINT_COMPUTE, i == 0 ? depthPipeline : pipeline);
+
+		}
+		vkCmdBindDescriptorSets(commandBuffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+		vkCmdDispatch(commandBuffer_, (width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+		// the next level reads this one, the last one is read by the culling pass
+		vkCmdPipelineBarrier(commandBuffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+		width	= std::max(width / 2, 1u);
+		height	= std::max(height / 2, 1u);
+
+	}
+
+}
+
+/*
+*	Function:		VkDescriptorImageInfo getImageInfo()
+*	Purpose:		Returns the whole pyramid as it is read by the culling pass
+*
+*/
+VkDescriptorImageInfo DepthPyramid::getImageInfo(void) const {
+
+	VkDescriptorImageInfo imageInfo		= {};
+	imageInfo.sampler					= sampler;
+	imageInfo.imageView					= imageView;
+	imageInfo.imageLayout				= VK_IMAGE_LAYOUT_GENERAL;
+	return imageInfo;
+
+}
+
+/*
+*	Function:		VkExtent2D getDepthExtent()
+*	Purpose:		Returns the size of the depth buffer the pyramid is built from
+*
+*/
+VkExtent2D DepthPyramid::getDepthExtent(void) const {
+
+	return depthExtent;
+
+}
+
+/*
+*	Function:		uint64_t getVersion()
+*	Purpose:		Returns a counter that changes every time the pyramid is recreated
+*
+*/
+uint64_t DepthPyramid::getVersion(void) const {
+
+	return version;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the pyramid and the pipelines building it
+*
+*/
+void DepthPyramid::destroy(void) {
+
+	levelViews.clear();
+	imageView.reset();
+	image.reset();
+	imageMemory.reset();
+	descriptorPool.reset();
+	sampler.reset();
+	depthPipeline.reset();
+	pipeline.reset();
+	pipelineLayout.reset();
+	descriptorSetLayout.reset();
+
+}
+
+/*
+*	Function:		~DepthPyramid()
+*	Purpose:		Default destructor
+*
+*/
+DepthPyramid::~DepthPyramid() {
+
+
+
+}
+
+/*
+*	Function:		VkPipeline createPipeline(const char* shaderPath_)
+*	Purpose:		Creates a reduction pipeline out of the compute shader at shaderPath_
+*
+*/
+VkPipeline DepthPyramid::createPipeline(const char* shaderPath_) {
+
+	ShaderModule computeShaderModule						= ShaderModule(shaderPath_);
+
+	VkPipelineShaderStageCreateInfo stageInfo				= {};
+	stageInfo.sType											= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage											= VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module										= computeShaderModule.getModule();
+	stageInfo.pName											= "main";
+
+	VkComputePipelineCreateInfo pipelineInfo				= {};
+	pipelineInfo.sType										= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage										= stageInfo;
+	pipelineInfo.layout										= pipelineLayout;
+
+	VkPipeline result										= VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(
+
+		engine.device,
+		VK_NULL_HANDLE,
+		1,
+		&pipelineInfo,
+		nullptr,
+		&result
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create depth pyramid pipeline!");
+
+	}
+
+	vkDestroyShaderModule(
+
+		engine.device,
+		computeShaderModule.getModule(),
+		nullptr
+
+	);
+
+	return result;
+
+}
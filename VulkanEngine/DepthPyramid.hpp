@@ -0,0 +1,64 @@
+/*
+*	File:		DepthPyramid.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "VulkanHandle.hpp"
+
+/*
+*	Class:			DepthPyramid
+*	Purpose:		Hierarchical-Z mip chain of a depth buffer, every texel holds the farthest depth of the 2x2 texels below it
+*					Level 0 is half the depth resolution, so a texel of level n covers 2^(n + 1) depth pixels in each direction
+*
+*/
+class DepthPyramid {
+public:
+	DepthPyramid(void);
+	void init(VkSampleCountFlagBits depthSamples_);
+	void create(
+
+		VkImage						depthImage_,
+		VkImageView					depthImageView_,
+		VkImageAspectFlags			depthAspect_,
+		VkExtent2D					depthExtent_
+
+	);
+	void record(VkCommandBuffer commandBuffer_);
+	VkDescriptorImageInfo getImageInfo(void) const;
+	VkExtent2D getDepthExtent(void) const;
+	uint64_t getVersion(void) const;
+	void destroy(void);
+	~DepthPyramid();
+private:
+	VkSampleCountFlagBits						depthSamples;
+	UniqueDescriptorSetLayout					descriptorSetLayout;
+	UniquePipelineLayout						pipelineLayout;
+	UniquePipeline								depthPipeline;			// builds level 0 out of the depth buffer
+	UniquePipeline								pipeline;				// builds every further level out of the one above
+	UniqueSampler								sampler;
+	UniqueDescriptorPool						descriptorPool;
+	UniqueImage									image;
+	UniqueDeviceMemory							imageMemory;
+	UniqueImageView								imageView;
+	std::vector< UniqueImageView >				levelViews;
+	std::vector< VkDescriptorSet >				descriptorSets;
+	VkImage										depthImage;
+	VkImageAspectFlags							depthAspect;
+	VkExtent2D									depthExtent;
+	uint32_t									levelCount;
+	uint64_t									version;
+
+	VkPipeline createPipeline(const char* shaderPath_);
+
+};
@@ -0,0 +1,568 @@
+/*
+*	File:		DescriptorHeap.cpp
+*
+*
+*/
+#include "DescriptorHeap.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <array>
+
+extern Engine engine;
+
+/*
+*	Array sizes with descriptor indexing, far below the 500000 update after bind descriptors per stage the extension guarantees
+*/
+static const uint32_t BINDLESS_CAPACITIES[DESCRIPTOR_HEAP_ARRAY_COUNT]		= { 4096, 64, 1024 };
+
+/*
+*	Array sizes without, at most what the per stage limits leave next to the descriptors the pipelines bind themselves
+*	The minimums of Vulkan 1.0 for sampled images, samplers and storage buffers are 16, 16 and 4
+*/
+static const uint32_t FALLBACK_CAPACITIES[DESCRIPTOR_HEAP_ARRAY_COUNT]		= { 16, 4, 4 };
+
+/*
+*	Descriptor type of each array
+*/
+static const VkDescriptorType DESCRIPTOR_TYPES[DESCRIPTOR_HEAP_ARRAY_COUNT]	= {
+
+	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+	VK_DESCRIPTOR_TYPE_SAMPLER,
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+
+};
+
+/*
+*	Function:		DescriptorHeap()
+*	Purpose:		Default constructor
+*
+*/
+DescriptorHeap::DescriptorHeap(void) : bindless(false), capacities{ 0, 0, 0 }, specializationEntries{}, specializationInfo{} {
+
+
+
+}
+
+/*
+*	Function:		void create(
+*
+*						bool							bindless_,
+*						VkImageView						defaultImageView_,
+*						VkSampler						defaultSampler_,
+*						const VkPhysicalDeviceLimits&	limits_,
+*						const uint32_t*					reserved_
+*
+*					)
+*	Purpose:		Creates the set layout, the pool and the sets, bindless_ if VK_EXT_descriptor_indexing has been enabled on the device
+*					reserved_ holds per array how many descriptors of its type the pipelines bind to the fragment stage outside of the heap
+*					Every descriptor starts out as the default, slot 0 of each array keeps it, an array the limits leave no room for stays empty
+*
+*/
+void DescriptorHeap::create(
+
+	bool							bindless_,
+	VkImageView						defaultImageView_,
+	VkSampler						defaultSampler_,
+	const VkPhysicalDeviceLimits&	limits_,
+	const uint32_t*					reserved_
+
+) {
+
+	bindless = bindless_;
+#if !defined VK_EXT_descriptor_indexing
+	bindless = false;
+#endif
+
+	// the heap is part of every pipeline layout, so its arrays share the per stage limits with the pipeline's own set
+	const uint32_t stageLimits[DESCRIPTOR_HEAP_ARRAY_COUNT]		= {
+
+		limits_.maxPerStageDescriptorSampledImages,
+		limits_.maxPerStageDescriptorSamplers,
+		limits_.maxPerStageDescriptorStorageBuffers
+
+	};
+
+	std::array< VkDescriptorSetLayoutBinding, DESCRIPTOR_HEAP_ARRAY_COUNT > bindings		= {};
+	for (uint32_t a = 0; a < DESCRIPTOR_HEAP_ARRAY_COUNT; a++) {
+
+		capacities[a]												= bindless ? BINDLESS_CAPACITIES[a] : std::min(FALLBACK_CAPACITIES[a], stageLimits[a] - std::min(reserved_[a], stageLimits[a]));
+		bindings[a].binding											= a;
+		bindings[a].descriptorCount									= capacities[a];
+		bindings[a].descriptorType									= DESCRIPTOR_TYPES[a];
+		bindings[a].pImmutableSamplers								= nullptr;
+		bindings[a].stageFlags										= VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo						= {};
+	layoutInfo.sType												= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount											= static_cast< uint32_t >(bindings.size());
+	layoutInfo.pBindings											= bindings.data();
+
+#if defined VK_EXT_descriptor_indexing
+	// unused slots may stay empty and slots may be written while the set is bound, as long as no pending draw reads them
+	std::array< VkDescriptorBindingFlagsEXT, DESCRIPTOR_HEAP_ARRAY_COUNT > bindingFlags;
+	bindingFlags.fill(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT);
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo	= {};
+	bindingFlagsInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount									= static_cast< uint32_t >(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags									= bindingFlags.data();
+
+	if (bindless) {
+
+		layoutInfo.flags											= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		layoutInfo.pNext											= &bindingFlagsInfo;
+
+	}
+#endif
+
+	if (vkCreateDescriptorSetLayout(
+
+		engine.device,
+		&layoutInfo,
+		nullptr,
+		&setLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create descriptor heap set layout!");
+
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo					= {};
+	pipelineLayoutInfo.sType										= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount								= 1;
+	pipelineLayoutInfo.pSetLayouts									= setLayout.address();
+
+	if (vkCreatePipelineLayout(
+
+		engine.device,
+		&pipelineLayoutInfo,
+		nullptr,
+		&pipelineLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create descriptor heap pipeline layout!");
+
+	}
+
+	// the fallback cannot touch a set a pending frame uses, so every frame in flight has its own
+	uint32_t setCount												= bindless ? 1 : engine.MAX_FRAMES_IN_FLIGHT;
+
+	// pool sizes may not be empty, an array without room gets none
+	std::vector< VkDescriptorPoolSize > poolSizes;
+	for (uint32_t a = 0; a < DESCRIPTOR_HEAP_ARRAY_COUNT; a++) {
+
+		if (capacities[a] > 0) {
+
+			poolSizes.push_back({ DESCRIPTOR_TYPES[a], capacities[a] * setCount });
+
+		}
+
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo								= {};
+	poolInfo.sType													= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount											= static_cast< uint32_t >(poolSizes.size());
+	poolInfo.pPoolSizes												= poolSizes.data();
+	poolInfo.maxSets												= setCount;
+#if defined VK_EXT_descriptor_indexing
+	if (bindless) {
+
+		poolInfo.flags												= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+
+	}
+#endif
+
+	if (vkCreateDescriptorPool(
+
+		engine.device,
+		&poolInfo,
+		nullptr,
+		&descriptorPool.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create descriptor heap pool!");
+
+	}
+
+	std::vector< VkDescriptorSetLayout > layouts(setCount, getSetLayout());
+	VkDescriptorSetAllocateInfo allocInfo							= {};
+	allocInfo.sType													= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool										= descriptorPool;
+	allocInfo.descriptorSetCount									= setCount;
+	allocInfo.pSetLayouts											= layouts.data();
+
+	descriptorSets.resize(setCount);
+	if (vkAllocateDescriptorSets(
+
+		engine.device,
+		&allocInfo,
+		descriptorSets.data()
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to allocate descriptor heap sets!");
+
+	}
+
+	// the storage buffer array needs something to point at, its content is never read
+	engine.createBuffer(
+
+		16,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		defaultBuffer.replace(engine.device),
+		defaultBufferMemory.replace(engine.device)
+
+	);
+
+	Slot defaults[DESCRIPTOR_HEAP_ARRAY_COUNT]						= {};
+	defaults[DESCRIPTOR_HEAP_TEXTURES].image.imageView				= defaultImageView_;
+	defaults[DESCRIPTOR_HEAP_TEXTURES].image.imageLayout			= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	defaults[DESCRIPTOR_HEAP_SAMPLERS].image.sampler				= defaultSampler_;
+	defaults[DESCRIPTOR_HEAP_STORAGE_BUFFERS].buffer.buffer			= defaultBuffer;
+	defaults[DESCRIPTOR_HEAP_STORAGE_BUFFERS].buffer.offset			= 0;
+	defaults[DESCRIPTOR_HEAP_STORAGE_BUFFERS].buffer.range			= VK_WHOLE_SIZE;
+
+	std::vector< VkWriteDescriptorSet > descriptorWrites;
+	pendingWrites.assign(bindless ? 0 : engine.MAX_FRAMES_IN_FLIGHT, std::vector< PendingWrite >());
+	for (uint32_t a = 0; a < DESCRIPTOR_HEAP_ARRAY_COUNT; a++) {
+
+		slots[a].assign(capacities[a], defaults[a]);
+		freeSlots[a].clear();
+		for (uint32_t i = capacities[a]; i > 1; i--) {
+
+			freeSlots[a].push_back(i - 1);
+
+		}
+
+		// nothing is in flight yet, so every set can be filled right away
+		for (VkDescriptorSet set : descriptorSets) {
+
+			for (uint32_t i = 0; i < capacities[a]; i++) {
+
+				descriptorWrites.push_back(getWrite(set, static_cast< DescriptorHeapArray >(a), i));
+
+			}
+
+		}
+
+	}
+
+	vkUpdateDescriptorSets(
+
+		engine.device,
+		static_cast< uint32_t >(descriptorWrites.size()),
+		descriptorWrites.data(),
+		0,
+		nullptr
+
+	);
+
+	// the shaders size their arrays by specialization constants 0 to 2, the same binaries serve both paths
+	for (uint32_t a = 0; a < DESCRIPTOR_HEAP_ARRAY_COUNT; a++) {
+
+		specializationEntries[a].constantID							= a;
+		specializationEntries[a].offset								= static_cast< uint32_t >(a * sizeof(uint32_t));
+		specializationEntries[a].size								= sizeof(uint32_t);
+
+	}
+	specializationInfo.mapEntryCount								= DESCRIPTOR_HEAP_ARRAY_COUNT;
+	specializationInfo.pMapEntries									= specializationEntries;
+	specializationInfo.dataSize										= sizeof(capacities);
+	specializationInfo.pData										= capacities;
+
+	logger.log(EVENT_LOG, std::string(bindless ? "Bindless descriptor heap" : "Descriptor heap without descriptor indexing") + " with " + std::to_string(capacities[DESCRIPTOR_HEAP_TEXTURES]) + " textures, " + std::to_string(capacities[DESCRIPTOR_HEAP_SAMPLERS]) + " samplers and " + std::to_string(capacities[DESCRIPTOR_HEAP_STORAGE_BUFFERS]) + " storage buffers");
+
+}
+
+/*
+*	Function:		uint32_t addTexture(VkImageView imageView_)
+*	Purpose:		Puts a sampled image in shader read only layout into the heap and returns its index
+*
+*/
+uint32_t DescriptorHeap::addTexture(VkImageView imageView_) {
+
+	Slot slot					= {};
+	slot.image.imageView		= imageView_;
+	slot.image.imageLayout		= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return add(DESCRIPTOR_HEAP_TEXTURES, slot);
+
+}
+
+/*
+*	Function:		uint32_t addSampler(VkSampler sampler_)
+*	Purpose:		Puts a sampler into the heap and returns its index
+*
+*/
+uint32_t DescriptorHeap::addSampler(VkSampler sampler_) {
+
+	Slot slot					= {};
+	slot.image.sampler			= sampler_;
+	return add(DESCRIPTOR_HEAP_SAMPLERS, slot);
+
+}
+
+/*
+*	Function:		uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo_)
+*	Purpose:		Puts a storage buffer range into the heap and returns its index
+*
+*/
+uint32_t DescriptorHeap::addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo_) {
+
+	Slot slot					= {};
+	slot.buffer					= bufferInfo_;
+	return add(DESCRIPTOR_HEAP_STORAGE_BUFFERS, slot);
+
+}
+
+/*
+*	Function:		void remove(DescriptorHeapArray array_, uint32_t index_)
+*	Purpose:		Points index_ back at the default and frees it once no frame in flight reads it anymore
+*					The resource behind it may be destroyed after this call, as long as that is retired too
+*
+*/
+void DescriptorHeap::remove(DescriptorHeapArray array_, uint32_t index_) {
+
+	if (index_ == 0 || index_ >= capacities[array_]) {
+
+		return;
+
+	}
+
+	engine.retire([this, array_, index_] () {
+
+		if (descriptorSets.empty()) {
+
+			return;
+
+		}
+
+		write(array_, index_, slots[array_][0]);
+		freeSlots[array_].push_back(index_);
+
+	});
+
+}
+
+/*
+*	Function:		bool update(uint32_t frame_)
+*	Purpose:		Applies the writes frame_'s set has missed, call once the frame is done on the GPU
+*					Returns true if it wrote anything, the command buffers that bound the set have to be re-recorded then; always false when bindless
+*
+*/
+bool DescriptorHeap::update(uint32_t frame_) {
+
+	if (bindless || pendingWrites[frame_].empty()) {
+
+		return false;
+
+	}
+
+	std::vector< VkWriteDescriptorSet > descriptorWrites;
+	descriptorWrites.reserve(pendingWrites[frame_].size());
+	for (const PendingWrite& pending : pendingWrites[frame_]) {
+
+		descriptorWrites.push_back(getWrite(descriptorSets[frame_], pending.array, pending.index));
+
+	}
+	pendingWrites[frame_].clear();
+
+	vkUpdateDescriptorSets(
+
+		engine.device,
+		static_cast< uint32_t >(descriptorWrites.size()),
+		descriptorWrites.data(),
+		0,
+		nullptr
+
+	);
+	return true;
+
+}
+
+/*
+*	Function:		void bind(VkCommandBuffer commandBuffer_, uint32_t frame_)
+*	Purpose:		Binds the heap as set 0, it stays bound across every pipeline since all pipeline layouts start with it
+*
+*/
+void DescriptorHeap::bind(VkCommandBuffer commandBuffer_, uint32_t frame_) {
+
+	vkCmdBindDescriptorSets(
+
+		commandBuffer_,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		0,
+		1,
+		&descriptorSets[bindless ? 0 : frame_],
+		0,
+		nullptr
+
+	);
+
+}
+
+/*
+*	Function:		VkDescriptorSetLayout getSetLayout()
+*	Purpose:		Returns the layout every pipeline layout has to use for set 0
+*
+*/
+VkDescriptorSetLayout DescriptorHeap::getSetLayout(void) const {
+
+	return setLayout;
+
+}
+
+/*
+*	Function:		const VkSpecializationInfo* getSpecializationInfo()
+*	Purpose:		Returns the array sizes as specialization constants 0 to 2 for the shader stages of every pipeline
+*
+*/
+const VkSpecializationInfo* DescriptorHeap::getSpecializationInfo(void) const {
+
+	return &specializationInfo;
+
+}
+
+/*
+*	Function:		uint32_t getCapacity(DescriptorHeapArray array_)
+*	Purpose:		Returns the size of array_, including the default in slot 0
+*
+*/
+uint32_t DescriptorHeap::getCapacity(DescriptorHeapArray array_) const {
+
+	return capacities[array_];
+
+}
+
+/*
+*	Function:		bool isBindless()
+*	Purpose:		Returns whether the heap uses descriptor indexing
+*
+*/
+bool DescriptorHeap::isBindless(void) const {
+
+	return bindless;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the pool, the layouts and the default buffer, removals still in the deletion queue are ignored
+*
+*/
+void DescriptorHeap::destroy(void) {
+
+	descriptorSets.clear();
+	pendingWrites.clear();
+	for (uint32_t a = 0; a < DESCRIPTOR_HEAP_ARRAY_COUNT; a++) {
+
+		slots[a].clear();
+		freeSlots[a].clear();
+
+	}
+	descriptorPool.reset();
+	pipelineLayout.reset();
+	setLayout.reset();
+	defaultBuffer.reset();
+	defaultBufferMemory.reset();
+
+}
+
+/*
+*	Function:		~DescriptorHeap()
+*	Purpose:		Default destructor
+*
+*/
+DescriptorHeap::~DescriptorHeap() {
+
+
+
+}
+
+/*
+*	Function:		uint32_t add(DescriptorHeapArray array_, const Slot& slot_)
+*	Purpose:		Takes a free slot of array_ and points it at slot_, the default slot 0 if the array is full or has no room at all
+*
+*/
+uint32_t DescriptorHeap::add(DescriptorHeapArray array_, const Slot& slot_) {
+
+	if (freeSlots[array_].empty()) {
+
+		logger.log(ERROR_LOG, "Descriptor heap array " + std::to_string(array_) + " is full!");
+		return 0;
+
+	}
+
+	uint32_t index = freeSlots[array_].back();
+	freeSlots[array_].pop_back();
+	write(array_, index, slot_);
+	return index;
+
+}
+
+/*
+*	Function:		void write(DescriptorHeapArray array_, uint32_t index_, const Slot& slot_)
+*	Purpose:		Points a slot at slot_, right away when bindless and queued for every frame's set otherwise
+*
+*/
+void DescriptorHeap::write(DescriptorHeapArray array_, uint32_t index_, const Slot& slot_) {
+
+	slots[array_][index_] = slot_;
+	if (!bindless) {
+
+		for (auto& pending : pendingWrites) {
+
+			pending.push_back({ array_, index_ });
+
+		}
+		return;
+
+	}
+
+	VkWriteDescriptorSet descriptorWrite = getWrite(descriptorSets[0], array_, index_);
+	vkUpdateDescriptorSets(
+
+		engine.device,
+		1,
+		&descriptorWrite,
+		0,
+		nullptr
+
+	);
+
+}
+
+/*
+*	Function:		VkWriteDescriptorSet getWrite(VkDescriptorSet set_, DescriptorHeapArray array_, uint32_t index_)
+*	Purpose:		Returns the write of one slot's current content into set_, it points into the slots and is only valid until they change
+*
+*/
+VkWriteDescriptorSet DescriptorHeap::getWrite(VkDescriptorSet set_, DescriptorHeapArray array_, uint32_t index_) const {
+
+	VkWriteDescriptorSet descriptorWrite		= {};
+	descriptorWrite.sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet						= set_;
+	descriptorWrite.dstBinding					= array_;
+	descriptorWrite.dstArrayElement				= index_;
+	descriptorWrite.descriptorType				= DESCRIPTOR_TYPES[array_];
+	descriptorWrite.descriptorCount				= 1;
+	if (array_ == DESCRIPTOR_HEAP_STORAGE_BUFFERS) {
+
+		descriptorWrite.pBufferInfo				= &slots[array_][index_].buffer;
+
+	}
+	else {
+
+		descriptorWrite.pImageInfo				= &slots[array_][index_].image;
+
+	}
+	return descriptorWrite;
+
+}
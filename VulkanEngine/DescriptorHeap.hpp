@@ -0,0 +1,100 @@
+/*
+*	File:		DescriptorHeap.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "VulkanHandle.hpp"
+
+/*
+*	The descriptor arrays of the heap, also their binding numbers in set 0
+*/
+enum DescriptorHeapArray {
+
+	DESCRIPTOR_HEAP_TEXTURES			= 0,
+	DESCRIPTOR_HEAP_SAMPLERS			= 1,
+	DESCRIPTOR_HEAP_STORAGE_BUFFERS		= 2,
+	DESCRIPTOR_HEAP_ARRAY_COUNT			= 3
+
+};
+
+/*
+*	Index of nothing, e.g. a material without a texture
+*/
+static const uint32_t DESCRIPTOR_HEAP_NONE		= 0xffffffff;
+
+/*
+*	Class:			DescriptorHeap
+*	Purpose:		Global descriptor set 0 with arrays of textures, samplers and storage buffers, which materials refer to by index
+*					With VK_EXT_descriptor_indexing there is one set, partially bound and updated after bind, so it is bound once per command buffer and never rewritten for a new texture
+*					Without it the arrays fit next to the pipelines' own descriptors on every device, one set per frame in flight takes the writes once its frame is done and the frame is re-recorded
+*
+*/
+class DescriptorHeap {
+public:
+	DescriptorHeap(void);
+	void create(
+
+		bool							bindless_,
+		VkImageView						defaultImageView_,
+		VkSampler						defaultSampler_,
+		const VkPhysicalDeviceLimits&	limits_,
+		const uint32_t*					reserved_
+
+	);
+	uint32_t addTexture(VkImageView imageView_);
+	uint32_t addSampler(VkSampler sampler_);
+	uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo_);
+	void remove(DescriptorHeapArray array_, uint32_t index_);
+	bool update(uint32_t frame_);
+	void bind(VkCommandBuffer commandBuffer_, uint32_t frame_);
+	VkDescriptorSetLayout getSetLayout(void) const;
+	const VkSpecializationInfo* getSpecializationInfo(void) const;
+	uint32_t getCapacity(DescriptorHeapArray array_) const;
+	bool isBindless(void) const;
+	void destroy(void);
+	~DescriptorHeap();
+private:
+	struct Slot {
+
+		VkDescriptorImageInfo			image;
+		VkDescriptorBufferInfo			buffer;
+
+	};
+
+	struct PendingWrite {
+
+		DescriptorHeapArray				array;
+		uint32_t						index;
+
+	};
+
+	bool											bindless;
+	uint32_t										capacities[DESCRIPTOR_HEAP_ARRAY_COUNT];
+	std::vector< Slot >								slots[DESCRIPTOR_HEAP_ARRAY_COUNT];				// what every descriptor points at, slot 0 holds the defaults
+	std::vector< uint32_t >							freeSlots[DESCRIPTOR_HEAP_ARRAY_COUNT];
+	std::vector< std::vector< PendingWrite > >		pendingWrites;									// per frame in flight, only without descriptor indexing
+	UniqueDescriptorSetLayout						setLayout;
+	UniquePipelineLayout							pipelineLayout;								// set 0 only, compatible with every pipeline layout for binding set 0
+	UniqueDescriptorPool							descriptorPool;
+	std::vector< VkDescriptorSet >					descriptorSets;
+	UniqueBuffer									defaultBuffer;
+	UniqueDeviceMemory								defaultBufferMemory;
+	VkSpecializationMapEntry						specializationEntries[DESCRIPTOR_HEAP_ARRAY_COUNT];
+	VkSpecializationInfo							specializationInfo;
+
+	uint32_t add(DescriptorHeapArray array_, const Slot& slot_);
+	void write(DescriptorHeapArray array_, uint32_t index_, const Slot& slot_);
+	VkWriteDescriptorSet getWrite(VkDescriptorSet set_, DescriptorHeapArray array_, uint32_t index_) const;
+
+};
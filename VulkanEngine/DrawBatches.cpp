@@ -0,0 +1,461 @@
+/*
+*	File:		DrawBatches.cpp
+*
+*
+*/
+#include "DrawBatches.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+
+extern Engine engine;
+
+/*
+*	Instances and batches are allocated in multiples of these, the instance indices fill whole 4 KiB blocks, which keeps the draw commands behind them aligned
+*/
+static const size_t INSTANCE_GRANULARITY		= 1024;
+static const size_t BATCH_GRANULARITY			= 64;
+
+/*
+*	Function:		VkDeviceSize getCommandOffset(size_t instanceCapacity_)
+*	Purpose:		Returns where the draw commands start in a frame's buffer, behind the instance indices
+*
+*/
+static inline VkDeviceSize getCommandOffset(size_t instanceCapacity_) {
+
+	return sizeof(uint32_t) * instanceCapacity_;
+
+}
+
+/*
+*	Function:		DrawBatches()
+*	Purpose:		Default constructor
+*
+*/
+DrawBatches::DrawBatches(void) : multiDrawIndirect(false), batchGeneration(0), unsortedBinds(0) {
+
+
+
+}
+
+/*
+*	Function:		void init(bool multiDrawIndirect_)
+*	Purpose:		Creates the per-frame buffers, multiDrawIndirect_ tells whether the device can draw a whole run with one call
+*
+*/
+void DrawBatches::init(bool multiDrawIndirect_) {
+
+	multiDrawIndirect		= multiDrawIndirect_;
+
+	frames.resize(engine.MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < engine.MAX_FRAMES_IN_FLIGHT; i++) {
+
+		frames[i].mapped				= nullptr;
+		frames[i].instanceCapacity		= 0;
+		frames[i].batchCapacity			= 0;
+		reserve(i, INSTANCE_GRANULARITY, BATCH_GRANULARITY);
+
+	}
+
+}
+
+/*
+*	Function:		bool update(
+*
+*						uint32_t				frame_,
+*						const Scene&			scene_,
+*						uint64_t				sceneGeneration_,
+*						const RenderItem*		items_,
+*						size_t					itemCount_
+*
+*					)
+*	Purpose:		Writes the draws of frame_ for the sorted render queue items_, returns true if its buffer was reallocated and the descriptors pointing at it have to be rewritten
+*					Items of one batch keep their queue order, so the instances of a batch are drawn front to back
+*
+*/
+bool DrawBatches::update(
+
+	uint32_t				frame_,
+	const Scene&			scene_,
+	uint64_t				sceneGeneration_,
+	const RenderItem*		items_,
+	size_t					itemCount_
+
+) {
+
+	// batches only change with the scene structure, everything recorded depends on them
+	if (batchGeneration != sceneGeneration_) {
+
+		rebuildBatches(scene_);
+		batchGeneration = sceneGeneration_;
+
+	}
+
+	bool reallocated						= reserve(frame_, scene_.size(), drawTemplates.size());
+	FrameResources& frame					= frames[frame_];
+	uint32_t* instanceIndices				= reinterpret_cast< uint32_t* >(frame.mapped);
+	VkDrawIndexedIndirectCommand* commands	= reinterpret_cast< VkDrawIndexedIndirectCommand* >(frame.mapped + getCommandOffset(frame.instanceCapacity));
+
+	instanceCounts.assign(drawTemplates.size(), 0);
+	unsortedBinds							= 0;
+	for (size_t i = 0; i < itemCount_; i++) {
+
+		uint32_t entity						= items_[i].entity;
+		uint32_t batch						= entityBatches[entity];
+		if (batch == UINT32_MAX) {
+
+			continue;
+
+		}
+
+		instanceIndices[instanceBases[batch] + instanceCounts[batch]++] = entity;
+
+	}
+
+	for (const DrawBatchRun& run : runs) {
+
+		for (uint32_t b = run.firstBatch; b < run.firstBatch + run.batchCount; b++) {
+
+			VkDrawIndexedIndirectCommand command	= drawTemplates[b];
+			command.instanceCount					= instanceCounts[b];
+			commands[b]								= command;
+
+			// pipeline, descriptor set, vertex buffer and index buffer for every instance, as if each was drawn on its own
+			unsortedBinds							+= instanceCounts[b] * (run.mesh->indexCount > 0 ? 4 : 3);
+
+		}
+
+	}
+
+	return reallocated;
+
+}
+
+/*
+*	Function:		void recordDraws(
+*
+*						VkCommandBuffer			commandBuffer_,
+*						uint32_t				frame_,
+*						size_t					firstRun_,
+*						size_t					lastRun_,
+*						BindStats&				stats_
+*
+*					)
+*	Purpose:		Records one indirect draw per run from firstRun_ to lastRun_, or one per batch if the device can only draw one command at a time
+*					The binds and draws it records are added to stats_
+*
+*/
+void DrawBatches::recordDraws(
+
+	VkCommandBuffer			commandBuffer_,
+	uint32_t				frame_,
+	size_t					firstRun_,
+	size_t					lastRun_,
+	BindStats&				stats_
+
+) {
+
+	const FrameResources& frame		= frames[frame_];
+	VkDeviceSize commandOffset		= getCommandOffset(frame.instanceCapacity);
+	uint32_t stride					= sizeof(VkDrawIndexedIndirectCommand);
+	Pipeline* boundPipeline			= nullptr;
+	VkBuffer vertexBuffer			= engine.geometryPool.getVertexBuffer();
+	VkDeviceSize offsets[]			= { 0 };
+
+	// every mesh lives in the geometry pool, the draws only differ in their offsets into it
+	if (firstRun_ < lastRun_ && vertexBuffer != VK_NULL_HANDLE) {
+
+		vkCmdBindVertexBuffers(commandBuffer_, 0, 1, &vertexBuffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer_, engine.geometryPool.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		stats_.vertexBuffers++;
+		stats_.indexBuffers++;
+
+	}
+
+	for (size_t r = firstRun_; r < lastRun_; r++) {
+
+		const DrawBatchRun& run		= runs[r];
+		bool indexed				= run.mesh->indexCount > 0;
+		VkDeviceSize drawOffset		= commandOffset + stride * run.firstBatch;
+
+		if (run.pipeline != boundPipeline) {
+
+			boundPipeline = run.pipeline;
+			boundPipeline->bind(commandBuffer_, &boundPipeline->descriptorSets[frame_]);
+			stats_.pipelines++;
+			stats_.descriptorSets++;
+
+		}
+
+		// batches without visible instances stay in the run, with no instances they cost next to nothing
+		uint32_t drawCount			= multiDrawIndirect ? run.batchCount : 1;
+		for (uint32_t b = 0; b < run.batchCount; b += drawCount) {
+
+			if (indexed) {
+
+				vkCmdDrawIndexedIndirect(commandBuffer_, frame.buffer, drawOffset + stride * b, drawCount, stride);
+
+			}
+			else {
+
+				vkCmdDrawIndirect(commandBuffer_, frame.buffer, drawOffset + stride * b, drawCount, stride);
+
+			}
+			stats_.draws++;
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		size_t getRunCount()
+*	Purpose:		Returns the number of draw runs, which is what recording has to be split over
+*
+*/
+size_t DrawBatches::getRunCount(void) const {
+
+	return runs.size();
+
+}
+
+/*
+*	Function:		uint32_t getUnsortedBinds()
+*	Purpose:		Returns the binds the last update's visible entities would take if every one of them was drawn with all of its state
+*
+*/
+uint32_t DrawBatches::getUnsortedBinds(void) const {
+
+	return unsortedBinds;
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getInstanceIndexBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the range holding the entity index of every drawn instance of frame_, the vertex shaders read it with gl_InstanceIndex
+*
+*/
+VkDescriptorBufferInfo DrawBatches::getInstanceIndexBufferInfo(uint32_t frame_) const {
+
+	const FrameResources& frame		= frames[frame_];
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frame.buffer;
+	bufferInfo.offset					= 0;
+	bufferInfo.range					= sizeof(uint32_t) * frame.instanceCapacity;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires all buffers
+*
+*/
+void DrawBatches::destroy(void) {
+
+	for (auto& frame : frames) {
+
+		if (frame.mapped != nullptr) {
+
+			vkUnmapMemory(engine.device, frame.memory);
+
+		}
+		frame.buffer.reset();
+		frame.memory.reset();
+
+	}
+	frames.clear();
+
+}
+
+/*
+*	Function:		~DrawBatches()
+*	Purpose:		Default destructor
+*
+*/
+DrawBatches::~DrawBatches() {
+
+
+
+}
+
+/*
+*	Function:		void rebuildBatches(const Scene& scene_)
+*	Purpose:		Groups the entities into batches of the same material and mesh and lays out their draws and instance ranges
+*
+*/
+void DrawBatches::rebuildBatches(const Scene& scene_) {
+
+	struct Batch {
+
+		Pipeline*			pipeline;
+		const MeshInfo*		mesh;
+		uint32_t			instanceCount;
+
+	};
+
+	size_t entityCount							= scene_.size();
+	const ObjectHandle* meshes					= scene_.getMeshes();
+	const MaterialHandle* materials				= scene_.getMaterials();
+	std::unordered_map< uint64_t, uint32_t >	batchIndices;
+	std::vector< Batch >						batches;
+
+	entityBatches.assign(entityCount, UINT32_MAX);
+	for (size_t i = 0; i < entityCount; i++) {
+
+		Object* mesh			= engine.getObject(meshes[i]);
+		Pipeline* material		= engine.getMaterial(materials[i]);
+		if (mesh == nullptr || material == nullptr) {
+
+			continue;
+
+		}
+
+		uint64_t key			= (static_cast< uint64_t >(materials[i].index) << 32) | meshes[i].index;
+		auto inserted			= batchIndices.emplace(key, static_cast< uint32_t >(batches.size()));
+		if (inserted.second) {
+
+			batches.push_back({ material, &mesh->getMeshInfo(), 0 });
+
+		}
+		entityBatches[i]		= inserted.first->second;
+		batches[inserted.first->second].instanceCount++;
+
+	}
+
+	// all meshes share the geometry pool buffers, so batches of one pipeline form one indexed and one non-indexed run
+	std::vector< uint32_t > order(batches.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&batches] (uint32_t a_, uint32_t b_) {
+
+		const Batch& a = batches[a_];
+		const Batch& b = batches[b_];
+		if (a.pipeline != b.pipeline) {
+
+			return std::less< Pipeline* >()(a.pipeline, b.pipeline);
+
+		}
+		return (a.mesh->indexCount > 0) < (b.mesh->indexCount > 0);
+
+	});
+
+	std::vector< uint32_t > remap(batches.size());
+	drawTemplates.clear();
+	instanceBases.clear();
+	runs.clear();
+	uint32_t instanceBase = 0;
+	for (uint32_t b = 0; b < order.size(); b++) {
+
+		const Batch& batch		= batches[order[b]];
+		bool indexed			= batch.mesh->indexCount > 0;
+		remap[order[b]]			= b;
+
+		if (runs.empty()
+			|| runs.back().pipeline != batch.pipeline
+			|| (runs.back().mesh->indexCount > 0) != indexed) {
+
+			runs.push_back({ batch.pipeline, batch.mesh, b, 0 });
+
+		}
+		runs.back().batchCount++;
+
+		// meshes without indices read the first four words as a VkDrawIndirectCommand, so vertexOffset holds the first instance there
+		VkDrawIndexedIndirectCommand command	= {};
+		command.indexCount						= indexed ? batch.mesh->indexCount : batch.mesh->vertexCount;
+		command.instanceCount					= 0;
+		command.firstIndex						= indexed ? batch.mesh->firstIndex : batch.mesh->firstVertex;
+		command.vertexOffset					= indexed ? static_cast< int32_t >(batch.mesh->firstVertex) : static_cast< int32_t >(instanceBase);
+		command.firstInstance					= indexed ? instanceBase : 0;
+		drawTemplates.push_back(command);
+		instanceBases.push_back(instanceBase);
+
+		instanceBase			+= batch.instanceCount;
+
+	}
+
+	for (auto& batch : entityBatches) {
+
+		if (batch != UINT32_MAX) {
+
+			batch = remap[batch];
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		bool reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_)
+*	Purpose:		Grows the buffer of frame_ to hold at least instanceCount_ instances and batchCount_ draws, returns true if it was reallocated
+*
+*/
+bool DrawBatches::reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_) {
+
+	FrameResources& frame		= frames[frame_];
+	if (instanceCount_ <= frame.instanceCapacity && batchCount_ <= frame.batchCapacity) {
+
+		return false;
+
+	}
+
+	size_t instanceCapacity		= frame.instanceCapacity;
+	if (instanceCount_ > instanceCapacity) {
+
+		instanceCapacity		= std::max(instanceCount_, instanceCapacity * 2);
+		instanceCapacity		= (instanceCapacity + INSTANCE_GRANULARITY - 1) / INSTANCE_GRANULARITY * INSTANCE_GRANULARITY;
+
+	}
+
+	size_t batchCapacity		= frame.batchCapacity;
+	if (batchCount_ > batchCapacity) {
+
+		batchCapacity			= std::max(batchCount_, batchCapacity * 2);
+		batchCapacity			= (batchCapacity + BATCH_GRANULARITY - 1) / BATCH_GRANULARITY * BATCH_GRANULARITY;
+
+	}
+
+	VkDeviceSize bufferSize		= getCommandOffset(instanceCapacity) + sizeof(VkDrawIndexedIndirectCommand) * batchCapacity;
+
+	// retired, the frames still in flight keep drawing from the old buffer
+	frame.buffer.reset();
+	frame.memory.reset();
+
+	engine.createBuffer(
+
+		bufferSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame.buffer.replace(engine.device),
+		frame.memory.replace(engine.device)
+
+	);
+
+	void* data;
+	vkMapMemory(
+
+		engine.device,
+		frame.memory,
+		0,
+		bufferSize,
+		0,
+		&data
+
+	);
+	frame.mapped				= static_cast< uint8_t* >(data);
+
+	// a new buffer holds no draws until the next update, the recorded commands pointing at it are stale anyway
+	memset(frame.mapped + getCommandOffset(instanceCapacity), 0, sizeof(VkDrawIndexedIndirectCommand) * batchCapacity);
+
+	frame.instanceCapacity		= instanceCapacity;
+	frame.batchCapacity			= batchCapacity;
+
+	return true;
+
+}
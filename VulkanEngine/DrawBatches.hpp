@@ -0,0 +1,98 @@
+/*
+*	File:		DrawBatches.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Object.hpp"
+#include "RenderQueue.hpp"
+#include "VulkanHandle.hpp"
+
+class Pipeline;
+class Scene;
+struct BindStats;
+
+/*
+*	Consecutive batches that share a pipeline and are all indexed or all not, drawn by one indirect call out of the geometry pool
+*/
+struct DrawBatchRun {
+
+	Pipeline*			pipeline;
+	const MeshInfo*		mesh;
+	uint32_t			firstBatch;
+	uint32_t			batchCount;
+
+};
+
+/*
+*	Class:			DrawBatches
+*	Purpose:		Indirect submission for the CPU culling path: entities are grouped into batches by material and mesh, the same way GpuCulling does
+*					Every frame the CPU writes the instance count of each batch and the entity index of each visible instance, in render queue order
+*					Recording only depends on the batches, so what is visible and how it is ordered by depth never invalidate the command buffers
+*
+*/
+class DrawBatches {
+public:
+	DrawBatches(void);
+	void init(bool multiDrawIndirect_);
+	bool update(
+
+		uint32_t				frame_,
+		const Scene&			scene_,
+		uint64_t				sceneGeneration_,
+		const RenderItem*		items_,
+		size_t					itemCount_
+
+	);
+	void recordDraws(
+
+		VkCommandBuffer			commandBuffer_,
+		uint32_t				frame_,
+		size_t					firstRun_,
+		size_t					lastRun_,
+		BindStats&				stats_
+
+	);
+	size_t getRunCount(void) const;
+	uint32_t getUnsortedBinds(void) const;
+	VkDescriptorBufferInfo getInstanceIndexBufferInfo(uint32_t frame_) const;
+	void destroy(void);
+	~DrawBatches();
+private:
+	/*
+	*	Per-frame buffer written by the CPU, the instance indices first and the draw commands behind them
+	*/
+	struct FrameResources {
+
+		UniqueBuffer			buffer;
+		UniqueDeviceMemory		memory;
+		uint8_t*				mapped;
+		size_t					instanceCapacity;
+		size_t					batchCapacity;
+
+	};
+
+	bool										multiDrawIndirect;
+	std::vector< FrameResources >				frames;
+	std::vector< uint32_t >						entityBatches;
+	std::vector< VkDrawIndexedIndirectCommand >	drawTemplates;
+	std::vector< uint32_t >						instanceBases;
+	std::vector< uint32_t >						instanceCounts;
+	std::vector< DrawBatchRun >					runs;
+	uint64_t									batchGeneration;
+	uint32_t									unsortedBinds;
+
+	void rebuildBatches(const Scene& scene_);
+	bool reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_);
+
+};
@@ -7,6 +7,7 @@
 #include "Engine.hpp"
 #include <stb_image.h>
 #include <tiny_obj_loader.h>
+#include <random>
 #include "CubeVertex.cpp"
 
 /*
@@ -16,6 +17,10 @@
 */
 void Engine::run() {
 
+	// the start window loop occupies a worker for the whole loading phase, so always keep at least one besides the main thread
+	numThreads				= getNumThreads();
+	jobSystem.init(std::max(numThreads, 2u));
+
 	logger.log(EVENT_LOG, "Initializing GLFW-window...");
 	initWindow();
 	engine.loadingProgress += 0.1f;
@@ -41,14 +46,14 @@ void Engine::initStartWindow(void) {
 
 	startWindow = new StartWindow();
 
-	logger.log(EVENT_LOG, "Starting thread...");
-	std::thread t0([=] () {
+	// the splash loop blocks until loading is done, as a job it would hold a worker and could be picked up by the main thread while it waits
+	logger.log(EVENT_LOG, "Starting start window thread...");
+	startWindowThread = std::thread([=] () {
 
 		startWindow->loop();
-		logger.log(EVENT_LOG, "Stopping thread...");
+		logger.log(EVENT_LOG, "Stopping start window thread...");
 
 	});
-	t0.detach();
 
 }
 
@@ -145,7 +150,11 @@ void Engine::initWindow() {
 	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
 	glfwSetCursorPosCallback(window, mouseCallback);
 	glfwSetScrollCallback(window, scrollCallback);
+	glfwSetMouseButtonCallback(window, mouseButtonCallback);
 	glfwSetKeyCallback(window, keyboardInputCallback);
+	glfwSetWindowFocusCallback(window, windowFocusCallback);
+	glfwSetWindowIconifyCallback(window, windowIconifyCallback);
+	glfwSetWindowRefreshCallback(window, windowRefreshCallback);
 
 	glfwSetInputMode(
 	
@@ -187,9 +196,26 @@ void Engine::initWindow() {
 */
 void Engine::initVulkan() {
 
-	numThreads = getNumThreads();
+	numRecordingThreads		= jobSystem.getNumWorkers();
+
+	// parse the model files on the workers while the device is being set up
+	jobSystem.run([=] () {
+
+		loadedChalet = new Model(CHALET_PATH, true);
+
+	}, &loadingCounter);
 
 	std::cout << green << "std::thread::hardware_concurrency()" << white << ":		" << yellow << numThreads << white << std::endl;
+	std::cout << green << "SimdMath::getPath()" << white << ":				" << yellow << SimdMath::getPathName(SimdMath::getPath()) << white << std::endl;
+#if defined GAME_BENCHMARK_SIMD
+	SimdMath::benchmark();
+#endif
+#if defined GAME_BENCHMARK_OCCLUSION
+	SoftwareOcclusion::benchmark(jobSystem);
+#endif
+#if defined GAME_BENCHMARK_LIGHTING
+	ClusteredLighting::benchmark(jobSystem);
+#endif
 	
 	createCamera();
 
@@ -204,18 +230,39 @@ void Engine::initVulkan() {
 	createSurface();
 	pickPhysicalDevice();
 	createLogicalDevice();
+#if defined GAME_PRESENT_PROFILE_LOW_LATENCY
+	presentProfile			= PRESENT_PROFILE_LOW_LATENCY;
+#endif
+	framesInFlight			= getFramesInFlight(presentProfile);
 	createSwapChain();
 	createImageViews();
+	if (deferredShading) {
+
+		gBuffer.init(physicalDevice, findDepthFormat());
+
+	}
 	createRenderPass();
 	createDescriptorSetLayout();
 	createDescriptorPool();
 	createCommandPool();
+	if (occlusionCulling) {
+
+		depthPyramid.init(msaaSamples);
+
+	}
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	fillRateQueries.init(MAX_FRAMES_IN_FLIGHT, deviceProperties.limits.timestampComputeAndGraphics == VK_TRUE, deviceProperties.limits.timestampPeriod, pipelineStatisticsEnabled);
 	createColorResources();
 	createDepthResources();
 	createFramebuffers();
 	createTextureImage();
 	createTextureImageView();
 	createTextureSampler(); 
+	// the object pipeline binds the material table and the three light buffers to the fragment stage next to the heap
+	const uint32_t heapReserved[DESCRIPTOR_HEAP_ARRAY_COUNT]	= { 0, 0, 4 };
+	descriptorHeap.create(descriptorIndexingEnabled, textureImageView, textureSampler, deviceProperties.limits, heapReserved);
 
 	engine.loadingProgress += 0.1f;
 	//std::this_thread::sleep_for(std::chrono::seconds(5));		// JUST TO SHOW LOADING SCREEN A LITTLE BIT LONGER!!!
@@ -223,10 +270,25 @@ void Engine::initVulkan() {
 	engine.loadingProgress += 0.1f;
 
 	createUniformBuffers();
+	if (gpuDrivenRendering) {
+
+		gpuCulling.init(drawIndirectCountEnabled, multiDrawIndirectEnabled, occlusionCulling ? &depthPyramid : nullptr);
+
+	}
+	else if (indirectBatching) {
+
+		drawBatches.init(multiDrawIndirectEnabled);
+
+	}
+	createEntityBuffers();
+	createMaterialTable();
+	createLights();
 	createPipelines();
+	objectMaterial			= addMaterial(&objectPipeline);
+	lightingMaterial		= addMaterial(&lightingPipeline);
+	createFrameCommandPools();
 	loadModels();
 	createDescriptorSets();
-	recordCommandBuffers();
 	createSyncObjects();
 
 	glfwShowWindow(window); 
@@ -236,8 +298,21 @@ void Engine::initVulkan() {
 	startWindow->closeVar = true;
 	engine.closeStartWindow.unlock();
 
+	startWindowThread.join();
 	delete startWindow;
 
+	// wakes the main loop out of glfwWaitEventsTimeout when an animation or camera movement needs a new frame
+	simulation.setChangeCallback([this] () {
+
+		if (renderOnDemand) {
+
+			glfwPostEmptyEvent();
+
+		}
+
+	});
+	simulation.start(&camera);
+
 }
 
 /*
@@ -352,7 +427,7 @@ void Engine::mainLoop() {
 	float	nbFrames		= 0;
 	float	maxfps			= 0;
 
-	std::thread t0([=]() {
+	jobSystem.run([=] () {
 
 		bgmusic = audioEngine->play2D(
 			
@@ -369,51 +444,182 @@ void Engine::mainLoop() {
 		
 		}
 
-	});
-	t0.detach();
+	}, &audioCounter);
+
+#if defined GAME_USE_FRAMERATE_CAP_60
+	setTargetFrameRate(maxFPS);
+#endif
+#if defined GAME_RENDER_ON_DEMAND
+	setRenderOnDemand(true);
+#endif
 
 	while (!glfwWindowShouldClose(window)) {
 
+		if (windowIconified) {
+
+			// nothing is visible, sleep until the window is restored
+			glfwWaitEvents();
+			continue;
+
+		}
+		if (renderOnDemand && !needsRedraw()) {
+
+			glfwWaitEventsTimeout(idleTimeout);
+			continue;
+
+		}
+
+		framePacer.waitForNextFrame();
+
 		double currentTime		= glfwGetTime();
 		double deltaTime		= currentTime - pastTime;
 		DELTATIME				= deltaTime;
-#if defined GAME_USE_FRAMERATE_CAP_60
-		if (deltaTime >= maxPeriod) {
-#endif
-			pastTime = currentTime;
+		pastTime = currentTime;
+
+		nbFrames++;
+		float seconds = 10.0f;
 
-			nbFrames++;
-			float seconds = 10.0f;
+		if (currentTime - lastTime >= 1.0 && nbFrames > maxfps) {
 
-			if (currentTime - lastTime >= 1.0 && nbFrames > maxfps) {
+			maxfps = nbFrames;
+
+		}
+
+		if (currentTime - lastTime >= seconds) {
+
+			std::string fps = "Average FPS (last " + std::to_string(seconds) + " seconds):	%f\t";
+			std::string frametime = "Average Frametime (last " + std::to_string(seconds) + " seconds):	%f ms\t";
+			std::string maxFPS = "Max FPS:	%f\t";
+			std::string fenceWait = "Average GPU wait (" + std::to_string(framesInFlight) + " frames in flight):	%f ms\n";
+
+			printf(fps.c_str(), double(nbFrames / seconds));
+			printf(frametime.c_str(), double((1000.0 * seconds) / nbFrames));
+			printf(maxFPS.c_str(), double(maxfps / seconds));
+			printf(fenceWait.c_str(), double((1000.0 * fenceWaitTime) / nbFrames));
+			if (presentIntervalCount > 0) {
+
+				double meanInterval		= presentIntervalSum / presentIntervalCount;
+				double variance			= std::max(presentIntervalSquareSum / presentIntervalCount - meanInterval * meanInterval, 0.0);
+				printf(
+					
+					"Present-to-present (%s):	mean %f ms, jitter %f ms, max %f ms\n",
+					presentProfile == PRESENT_PROFILE_LOW_LATENCY ? "low latency" : "high throughput",
+					1000.0 * meanInterval,
+					1000.0 * std::sqrt(variance),
+					1000.0 * presentIntervalMax
+				
+				);
 
-				maxfps = nbFrames;
+			}
+			presentIntervalSum			= 0.0;
+			presentIntervalSquareSum	= 0.0;
+			presentIntervalMax			= 0.0;
+			presentIntervalCount		= 0;
+			if (framePacer.getTargetRate() > 0.0) {
+
+				FramePacerStats pacing = framePacer.getStats();
+				printf(
+					
+					"Pacing (%.1f FPS target):	predicted work %f ms, sleep %f ms, spin %f ms, overshoot %f ms, missed %llu (avg %f ms late)\n",
+					framePacer.getTargetRate(),
+					1000.0 * pacing.predictedWorkTime,
+					1000.0 * pacing.averageSleepTime,
+					1000.0 * pacing.averageSpinTime,
+					1000.0 * pacing.sleepOvershoot,
+					static_cast< unsigned long long >(pacing.missedDeadlines),
+					1000.0 * pacing.averageLateness
+				
+				);
 
 			}
+			framePacer.resetStats();
+			printf(
+				
+				"Culling (%s):	drawn %f, culled %f entities per frame\n",
+				gpuDrivenRendering ? "GPU" : SimdMath::getPathName(SimdMath::getPath()),
+				double(drawnSum) / nbFrames,
+				double(culledSum) / nbFrames
+			
+			);
+			if (softwareOcclusionCulling) {
 
-			if (currentTime - lastTime >= seconds) {
+				SoftwareOcclusionStats occlusion = softwareOcclusion.getStats();
+				printf(
 
-				std::string fps = "Average FPS (last " + std::to_string(seconds) + " seconds):	%f\t";
-				std::string frametime = "Average Frametime (last " + std::to_string(seconds) + " seconds):	%f ms\t";
-				std::string maxFPS = "Max FPS:	%f\n";
+					"Software occlusion (%s):	%f occluder triangles in %f ms, %f of %f entities occluded in %f ms per frame\n",
+					SimdMath::getPathName(SimdMath::getPath()),
+					occlusion.averageTriangles,
+					1000.0 * occlusion.averageRasterTime,
+					occlusion.averageOccluded,
+					occlusion.averageTested,
+					1000.0 * occlusion.averageTestTime
 
-				printf(fps.c_str(), double(nbFrames / seconds));
-				printf(frametime.c_str(), double((1000.0 * seconds) / nbFrames));
-				printf(maxFPS.c_str(), double(maxfps / seconds));
-				nbFrames = 0;
-				lastTime += seconds;
+				);
+				softwareOcclusion.resetStats();
 
 			}
+			ClusteredLightingStats lighting = clusteredLighting.getStats();
+			printf(
+
+				"Lighting (%s):	%f lights, %f light indices, at most %f lights per cluster, assigned in %f ms per frame\n",
+				SimdMath::getPathName(SimdMath::getPath()),
+				lighting.averageLights,
+				lighting.averageIndices,
+				lighting.averageMaxPerCluster,
+				1000.0 * lighting.averageAssignTime
+
+			);
+			clusteredLighting.resetStats();
+			FillRateStats fillRate = fillRateQueries.getStats();
+			if (fillRate.frames > 0) {
+
+				// forward counts every fragment that reached the shader, MSAA sample shading included, deferred the G-buffer writes plus one lighting invocation per pixel
+				printf(
+
+					"Fill rate (%s):	%f fragment shader invocations, %f per pixel, %f ms on the GPU per frame\n",
+					deferredShading ? "deferred" : "forward",
+					fillRate.averageFragments,
+					fillRate.averageFragments / (static_cast< double >(swapChainExtent.width) * swapChainExtent.height),
+					1000.0 * fillRate.averageGpuTime
+
+				);
 
-			glfwPollEvents();
-			queryKeyboardGLFW();
-			renderFrame();
-#if defined GAME_USE_FRAMERATE_CAP_60
 			}
-#endif
+			fillRateQueries.resetStats();
+			if (!gpuDrivenRendering) {
+
+				BindStats binds = getBindStats();
+				printf(
+
+					"Binds (last recording):	%u draws, %u pipelines, %u descriptor sets, %u vertex buffers, %u index buffers, %u binds if every draw bound all of its state\n",
+					binds.draws,
+					binds.pipelines,
+					binds.descriptorSets,
+					binds.vertexBuffers,
+					binds.indexBuffers,
+					binds.unsortedBinds
+
+				);
+
+			}
+			drawnSum = 0;
+			culledSum = 0;
+			nbFrames = 0;
+			fenceWaitTime = 0.0;
+			lastTime += seconds;
+
+		}
+
+		glfwPollEvents();
+		queryKeyboardGLFW();
+		lastRenderTime = Simulation::now();
+		renderFrame();
+
+		framePacer.endFrame();
 
 	}
 
+	simulation.stop();
 	vkDeviceWaitIdle(device);
 
 }
@@ -426,7 +632,12 @@ void Engine::mainLoop() {
 void Engine::cleanup() {
 
 	//effect->drop();
-	bgmusic->drop();
+	jobSystem.wait(&audioCounter);
+	if (bgmusic) {
+
+		bgmusic->drop();
+
+	}
 	audioEngine->drop();
 
 	cleanupSwapChain();
@@ -478,12 +689,36 @@ void Engine::cleanup() {
 
 	);*/
 
+	scene.clear();
 	for (auto& obj : objects) {
 	
 		obj->destroy();
-		obj.reset();
 	
 	}
+	objects.clear();
+
+	for (size_t i = 0; i < entityBuffers.size(); i++) {
+
+		if (entityBuffersMapped[i] != nullptr) {
+
+			vkUnmapMemory(device, entityBuffersMemory[i]);
+
+		}
+		entityBuffers[i].reset();
+		entityBuffersMemory[i].reset();
+
+	}
+	gpuCulling.destroy();
+	drawBatches.destroy();
+	depthPyramid.destroy();
+	geometryPool.destroy();
+	materialTable.destroy();
+	clusteredLighting.destroy();
+	fillRateQueries.destroy();
+	descriptorHeap.destroy();
+
+	// the device is idle by now, everything retired can go before the pools it came from
+	deletionQueue.flush();
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
@@ -501,12 +736,29 @@ void Engine::cleanup() {
 			nullptr
 		
 		);
-		vkDestroyFence(
-			
+
+	}
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		for (auto& pool : threadCommandPools[i]) {
+
+			vkDestroyCommandPool(
+
+				device,
+				pool,
+				nullptr
+
+			);
+
+		}
+
+		vkDestroyCommandPool(
+
 			device,
-			inFlightFences[i],
+			frameCommandPools[i],
 			nullptr
-		
+
 		);
 
 	}
@@ -519,6 +771,8 @@ void Engine::cleanup() {
 	
 	);
 
+	graphicsTimeline.destroy();
+
 	vkDestroyDevice(device,	nullptr);
 
 	if (enableValidationLayers) {
@@ -547,6 +801,8 @@ void Engine::cleanup() {
 
 	glfwTerminate();
 
+	jobSystem.shutdown();
+
 }
 
 /*
@@ -608,6 +864,25 @@ std::vector< const char* > Engine::getRequiredExtensions() {
 
 	}
 
+#if defined VK_KHR_get_physical_device_properties2
+	// needed to query the timeline semaphore and descriptor indexing features on a 1.0 instance
+	uint32_t instanceExtensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, nullptr);
+	std::vector< VkExtensionProperties > instanceExtensions(instanceExtensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, instanceExtensions.data());
+
+	for (const auto& extension : instanceExtensions) {
+
+		if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+
+			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			physicalDeviceProperties2Enabled = true;
+
+		}
+
+	}
+#endif
+
 	return extensions;
 
 }
@@ -814,13 +1089,132 @@ void Engine::createLogicalDevice() {
 	deviceFeatures.samplerAnisotropy		= VK_TRUE;
 	deviceFeatures.sampleRateShading		= VK_TRUE;
 
+	std::vector< const char* > enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
 	VkDeviceCreateInfo createInfo			= {};
 	createInfo.sType						= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.pQueueCreateInfos			= queueCreateInfos.data();
 	createInfo.queueCreateInfoCount			= static_cast< uint32_t >(queueCreateInfos.size());
 	createInfo.pEnabledFeatures				= &deviceFeatures;
-	createInfo.enabledExtensionCount		= static_cast< uint32_t >(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames		= deviceExtensions.data();
+
+#if defined VK_KHR_timeline_semaphore
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures		= {};
+	timelineFeatures.sType												= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore									= VK_TRUE;
+
+	timelineSemaphoreEnabled = checkTimelineSemaphoreSupport(physicalDevice);
+	if (timelineSemaphoreEnabled) {
+
+		enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		createInfo.pNext					= &timelineFeatures;
+
+	}
+#endif
+
+	// materials pick their textures by index from the heap arrays, the fallback shader only ever uses constant indices
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing	= supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+	deviceFeatures.shaderStorageBufferArrayDynamicIndexing	= supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+
+#if defined GAME_BINDLESS_DESCRIPTORS && defined VK_EXT_descriptor_indexing
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures		= {};
+	descriptorIndexingFeatures.sType												= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	descriptorIndexingFeatures.descriptorBindingPartiallyBound						= VK_TRUE;
+	descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind		= VK_TRUE;
+	descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind		= VK_TRUE;
+	descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing			= VK_TRUE;
+
+	descriptorIndexingEnabled = checkDescriptorIndexingSupport(physicalDevice);
+	if (descriptorIndexingEnabled) {
+
+		enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		descriptorIndexingFeatures.pNext		= const_cast< void* >(createInfo.pNext);
+		createInfo.pNext						= &descriptorIndexingFeatures;
+
+	}
+	else {
+
+		logger.log(EVENT_LOG, "VK_EXT_descriptor_indexing is not supported, using the fixed size descriptor heap");
+
+	}
+#endif
+
+#if defined GAME_GPU_DRIVEN_RENDERING
+	// the indirect draws find their instances through firstInstance, multi draw and draw count are optional
+	gpuDrivenRendering = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+	if (gpuDrivenRendering) {
+
+		deviceFeatures.drawIndirectFirstInstance	= VK_TRUE;
+		deviceFeatures.multiDrawIndirect			= supportedFeatures.multiDrawIndirect;
+		multiDrawIndirectEnabled					= supportedFeatures.multiDrawIndirect == VK_TRUE;
+	#if defined VK_KHR_draw_indirect_count
+		drawIndirectCountEnabled					= isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (drawIndirectCountEnabled) {
+
+			enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+		}
+	#endif
+
+	}
+	else {
+
+		logger.log(EVENT_LOG, "drawIndirectFirstInstance is not supported, culling on the CPU");
+
+	}
+#endif
+
+	// culling on the CPU still draws its batches indirectly if it can, what is visible then only changes the contents of the draw buffers
+	indirectBatching = !gpuDrivenRendering && supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+	if (indirectBatching) {
+
+		deviceFeatures.drawIndirectFirstInstance	= VK_TRUE;
+		deviceFeatures.multiDrawIndirect			= supportedFeatures.multiDrawIndirect;
+		multiDrawIndirectEnabled					= supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+	}
+
+#if defined GAME_OCCLUSION_CULLING
+	// the culling pass reads the depth buffer through a depth pyramid, so it has to be sampled
+	VkFormatProperties depthFormatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, findDepthFormat(), &depthFormatProperties);
+
+	occlusionCulling = gpuDrivenRendering && (depthFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	if (!occlusionCulling) {
+
+		logger.log(EVENT_LOG, "Occlusion culling needs GPU-driven rendering and a sampled depth buffer, culling against the view frustum only");
+
+	}
+#endif
+
+#if defined GAME_SOFTWARE_OCCLUSION_CULLING
+	// the GPU-driven path culls on the GPU, the software buffer only serves the CPU recording
+	softwareOcclusionCulling = !gpuDrivenRendering;
+#endif
+
+#if defined GAME_DEFERRED_SHADING
+	// the G-buffer is single sampled and never leaves the render pass, the occlusion pass needs the depth buffer after it
+	deferredShading = true;
+	msaaSamples		= VK_SAMPLE_COUNT_1_BIT;
+	if (occlusionCulling) {
+
+		occlusionCulling = false;
+		logger.log(EVENT_LOG, "The deferred path keeps its depth buffer transient, culling against the view frustum only");
+
+	}
+#endif
+
+	// fill rate is counted in fragment shader invocations, the secondary command buffers run inside that query and have to inherit it
+	VkPhysicalDeviceFeatures queryFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &queryFeatures);
+	pipelineStatisticsEnabled				= queryFeatures.pipelineStatisticsQuery == VK_TRUE && queryFeatures.inheritedQueries == VK_TRUE;
+	deviceFeatures.pipelineStatisticsQuery	= pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+	deviceFeatures.inheritedQueries			= pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+
+	createInfo.enabledExtensionCount		= static_cast< uint32_t >(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames		= enabledExtensions.data();
 
 	if (enableValidationLayers) {
 	
@@ -865,6 +1259,26 @@ void Engine::createLogicalDevice() {
 	
 	);
 
+	graphicsTimeline.init(device, timelineSemaphoreEnabled);
+	logger.log(EVENT_LOG, graphicsTimeline.usesTimelineSemaphore() ? "GPU progress tracked with a timeline semaphore" : "GPU progress tracked with fences");
+
+	if (gpuDrivenRendering) {
+
+		logger.log(EVENT_LOG, drawIndirectCountEnabled ? "GPU-driven rendering with draw indirect count" : multiDrawIndirectEnabled ? "GPU-driven rendering with multi draw indirect" : "GPU-driven rendering with one indirect draw per batch");
+
+	}
+	else {
+
+		logger.log(EVENT_LOG, !indirectBatching ? "CPU culling with one draw per entity" : multiDrawIndirectEnabled ? "CPU culling with multi draw indirect" : "CPU culling with one indirect draw per batch");
+
+	}
+
+	if (occlusionCulling) {
+
+		logger.log(EVENT_LOG, "Hierarchical-Z occlusion culling enabled");
+
+	}
+
 }
 
 /*
@@ -994,6 +1408,124 @@ bool Engine::checkDeviceExtensionSupport(VkPhysicalDevice device_) {
 
 }
 
+/*
+*	Function:		bool isDeviceExtensionSupported(VkPhysicalDevice device_, const char* extensionName_)
+*	Purpose:		Checks for a single optional device extension
+*
+*/
+bool Engine::isDeviceExtensionSupported(VkPhysicalDevice device_, const char* extensionName_) {
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(
+		
+		device_,
+		nullptr,
+		&extensionCount,
+		nullptr
+	
+	);
+
+	std::vector< VkExtensionProperties > availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(
+		
+		device_,
+		nullptr,
+		&extensionCount,
+		availableExtensions.data()
+	
+	);
+
+	for (const auto& extension : availableExtensions) {
+	
+		if (strcmp(extension.extensionName, extensionName_) == 0) {
+
+			return true;
+
+		}
+	
+	}
+
+	return false;
+
+}
+
+/*
+*	Function:		bool checkTimelineSemaphoreSupport(VkPhysicalDevice device_)
+*	Purpose:		Checks whether VK_KHR_timeline_semaphore can be enabled on device_
+*
+*/
+bool Engine::checkTimelineSemaphoreSupport(VkPhysicalDevice device_) {
+
+#if defined VK_KHR_timeline_semaphore
+	if (!physicalDeviceProperties2Enabled || !isDeviceExtensionSupported(device_, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+
+		return false;
+
+	}
+
+	auto getPhysicalDeviceFeatures2 = reinterpret_cast< PFN_vkGetPhysicalDeviceFeatures2KHR >(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getPhysicalDeviceFeatures2 == nullptr) {
+
+		return false;
+
+	}
+
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures		= {};
+	timelineFeatures.sType												= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+	VkPhysicalDeviceFeatures2KHR features								= {};
+	features.sType														= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext														= &timelineFeatures;
+
+	getPhysicalDeviceFeatures2(device_, &features);
+	return timelineFeatures.timelineSemaphore == VK_TRUE;
+#else
+	return false;
+#endif
+
+}
+
+/*
+*	Function:		bool checkDescriptorIndexingSupport(VkPhysicalDevice device_)
+*	Purpose:		Checks whether device_ can update and partially bind the arrays of the descriptor heap and index them non-uniformly through VK_EXT_descriptor_indexing
+*
+*/
+bool Engine::checkDescriptorIndexingSupport(VkPhysicalDevice device_) {
+
+#if defined VK_EXT_descriptor_indexing
+	if (!physicalDeviceProperties2Enabled
+		|| !isDeviceExtensionSupported(device_, VK_KHR_MAINTENANCE3_EXTENSION_NAME)
+		|| !isDeviceExtensionSupported(device_, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+
+		return false;
+
+	}
+
+	auto getPhysicalDeviceFeatures2 = reinterpret_cast< PFN_vkGetPhysicalDeviceFeatures2KHR >(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getPhysicalDeviceFeatures2 == nullptr) {
+
+		return false;
+
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures	= {};
+	indexingFeatures.sType											= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2KHR features							= {};
+	features.sType													= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext													= &indexingFeatures;
+
+	getPhysicalDeviceFeatures2(device_, &features);
+	return indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE
+		&& indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE
+		&& indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE
+		&& indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+#else
+	return false;
+#endif
+
+}
+
 /*
 *	Function:		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device_)
 *	Purpose:		Querys the system for swapchain support
@@ -1096,33 +1628,68 @@ VkSurfaceFormatKHR Engine::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFo
 */
 VkPresentModeKHR Engine::chooseSwapPresentMode(const std::vector< VkPresentModeKHR > availablePresentModes_) {
 	
-	VkPresentModeKHR bestMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	// FIFO is the only mode every implementation has to support, so it terminates both lists
+	std::vector< VkPresentModeKHR > preferredModes;
+	if (presentProfile == PRESENT_PROFILE_LOW_LATENCY) {
 
-	std::string mode = "VK_PRESENT_MODE_MAILBOX_KHR";
+		preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR };
 
-	for (const auto& availablePresentMode : availablePresentModes_) {
-	
-		if (availablePresentMode == VK_PRESENT_MODE_FIFO_KHR) {
-		
-			mode = "VK_PRESENT_MODE_FIFO_KHR";
-			bestMode = availablePresentMode;
-		
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-		
-			mode = "VK_PRESENT_MODE_IMMEDIATE_KHR";
-			bestMode = availablePresentMode;
-		
-		}
-	
 	}
+	else {
 
-	logger.log(EVENT_LOG, "Swapchain presentation mode:	" + mode);
+		preferredModes = { VK_PRESENT_MODE_FIFO_KHR };
+
+	}
+
+	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
+	for (const auto& preferredMode : preferredModes) {
+
+		if (std::find(availablePresentModes_.begin(), availablePresentModes_.end(), preferredMode) != availablePresentModes_.end()) {
+
+			bestMode = preferredMode;
+			break;
+
+		}
+
+	}
+
+	std::string mode = "VK_PRESENT_MODE_FIFO_KHR";
+	if (bestMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+
+		mode = "VK_PRESENT_MODE_MAILBOX_KHR";
+
+	}
+	else if (bestMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+
+		mode = "VK_PRESENT_MODE_IMMEDIATE_KHR";
+
+	}
+
+	logger.log(EVENT_LOG, "Swapchain presentation mode:	" + mode);
 
 	return bestMode;
 
 }
 
+/*
+*	Function:		uint32_t chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities_, VkPresentModeKHR presentMode_)
+*	Purpose:		Picks the swapchain depth for the present mode: two for IMMEDIATE, three for MAILBOX and FIFO
+*
+*/
+uint32_t Engine::chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities_, VkPresentModeKHR presentMode_) {
+
+	uint32_t imageCount = presentMode_ == VK_PRESENT_MODE_IMMEDIATE_KHR ? 2 : 3;
+	imageCount = std::max(imageCount, capabilities_.minImageCount);
+	if (capabilities_.maxImageCount > 0 && imageCount > capabilities_.maxImageCount) {
+	
+		imageCount = capabilities_.maxImageCount;
+	
+	}
+
+	return imageCount;
+
+}
+
 /*
 *	Function:		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities_)
 *	Purpose:		Enumerates best image_ size_ for swapchain
@@ -1172,11 +1739,11 @@ VkExtent2D Engine::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities
 }
 
 /*
-*	Function:		void createSwapChain()
-*	Purpose:		Puts together the swapchain with desired options
+*	Function:		void createSwapChain(VkSwapchainKHR oldSwapChain_)
+*	Purpose:		Puts together the swapchain with desired options, oldSwapChain_ is retired but has to be destroyed by the caller
 *
 */
-void Engine::createSwapChain(void) {
+void Engine::createSwapChain(VkSwapchainKHR oldSwapChain_) {
 
 	SwapChainSupportDetails swapChainSupport	= querySwapChainSupport(physicalDevice);
 	
@@ -1184,12 +1751,7 @@ void Engine::createSwapChain(void) {
 	VkPresentModeKHR presentMode				= chooseSwapPresentMode(swapChainSupport.presentModes);
 	VkExtent2D extent							= chooseSwapExtent(swapChainSupport.capabilities);
 
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-	
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	
-	}
+	uint32_t imageCount							= chooseSwapImageCount(swapChainSupport.capabilities, presentMode);
 
 	VkSwapchainCreateInfoKHR createInfo			= {};
 	createInfo.sType							= VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -1223,7 +1785,7 @@ void Engine::createSwapChain(void) {
 	createInfo.compositeAlpha					= VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode						= presentMode;
 	createInfo.clipped							= VK_TRUE;
-	createInfo.oldSwapchain						= VK_NULL_HANDLE;
+	createInfo.oldSwapchain						= oldSwapChain_;
 
 	if (vkCreateSwapchainKHR(
 			
@@ -1400,6 +1962,15 @@ void Engine::createPipelines(void) {
 	colorBlending.blendConstants[2]													= 0.0f;
 	colorBlending.blendConstants[3]													= 0.0f;
 
+	// the geometry subpass of the deferred path writes albedo and normal instead of a color
+	std::array< VkPipelineColorBlendAttachmentState, 2 > gBufferBlendAttachments	= { colorBlendAttachment, colorBlendAttachment };
+	if (deferredShading) {
+
+		colorBlending.attachmentCount												= static_cast< uint32_t >(gBufferBlendAttachments.size());
+		colorBlending.pAttachments													= gBufferBlendAttachments.data();
+
+	}
+
 	VkPipelineDepthStencilStateCreateInfo depthStencil								= {};
 	depthStencil.sType																= VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencil.depthTestEnable													= VK_TRUE;
@@ -1433,19 +2004,61 @@ void Engine::createPipelines(void) {
 	lboBinding.pImmutableSamplers													= nullptr;
 	lboBinding.stageFlags															= VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	VkDescriptorSetLayoutBinding mboBinding											= {};
-	mboBinding.binding																= 2;
-	mboBinding.descriptorCount														= 1;
-	mboBinding.descriptorType														= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	mboBinding.pImmutableSamplers													= nullptr;
-	mboBinding.stageFlags															= VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutBinding materialBinding									= {};
+	materialBinding.binding															= 2;
+	materialBinding.descriptorCount													= 1;
+	materialBinding.descriptorType													= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	materialBinding.pImmutableSamplers												= nullptr;
+	materialBinding.stageFlags														= VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding entityBinding										= {};
+	entityBinding.binding															= 3;
+	entityBinding.descriptorCount													= 1;
+	entityBinding.descriptorType													= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	entityBinding.pImmutableSamplers												= nullptr;
+	entityBinding.stageFlags														= VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutBinding normalBinding										= entityBinding;
+	normalBinding.binding															= 4;
+
+	VkDescriptorSetLayoutBinding instanceBinding									= entityBinding;
+	instanceBinding.binding															= 5;
 
-	std::vector< VkDescriptorSetLayoutBinding > bindings							= { uboLayoutBinding, lboBinding, mboBinding };
+	VkDescriptorSetLayoutBinding materialIndexBinding								= entityBinding;
+	materialIndexBinding.binding													= 6;
 
+	// point lights, offset and count per cluster and the light index lists of the clusters
+	VkDescriptorSetLayoutBinding pointLightBinding									= materialBinding;
+	pointLightBinding.binding														= 7;
+
+	VkDescriptorSetLayoutBinding clusterBinding										= materialBinding;
+	clusterBinding.binding															= 8;
+
+	VkDescriptorSetLayoutBinding lightIndexBinding									= materialBinding;
+	lightIndexBinding.binding														= 9;
+
+	std::vector< VkDescriptorSetLayoutBinding > bindings							= {
+
+		uboLayoutBinding,
+		lboBinding,
+		materialBinding,
+		entityBinding,
+		normalBinding,
+		instanceBinding,
+		materialIndexBinding,
+		pointLightBinding,
+		clusterBinding,
+		lightIndexBinding
+
+	};
+
+	// instances of one draw can use different materials, only the bindless variant may index the texture arrays with that
+	// the G-buffer variant only writes the surface, the deferred pipeline lights it
+	std::string objectFragShader													= deferredShading ? "shaders/objectShaders/gbuffer" : "shaders/objectShaders/frag";
 	objectPipeline = Pipeline(
 		
 		"shaders/objectShaders/vert.spv", 
-		"shaders/objectShaders/frag.spv",
+		objectFragShader + (descriptorHeap.isBindless() ? "_bindless.spv" : ".spv"),
 		&vertexInputInfo,
 		&inputAssembly,
 		&viewportState,
@@ -1466,7 +2079,7 @@ void Engine::createPipelines(void) {
 
 	objectPipeline.descriptorSetWrites([=] () {
 
-		for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
 			VkDescriptorBufferInfo bufferInfo							= {};
 			bufferInfo.buffer											= objectPipeline.uniformBuffers[i];
@@ -1483,12 +2096,7 @@ void Engine::createPipelines(void) {
 			lightingBufferInfo.offset									= 0;
 			lightingBufferInfo.range									= sizeof(LightingBufferObject);
 
-			VkDescriptorBufferInfo materialBufferInfo					= {};
-			materialBufferInfo.buffer									= objectPipeline.lightingBuffers[i];
-			materialBufferInfo.offset									= 0;
-			materialBufferInfo.range									= sizeof(MaterialBufferObject);
-
-			std::array< VkWriteDescriptorSet, 3 > descriptorWrites		= {};
+			std::array< VkWriteDescriptorSet, 2 > descriptorWrites		= {};
 			descriptorWrites[0].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptorWrites[0].dstSet									= objectPipeline.descriptorSets[i];
 			descriptorWrites[0].dstBinding								= 0;
@@ -1503,13 +2111,6 @@ void Engine::createPipelines(void) {
 			descriptorWrites[1].descriptorType							= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 			descriptorWrites[1].descriptorCount							= 1;
 			descriptorWrites[1].pBufferInfo								= &lightingBufferInfo;
-			descriptorWrites[2].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[2].dstSet									= objectPipeline.descriptorSets[i];
-			descriptorWrites[2].dstBinding								= 2;
-			descriptorWrites[2].dstArrayElement							= 0;
-			descriptorWrites[2].descriptorType							= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[2].descriptorCount							= 1;
-			descriptorWrites[2].pBufferInfo								= &materialBufferInfo;
 			/*descriptorWrites[1].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptorWrites[1].dstSet									= objectPipeline.descriptorSets[i];
 			descriptorWrites[1].dstBinding								= 1;
@@ -1542,12 +2143,15 @@ void Engine::createPipelines(void) {
 
 	rasterizer.cullMode																		= VK_CULL_MODE_NONE;
 
-	std::vector< VkDescriptorSetLayoutBinding > lightingBindings							= { uboLayoutBinding };
+	entityBinding.binding																	= 1;
+	instanceBinding.binding																	= 2;
+
+	std::vector< VkDescriptorSetLayoutBinding > lightingBindings							= { uboLayoutBinding, entityBinding, instanceBinding };
 
 	lightingPipeline = Pipeline(
 		
 		"shaders/lightingShaders/vert.spv",
-		"shaders/lightingShaders/frag.spv",
+		deferredShading ? "shaders/lightingShaders/gbuffer.spv" : "shaders/lightingShaders/frag.spv",
 		&vertexInputInfo,
 		&inputAssembly,
 		&viewportState,
@@ -1568,7 +2172,7 @@ void Engine::createPipelines(void) {
 
 	lightingPipeline.descriptorSetWrites([=] () {
 
-		for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
 			VkDescriptorBufferInfo bufferInfo											= {};
 			bufferInfo.buffer															= lightingPipeline.uniformBuffers[i];
@@ -1598,6 +2202,138 @@ void Engine::createPipelines(void) {
 
 	});
 
+	if (deferredShading) {
+
+		// the full screen triangle comes out of the vertex index and covers every pixel exactly once
+		VkPipelineVertexInputStateCreateInfo emptyVertexInput								= {};
+		emptyVertexInput.sType																= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		multisampling.sampleShadingEnable													= VK_FALSE;
+		depthStencil.depthTestEnable														= VK_FALSE;
+		depthStencil.depthWriteEnable														= VK_FALSE;
+		colorBlending.attachmentCount														= 1;
+		colorBlending.pAttachments															= &colorBlendAttachment;
+
+		// the inverse camera matrices reconstruct the position out of depth
+		uboLayoutBinding.stageFlags															= VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutBinding depthInputBinding										= {};
+		depthInputBinding.binding															= 2;
+		depthInputBinding.descriptorCount													= 1;
+		depthInputBinding.descriptorType													= VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		depthInputBinding.pImmutableSamplers												= nullptr;
+		depthInputBinding.stageFlags														= VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutBinding albedoInputBinding										= depthInputBinding;
+		albedoInputBinding.binding															= 3;
+
+		VkDescriptorSetLayoutBinding normalInputBinding										= depthInputBinding;
+		normalInputBinding.binding															= 4;
+
+		std::vector< VkDescriptorSetLayoutBinding > deferredBindings						= {
+
+			uboLayoutBinding,
+			lboBinding,
+			depthInputBinding,
+			albedoInputBinding,
+			normalInputBinding,
+			pointLightBinding,
+			clusterBinding,
+			lightIndexBinding
+
+		};
+
+		deferredPipeline = Pipeline(
+
+			"shaders/deferredShaders/vert.spv",
+			"shaders/deferredShaders/frag.spv",
+			&emptyVertexInput,
+			&inputAssembly,
+			&viewportState,
+			&rasterizer,
+			&multisampling,
+			&depthStencil,
+			&colorBlending,
+			nullptr,
+			renderPass,
+			1,
+			VK_NULL_HANDLE,
+			-1,
+			&deferredBindings,
+			deferredDescriptorPool,
+			true
+
+		);
+
+		deferredPipeline.descriptorSetWrites([=] () {
+
+			for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+				VkDescriptorBufferInfo bufferInfo											= {};
+				bufferInfo.buffer															= deferredPipeline.uniformBuffers[i];
+				bufferInfo.offset															= 0;
+				bufferInfo.range															= sizeof(UniformBufferObject);
+
+				VkDescriptorBufferInfo lightingBufferInfo									= {};
+				lightingBufferInfo.buffer													= deferredPipeline.lightingBuffers[i];
+				lightingBufferInfo.offset													= 0;
+				lightingBufferInfo.range													= sizeof(LightingBufferObject);
+
+				std::array< VkDescriptorImageInfo, 3 > inputInfos							= {};
+				inputInfos[0].imageView														= gBuffer.getDepthView();
+				inputInfos[0].imageLayout													= VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+				inputInfos[1].imageView														= gBuffer.getAlbedoView();
+				inputInfos[1].imageLayout													= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				inputInfos[2].imageView														= gBuffer.getNormalView();
+				inputInfos[2].imageLayout													= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+				std::array< VkWriteDescriptorSet, 3 > descriptorWrites						= {};
+				descriptorWrites[0].sType													= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[0].dstSet													= deferredPipeline.descriptorSets[i];
+				descriptorWrites[0].dstBinding												= 0;
+				descriptorWrites[0].dstArrayElement											= 0;
+				descriptorWrites[0].descriptorType											= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descriptorWrites[0].descriptorCount											= 1;
+				descriptorWrites[0].pBufferInfo												= &bufferInfo;
+				descriptorWrites[1].sType													= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[1].dstSet													= deferredPipeline.descriptorSets[i];
+				descriptorWrites[1].dstBinding												= 1;
+				descriptorWrites[1].dstArrayElement											= 0;
+				descriptorWrites[1].descriptorType											= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descriptorWrites[1].descriptorCount											= 1;
+				descriptorWrites[1].pBufferInfo												= &lightingBufferInfo;
+				descriptorWrites[2].sType													= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[2].dstSet													= deferredPipeline.descriptorSets[i];
+				descriptorWrites[2].dstBinding												= 2;
+				descriptorWrites[2].dstArrayElement											= 0;
+				descriptorWrites[2].descriptorType											= VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				descriptorWrites[2].descriptorCount											= static_cast< uint32_t >(inputInfos.size());
+				descriptorWrites[2].pImageInfo												= inputInfos.data();
+
+				vkUpdateDescriptorSets(
+
+					device,
+					static_cast< uint32_t >(descriptorWrites.size()),
+					descriptorWrites.data(),
+					0,
+					nullptr
+
+				);
+
+			}
+
+		});
+
+	}
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		writeEntityBufferDescriptors(i);
+		writeMaterialTableDescriptor(i);
+		writeLightingDescriptors(i);
+
+	}
+
 	vkDestroyShaderModule(
 
 		device,
@@ -1628,6 +2364,25 @@ void Engine::createPipelines(void) {
 
 	);
 
+	if (deferredShading) {
+
+		vkDestroyShaderModule(
+
+			device,
+			deferredPipeline.getVertShaderModule().getModule(),
+			nullptr
+
+		);
+		vkDestroyShaderModule(
+
+			device,
+			deferredPipeline.getFragShaderModule().getModule(),
+			nullptr
+
+		);
+
+	}
+
 }
 
 /*
@@ -1637,6 +2392,13 @@ void Engine::createPipelines(void) {
 */
 void Engine::createRenderPass(void) {
 
+	if (deferredShading) {
+
+		createDeferredRenderPass();
+		return;
+
+	}
+
 	VkAttachmentDescription colorAttachment						= {};
 	colorAttachment.format										= swapChainImageFormat;
 	colorAttachment.samples										= msaaSamples;
@@ -1651,7 +2413,7 @@ void Engine::createRenderPass(void) {
 	depthAttachment.format										= findDepthFormat();
 	depthAttachment.samples										= msaaSamples;
 	depthAttachment.loadOp										= VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp										= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp										= occlusionCulling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp								= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp								= VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout								= VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1689,10 +2451,10 @@ void Engine::createRenderPass(void) {
 	VkSubpassDependency dependency								= {};
 	dependency.srcSubpass										= VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass										= 0;
-	dependency.srcStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask									= 0;
-	dependency.dstStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask									= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.srcStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.srcAccessMask									= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask									= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
 	std::array< VkAttachmentDescription, 3 > attachments		= {colorAttachment, depthAttachment, colorAttachmentResolve};
 	VkRenderPassCreateInfo renderPassInfo						= {};
@@ -1717,6 +2479,161 @@ void Engine::createRenderPass(void) {
 	
 	}
 
+	if (!occlusionCulling) {
+
+		return;
+
+	}
+
+	// compatible with the main render pass, so the same framebuffers and secondaries work in both
+	// it continues on the color and depth the main pass left behind and resolves again on top
+	attachments[0].loadOp										= VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[0].storeOp										= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout								= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachments[1].loadOp										= VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[1].storeOp										= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout								= VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	// the depth pyramid and the late culling phase ran in between
+	dependency.srcStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependency.srcAccessMask									= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask										= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask									= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	if (vkCreateRenderPass(
+
+		device,
+		&renderPassInfo,
+		nullptr,
+		&occlusionRenderPass
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create occlusion render pass!");
+
+	}
+
+}
+
+/*
+*	Function:		void createDeferredRenderPass()
+*	Purpose:		Generates the render pass of the deferred path, the geometry subpass fills the G-buffer and the lighting subpass shades every pixel once out of it
+*					Only the swapchain image is stored, the G-buffer lives and dies within the render pass
+*
+*/
+void Engine::createDeferredRenderPass(void) {
+
+	// the lighting subpass writes every pixel, the background included
+	VkAttachmentDescription colorAttachment						= {};
+	colorAttachment.format										= swapChainImageFormat;
+	colorAttachment.samples										= VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp										= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.storeOp										= VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp								= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp								= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout								= VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout									= VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentDescription depthAttachment						= {};
+	depthAttachment.format										= gBuffer.getDepthFormat();
+	depthAttachment.samples										= VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp										= VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp										= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp								= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp								= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout								= VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout									= VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	VkAttachmentDescription albedoAttachment					= depthAttachment;
+	albedoAttachment.format										= gBuffer.getAlbedoFormat();
+	albedoAttachment.finalLayout								= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkAttachmentDescription normalAttachment					= albedoAttachment;
+	normalAttachment.format										= gBuffer.getNormalFormat();
+
+	VkAttachmentReference gBufferRefs[2]						= {};
+	gBufferRefs[0].attachment									= 2;
+	gBufferRefs[0].layout										= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	gBufferRefs[1].attachment									= 3;
+	gBufferRefs[1].layout										= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef					= {};
+	depthAttachmentRef.attachment								= 1;
+	depthAttachmentRef.layout									= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef					= {};
+	colorAttachmentRef.attachment								= 0;
+	colorAttachmentRef.layout									= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// depth, albedo and normal in the order of the input attachment indices of the lighting shader
+	VkAttachmentReference inputRefs[3]							= {};
+	inputRefs[0].attachment										= 1;
+	inputRefs[0].layout											= VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	inputRefs[1].attachment										= 2;
+	inputRefs[1].layout											= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	inputRefs[2].attachment										= 3;
+	inputRefs[2].layout											= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	std::array< VkSubpassDescription, 2 > subpasses				= {};
+	subpasses[0].pipelineBindPoint								= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[0].colorAttachmentCount							= 2;
+	subpasses[0].pColorAttachments								= gBufferRefs;
+	subpasses[0].pDepthStencilAttachment						= &depthAttachmentRef;
+	subpasses[1].pipelineBindPoint								= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[1].inputAttachmentCount							= 3;
+	subpasses[1].pInputAttachments								= inputRefs;
+	subpasses[1].colorAttachmentCount							= 1;
+	subpasses[1].pColorAttachments								= &colorAttachmentRef;
+
+	// the previous frame's lighting subpass may still read the G-buffer this one clears
+	std::array< VkSubpassDependency, 3 > dependencies			= {};
+	dependencies[0].srcSubpass									= VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass									= 0;
+	dependencies[0].srcStageMask								= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[0].srcAccessMask								= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask								= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask								= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// per region, a tile-based GPU shades a tile straight out of its own memory
+	dependencies[1].srcSubpass									= 0;
+	dependencies[1].dstSubpass									= 1;
+	dependencies[1].srcStageMask								= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].srcAccessMask								= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask								= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].dstAccessMask								= VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+	dependencies[1].dependencyFlags								= VK_DEPENDENCY_BY_REGION_BIT;
+
+	// the swapchain image is first written by the lighting subpass, after the acquire semaphore
+	dependencies[2].srcSubpass									= VK_SUBPASS_EXTERNAL;
+	dependencies[2].dstSubpass									= 1;
+	dependencies[2].srcStageMask								= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[2].srcAccessMask								= 0;
+	dependencies[2].dstStageMask								= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[2].dstAccessMask								= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	std::array< VkAttachmentDescription, 4 > attachments		= {colorAttachment, depthAttachment, albedoAttachment, normalAttachment};
+	VkRenderPassCreateInfo renderPassInfo						= {};
+	renderPassInfo.sType										= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount								= static_cast< uint32_t >(attachments.size());
+	renderPassInfo.pAttachments									= attachments.data();
+	renderPassInfo.subpassCount									= static_cast< uint32_t >(subpasses.size());
+	renderPassInfo.pSubpasses									= subpasses.data();
+	renderPassInfo.dependencyCount								= static_cast< uint32_t >(dependencies.size());
+	renderPassInfo.pDependencies								= dependencies.data();
+
+	if (vkCreateRenderPass(
+
+		device,
+		&renderPassInfo,
+		nullptr,
+		&renderPass
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create deferred render pass!");
+
+	}
+
 }
 
 /*
@@ -1730,13 +2647,25 @@ void Engine::createFramebuffers(void) {
 
 	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
 	
-		std::array< VkImageView, 3 > attachments = {
+		std::vector< VkImageView > attachments = {
 
 			colorImageView,
 			depthImageView,
 			swapChainImageViews[i]
 
 		};
+		if (deferredShading) {
+
+			attachments = {
+
+				swapChainImageViews[i],
+				gBuffer.getDepthView(),
+				gBuffer.getAlbedoView(),
+				gBuffer.getNormalView()
+
+			};
+
+		}
 
 		VkFramebufferCreateInfo framebufferInfo					= {};
 		framebufferInfo.sType									= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -1794,137 +2723,138 @@ void Engine::createCommandPool(void) {
 }
 
 /*
-*	Function:		void recordCommandBuffers()
-*	Purpose:		Creates command buffers
+*	Function:		void createFrameCommandPools()
+*	Purpose:		Creates one primary command pool and one secondary command pool per recording thread for each frame in flight
 *
 */
-void Engine::recordCommandBuffers(void) {
+void Engine::createFrameCommandPools(void) {
 
-	commandBuffers.resize(swapChainFramebuffers.size());
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
-	VkCommandBufferAllocateInfo allocInfo		= {};
-	allocInfo.sType								= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool						= commandPool;
-	allocInfo.level								= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount				= (uint32_t)commandBuffers.size();
+	VkCommandPoolCreateInfo poolInfo	= {};
+	poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex			= queueFamilyIndices.graphicsFamily.value();
+	poolInfo.flags						= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-	if (vkAllocateCommandBuffers(
-	
-		device,
-		&allocInfo,
-		commandBuffers.data()
-	
-	) != VK_SUCCESS) {
-	
-		logger.log(ERROR_LOG, "Failed to allocate command buffers!");
-	
-	}
+	frameCommandPools.resize(MAX_FRAMES_IN_FLIGHT);
+	threadCommandPools.resize(MAX_FRAMES_IN_FLIGHT);
+	secondaryCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	recordedGenerations.resize(MAX_FRAMES_IN_FLIGHT, 0);
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-	
-		VkRenderPassBeginInfo renderPassBeginInfo		= {};
-		renderPassBeginInfo.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassBeginInfo.renderPass					= renderPass;
-		renderPassBeginInfo.framebuffer					= swapChainFramebuffers[i];
-		renderPassBeginInfo.renderArea.offset			= {0, 0};
-		renderPassBeginInfo.renderArea.extent			= swapChainExtent;
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
-		std::array< VkClearValue, 2 > clearValues		= {};
-		clearValues[0].color							= {0.0f / 255.0f, 0.0f / 255.0f, 0.0f / 255.0f, 1.0f};
-		clearValues[1].depthStencil						= {1.0f, 0};
-		renderPassBeginInfo.clearValueCount				= static_cast< uint32_t >(clearValues.size());
-		renderPassBeginInfo.pClearValues				= clearValues.data();
+		if (vkCreateCommandPool(
 
-		VkCommandBufferBeginInfo beginInfo				= {};
-		beginInfo.sType									= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			device,
+			&poolInfo,
+			nullptr,
+			&frameCommandPools[i]
 
-		vkBeginCommandBuffer(
-			
-			commandBuffers[i],
-			&beginInfo
-		
-		);
+		) != VK_SUCCESS) {
 
-		vkCmdBeginRenderPass(
-			
-			commandBuffers[i],
-			&renderPassBeginInfo,
-			VK_SUBPASS_CONTENTS_INLINE
+			logger.log(ERROR_LOG, "Failed to create frame command pool!");
 
-		);
+		}
 
-			for (auto& obj : objects) {
+		threadCommandPools[i].resize(numRecordingThreads);
 
-				VkDeviceSize offsets[] = { 0 };
+		for (uint32_t j = 0; j < numRecordingThreads; j++) {
 
-				obj->draw(
+			if (vkCreateCommandPool(
 
-					commandBuffers[i],
-					offsets,
-					0,
-					VK_INDEX_TYPE_UINT32,
-					i
+				device,
+				&poolInfo,
+				nullptr,
+				&threadCommandPools[i][j]
 
-				);
+			) != VK_SUCCESS) {
+
+				logger.log(ERROR_LOG, "Failed to create thread command pool!");
 
 			}
 
-		vkCmdEndRenderPass(commandBuffers[i]);
+		}
+
+		// one secondary per recording slot, each records a contiguous range of entities
+		// occlusion culling adds a second one per slot for the late draws, recorded by the same thread from the same pool
+		secondaryCommandBuffers[i].resize(occlusionCulling ? 2 * numRecordingThreads : numRecordingThreads);
+		for (uint32_t j = 0; j < secondaryCommandBuffers[i].size(); j++) {
+
+			VkCommandBufferAllocateInfo allocInfo		= {};
+			allocInfo.sType								= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool						= threadCommandPools[i][j % numRecordingThreads];
+			allocInfo.level								= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount				= 1;
+
+			if (vkAllocateCommandBuffers(
+
+				device,
+				&allocInfo,
+				&secondaryCommandBuffers[i][j]
+
+			) != VK_SUCCESS) {
+
+				logger.log(ERROR_LOG, "Failed to allocate secondary command buffer!");
+
+			}
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-		
-			logger.log(ERROR_LOG, "Failed to record command buffer!");
-		
 		}
+
 	}
 
+	allocatePrimaryCommandBuffers();
+
 }
 
 /*
-*	Function:		void createSemaphores()
-*	Purpose:		Creates the semaphores to safely compute everything
+*	Function:		void allocatePrimaryCommandBuffers()
+*	Purpose:		(Re-)allocates one primary command buffer per frame in flight and swapchain image
 *
 */
-void Engine::createSyncObjects(void) {
+void Engine::allocatePrimaryCommandBuffers(void) {
 
-	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	stitchedGenerations.resize(MAX_FRAMES_IN_FLIGHT);
 
-	VkSemaphoreCreateInfo semaphoreInfo		= {};
-	semaphoreInfo.sType						= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
-	VkFenceCreateInfo fenceInfo				= {};
-	fenceInfo.sType							= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags							= VK_FENCE_CREATE_SIGNALED_BIT;
+		if (!commandBuffers[i].empty()) {
 
+			VkCommandPool pool							= frameCommandPools[i];
+			std::vector< VkCommandBuffer > oldBuffers	= commandBuffers[i];
+			retire([=] () {
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+				vkFreeCommandBuffers(
 
-		if (vkCreateSemaphore(
+					device,
+					pool,
+					static_cast< uint32_t >(oldBuffers.size()),
+					oldBuffers.data()
 
-			device,
-			&semaphoreInfo,
-			nullptr,
-			&imageAvailableSemaphores[i]
+				);
 
-		) != VK_SUCCESS || vkCreateSemaphore(
+			});
 
-			device,
-			&semaphoreInfo,
-			nullptr,
-			&renderFinishedSemaphores[i]
+		}
+
+		commandBuffers[i].resize(swapChainImages.size());
+		stitchedGenerations[i].assign(swapChainImages.size(), 0);
+
+		VkCommandBufferAllocateInfo allocInfo		= {};
+		allocInfo.sType								= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool						= frameCommandPools[i];
+		allocInfo.level								= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount				= static_cast< uint32_t >(commandBuffers[i].size());
+
+		if (vkAllocateCommandBuffers(
 
-		) != VK_SUCCESS || vkCreateFence(
-		
 			device,
-			&fenceInfo,
-			nullptr,
-			&inFlightFences[i]
-		
+			&allocInfo,
+			commandBuffers[i].data()
+
 		) != VK_SUCCESS) {
 
-			logger.log(ERROR_LOG, "Failed to create semaphores!");
+			logger.log(ERROR_LOG, "Failed to allocate command buffers!");
 
 		}
 
@@ -1933,545 +2863,1808 @@ void Engine::createSyncObjects(void) {
 }
 
 /*
-*	Function:		void renderFrame()
-*	Purpose:		Renders a frame to the screen
+*	Function:		void recordCommandBuffers(uint32_t frame_, uint32_t imageIndex_)
+*	Purpose:		Re-records the secondary command buffers and re-stitches the primary if entities were added, removed, changed or changed visibility
+*					Moving entities only changes the entity buffer, so the recorded commands stay valid
 *
 */
-void Engine::renderFrame(void) {
+void Engine::recordCommandBuffers(uint32_t frame_, uint32_t imageIndex_) {
 
-	vkWaitForFences(
-	
-		device,
-		1,
-		&inFlightFences[currentFrame],
-		VK_TRUE,
-		std::numeric_limits< uint64_t >::max()
-	
-	);
+	if (recordedGenerations[frame_] != sceneGeneration) {
 
-	uint32_t imageIndex;
-	result = vkAcquireNextImageKHR(
-	
-		device,
+		// one contiguous range of visible entities, or of draw runs when drawing indirectly, and one job per recording slot, so a slot's command pools are never used by two threads at once
+		size_t itemCount		= gpuDrivenRendering ? gpuCulling.getRunCount() : indirectBatching ? drawBatches.getRunCount() : visibleEntities.size();
+		size_t rangeSize		= (itemCount + numRecordingThreads - 1) / numRecordingThreads;
+		slotBindStats.assign(numRecordingThreads, BindStats());
+
+		JobCounter recordingCounter;
+		for (uint32_t i = 0; i < numRecordingThreads; i++) {
+
+			size_t first	= std::min(i * rangeSize, itemCount);
+			size_t last		= std::min(first + rangeSize, itemCount);
+			jobSystem.run([=] () {
+
+				recordSecondaryCommandBuffer(frame_, i, first, last, false);
+				if (occlusionCulling) {
+
+					recordSecondaryCommandBuffer(frame_, numRecordingThreads + i, first, last, true);
+
+				}
+
+			}, &recordingCounter);
+
+		}
+
+		jobSystem.wait(&recordingCounter);
+
+		if (!gpuDrivenRendering) {
+
+			bindStats = BindStats();
+			for (const BindStats& slotStats : slotBindStats) {
+
+				bindStats.draws				+= slotStats.draws;
+				bindStats.pipelines			+= slotStats.pipelines;
+				bindStats.descriptorSets	+= slotStats.descriptorSets;
+				bindStats.vertexBuffers		+= slotStats.vertexBuffers;
+				bindStats.indexBuffers		+= slotStats.indexBuffers;
+				bindStats.unsortedBinds		+= slotStats.unsortedBinds;
+
+			}
+
+			if (indirectBatching) {
+
+				bindStats.unsortedBinds		= drawBatches.getUnsortedBinds();
+
+			}
+
+		}
+
+		recordedGenerations[frame_] = sceneGeneration;
+
+	}
+
+	if (stitchedGenerations[frame_][imageIndex_] == sceneGeneration) {
+
+		return;
+
+	}
+
+	VkCommandBuffer commandBuffer					= commandBuffers[frame_][imageIndex_];
+
+	VkRenderPassBeginInfo renderPassBeginInfo		= {};
+	renderPassBeginInfo.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass					= renderPass;
+	renderPassBeginInfo.framebuffer					= swapChainFramebuffers[imageIndex_];
+	renderPassBeginInfo.renderArea.offset			= {0, 0};
+	renderPassBeginInfo.renderArea.extent			= swapChainExtent;
+
+	// the deferred render pass also clears albedo and normal, behind swapchain and depth
+	std::array< VkClearValue, 4 > clearValues		= {};
+	clearValues[0].color							= {0.0f / 255.0f, 0.0f / 255.0f, 0.0f / 255.0f, 1.0f};
+	clearValues[1].depthStencil						= {1.0f, 0};
+	clearValues[2].color							= {0.0f, 0.0f, 0.0f, 0.0f};
+	clearValues[3].color							= {0.0f, 0.0f, 0.0f, 0.0f};
+	renderPassBeginInfo.clearValueCount				= deferredShading ? 4 : 2;
+	renderPassBeginInfo.pClearValues				= clearValues.data();
+
+	VkCommandBufferBeginInfo beginInfo				= {};
+	beginInfo.sType									= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	vkBeginCommandBuffer(
+		
+		commandBuffer,
+		&beginInfo
+	
+	);
+
+	fillRateQueries.begin(commandBuffer, frame_);
+
+	if (gpuDrivenRendering) {
+
+		gpuCulling.recordCulling(commandBuffer, frame_);
+
+	}
+
+	vkCmdBeginRenderPass(
+		
+		commandBuffer,
+		&renderPassBeginInfo,
+		VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+
+	);
+
+		vkCmdExecuteCommands(
+
+			commandBuffer,
+			numRecordingThreads,
+			secondaryCommandBuffers[frame_].data()
+
+		);
+
+	if (deferredShading) {
+
+		// one full screen triangle lights every pixel out of the G-buffer the secondaries filled
+		vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+			deferredPipeline.bind(commandBuffer, &deferredPipeline.descriptorSets[frame_]);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (occlusionCulling) {
+
+		// the early draws are the occluders the pyramid is built from, the late draws get whatever they did not hide
+		depthPyramid.record(commandBuffer);
+		gpuCulling.recordOcclusionCulling(commandBuffer, frame_);
+
+		renderPassBeginInfo.renderPass				= occlusionRenderPass;
+		renderPassBeginInfo.clearValueCount			= 0;
+		renderPassBeginInfo.pClearValues			= nullptr;
+
+		vkCmdBeginRenderPass(
+
+			commandBuffer,
+			&renderPassBeginInfo,
+			VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+
+		);
+
+			vkCmdExecuteCommands(
+
+				commandBuffer,
+				numRecordingThreads,
+				secondaryCommandBuffers[frame_].data() + numRecordingThreads
+
+			);
+
+		vkCmdEndRenderPass(commandBuffer);
+
+	}
+
+	fillRateQueries.end(commandBuffer, frame_);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+	
+		logger.log(ERROR_LOG, "Failed to record command buffer!");
+	
+	}
+
+	stitchedGenerations[frame_][imageIndex_] = sceneGeneration;
+
+}
+
+/*
+*	Function:		void recordSecondaryCommandBuffer(
+*
+*						uint32_t				frame_,
+*						uint32_t				slot_,
+*						size_t					first_,
+*						size_t					last_,
+*						bool					late_
+*
+*					)
+*	Purpose:		Records the draws of the visible entities first_ to last_ into the secondary command buffer of the given recording slot
+*					When drawing indirectly, first_ and last_ are draw runs instead, late_ selects the draws after occlusion culling when GPU-driven
+*
+*/
+void Engine::recordSecondaryCommandBuffer(
+
+	uint32_t				frame_,
+	uint32_t				slot_,
+	size_t					first_,
+	size_t					last_,
+	bool					late_
+
+) {
+
+	VkCommandBuffer commandBuffer						= secondaryCommandBuffers[frame_][slot_];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo		= {};
+	inheritanceInfo.sType								= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass							= renderPass;
+	inheritanceInfo.subpass								= 0;
+	inheritanceInfo.framebuffer							= VK_NULL_HANDLE;
+	inheritanceInfo.pipelineStatistics					= fillRateQueries.getInheritedStatistics();
+
+	VkCommandBufferBeginInfo beginInfo					= {};
+	beginInfo.sType										= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags										= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	beginInfo.pInheritanceInfo							= &inheritanceInfo;
+
+	vkBeginCommandBuffer(
+
+		commandBuffer,
+		&beginInfo
+
+	);
+
+	if (gpuDrivenRendering) {
+
+		descriptorHeap.bind(commandBuffer, frame_);
+		gpuCulling.recordDraws(commandBuffer, frame_, first_, last_, late_);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to record secondary command buffer!");
+
+		}
+		return;
+
+	}
+
+	BindStats& stats									= slotBindStats[slot_];
+
+	if (indirectBatching) {
+
+		descriptorHeap.bind(commandBuffer, frame_);
+		stats.descriptorSets++;
+		drawBatches.recordDraws(commandBuffer, frame_, first_, last_, stats);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to record secondary command buffer!");
+
+		}
+		return;
+
+	}
+
+	const ObjectHandle* meshes							= scene.getMeshes();
+	const MaterialHandle* entityMaterials				= scene.getMaterials();
+	Pipeline* boundPipeline								= nullptr;
+	VkBuffer vertexBuffer								= geometryPool.getVertexBuffer();
+	VkBuffer indexBuffer								= geometryPool.getIndexBuffer();
+	VkDeviceSize offsets[]								= { 0 };
+
+	// the descriptor heap is set 0 of every pipeline layout, bound once it survives all pipeline changes
+	descriptorHeap.bind(commandBuffer, frame_);
+	stats.descriptorSets++;
+
+	// all meshes live in the geometry pool, its buffers are bound once for the whole range
+	if (first_ < last_ && vertexBuffer != VK_NULL_HANDLE) {
+
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		stats.vertexBuffers++;
+		stats.indexBuffers++;
+
+	}
+
+	// the visible list is sorted by state, so the pipeline is only bound when it differs from the previous draw's
+	for (size_t v = first_; v < last_; v++) {
+
+		// the visible list holds dense scene indices, passed as the first instance they select the entity's matrices
+		uint32_t i										= visibleEntities[v];
+		Object* mesh									= getObject(meshes[i]);
+		Pipeline** material								= materials.get(entityMaterials[i]);
+		if (mesh == nullptr || material == nullptr) {
+
+			continue;
+
+		}
+
+		// a pipeline's descriptor sets belong to its layout, a new pipeline always means new descriptor sets
+		if (*material != boundPipeline) {
+
+			boundPipeline = *material;
+			boundPipeline->bind(commandBuffer, &boundPipeline->descriptorSets[frame_]);
+			stats.pipelines++;
+			stats.descriptorSets++;
+
+		}
+
+		const MeshInfo& meshInfo						= mesh->getMeshInfo();
+
+		// pipeline, descriptor set, vertex buffer and index buffer for every draw
+		stats.draws++;
+		stats.unsortedBinds								+= meshInfo.indexCount > 0 ? 4 : 3;
+
+		// the instance index picks the entity's world matrix out of the entity buffer
+		if (meshInfo.indexCount > 0) {
+
+			vkCmdDrawIndexed(commandBuffer, meshInfo.indexCount, 1, meshInfo.firstIndex, static_cast< int32_t >(meshInfo.firstVertex), static_cast< uint32_t >(i));
+
+		}
+		else {
+
+			vkCmdDraw(commandBuffer, meshInfo.vertexCount, 1, meshInfo.firstVertex, static_cast< uint32_t >(i));
+
+		}
+
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to record secondary command buffer!");
+
+	}
+
+}
+
+/*
+*	Function:		ObjectHandle addObject(Object* object_)
+*	Purpose:		Takes ownership of the uploaded mesh object_ and returns the handle entities refer to it by
+*
+*/
+ObjectHandle Engine::addObject(Object* object_) {
+
+	return objects.insert(std::unique_ptr< Object >(object_));
+
+}
+
+/*
+*	Function:		void removeObject(ObjectHandle object_)
+*	Purpose:		Destroys the mesh once no frame in flight uses it anymore, entities still referring to it are skipped, stale handles are ignored
+*
+*/
+void Engine::removeObject(ObjectHandle object_) {
+
+	std::unique_ptr< Object >* obj = objects.get(object_);
+	if (obj == nullptr) {
+
+		return;
+
+	}
+
+	// only queues the destruction, so the frames still in flight keep their buffers
+	(*obj)->destroy();
+	objects.remove(object_);
+	sceneGeneration++;
+	requestRedraw();
+
+}
+
+/*
+*	Function:		Object* getObject(ObjectHandle object_)
+*	Purpose:		Returns the object behind object_, nullptr if it has been removed
+*
+*/
+Object* Engine::getObject(ObjectHandle object_) {
+
+	std::unique_ptr< Object >* obj = objects.get(object_);
+	return obj != nullptr ? obj->get() : nullptr;
+
+}
+
+/*
+*	Function:		Pipeline* getMaterial(MaterialHandle material_)
+*	Purpose:		Returns the pipeline of material_, nullptr if the handle is stale
+*
+*/
+Pipeline* Engine::getMaterial(MaterialHandle material_) {
+
+	Pipeline** material = materials.get(material_);
+	return material != nullptr ? *material : nullptr;
+
+}
+
+/*
+*	Function:		MaterialHandle addMaterial(Pipeline* pipeline_)
+*	Purpose:		Registers pipeline_ as a material entities can be drawn with, the pipeline has to outlive the material
+*
+*/
+MaterialHandle Engine::addMaterial(Pipeline* pipeline_) {
+
+	return materials.insert(pipeline_);
+
+}
+
+/*
+*	Function:		Entity createEntity(ObjectHandle mesh_, MaterialHandle material_, const Transform& transform_, Entity parent_)
+*	Purpose:		Adds an entity drawing mesh_ with material_ to the scene, transform_ is relative to parent_ if one is given
+*
+*/
+Entity Engine::createEntity(ObjectHandle mesh_, MaterialHandle material_, const Transform& transform_, Entity parent_) {
+
+	Object* mesh		= getObject(mesh_);
+	Entity entity		= scene.createEntity(mesh_, material_, mesh != nullptr ? mesh->getMeshInfo().bounds : Bounds(), transform_, parent_);
+	sceneGeneration++;
+	requestRedraw();
+	return entity;
+
+}
+
+/*
+*	Function:		void destroyEntity(Entity entity_)
+*	Purpose:		Removes the entity and its descendants from the scene, stale handles are ignored
+*
+*/
+void Engine::destroyEntity(Entity entity_) {
+
+	if (!scene.isAlive(entity_)) {
+
+		return;
+
+	}
+
+	scene.destroyEntity(entity_);
+	sceneGeneration++;
+	requestRedraw();
+
+}
+
+/*
+*	Function:		void retire(std::function< void() > deleter_)
+*	Purpose:		Runs deleter_ once everything submitted to the graphics queue so far has finished
+*					Vulkan handles that may still be used by a frame in flight are destroyed through this
+*
+*/
+void Engine::retire(std::function< void() > deleter_) {
+
+	deletionQueue.push(graphicsTimeline.getLastSubmittedValue(), deleter_);
+
+}
+
+/*
+*	Function:		void invalidateScene()
+*	Purpose:		Forces every frame to be re-recorded, e.g. after the render pass or the pipelines have been swapped
+*
+*/
+void Engine::invalidateScene(void) {
+
+	sceneGeneration++;
+	requestRedraw();
+
+}
+
+/*
+*	Function:		void setTargetFrameRate(double framesPerSecond_)
+*	Purpose:		Limits the frame rate at runtime, 0 renders as fast as possible
+*
+*/
+void Engine::setTargetFrameRate(double framesPerSecond_) {
+
+	targetFrameRate = framesPerSecond_;
+	updateFrameRateLimit();
+
+}
+
+/*
+*	Function:		void setRenderOnDemand(bool enabled_)
+*	Purpose:		Switches between continuous rendering and rendering only after something changed
+*
+*/
+void Engine::setRenderOnDemand(bool enabled_) {
+
+	renderOnDemand = enabled_;
+	updateFrameRateLimit();
+	requestRedraw();
+
+}
+
+/*
+*	Function:		void requestRedraw()
+*	Purpose:		Marks the current image as outdated, e.g. after input or when an asset finished loading; thread-safe
+*
+*/
+void Engine::requestRedraw(void) {
+
+	redrawRequested = true;
+	if (renderOnDemand) {
+
+		glfwPostEmptyEvent();
+
+	}
+
+}
+
+/*
+*	Function:		void createSemaphores()
+*	Purpose:		Creates the semaphores to safely compute everything
+*
+*/
+void Engine::createSyncObjects(void) {
+
+	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+
+	// frame slots wait on the graphics timeline instead of one fence each, 0 is reached before anything was submitted
+	frameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+
+	VkSemaphoreCreateInfo semaphoreInfo		= {};
+	semaphoreInfo.sType						= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		if (vkCreateSemaphore(
+
+			device,
+			&semaphoreInfo,
+			nullptr,
+			&imageAvailableSemaphores[i]
+
+		) != VK_SUCCESS || vkCreateSemaphore(
+
+			device,
+			&semaphoreInfo,
+			nullptr,
+			&renderFinishedSemaphores[i]
+
+		) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to create semaphores!");
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		void renderFrame()
+*	Purpose:		Renders a frame to the screen
+*
+*/
+void Engine::renderFrame(void) {
+
+	if (presentProfileChanged) {
+
+		presentProfileChanged = false;
+		applyPresentProfile();
+
+	}
+
+	double waitStart = glfwGetTime();
+
+	graphicsTimeline.wait(frameTimelineValues[currentFrame]);
+
+	fenceWaitTime += glfwGetTime() - waitStart;
+
+	deletionQueue.collect(graphicsTimeline.getCompletedValue());
+	fillRateQueries.collect(static_cast< uint32_t >(currentFrame));
+
+	uint32_t imageIndex;
+	result = vkAcquireNextImageKHR(
+	
+		device,
 		swapChain,
 		std::numeric_limits< uint64_t >::max(),
 		imageAvailableSemaphores[currentFrame],
 		VK_NULL_HANDLE,
 		&imageIndex
 	
-	);
+	);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+	
+		recreateSwapChain();
+		return;
+	
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+	
+		logger.log(ERROR_LOG, "Failed to acquire swap chain image!");
+	
+	}
+
+	updateUniformBuffers(static_cast< uint32_t >(currentFrame));
+	recordCommandBuffers(static_cast< uint32_t >(currentFrame), imageIndex);
+
+	VkSubmitInfo submitInfo				= {};
+	submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	VkSemaphore waitSemaphores[]		= {imageAvailableSemaphores[currentFrame]};
+	VkPipelineStageFlags waitStages[]	= {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+	submitInfo.waitSemaphoreCount		= 1;
+	submitInfo.pWaitSemaphores			= waitSemaphores;
+	submitInfo.pWaitDstStageMask		= waitStages;
+	submitInfo.commandBufferCount		= 1;
+	submitInfo.pCommandBuffers			= &commandBuffers[currentFrame][imageIndex];
+
+	VkSemaphore signalSemaphores[]		= {renderFinishedSemaphores[currentFrame]};
+	submitInfo.signalSemaphoreCount		= 1;
+	submitInfo.pSignalSemaphores		= signalSemaphores;
+
+	frameTimelineValues[currentFrame] = graphicsTimeline.submit(graphicsQueue, submitInfo);
+	fillRateQueries.submitted(static_cast< uint32_t >(currentFrame));
+
+	VkPresentInfoKHR presentInfo		= {};
+	presentInfo.sType					= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount		= 1;
+	presentInfo.pWaitSemaphores			= signalSemaphores;
+
+	VkSwapchainKHR swapChains[]			= {swapChain};
+	presentInfo.swapchainCount			= 1;
+	presentInfo.pSwapchains				= swapChains;
+	presentInfo.pImageIndices			= &imageIndex;
+	presentInfo.pResults				= nullptr;
+
+	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+	// CPU-side interval between present calls, the closest measure without display timing extensions
+	double presentTime = glfwGetTime();
+	if (lastPresentTime > 0.0) {
+
+		double interval				= presentTime - lastPresentTime;
+		presentIntervalSum			+= interval;
+		presentIntervalSquareSum	+= interval * interval;
+		presentIntervalMax			= std::max(presentIntervalMax, interval);
+		presentIntervalCount++;
+
+	}
+	lastPresentTime = presentTime;
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+	
+		framebufferResized = false;
+		recreateSwapChain();
+	
+	}
+	else if (result != VK_SUCCESS) {
+	
+		logger.log(ERROR_LOG, "Failed to present swap chain image!");
+	
+	}
+
+	currentFrame = (currentFrame + 1) % framesInFlight;
+
+}
+
+/*
+*	Function:		void setPresentProfile(PresentProfile profile_)
+*	Purpose:		Switches between the low latency and high throughput presentation setup before the next frame
+*
+*/
+void Engine::setPresentProfile(PresentProfile profile_) {
+
+	if (profile_ == presentProfile) {
+
+		return;
+
+	}
+
+	presentProfile			= profile_;
+	presentProfileChanged	= true;
+	requestRedraw();
+
+}
+
+/*
+*	Function:		uint32_t getFramesInFlight(PresentProfile profile_)
+*	Purpose:		Returns how many frames the CPU may record ahead in the given profile
+*
+*/
+uint32_t Engine::getFramesInFlight(PresentProfile profile_) {
+
+	if (profile_ == PRESENT_PROFILE_LOW_LATENCY) {
+
+		return 1;
+
+	}
+	return std::min(std::max(static_cast< uint32_t >(GAME_FRAMES_IN_FLIGHT), 2u), MAX_FRAMES_IN_FLIGHT);
+
+}
+
+/*
+*	Function:		void applyPresentProfile()
+*	Purpose:		Rebuilds only the swapchain and what is sized by its image count, render pass, pipelines and secondary command buffers stay valid
+*					If the surface extent changed in the meantime, everything sized by it is rebuilt through recreateSwapChain instead
+*
+*/
+void Engine::applyPresentProfile(void) {
+
+	// slots above the new count stay allocated but idle, every slot waits on its own timeline value before reuse
+	framesInFlight		= getFramesInFlight(presentProfile);
+	currentFrame		= 0;
+	lastPresentTime		= 0.0;
+
+	VkExtent2D extent	= chooseSwapExtent(querySwapChainSupport(physicalDevice).capabilities);
+	if (extent.width != swapChainExtent.width || extent.height != swapChainExtent.height) {
+
+		recreateSwapChain();
+		return;
+
+	}
+
+	// no device wait: the old swapchain is handed over to the new one and retired with its views and framebuffers
+	VkSwapchainKHR oldSwapChain = swapChain;
+	retireSwapChain();
+
+	createSwapChain(oldSwapChain);
+	createImageViews();
+	createFramebuffers();
+	allocatePrimaryCommandBuffers();
+
+}
+
+/*
+*	Function:		void recreateSwapChain()
+*	Purpose:		Recreates the swapchain on window_ resize events and more
+*
+*/
+void Engine::recreateSwapChain(void) {
+
+	int width = 0, height = 0;
+	while (width == 0 || height == 0) {
+	
+		glfwGetFramebufferSize(
+		
+			window,
+			&width,
+			&height
+		
+		);
+	
+		glfwWaitEvents();
+
+	}
+
+	// no device wait: the old resources are retired and the old swapchain is handed over to the new one
+	VkSwapchainKHR oldSwapChain = swapChain;
+	cleanupSwapChain();
+
+	createSwapChain(oldSwapChain);
+	createImageViews();
+	createRenderPass();
+	createDescriptorPool();
+	createColorResources();
+	createDepthResources();
+	createFramebuffers();
+	createPipelines();
+	allocatePrimaryCommandBuffers();
+	invalidateScene();
+
+}
+
+/*
+*	Function:		void cleanupSwapChain()
+*	Purpose:		Retires objects, that are needed for swapchain recreation, they are destroyed once no frame in flight uses them
+*
+*/
+void Engine::cleanupSwapChain(void) {
+
+	objectPipeline.destroy();
+
+	lightingPipeline.destroy();
+
+	if (deferredShading) {
+
+		deferredPipeline.destroy();
+		gBuffer.destroy();
+
+	}
+
+	descriptorPool.reset();
+	lightingDescriptorPool.reset();
+	deferredDescriptorPool.reset();
+	colorImageView.reset();
+	colorImage.reset();
+	colorImageMemory.reset();
+	depthImageView.reset();
+	depthImage.reset();
+	depthImageMemory.reset();
+
+	// the swapchain images are still being presented, they go on their own once the presentation engine is done with them
+	retireSwapChain();
+
+	// the members are overwritten by the following create calls, the frames in flight still use these
+	VkRenderPass oldRenderPass							= renderPass;
+	VkRenderPass oldOcclusionRenderPass					= occlusionRenderPass;
+
+	retire([=] () {
+
+		vkDestroyRenderPass(
+		
+			device,
+			oldRenderPass,
+			nullptr
+	
+		);
+
+		vkDestroyRenderPass(
+
+			device,
+			oldOcclusionRenderPass,
+			nullptr
+
+		);
+
+	});
+
+}
+
+/*
+*	Function:		void retireSwapChain()
+*	Purpose:		Retires the swapchain with its image views and framebuffers, the members are left to be overwritten by the create calls
+*					Presents are not tracked by the graphics timeline, so an empty submission behind the last present fences them on the present queue
+*
+*/
+void Engine::retireSwapChain(void) {
+
+	std::vector< VkFramebuffer > oldFramebuffers		= swapChainFramebuffers;
+	std::vector< VkImageView > oldImageViews			= swapChainImageViews;
+	VkSwapchainKHR oldSwapChain							= swapChain;
+
+	VkFenceCreateInfo fenceInfo							= {};
+	fenceInfo.sType										= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence presentFence;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &presentFence) != VK_SUCCESS
+		|| vkQueueSubmit(presentQueue, 0, nullptr, presentFence) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to fence the last present!");
+
+	}
+
+	// by the time the frames rendered to the old images finished, their presents have almost always finished too, the wait only covers the rest
+	retire([=] () {
+
+		vkWaitForFences(
+
+			device,
+			1,
+			&presentFence,
+			VK_TRUE,
+			std::numeric_limits< uint64_t >::max()
+
+		);
+		vkDestroyFence(
+
+			device,
+			presentFence,
+			nullptr
+
+		);
+
+		for (size_t i = 0; i < oldFramebuffers.size(); i++) {
+
+			vkDestroyFramebuffer(
+			
+				device,
+				oldFramebuffers[i], 
+				nullptr
+		
+			);
+
+		}
+
+		for (size_t i = 0; i < oldImageViews.size(); i++) {
+
+			vkDestroyImageView(
+			
+				device, 
+				oldImageViews[i], 
+				nullptr
+		
+			);
+
+		}
+
+		vkDestroySwapchainKHR(
+		
+			device,
+			oldSwapChain,
+			nullptr
+	
+		);
+
+	});
+
+}
+
+/*
+*	Function:		static void framebufferResizeCallback(
+*
+*						GLFWwindow*		window_, 
+*						int				width_,
+*						int				height_
+*	
+*					)
+*	Purpose:		GLFW-callback function on window_ resize event
+*
+*/
+void Engine::framebufferResizeCallback(
+	
+	GLFWwindow*		window_,
+	int				width_,
+	int				height_
+
+) {
+
+	auto app = reinterpret_cast< Engine* >(glfwGetWindowUserPointer(window_));
+	app->framebufferResized = true;
+	app->requestRedraw();
+
+	std::string log = "Framebuffer resized to: " + std::to_string(width_) + " / " + std::to_string(height_);
+
+	logger.log(EVENT_LOG, log);
+
+}
+
+/*
+*	Function:		uint32_t findMemoryType(uint32_t typeFilter_, VkMemoryPropertyFlags properties_)
+*	Purpose:		Find memory type to use for vertex data
+*
+*/
+uint32_t Engine::findMemoryType(uint32_t typeFilter_, VkMemoryPropertyFlags properties_) {
+
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+	
+		if ((typeFilter_ & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties_) == properties_) {
+		
+			return i;
+		
+		}
+	
+	}
+
+	logger.log(ERROR_LOG, "Failed to find suitable memory type!");
+
+	return -1;
+
+}
+
+/*
+*	Function:		void createBuffer(
+*			
+*						VkDeviceSize				size_,
+*						VkBufferUsageFlags			usage_,
+*						VkMemoryPropertyFlags		properties_,
+*						VkBuffer&					buffer_, 
+*						VkDeviceMemory&				bufferMemory_
+*
+*					)
+*	Purpose:		Creates a valid VkBuffer handle
+*
+*/
+void Engine::createBuffer(
+	
+	VkDeviceSize				size_,
+	VkBufferUsageFlags			usage_,
+	VkMemoryPropertyFlags		properties_,
+	VkBuffer&					buffer_, 
+	VkDeviceMemory&				bufferMemory_
+
+) {
+
+	VkBufferCreateInfo bufferInfo		= {};
+	bufferInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size						= size_;
+	bufferInfo.usage					= usage_;
+	bufferInfo.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(
+		
+		device,
+		&bufferInfo,
+		nullptr, 
+		&buffer_
+	
+	) != VK_SUCCESS) {
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		logger.log(ERROR_LOG, "Failed to create buffer!");
+
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(
+		
+		device,
+		buffer_,
+		&memRequirements
 	
-		recreateSwapChain();
-		return;
+	);
+
+	VkMemoryAllocateInfo allocInfo		= {};
+	allocInfo.sType						= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize			= memRequirements.size;
+	allocInfo.memoryTypeIndex			= findMemoryType(memRequirements.memoryTypeBits, properties_);
+
+	if (vkAllocateMemory(
+		
+		device,
+		&allocInfo,
+		nullptr,
+		&bufferMemory_
 	
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to allocate buffer memory!");
+
 	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+
+	vkBindBufferMemory(
+		
+		device,
+		buffer_,
+		bufferMemory_,
+		0
 	
-		logger.log(ERROR_LOG, "Failed to acquire swap chain image!");
+	);
+
+}
+
+/*
+*	Function:		void copyBuffer(
+*	
+*						VkBuffer srcBuffer_
+*						VkBuffer dstBuffer_
+*						VkDeviceSize size_
+*					)
+*	Purpose:		Copies a source buffer_ to a destination buffer_
+*
+*/
+void Engine::copyBuffer(
+
+	VkBuffer		srcBuffer_,
+	VkBuffer		dstBuffer_,
+	VkDeviceSize	size_
+
+) {
+
+	VkCommandBuffer commandBuffer		= beginSingleTimeCommands();
+
+	VkBufferCopy copyRegion				= {};
+	copyRegion.size						= size_;
+	vkCmdCopyBuffer(
+		
+		commandBuffer, 
+		srcBuffer_, 
+		dstBuffer_,
+		1, 
+		&copyRegion
 	
+	);
+
+	endSingleTimeCommands(commandBuffer);
+
+}
+
+/*
+*	Function:		void copyBuffer(
+*
+*						VkBuffer								srcBuffer_,
+*						VkBuffer								dstBuffer_,
+*						const std::vector< VkBufferCopy >&		regions_
+*
+*					)
+*	Purpose:		Copies the regions_ of a source buffer_ to a destination buffer_ in one submission
+*
+*/
+void Engine::copyBuffer(
+
+	VkBuffer								srcBuffer_,
+	VkBuffer								dstBuffer_,
+	const std::vector< VkBufferCopy >&		regions_
+
+) {
+
+	VkCommandBuffer commandBuffer		= beginSingleTimeCommands();
+
+	vkCmdCopyBuffer(
+
+		commandBuffer,
+		srcBuffer_,
+		dstBuffer_,
+		static_cast< uint32_t >(regions_.size()),
+		regions_.data()
+
+	);
+
+	endSingleTimeCommands(commandBuffer);
+
+}
+
+/*
+*	Function:		void createDescriptorSetLayout()
+*	Purpose:		Creates the descriptor set for uniform buffers
+*
+*/
+void Engine::createDescriptorSetLayout(void) {
+
+
+
+}
+
+/*
+*	Function:		void createUniformBuffers()
+*	Purpose:		Creates uniform buffers for each frame and puts them into an array
+*
+*/
+void Engine::createUniformBuffers(void) {
+
+
+
+}
+
+/*
+*	Function:		void createEntityBuffers()
+*	Purpose:		Creates the per-frame storage buffers holding the world matrix of every entity
+*
+*/
+void Engine::createEntityBuffers(void) {
+
+	entityBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	entityBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	entityBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT, nullptr);
+	entityBufferCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	entityBufferVersions.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	entityMaterialVersions.resize(MAX_FRAMES_IN_FLIGHT, 0);
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+		reserveEntityBuffer(i, 1024);
+
 	}
 
-	updateUniformBuffers(imageIndex);
+}
 
-	VkSubmitInfo submitInfo				= {};
-	submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+/*
+*	Function:		bool reserveEntityBuffer(uint32_t frame_, size_t count_)
+*	Purpose:		Grows the entity buffer of frame_ to hold at least count_ matrices, returns true if it was reallocated
+*
+*/
+bool Engine::reserveEntityBuffer(uint32_t frame_, size_t count_) {
 
-	VkSemaphore waitSemaphores[]		= {imageAvailableSemaphores[currentFrame]};
-	VkPipelineStageFlags waitStages[]	= {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount		= 1;
-	submitInfo.pWaitSemaphores			= waitSemaphores;
-	submitInfo.pWaitDstStageMask		= waitStages;
-	submitInfo.commandBufferCount		= 1;
-	submitInfo.pCommandBuffers			= &commandBuffers[imageIndex];
+	if (count_ <= entityBufferCapacities[frame_]) {
 
-	VkSemaphore signalSemaphores[]		= {renderFinishedSemaphores[currentFrame]};
-	submitInfo.signalSemaphoreCount		= 1;
-	submitInfo.pSignalSemaphores		= signalSemaphores;
+		return false;
+
+	}
+
+	// world matrices first, normal matrices, instance and material indices behind them, 1024 entries keep every range aligned for any device
+	size_t capacity				= std::max(std::max(count_, entityBufferCapacities[frame_] * 2), static_cast< size_t >(1024));
+	capacity					= (capacity + 1023) & ~static_cast< size_t >(1023);
+	VkDeviceSize bufferSize		= (2 * sizeof(glm::mat4) + 2 * sizeof(uint32_t)) * capacity;
+
+	// retired, the frames still in flight keep reading the old buffer
+	entityBuffers[frame_].reset();
+	entityBuffersMemory[frame_].reset();
+
+	createBuffer(
+
+		bufferSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		entityBuffers[frame_].replace(device),
+		entityBuffersMemory[frame_].replace(device)
+
+	);
 
-	vkResetFences(
+	void* data;
+	vkMapMemory(
 
 		device,
-		1,
-		&inFlightFences[currentFrame]
+		entityBuffersMemory[frame_],
+		0,
+		bufferSize,
+		0,
+		&data
 
 	);
+	entityBuffersMapped[frame_]			= static_cast< glm::mat4* >(data);
+	entityBufferCapacities[frame_]		= capacity;
+
+	// recorded draws pass the entity index as the first instance, so the instance indices of the CPU path are the identity
+	uint32_t* instanceIndices			= reinterpret_cast< uint32_t* >(entityBuffersMapped[frame_] + 2 * capacity);
+	for (size_t i = 0; i < capacity; i++) {
+
+		instanceIndices[i] = static_cast< uint32_t >(i);
 
-	if (vkQueueSubmit(
-	
-		graphicsQueue,
-		1,
-		&submitInfo,
-		inFlightFences[currentFrame]
-	
-	) != VK_SUCCESS) {
-	
-		logger.log(ERROR_LOG, "Failed to submit draw buffer command!");
-	
 	}
 
-	VkPresentInfoKHR presentInfo		= {};
-	presentInfo.sType					= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount		= 1;
-	presentInfo.pWaitSemaphores			= signalSemaphores;
+	if (!objectPipeline.descriptorSets.empty()) {
 
-	VkSwapchainKHR swapChains[]			= {swapChain};
-	presentInfo.swapchainCount			= 1;
-	presentInfo.pSwapchains				= swapChains;
-	presentInfo.pImageIndices			= &imageIndex;
-	presentInfo.pResults				= nullptr;
+		writeEntityBufferDescriptors(frame_);
 
-	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+
+	return true;
+
+}
+
+/*
+*	Function:		void writeEntityBufferDescriptors(uint32_t frame_)
+*	Purpose:		Points the entity buffer bindings of both pipelines at the entity buffer of frame_
+*					The instance indices come from the culling pass when rendering GPU-driven and from the draw batches when culling on the CPU draws indirectly
+*
+*/
+void Engine::writeEntityBufferDescriptors(uint32_t frame_) {
+
+	VkDeviceSize rangeSize										= sizeof(glm::mat4) * entityBufferCapacities[frame_];
+
+	VkDescriptorBufferInfo bufferInfo							= {};
+	bufferInfo.buffer											= entityBuffers[frame_];
+	bufferInfo.offset											= 0;
+	bufferInfo.range											= rangeSize;
+
+	VkDescriptorBufferInfo normalBufferInfo						= {};
+	normalBufferInfo.buffer										= entityBuffers[frame_];
+	normalBufferInfo.offset										= rangeSize;
+	normalBufferInfo.range										= rangeSize;
+
+	VkDescriptorBufferInfo instanceBufferInfo					= {};
+	if (gpuDrivenRendering) {
+
+		instanceBufferInfo										= gpuCulling.getInstanceIndexBufferInfo(frame_);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
-	
-		framebufferResized = false;
-		recreateSwapChain();
-	
 	}
-	else if (result != VK_SUCCESS) {
-	
-		logger.log(ERROR_LOG, "Failed to present swap chain image!");
-	
+	else if (indirectBatching) {
+
+		instanceBufferInfo										= drawBatches.getInstanceIndexBufferInfo(frame_);
+
+	}
+	else {
+
+		instanceBufferInfo.buffer								= entityBuffers[frame_];
+		instanceBufferInfo.offset								= 2 * rangeSize;
+		instanceBufferInfo.range								= sizeof(uint32_t) * entityBufferCapacities[frame_];
+
 	}
 
-	vkQueueWaitIdle(presentQueue);
+	VkDescriptorBufferInfo materialIndexBufferInfo				= {};
+	materialIndexBufferInfo.buffer								= entityBuffers[frame_];
+	materialIndexBufferInfo.offset								= 2 * rangeSize + sizeof(uint32_t) * entityBufferCapacities[frame_];
+	materialIndexBufferInfo.range								= sizeof(uint32_t) * entityBufferCapacities[frame_];
+
+	std::array< VkWriteDescriptorSet, 6 > descriptorWrites		= {};
+	descriptorWrites[0].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet									= objectPipeline.descriptorSets[frame_];
+	descriptorWrites[0].dstBinding								= 3;
+	descriptorWrites[0].dstArrayElement							= 0;
+	descriptorWrites[0].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[0].descriptorCount							= 1;
+	descriptorWrites[0].pBufferInfo								= &bufferInfo;
+	descriptorWrites[1].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet									= lightingPipeline.descriptorSets[frame_];
+	descriptorWrites[1].dstBinding								= 1;
+	descriptorWrites[1].dstArrayElement							= 0;
+	descriptorWrites[1].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[1].descriptorCount							= 1;
+	descriptorWrites[1].pBufferInfo								= &bufferInfo;
+	descriptorWrites[2].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet									= objectPipeline.descriptorSets[frame_];
+	descriptorWrites[2].dstBinding								= 4;
+	descriptorWrites[2].dstArrayElement							= 0;
+	descriptorWrites[2].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[2].descriptorCount							= 1;
+	descriptorWrites[2].pBufferInfo								= &normalBufferInfo;
+	descriptorWrites[3].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[3].dstSet									= objectPipeline.descriptorSets[frame_];
+	descriptorWrites[3].dstBinding								= 5;
+	descriptorWrites[3].dstArrayElement							= 0;
+	descriptorWrites[3].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[3].descriptorCount							= 1;
+	descriptorWrites[3].pBufferInfo								= &instanceBufferInfo;
+	descriptorWrites[4].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[4].dstSet									= lightingPipeline.descriptorSets[frame_];
+	descriptorWrites[4].dstBinding								= 2;
+	descriptorWrites[4].dstArrayElement							= 0;
+	descriptorWrites[4].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[4].descriptorCount							= 1;
+	descriptorWrites[4].pBufferInfo								= &instanceBufferInfo;
+	descriptorWrites[5].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[5].dstSet									= objectPipeline.descriptorSets[frame_];
+	descriptorWrites[5].dstBinding								= 6;
+	descriptorWrites[5].dstArrayElement							= 0;
+	descriptorWrites[5].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[5].descriptorCount							= 1;
+	descriptorWrites[5].pBufferInfo								= &materialIndexBufferInfo;
+
+	vkUpdateDescriptorSets(
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		device,
+		static_cast< uint32_t >(descriptorWrites.size()),
+		descriptorWrites.data(),
+		0,
+		nullptr
+
+	);
 
 }
 
 /*
-*	Function:		void recreateSwapChain()
-*	Purpose:		Recreates the swapchain on window_ resize events and more
+*	Function:		void createMaterialTable()
+*	Purpose:		Creates the material table with the default material as entry 0, which every new entity uses
 *
 */
-void Engine::recreateSwapChain(void) {
+void Engine::createMaterialTable(void) {
 
-	int width = 0, height = 0;
-	while (width == 0 || height == 0) {
-	
-		glfwGetFramebufferSize(
-		
-			window,
-			&width,
-			&height
-		
-		);
-	
-		glfwWaitEvents();
+	materialTable.init(MAX_FRAMES_IN_FLIGHT);
 
-	}
+	MaterialBufferObject material	= {};
+	material.ambient				= glm::vec3(1.0f, 0.5f, 0.31f);
+	material.diffuse				= glm::vec3(1.0f, 0.5f, 0.31f);
+	material.specular				= glm::vec3(0.5f, 0.5f, 0.5f);
+	material.shininess				= 128.0f;
+	material.texture				= DESCRIPTOR_HEAP_NONE;
+	material.sampler				= 0;
+	materialTable.add(material);
 
-	vkDeviceWaitIdle(device);
+}
 
-	cleanupSwapChain();
+/*
+*	Function:		void writeMaterialTableDescriptor(uint32_t frame_)
+*	Purpose:		Points the material binding of the object pipeline at the material table buffer of frame_
+*
+*/
+void Engine::writeMaterialTableDescriptor(uint32_t frame_) {
 
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createDescriptorPool();
-	createPipelines();
-	createColorResources();
-	createDepthResources();
-	createFramebuffers();
-	recordCommandBuffers();
+	VkDescriptorBufferInfo bufferInfo			= materialTable.getBufferInfo(frame_);
+
+	VkWriteDescriptorSet descriptorWrite		= {};
+	descriptorWrite.sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet						= objectPipeline.descriptorSets[frame_];
+	descriptorWrite.dstBinding					= 2;
+	descriptorWrite.dstArrayElement				= 0;
+	descriptorWrite.descriptorType				= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount				= 1;
+	descriptorWrite.pBufferInfo					= &bufferInfo;
+
+	vkUpdateDescriptorSets(
+
+		device,
+		1,
+		&descriptorWrite,
+		0,
+		nullptr
+
+	);
 
 }
 
 /*
-*	Function:		void cleanupSwapChain()
-*	Purpose:		Cleans objects, that are needed for swapchain recreation
+*	Function:		void createLights()
+*	Purpose:		Creates the light buffers and the scene's point lights, the first one follows the animated light cube
 *
 */
-void Engine::cleanupSwapChain(void) {
+void Engine::createLights(void) {
+
+	clusteredLighting.init(MAX_FRAMES_IN_FLIGHT);
+
+	// reaches the whole scene from its orbit, it fades out well beyond the chalet
+	PointLight light;
+	light.position		= glm::vec3(0.0f, 20.0f, 0.0f);
+	light.radius		= 100.0f;
+	light.color			= glm::vec3(1.0f, 1.0f, 1.0f);
+	light.intensity		= 1.0f;
+	lights.push_back(light);
+
+#if defined GAME_DEMO_LIGHTS
+	std::mt19937 random(7);
+	std::uniform_real_distribution< float > positionDistribution(-3.0f, 3.0f);
+	std::uniform_real_distribution< float > radiusDistribution(0.5f, 1.5f);
+	std::uniform_real_distribution< float > colorDistribution(0.2f, 1.0f);
+	for (uint32_t i = 0; i < GAME_DEMO_LIGHTS; i++) {
+
+		light.position		= glm::vec3(positionDistribution(random), positionDistribution(random) * 0.5f + 0.5f, positionDistribution(random));
+		light.radius		= radiusDistribution(random);
+		light.color			= glm::vec3(colorDistribution(random), colorDistribution(random), colorDistribution(random));
+		lights.push_back(light);
 
-	objectPipeline.destroy();
+	}
+#endif
 
-	lightingPipeline.destroy();
+}
 
-	vkDestroyDescriptorPool(
+/*
+*	Function:		void writeLightingDescriptors(uint32_t frame_)
+*	Purpose:		Points the light bindings of the pipeline that shades, the object pipeline or the deferred one, at the light buffer of frame_
+*
+*/
+void Engine::writeLightingDescriptors(uint32_t frame_) {
+
+	VkDescriptorSet descriptorSet								= deferredShading ? deferredPipeline.descriptorSets[frame_] : objectPipeline.descriptorSets[frame_];
+	VkDescriptorBufferInfo lightBufferInfo						= clusteredLighting.getLightBufferInfo(frame_);
+	VkDescriptorBufferInfo clusterBufferInfo					= clusteredLighting.getClusterBufferInfo(frame_);
+	VkDescriptorBufferInfo indexBufferInfo						= clusteredLighting.getIndexBufferInfo(frame_);
+
+	std::array< VkWriteDescriptorSet, 3 > descriptorWrites		= {};
+	descriptorWrites[0].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet									= descriptorSet;
+	descriptorWrites[0].dstBinding								= 7;
+	descriptorWrites[0].dstArrayElement							= 0;
+	descriptorWrites[0].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[0].descriptorCount							= 1;
+	descriptorWrites[0].pBufferInfo								= &lightBufferInfo;
+	descriptorWrites[1].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet									= descriptorSet;
+	descriptorWrites[1].dstBinding								= 8;
+	descriptorWrites[1].dstArrayElement							= 0;
+	descriptorWrites[1].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[1].descriptorCount							= 1;
+	descriptorWrites[1].pBufferInfo								= &clusterBufferInfo;
+	descriptorWrites[2].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet									= descriptorSet;
+	descriptorWrites[2].dstBinding								= 9;
+	descriptorWrites[2].dstArrayElement							= 0;
+	descriptorWrites[2].descriptorType							= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[2].descriptorCount							= 1;
+	descriptorWrites[2].pBufferInfo								= &indexBufferInfo;
+
+	vkUpdateDescriptorSets(
 
 		device,
-		descriptorPool,
+		static_cast< uint32_t >(descriptorWrites.size()),
+		descriptorWrites.data(),
+		0,
 		nullptr
 
 	);
 
-	vkDestroyDescriptorPool(
+}
 
-		device,
-		lightingDescriptorPool,
-		nullptr
+/*
+*	Function:		void updateEntityBuffer(uint32_t frame_)
+*	Purpose:		Copies the world matrices of all entities into the entity buffer of frame_ if they changed since its last use
+*
+*/
+void Engine::updateEntityBuffer(uint32_t frame_) {
 
-	);
+	// a reallocated buffer means new descriptors, which invalidates the recorded command buffers
+	if (reserveEntityBuffer(frame_, scene.size())) {
 
-	vkDestroyImageView(
-	
-		device,
-		colorImageView,
-		nullptr	
-	);
+		invalidateScene();
+		entityBufferVersions[frame_]	= 0;
+		entityMaterialVersions[frame_]	= 0;
 
-	vkDestroyImage(
-	
-		device,
-		colorImage,
-		nullptr
-	
-	);
+	}
 
-	vkFreeMemory(
-	
-		device,
-		colorImageMemory,
-		nullptr
-	
-	);
+	if (entityMaterialVersions[frame_] != scene.getMaterialVersion()) {
 
-	vkDestroyImageView(
-		
-		device,
-		depthImageView,
-		nullptr
-	
-	);
+		entityMaterialVersions[frame_] = scene.getMaterialVersion();
+		if (scene.size() > 0) {
 
-	vkDestroyImage(
-	
-		device,
-		depthImage,
-		nullptr
-	
-	);
+			memcpy(
 
-	vkFreeMemory(
-	
-		device,
-		depthImageMemory,
-		nullptr
+				reinterpret_cast< uint32_t* >(entityBuffersMapped[frame_] + 2 * entityBufferCapacities[frame_]) + entityBufferCapacities[frame_],
+				scene.getMaterialIndices(),
+				sizeof(uint32_t) * scene.size()
 
-	);
+			);
 
-	for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
+		}
 
-		vkDestroyFramebuffer(
-			
-			device,
-			swapChainFramebuffers[i], 
-			nullptr
-		
-		);
+	}
+
+	if (entityBufferVersions[frame_] == scene.getTransformVersion()) {
+
+		return;
 
 	}
+	entityBufferVersions[frame_] = scene.getTransformVersion();
 
-	vkFreeCommandBuffers(
-		
-		device,
-		commandPool,
-		static_cast< uint32_t >(commandBuffers.size()),
-		commandBuffers.data()
-	
-	);
+	if (scene.size() > 0) {
 
-	vkDestroyRenderPass(
-		
-		device,
-		renderPass,
-		nullptr
-	
-	);
+		memcpy(
 
-	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+			entityBuffersMapped[frame_],
+			scene.getWorldMatrices(),
+			sizeof(glm::mat4) * scene.size()
 
-		vkDestroyImageView(
-			
-			device, 
-			swapChainImageViews[i], 
-			nullptr
-		
 		);
+		memcpy(
 
-	}
+			entityBuffersMapped[frame_] + entityBufferCapacities[frame_],
+			scene.getNormalMatrices(),
+			sizeof(glm::mat4) * scene.size()
 
-	vkDestroySwapchainKHR(
-		
-		device,
-		swapChain,
-		nullptr
-	
-	);
+		);
+
+	}
 
 }
 
 /*
-*	Function:		static void framebufferResizeCallback(
-*
-*						GLFWwindow*		window_, 
-*						int				width_,
-*						int				height_
-*	
-*					)
-*	Purpose:		GLFW-callback function on window_ resize event
+*	Function:		void updateUniformBuffers(uint32_t frame_)
+*	Purpose:		Updates uniform buffers (transformation matrices) every frame
 *
 */
-void Engine::framebufferResizeCallback(
+void Engine::updateUniformBuffers(uint32_t frame_) {
+
+	// the simulation thread owns the camera and the animation, only its interpolated snapshot is read here
+	SimulationState state								= simulation.sample();
+	Camera view											= state.getCamera();
+	glm::vec3 lightPos									= state.lightPosition;
 	
-	GLFWwindow*		window_,
-	int				width_,
-	int				height_
+	objectPipeline.ubo.view								= view.getViewMatrix();
+	objectPipeline.ubo.proj								= glm::perspective(glm::radians(view.zoom), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 100.0f);
+	objectPipeline.ubo.proj[1][1]						*= -1;
 
-) {
+	objectPipeline.updateUBOs(frame_);
 
-	auto app = reinterpret_cast< Engine* >(glfwGetWindowUserPointer(window_));
-	app->framebufferResized = true;
+	// lights are assigned to the clusters of this frame's camera before their buffer is filled
+	lights[0].position									= lightPos;
+	clusteredLighting.assign(jobSystem, lights.data(), lights.size(), objectPipeline.ubo.view, objectPipeline.ubo.proj, 0.1f, 100.0f);
+	if (clusteredLighting.update(frame_)) {
 
-	std::string log = "Framebuffer resized to: " + std::to_string(width_) + " / " + std::to_string(height_);
+		writeLightingDescriptors(frame_);
+		invalidateScene();
 
-	logger.log(EVENT_LOG, log);
+	}
 
-}
+	objectPipeline.lbo.ambientColor						= glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	objectPipeline.lbo.viewPos							= glm::vec4(view.position, 1.0f);
+	objectPipeline.lbo.clusterScale						= clusteredLighting.getClusterScale(static_cast< float >(swapChainExtent.width), static_cast< float >(swapChainExtent.height));
+	objectPipeline.lbo.clusterCounts					= glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0);
 
-/*
-*	Function:		uint32_t findMemoryType(uint32_t typeFilter_, VkMemoryPropertyFlags properties_)
-*	Purpose:		Find memory type to use for vertex data
-*
-*/
-uint32_t Engine::findMemoryType(uint32_t typeFilter_, VkMemoryPropertyFlags properties_) {
+	objectPipeline.updateLBOs(frame_);
 
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+	if (deferredShading) {
+
+		// the lighting subpass goes from depth back to world space, so it gets the inverse camera
+		deferredPipeline.ubo.view						= glm::inverse(objectPipeline.ubo.view);
+		deferredPipeline.ubo.proj						= glm::inverse(objectPipeline.ubo.proj);
+		deferredPipeline.lbo							= objectPipeline.lbo;
+
+		deferredPipeline.updateUBOs(frame_);
+		deferredPipeline.updateLBOs(frame_);
+
+	}
 
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
 	
-		if ((typeFilter_ & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties_) == properties_) {
-		
-			return i;
-		
+	lightingPipeline.ubo.view							= view.getViewMatrix();
+	lightingPipeline.ubo.proj							= glm::perspective(glm::radians(view.zoom), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 100.0f);
+	lightingPipeline.ubo.proj[1][1]						*= -1;
+
+	lightingPipeline.updateUBOs(frame_);
+
+	scene.setTransform(chaletEntity, state.objectTransform);
+	scene.setTransform(lightingCubeEntity, state.lightingTransform);
+	scene.updateTransforms(jobSystem);
+	updateEntityBuffer(frame_);
+
+	// materials are only copied where they changed, a grown table needs its new buffer in the frame's descriptor set
+	if (materialTable.update(frame_)) {
+
+		writeMaterialTableDescriptor(frame_);
+		invalidateScene();
+
+	}
+
+	// without descriptor indexing the heap writes reach a frame's set only now, which the recorded command buffers have bound
+	if (descriptorHeap.update(frame_)) {
+
+		invalidateScene();
+
+	}
+
+	// a grown or compacted geometry pool means new buffers and possibly new offsets for every mesh
+	if (geometryPool.getVersion() != geometryVersion) {
+
+		for (auto& obj : objects) {
+
+			obj->updateMeshInfo();
+
 		}
-	
+		geometryVersion = geometryPool.getVersion();
+		invalidateScene();
+
 	}
 
-	logger.log(ERROR_LOG, "Failed to find suitable memory type!");
+	if (gpuDrivenRendering) {
 
-	return -1;
+		cullSceneOnGpu(frame_, objectPipeline.ubo.proj * objectPipeline.ubo.view);
+
+	}
+	else {
+
+		cullScene(frame_, objectPipeline.ubo.proj * objectPipeline.ubo.view);
+
+	}
 
 }
 
 /*
-*	Function:		void createBuffer(
-*			
-*						VkDeviceSize				size_,
-*						VkBufferUsageFlags			usage_,
-*						VkMemoryPropertyFlags		properties_,
-*						VkBuffer&					buffer_, 
-*						VkDeviceMemory&				bufferMemory_
+*	Function:		void updateSceneBvh()
+*	Purpose:		Brings the bounding volume hierarchy up to date with the world bounds, rebuilding it after entities were added or removed and refitting it after they moved
 *
-*					)
-*	Purpose:		Creates a valid VkBuffer handle
+*/
+void Engine::updateSceneBvh(void) {
+
+	sceneBvh.update(jobSystem, scene.getWorldBounds(), scene.size(), scene.getStructureVersion(), scene.getTransformVersion());
+
+}
+
+/*
+*	Function:		void cullScene(uint32_t frame_, const glm::mat4& viewProjection_)
+*	Purpose:		Collects the entities inside the view frustum from the bounding volume hierarchy and rebuilds the list of entities to record
+*					Drawing indirectly, the visible entities only go to the draw batches of frame_, otherwise the command buffers are re-recorded if they changed
 *
 */
-void Engine::createBuffer(
-	
-	VkDeviceSize				size_,
-	VkBufferUsageFlags			usage_,
-	VkMemoryPropertyFlags		properties_,
-	VkBuffer&					buffer_, 
-	VkDeviceMemory&				bufferMemory_
+void Engine::cullScene(uint32_t frame_, const glm::mat4& viewProjection_) {
 
-) {
+	viewProjection				= viewProjection_;
+	size_t entityCount			= scene.size();
+	updateSceneBvh();
 
-	VkBufferCreateInfo bufferInfo		= {};
-	bufferInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size						= size_;
-	bufferInfo.usage					= usage_;
-	bufferInfo.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
+	nextVisibleEntities.clear();
+	sceneBvh.cullFrustum(Frustum::fromViewProjection(viewProjection_), nextVisibleEntities);
 
-	if (vkCreateBuffer(
-		
-		device,
-		&bufferInfo,
-		nullptr, 
-		&buffer_
-	
-	) != VK_SUCCESS) {
+	cullingStats.occluded		= 0;
+	if (softwareOcclusionCulling) {
 
-		logger.log(ERROR_LOG, "Failed to create buffer!");
+		// the visible occluders are drawn first, everything inside the frustum is then tested against them
+		const glm::mat4* worldMatrices	= scene.getWorldMatrices();
+		const ObjectHandle* meshes		= scene.getMeshes();
+		occluders.clear();
+		for (uint32_t entity : nextVisibleEntities) {
+
+			const OccluderMesh* occluder = getObject(meshes[entity])->getOccluder();
+			if (occluder != nullptr) {
+
+				occluders.push_back({ occluder, worldMatrices[entity] });
+
+			}
+
+		}
+		softwareOcclusion.render(jobSystem, viewProjection_, occluders.data(), occluders.size());
+		cullingStats.occluded	= softwareOcclusion.cull(jobSystem, scene.getWorldBounds(), nextVisibleEntities);
 
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(
-		
-		device,
-		buffer_,
-		&memRequirements
-	
-	);
+	sortVisibleEntities(viewProjection_);
 
-	VkMemoryAllocateInfo allocInfo		= {};
-	allocInfo.sType						= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize			= memRequirements.size;
-	allocInfo.memoryTypeIndex			= findMemoryType(memRequirements.memoryTypeBits, properties_);
+	cullingStats.drawn			= static_cast< uint32_t >(nextVisibleEntities.size());
+	cullingStats.culled			= static_cast< uint32_t >(entityCount - nextVisibleEntities.size());
+	drawnSum					+= cullingStats.drawn;
+	culledSum					+= cullingStats.culled;
 
-	if (vkAllocateMemory(
-		
-		device,
-		&allocInfo,
-		nullptr,
-		&bufferMemory_
-	
-	) != VK_SUCCESS) {
+	if (indirectBatching) {
 
-		logger.log(ERROR_LOG, "Failed to allocate buffer memory!");
+		// neither the visible set nor its depth order are recorded, only a reallocated draw buffer makes the command buffers stale
+		if (drawBatches.update(frame_, scene, sceneGeneration, renderQueue.data(), renderQueue.size())) {
+
+			writeEntityBufferDescriptors(frame_);
+			invalidateScene();
+
+		}
+		bindStats.unsortedBinds	= drawBatches.getUnsortedBinds();
+		return;
 
 	}
 
-	vkBindBufferMemory(
-		
-		device,
-		buffer_,
-		bufferMemory_,
-		0
-	
-	);
+	if (nextVisibleEntities != visibleEntities) {
+
+		visibleEntities.swap(nextVisibleEntities);
+		sceneGeneration++;
+
+	}
 
 }
 
 /*
-*	Function:		void copyBuffer(
-*	
-*						VkBuffer srcBuffer_
-*						VkBuffer dstBuffer_
-*						VkDeviceSize size_
-*					)
-*	Purpose:		Copies a source buffer_ to a destination buffer_
+*	Function:		void sortVisibleEntities(const glm::mat4& viewProjection_)
+*	Purpose:		Orders the visible entities by pipeline, material and mesh, and front to back within those, so recording binds each state once
+*					Equal keys keep the culling order, which keeps the order and with it the recorded command buffers stable between frames
 *
 */
-void Engine::copyBuffer(
+void Engine::sortVisibleEntities(const glm::mat4& viewProjection_) {
 
-	VkBuffer		srcBuffer_,
-	VkBuffer		dstBuffer_,
-	VkDeviceSize	size_
+	const ObjectHandle* meshes				= scene.getMeshes();
+	const MaterialHandle* entityMaterials	= scene.getMaterials();
+	const Bounds* worldBounds				= scene.getWorldBounds();
+	glm::vec4 depthRow						= glm::vec4(viewProjection_[0][3], viewProjection_[1][3], viewProjection_[2][3], viewProjection_[3][3]);
 
-) {
+	renderQueue.clear();
+	for (uint32_t entity : nextVisibleEntities) {
+
+		// clip w of the bounds center is its distance along the view direction
+		Pipeline* material	= getMaterial(entityMaterials[entity]);
+		float depth			= glm::dot(depthRow, glm::vec4(worldBounds[entity].center, 1.0f));
+		renderQueue.push(RenderQueue::makeKey(
+
+			RENDER_QUEUE_PASS_OPAQUE,
+			renderQueue.getStateId(material),
+			entityMaterials[entity].index,
+			meshes[entity].index,
+			depth
+
+		), entity);
+
+	}
+	renderQueue.sort();
 
-	VkCommandBuffer commandBuffer		= beginSingleTimeCommands();
+	const RenderItem* items					= renderQueue.data();
+	for (size_t i = 0; i < renderQueue.size(); i++) {
 
-	VkBufferCopy copyRegion				= {};
-	copyRegion.size						= size_;
-	vkCmdCopyBuffer(
-		
-		commandBuffer, 
-		srcBuffer_, 
-		dstBuffer_,
-		1, 
-		&copyRegion
-	
-	);
+		nextVisibleEntities[i] = items[i].entity;
 
-	endSingleTimeCommands(commandBuffer);
+	}
 
 }
 
 /*
-*	Function:		void createDescriptorSetLayout()
-*	Purpose:		Creates the descriptor set for uniform buffers
+*	Function:		void cullSceneOnGpu(uint32_t frame_, const glm::mat4& viewProjection_)
+*	Purpose:		Hands the view projection and the entity bounds to the culling pass of frame_, which decides what gets drawn on the GPU
+*					The stats are the ones of the last time frame_ was rendered, the counter cannot be read back any earlier
 *
 */
-void Engine::createDescriptorSetLayout(void) {
+void Engine::cullSceneOnGpu(uint32_t frame_, const glm::mat4& viewProjection_) {
+
+	viewProjection				= viewProjection_;
+	uint32_t entityCount		= static_cast< uint32_t >(scene.size());
+
+	cullingStats.drawn			= std::min(gpuCulling.getVisibleCount(frame_), entityCount);
+	cullingStats.culled			= entityCount - cullingStats.drawn;
+	drawnSum					+= cullingStats.drawn;
+	culledSum					+= cullingStats.culled;
 
+	// reallocated culling buffers mean a new instance index buffer for the vertex shaders
+	if (gpuCulling.update(frame_, scene, sceneGeneration, viewProjection_)) {
 
+		writeEntityBufferDescriptors(frame_);
+		invalidateScene();
+
+	}
 
 }
 
 /*
-*	Function:		void createUniformBuffers()
-*	Purpose:		Creates uniform buffers for each frame and puts them into an array
+*	Function:		CullingStats getCullingStats()
+*	Purpose:		Returns how many entities were drawn and culled last frame
 *
 */
-void Engine::createUniformBuffers(void) {
+CullingStats Engine::getCullingStats(void) {
 
-	/*VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	return cullingStats;
 
-	uniformBuffers.resize(swapChainImages.size());
-	uniformBuffersMemory.resize(swapChainImages.size());
+}
 
-	lightUniformBuffers.resize(swapChainImages.size());
-	lightUniformBuffersMemory.resize(swapChainImages.size());
+/*
+*	Function:		BindStats getBindStats()
+*	Purpose:		Returns the state binds of the last time the command buffers were recorded on the CPU culling path
+*					Drawing indirectly, the binds an unsorted recording would take are the ones of the last frame's visible entities
+*
+*/
+BindStats Engine::getBindStats(void) {
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-	
-		createBuffer(
-			
-			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			uniformBuffers[i],
-			uniformBuffersMemory[i]
-		
-		);
-		createBuffer(
-		
-			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			lightUniformBuffers[i],
-			lightUniformBuffersMemory[i]
-		
-		);
-	
-	}*/
+	return bindStats;
 
 }
 
 /*
-*	Function:		void updateUniformBuffers(uint32_t currentImage_)
-*	Purpose:		Updates uniform buffers (transformation matrices) every frame
+*	Function:		Entity pick(double xPos_, double yPos_)
+*	Purpose:		Returns the entity whose bounds the camera ray through the window coordinates hits first, a null handle if none
 *
 */
-void Engine::updateUniformBuffers(uint32_t currentImage_) {
+Entity Engine::pick(double xPos_, double yPos_) {
 
-	static auto startTime								= std::chrono::high_resolution_clock::now();
-	auto currentTime									= std::chrono::high_resolution_clock::now();
-	float time											= std::chrono::duration< float, std::chrono::seconds::period >(currentTime - startTime).count();
-	
-	objectPipeline.ubo.model							= glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	//objectPipeline.ubo.model							= glm::scale(glm::mat4(1.0f), glm::vec3(0.01f));
-	objectPipeline.ubo.model							= glm::rotate(objectPipeline.ubo.model, time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	objectPipeline.ubo.view								= camera.getViewMatrix();
-	objectPipeline.ubo.proj								= glm::perspective(glm::radians(camera.zoom), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 100.0f);
-	objectPipeline.ubo.proj[1][1]						*= -1;
+	int width;
+	int height;
+	glfwGetWindowSize(window, &width, &height);
+	if (width == 0 || height == 0) {
 
-	objectPipeline.updateUBOs(currentImage_);
+		return Entity();
 
-	float lightRadius									= 10;//glm::sin(time * 3);
-	glm::vec3 lightPos									= glm::vec3(glm::sin(time) * lightRadius, 20.0f, glm::cos(time) * 3.0f * lightRadius);
+	}
 
-	objectPipeline.lbo.lightColor						= glm::vec3(1.0f, 1.0f, 1.0f);
-	objectPipeline.lbo.objectColor						= glm::vec3(255.0f / 255.0f, 255.0f / 255.0f, 255.0f / 255.0f);		// R, G, B
-	objectPipeline.lbo.lightPos							= lightPos;
-	objectPipeline.lbo.viewPos							= camera.position;
+	// window coordinates to clip space, the projection already flips y for Vulkan, so y grows downwards in both
+	float x							= static_cast< float >(2.0 * xPos_ / width - 1.0);
+	float y							= static_cast< float >(2.0 * yPos_ / height - 1.0);
+	glm::mat4 inverseViewProjection	= glm::inverse(viewProjection);
+	glm::vec4 nearPoint				= inverseViewProjection * glm::vec4(x, y, 0.0f, 1.0f);
+	glm::vec4 farPoint				= inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+	glm::vec3 origin				= glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction				= glm::vec3(farPoint) / farPoint.w - origin;
 
-	objectPipeline.updateLBOs(currentImage_);
+	updateSceneBvh();
+	BvhHit hit						= sceneBvh.raycast(origin, glm::normalize(direction), glm::length(direction));
+	return hit.item == UINT32_MAX ? Entity() : scene.getEntity(hit.item);
 
-	objectPipeline.mbo.ambient							= glm::vec3(1.0f, 0.5f, 0.31f);
-	objectPipeline.mbo.diffuse							= glm::vec3(1.0f, 0.5f, 0.31f);
-	objectPipeline.mbo.specular							= glm::vec3(0.5f, 0.5f, 0.5f);
-	objectPipeline.mbo.shininess						= 128.0f;
+}
 
-	objectPipeline.updateMBOs(currentImage_);
-	
-	lightingPipeline.ubo.model							= glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	lightingPipeline.ubo.model							= glm::translate(lightingPipeline.ubo.model, lightPos);
-	lightingPipeline.ubo.model							= glm::scale(lightingPipeline.ubo.model, glm::vec3(0.4f));
-	lightingPipeline.ubo.model							= glm::rotate(lightingPipeline.ubo.model, time * glm::radians(-30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	lightingPipeline.ubo.view							= camera.getViewMatrix();
-	lightingPipeline.ubo.proj							= glm::perspective(glm::radians(camera.zoom), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 100.0f);
-	lightingPipeline.ubo.proj[1][1]						*= -1;
+/*
+*	Function:		void queryNearby(const glm::vec3& center_, float radius_, std::vector< Entity >& result_)
+*	Purpose:		Appends every entity whose bounds overlap the sphere to result_
+*
+*/
+void Engine::queryNearby(const glm::vec3& center_, float radius_, std::vector< Entity >& result_) {
 
-	lightingPipeline.updateUBOs(currentImage_);
+	updateSceneBvh();
+
+	std::vector< uint32_t > indices;
+	sceneBvh.querySphere(center_, radius_, indices);
+	for (uint32_t index : indices) {
+
+		result_.push_back(scene.getEntity(index));
+
+	}
 
 }
 
@@ -2482,26 +4675,25 @@ void Engine::updateUniformBuffers(uint32_t currentImage_) {
 */
 void Engine::createDescriptorPool(void) {
 
-	std::array< VkDescriptorPoolSize, 3 > poolSizes			= {};
+	// camera and lighting uniforms, entity, normal, instance and material index buffers, the material table and the clustered lights
+	std::array< VkDescriptorPoolSize, 2 > poolSizes			= {};
 	poolSizes[0].type										= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount							= static_cast< uint32_t >(swapChainImages.size());
-	poolSizes[1].type										= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[1].descriptorCount							= static_cast< uint32_t >(swapChainImages.size());
-	poolSizes[2].type										= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[2].descriptorCount							= static_cast< uint32_t >(swapChainImages.size());
+	poolSizes[0].descriptorCount							= 2 * MAX_FRAMES_IN_FLIGHT;
+	poolSizes[1].type										= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount							= 8 * MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorPoolCreateInfo poolInfo						= {};
 	poolInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount									= static_cast< uint32_t >(poolSizes.size());
 	poolInfo.pPoolSizes										= poolSizes.data();
-	poolInfo.maxSets										= static_cast< uint32_t >(swapChainImages.size());
+	poolInfo.maxSets										= MAX_FRAMES_IN_FLIGHT;
 
 	if (vkCreateDescriptorPool(
 	
 		device,
 		&poolInfo,
 		nullptr,
-		&descriptorPool
+		&descriptorPool.replace(device)
 	
 	) != VK_SUCCESS) {
 	
@@ -2509,22 +4701,24 @@ void Engine::createDescriptorPool(void) {
 	
 	}
 
-	std::array< VkDescriptorPoolSize, 1 > lightingPoolSizes					= {};
+	std::array< VkDescriptorPoolSize, 2 > lightingPoolSizes					= {};
 	lightingPoolSizes[0].type												= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	lightingPoolSizes[0].descriptorCount									= static_cast< uint32_t >(swapChainImages.size());
+	lightingPoolSizes[0].descriptorCount									= MAX_FRAMES_IN_FLIGHT;
+	lightingPoolSizes[1].type												= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	lightingPoolSizes[1].descriptorCount									= 2 * MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorPoolCreateInfo lightingPoolInfo								= {};
 	lightingPoolInfo.sType													= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	lightingPoolInfo.poolSizeCount											= static_cast< uint32_t >(lightingPoolSizes.size());
 	lightingPoolInfo.pPoolSizes												= lightingPoolSizes.data();
-	lightingPoolInfo.maxSets												= static_cast< uint32_t >(swapChainImages.size());
+	lightingPoolInfo.maxSets												= MAX_FRAMES_IN_FLIGHT;
 
 	if (vkCreateDescriptorPool(
 
 		device,
 		&lightingPoolInfo,
 		nullptr,
-		&lightingDescriptorPool
+		&lightingDescriptorPool.replace(device)
 
 	) != VK_SUCCESS) {
 
@@ -2532,124 +4726,50 @@ void Engine::createDescriptorPool(void) {
 
 	}
 
-}
-
-/*
-*	Function:		void createDescriptorSets()
-*	Purpose:		Finally creates the descriptor sets (for each image_ in the swapchain)
-*	
-*/
-void Engine::createDescriptorSets(void) {
-
-	/*std::vector< VkDescriptorSetLayout > layouts(swapChainImages.size(), objectDescriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo		= {};
-	allocInfo.sType								= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool					= descriptorPool;
-	allocInfo.descriptorSetCount				= static_cast< uint32_t >(swapChainImages.size());
-	allocInfo.pSetLayouts						= layouts.data();
-
-	objectDescriptorSets.resize(swapChainImages.size());
-
-	if (vkAllocateDescriptorSets(
-	
-		device,
-		&allocInfo,
-		objectDescriptorSets.data()
-
-	) != VK_SUCCESS) {
-	
-		logger.log(ERROR_LOG, "Failed to allocate descriptor sets!");
-	
-	}
+	if (!deferredShading) {
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-	
-		VkDescriptorBufferInfo bufferInfo									= {};
-		bufferInfo.buffer													= uniformBuffers[i];
-		bufferInfo.offset													= 0;
-		bufferInfo.range													= sizeof(UniformBufferObject);
-
-		VkDescriptorImageInfo imageInfo										= {};
-		imageInfo.imageLayout												= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView													= textureImageView;
-		imageInfo.sampler													= textureSampler;
-		
-		std::array< VkWriteDescriptorSet, 2> descriptorWrites				= {};
-		descriptorWrites[0].sType											= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet											= objectDescriptorSets[i];
-		descriptorWrites[0].dstBinding										= 0;
-		descriptorWrites[0].dstArrayElement									= 0;
-		descriptorWrites[0].descriptorType									= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount									= 1;
-		descriptorWrites[0].pBufferInfo										= &bufferInfo;
-		descriptorWrites[1].sType											= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet											= objectDescriptorSets[i];
-		descriptorWrites[1].dstBinding										= 1;
-		descriptorWrites[1].dstArrayElement									= 0;
-		descriptorWrites[1].descriptorType									= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount									= 1;
-		descriptorWrites[1].pImageInfo										= &imageInfo;
-
-		vkUpdateDescriptorSets(
-		
-			device,
-			static_cast< uint32_t >(descriptorWrites.size()),
-			descriptorWrites.data(),
-			0,
-			nullptr
-		
-		);
+		return;
 
 	}
 
-	std::vector< VkDescriptorSetLayout > lightingLayouts(swapChainImages.size(), lightingDescriptorSetLayout);
-	VkDescriptorSetAllocateInfo lightingAllocInfo		= {};
-	lightingAllocInfo.sType										= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	lightingAllocInfo.descriptorPool							= lightingDescriptorPool;
-	lightingAllocInfo.descriptorSetCount						= static_cast< uint32_t >(swapChainImages.size());
-	lightingAllocInfo.pSetLayouts								= lightingLayouts.data();
-
-	lightingDescriptorSets.resize(swapChainImages.size());
+	// camera and lighting uniforms, the clustered lights and the G-buffer
+	std::array< VkDescriptorPoolSize, 3 > deferredPoolSizes					= {};
+	deferredPoolSizes[0].type												= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	deferredPoolSizes[0].descriptorCount									= 2 * MAX_FRAMES_IN_FLIGHT;
+	deferredPoolSizes[1].type												= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	deferredPoolSizes[1].descriptorCount									= 3 * MAX_FRAMES_IN_FLIGHT;
+	deferredPoolSizes[2].type												= VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	deferredPoolSizes[2].descriptorCount									= 3 * MAX_FRAMES_IN_FLIGHT;
+
+	VkDescriptorPoolCreateInfo deferredPoolInfo								= {};
+	deferredPoolInfo.sType													= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	deferredPoolInfo.poolSizeCount											= static_cast< uint32_t >(deferredPoolSizes.size());
+	deferredPoolInfo.pPoolSizes												= deferredPoolSizes.data();
+	deferredPoolInfo.maxSets												= MAX_FRAMES_IN_FLIGHT;
 
-	if (vkAllocateDescriptorSets(
+	if (vkCreateDescriptorPool(
 
 		device,
-		&lightingAllocInfo,
-		lightingDescriptorSets.data()
+		&deferredPoolInfo,
+		nullptr,
+		&deferredDescriptorPool.replace(device)
 
 	) != VK_SUCCESS) {
 
-		logger.log(ERROR_LOG, "Failed to allocate descriptor sets!");
+		logger.log(ERROR_LOG, "Failed to create descriptor pool!");
 
 	}
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-
-		VkDescriptorBufferInfo bufferInfo							= {};
-		bufferInfo.buffer											= lightUniformBuffers[i];
-		bufferInfo.offset											= 0;
-		bufferInfo.range											= sizeof(UniformBufferObject);
-
-		std::array< VkWriteDescriptorSet, 1> descriptorWrites		= {};
-		descriptorWrites[0].sType									= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet									= lightingDescriptorSets[i];
-		descriptorWrites[0].dstBinding								= 0;
-		descriptorWrites[0].dstArrayElement							= 0;
-		descriptorWrites[0].descriptorType							= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount							= 1;
-		descriptorWrites[0].pBufferInfo								= &bufferInfo;
-
-		vkUpdateDescriptorSets(
+}
 
-			device,
-			static_cast< uint32_t >(descriptorWrites.size()),
-			descriptorWrites.data(),
-			0,
-			nullptr
+/*
+*	Function:		void createDescriptorSets()
+*	Purpose:		Finally creates the descriptor sets (for each frame in flight)
+*	
+*/
+void Engine::createDescriptorSets(void) {
 
-		);
 
-	}*/
 
 }
 
@@ -2752,20 +4872,25 @@ void Engine::createTextureImage(void) {
 	
 	);
 
-	vkDestroyBuffer(
+	// the copy is still in flight, the staging buffer goes once it completed
+	retire([=] () {
+
+		vkDestroyBuffer(
 		
-		device, 
-		stagingBuffer, 
-		nullptr
+			device, 
+			stagingBuffer, 
+			nullptr
 	
-	);
-	vkFreeMemory(
+		);
+		vkFreeMemory(
 		
-		device, 
-		stagingBufferMemory, 
-		nullptr
+			device, 
+			stagingBufferMemory, 
+			nullptr
 	
-	);
+		);
+
+	});
 
 	generateMipmaps(
 	
@@ -2911,11 +5036,33 @@ VkCommandBuffer Engine::beginSingleTimeCommands() {
 }
 
 /*
-*	Function:		void endSingleTimeCommands(VkCommandBuffer commandBuffer_)
-*	Purpose:		Ends execution of command buffer_
+*	Function:		uint64_t endSingleTimeCommands(VkCommandBuffer commandBuffer_)
+*	Purpose:		Ends and submits command buffer_ without waiting for it, returns the timeline value its completion signals
+*					Resources the commands read from have to be retired, not destroyed, the command buffer itself is freed the same way
 *	
 */
-void Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer_) {
+uint64_t Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer_) {
+
+	// everything submitted later on the queue is in the second scope of this barrier, so uploads are visible to the frames without waiting on the host
+	VkMemoryBarrier barrier			= {};
+	barrier.sType					= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask			= VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask			= VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+
+		commandBuffer_,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+
+	);
 
 	vkEndCommandBuffer(commandBuffer_);
 
@@ -2924,24 +5071,22 @@ void Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer_) {
 	submitInfo.commandBufferCount	= 1;
 	submitInfo.pCommandBuffers		= &commandBuffer_;
 
-	vkQueueSubmit(
-		
-		graphicsQueue,
-		1,
-		&submitInfo,
-		VK_NULL_HANDLE
-	
-	);
-	vkQueueWaitIdle(graphicsQueue);
+	uint64_t value					= graphicsTimeline.submit(graphicsQueue, submitInfo);
 
-	vkFreeCommandBuffers(
-		
-		device,
-		commandPool,
-		1, 
-		&commandBuffer_
-	
-	);
+	retire([=] () {
+
+		vkFreeCommandBuffers(
+
+			device,
+			commandPool,
+			1,
+			&commandBuffer_
+
+		);
+
+	});
+
+	return value;
 
 }
 
@@ -3234,6 +5379,14 @@ void Engine::createTextureSampler(void) {
 */
 void Engine::createDepthResources(void) {
 
+	// the deferred path keeps its depth with the rest of the G-buffer
+	if (deferredShading) {
+
+		gBuffer.create(swapChainExtent);
+		return;
+
+	}
+
 	VkFormat depthFormat = findDepthFormat();
 
 	createImage(
@@ -3244,21 +5397,21 @@ void Engine::createDepthResources(void) {
 		msaaSamples,
 		depthFormat,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusionCulling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0),
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depthImage, 
-		depthImageMemory
+		depthImage.replace(device), 
+		depthImageMemory.replace(device)
 	
 	);
 
-	depthImageView = createImageView(
+	depthImageView = UniqueImageView(device, createImageView(
 		
 		depthImage,
 		depthFormat,
 		VK_IMAGE_ASPECT_DEPTH_BIT,
 		1
 
-	);
+	));
 
 	transitionImageLayout(
 	
@@ -3270,6 +5423,19 @@ void Engine::createDepthResources(void) {
 
 	);
 
+	if (occlusionCulling) {
+
+		depthPyramid.create(
+
+			depthImage,
+			depthImageView,
+			VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0),
+			swapChainExtent
+
+		);
+
+	}
+
 }
 
 /*
@@ -3357,10 +5523,15 @@ bool Engine::hasStencilComponent(VkFormat format_) {
 */
 void Engine::loadModels(void) {
 
-	chalet				= new Model(CHALET_PATH, &objectPipeline);
-	objects.emplace_back(chalet);
-	lightingCube		= new Cube(&lightingPipeline);
-	objects.emplace_back(lightingCube);
+	Object* cube			= new Cube();
+	jobSystem.wait(&loadingCounter);
+	loadedChalet->upload();
+	chalet					= addObject(loadedChalet);
+	lightingCube			= addObject(cube);
+	cube->setOccluder(true);
+
+	chaletEntity			= createEntity(chalet, objectMaterial);
+	lightingCubeEntity		= createEntity(lightingCube, lightingMaterial);
 
 }
 
@@ -3389,6 +5560,8 @@ void Engine::keyboardInputCallback(
 
 	static unsigned int consoleCount = 0;
 
+	engine.requestRedraw();
+
 	if (action_ == GLFW_PRESS) {
 
 		switch (key_) {
@@ -3396,8 +5569,14 @@ void Engine::keyboardInputCallback(
 			case GLFW_KEY_ESCAPE:
 				glfwSetWindowShouldClose(window_, GLFW_TRUE);
 				break;
+			case GLFW_KEY_F1:
+				engine.setPresentProfile(PRESENT_PROFILE_LOW_LATENCY);
+				break;
+			case GLFW_KEY_F2:
+				engine.setPresentProfile(PRESENT_PROFILE_HIGH_THROUGHPUT);
+				break;
 			case GLFW_KEY_LEFT_CONTROL:
-				engine.camera.disableInput();
+				engine.simulation.setInputEnabled(false);
 				glfwSetInputMode(
 
 					engine.window,
@@ -3433,7 +5612,7 @@ void Engine::keyboardInputCallback(
 		switch(key_) {
 		
 			case GLFW_KEY_LEFT_CONTROL:
-				engine.camera.enableInput();
+				engine.simulation.setInputEnabled(true);
 				glfwSetInputMode(
 
 					engine.window,
@@ -3644,6 +5823,13 @@ VkSampleCountFlagBits Engine::getMaxUsableSampleCount(void) {
 */
 void Engine::createColorResources(void) {
 
+	// the deferred path renders single sampled straight into the swapchain
+	if (deferredShading) {
+
+		return;
+
+	}
+
 	VkFormat colorFormat = swapChainImageFormat;
 
 	createImage(
@@ -3656,19 +5842,19 @@ void Engine::createColorResources(void) {
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		colorImage,
-		colorImageMemory
+		colorImage.replace(device),
+		colorImageMemory.replace(device)
 	
 	);
 
-	colorImageView = createImageView(
+	colorImageView = UniqueImageView(device, createImageView(
 	
 		colorImage,
 		colorFormat,
 		VK_IMAGE_ASPECT_COLOR_BIT, 
 		1
 
-	);
+	));
 
 	transitionImageLayout(
 	
@@ -3714,7 +5900,8 @@ void Engine::mouseCallback(
 	engine.lastX			= xPos_;
 	engine.lastY			= yPos_;
 
-	engine.camera.processMouseMovement(static_cast< float >(xOffset), static_cast< float >(yOffset));
+	engine.simulation.addMouseMovement(static_cast< float >(xOffset), static_cast< float >(yOffset));
+	engine.requestRedraw();
 
 }
 
@@ -3737,7 +5924,129 @@ void Engine::scrollCallback(
 
 ) {
 
-	engine.camera.processMouseScroll(static_cast< float >(yOffset_));
+	engine.simulation.addMouseScroll(static_cast< float >(yOffset_));
+	engine.requestRedraw();
+
+}
+
+/*
+*	Function:		void mouseButtonCallback(
+*
+*						GLFWwindow*			window_,
+*						int					button_,
+*						int					action_,
+*						int					mods_
+*
+*					)
+*	Purpose:		Mouse button callback function for GLFW, a left click picks the entity under the cursor or, while the camera owns the cursor, in the center of the screen
+*
+*/
+void Engine::mouseButtonCallback(
+
+	GLFWwindow*			window_,
+	int					button_,
+	int					action_,
+	int					mods_
+
+) {
+
+	if (button_ != GLFW_MOUSE_BUTTON_LEFT || action_ != GLFW_PRESS) {
+
+		return;
+
+	}
+
+	double xPos = engine.lastX;
+	double yPos = engine.lastY;
+	if (glfwGetInputMode(window_, GLFW_CURSOR) == GLFW_CURSOR_DISABLED) {
+
+		int width;
+		int height;
+		glfwGetWindowSize(window_, &width, &height);
+		xPos = width / 2.0;
+		yPos = height / 2.0;
+
+	}
+
+	Entity entity = engine.pick(xPos, yPos);
+	if (!entity.isNull()) {
+
+		logger.log(EVENT_LOG, "Picked entity " + std::to_string(entity.index) + " (generation " + std::to_string(entity.generation) + ")");
+
+	}
+
+}
+
+/*
+*	Function:		static void windowFocusCallback(GLFWwindow* window_, int focused_)
+*	Purpose:		Throttles rendering while the window is in the background
+*
+*/
+void Engine::windowFocusCallback(GLFWwindow* window_, int focused_) {
+
+	engine.windowFocused = focused_ == GLFW_TRUE;
+	engine.updateFrameRateLimit();
+	engine.requestRedraw();
+
+}
+
+/*
+*	Function:		static void windowIconifyCallback(GLFWwindow* window_, int iconified_)
+*	Purpose:		Stops rendering while the window is minimized
+*
+*/
+void Engine::windowIconifyCallback(GLFWwindow* window_, int iconified_) {
+
+	engine.windowIconified = iconified_ == GLFW_TRUE;
+	engine.requestRedraw();
+
+}
+
+/*
+*	Function:		static void windowRefreshCallback(GLFWwindow* window_)
+*	Purpose:		Redraws when the window contents were damaged, e.g. by an overlapping window
+*
+*/
+void Engine::windowRefreshCallback(GLFWwindow* window_) {
+
+	engine.requestRedraw();
+
+}
+
+/*
+*	Function:		void updateFrameRateLimit()
+*	Purpose:		Applies the configured frame rate, capped to unfocusedFPS in the background when rendering on demand
+*
+*/
+void Engine::updateFrameRateLimit(void) {
+
+	double frameRate = targetFrameRate;
+	if (renderOnDemand && !windowFocused) {
+
+		frameRate = frameRate > 0.0 ? std::min(frameRate, unfocusedFPS) : unfocusedFPS;
+
+	}
+	if (frameRate != framePacer.getTargetRate()) {
+
+		framePacer.setTargetRate(frameRate);
+
+	}
+
+}
+
+/*
+*	Function:		bool needsRedraw()
+*	Purpose:		Returns true if the last rendered image is outdated
+*
+*/
+bool Engine::needsRedraw(void) {
+
+	if (redrawRequested.exchange(false)) {
+
+		return true;
+
+	}
+	return simulation.hasChangedSince(lastRenderTime);
 
 }
 
@@ -3777,26 +6086,11 @@ void Engine::createCamera(void) {
 */
 void Engine::queryKeyboardGLFW(void) {
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-
-		camera.processKeyboard(FORWARD, static_cast< float >(DELTATIME));
-
-	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-
-		camera.processKeyboard(BACKWARD, static_cast< float >(DELTATIME));
-
-	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-
-		camera.processKeyboard(LEFT, static_cast< float >(DELTATIME));
-
-	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-
-		camera.processKeyboard(RIGHT, static_cast< float >(DELTATIME));
-
-	}
+	// GLFW may only be polled here, the simulation integrates the held keys at its own fixed tick
+	simulation.setMovement(FORWARD, glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS);
+	simulation.setMovement(BACKWARD, glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS);
+	simulation.setMovement(LEFT, glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS);
+	simulation.setMovement(RIGHT, glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS);
 
 }
 
@@ -30,6 +30,9 @@
 #include <conio.h>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 
 #include "Logger.hpp"
 #include "QueueFamilyIndices.cpp"
@@ -46,6 +49,27 @@
 #include "Pipeline.hpp"
 #include "LightingBufferObject.cpp"
 #include "Cube.hpp"
+#include "JobSystem.hpp"
+#include "Simulation.hpp"
+#include "FramePacer.hpp"
+#include "GpuTimeline.hpp"
+#include "DeletionQueue.hpp"
+#include "VulkanHandle.hpp"
+#include "HandlePool.hpp"
+#include "Scene.hpp"
+#include "SimdMath.hpp"
+#include "Bvh.hpp"
+#include "GpuCulling.hpp"
+#include "DrawBatches.hpp"
+#include "DepthPyramid.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "RenderQueue.hpp"
+#include "GeometryPool.hpp"
+#include "DescriptorHeap.hpp"
+#include "MaterialTable.hpp"
+#include "ClusteredLighting.hpp"
+#include "GBuffer.hpp"
+#include "FillRateQueries.hpp"
 
 #ifdef NDEBUG
 	const bool enableValidationLayers = false;
@@ -56,6 +80,36 @@
 #define WIDTH 1280
 #define HEIGHT 780
 
+#if !defined GAME_FRAMES_IN_FLIGHT
+	#define GAME_FRAMES_IN_FLIGHT 2
+#endif
+
+enum PresentProfile {
+
+	PRESENT_PROFILE_LOW_LATENCY			= 0,
+	PRESENT_PROFILE_HIGH_THROUGHPUT		= 1
+
+};
+
+struct CullingStats {
+
+	uint32_t		drawn			= 0;		// entities inside the view frustum and not occluded last frame
+	uint32_t		culled			= 0;		// entities rejected by the frustum or the occlusion test last frame
+	uint32_t		occluded		= 0;		// entities inside the view frustum rejected by the software occlusion test last frame
+
+};
+
+struct BindStats {
+
+	uint32_t		draws			= 0;		// draws of the last recording
+	uint32_t		pipelines		= 0;		// pipeline binds of the last recording
+	uint32_t		descriptorSets	= 0;		// descriptor set binds of the last recording
+	uint32_t		vertexBuffers	= 0;		// vertex buffer binds of the last recording
+	uint32_t		indexBuffers	= 0;		// index buffer binds of the last recording
+	uint32_t		unsortedBinds	= 0;		// binds the same draws take when every draw binds all of its state
+
+};
+
 extern Logger											logger;
 
 namespace game {
@@ -90,14 +144,42 @@ public:
 	double												lastY							= HEIGHT / 2;
 	std::mutex											closeStartWindow;
 	const std::string									TITLE							= "VULKANENGINE by D3PSI\0";
-	const unsigned int									MAX_FRAMES_IN_FLIGHT			= 2;
+	const unsigned int									MAX_FRAMES_IN_FLIGHT			= 3;		// per-frame resources are allocated for this many, the profile uses framesInFlight of them
 	float												loadingProgress					= 0.0f;
 	double												DELTATIME;
-	VkDescriptorPool									descriptorPool;
+	UniqueDescriptorPool								descriptorPool;
 	std::vector< VkImage >								swapChainImages;
 	float												MASTER_VOLUME					= 0.5f;
+	std::vector< std::vector< VkCommandPool > >			threadCommandPools;
+	uint32_t											numRecordingThreads;
+	uint64_t											sceneGeneration					= 1;
+	JobSystem											jobSystem;
+	GpuTimeline											graphicsTimeline;
+	DeletionQueue										deletionQueue;
+	Scene												scene;
+	GeometryPool										geometryPool;
+	DescriptorHeap										descriptorHeap;
+	MaterialTable										materialTable;
+	std::vector< PointLight >							lights;							// light 0 follows the animated light cube
 
 	void run(void); 
+	ObjectHandle addObject(Object* object_);
+	void removeObject(ObjectHandle object_);
+	Object* getObject(ObjectHandle object_);
+	Pipeline* getMaterial(MaterialHandle material_);
+	MaterialHandle addMaterial(Pipeline* pipeline_);
+	Entity createEntity(ObjectHandle mesh_, MaterialHandle material_, const Transform& transform_ = Transform(), Entity parent_ = Entity());
+	void destroyEntity(Entity entity_);
+	void retire(std::function< void() > deleter_);
+	void invalidateScene(void);
+	void setTargetFrameRate(double framesPerSecond_);
+	void setRenderOnDemand(bool enabled_);
+	void requestRedraw(void);
+	void setPresentProfile(PresentProfile profile_);
+	CullingStats getCullingStats(void);
+	BindStats getBindStats(void);
+	Entity pick(double xPos_, double yPos_);
+	void queryNearby(const glm::vec3& center_, float radius_, std::vector< Entity >& result_);
 	uint32_t findMemoryType(uint32_t typeFilter_, VkMemoryPropertyFlags properties_);
 	void createBuffer(
 
@@ -115,10 +197,34 @@ public:
 		VkDeviceSize	size_
 
 	);
+	void copyBuffer(
+
+		VkBuffer								srcBuffer_,
+		VkBuffer								dstBuffer_,
+		const std::vector< VkBufferCopy >&		regions_
+
+	);
+	void createImage(
+
+		uint32_t					width_,
+		uint32_t					height_,
+		uint32_t					mipLevels_, 
+		VkSampleCountFlagBits		numSamples_,
+		VkFormat					format_,
+		VkImageTiling				tiling_,
+		VkImageUsageFlags			usage_,
+		VkMemoryPropertyFlags		properties_,
+		VkImage&					image_,
+		VkDeviceMemory&				imageMemory_
+
+	);
 private:
 	VkResult											result;
 	GLFWwindow*											window;
 	StartWindow*										startWindow;
+	std::thread											startWindowThread;
+	JobCounter											audioCounter;
+	JobCounter											loadingCounter;
 	const std::string									CHALET_PATH						= "res/models/chalet/source/chaletblend.obj";
 	const std::string									TEXTURE_PATH					= "res/models/chalet/textures/chalet.jpg";
 	GLFWmonitor*										monitor							= nullptr; 
@@ -145,13 +251,63 @@ private:
 	VkExtent2D											swapChainExtent;
 	std::vector< VkImageView >							swapChainImageViews;
 	VkRenderPass										renderPass;
+	VkRenderPass										occlusionRenderPass				= VK_NULL_HANDLE;		// draws what became visible after occlusion culling on top
 	std::vector< VkFramebuffer >						swapChainFramebuffers;
 	VkCommandPool										commandPool;
-	std::vector< VkCommandBuffer >						commandBuffers;
+	std::vector< VkCommandPool >						frameCommandPools;
+	std::vector< std::vector< VkCommandBuffer > >		commandBuffers;
+	std::vector< std::vector< uint64_t > >				stitchedGenerations;
+	std::vector< uint64_t >								recordedGenerations;
+	std::vector< std::vector< VkCommandBuffer > >		secondaryCommandBuffers;
+	std::vector< UniqueBuffer >							entityBuffers;
+	std::vector< UniqueDeviceMemory >					entityBuffersMemory;
+	std::vector< glm::mat4* >							entityBuffersMapped;
+	std::vector< size_t >								entityBufferCapacities;
+	std::vector< uint64_t >								entityBufferVersions;
+	std::vector< uint64_t >								entityMaterialVersions;
+	Bvh													sceneBvh;
+	glm::mat4											viewProjection					= glm::mat4(1.0f);
+	std::vector< uint32_t >								visibleEntities;
+	std::vector< uint32_t >								nextVisibleEntities;
+	CullingStats										cullingStats;
+	uint64_t											drawnSum						= 0;
+	uint64_t											culledSum						= 0;
+	GpuCulling											gpuCulling;
+	DrawBatches											drawBatches;
+	DepthPyramid										depthPyramid;
+	SoftwareOcclusion									softwareOcclusion;
+	ClusteredLighting									clusteredLighting;
+	GBuffer												gBuffer;
+	FillRateQueries										fillRateQueries;
+	std::vector< OccluderInstance >						occluders;
+	RenderQueue											renderQueue;
+	std::vector< BindStats >							slotBindStats;
+	BindStats											bindStats;
+	uint64_t											geometryVersion					= 0;
 	std::vector< VkSemaphore >							imageAvailableSemaphores;
 	std::vector< VkSemaphore >							renderFinishedSemaphores;
-	std::vector< VkFence >								inFlightFences;
+	std::vector< uint64_t >								frameTimelineValues;
+	bool												physicalDeviceProperties2Enabled	= false;
+	bool												timelineSemaphoreEnabled			= false;
+	bool												descriptorIndexingEnabled			= false;
+	bool												gpuDrivenRendering					= false;
+	bool												indirectBatching					= false;		// CPU culling drawing its batches indirectly
+	bool												drawIndirectCountEnabled			= false;
+	bool												multiDrawIndirectEnabled			= false;
+	bool												occlusionCulling					= false;
+	bool												softwareOcclusionCulling			= false;
+	bool												deferredShading						= false;
+	bool												pipelineStatisticsEnabled			= false;
 	size_t												currentFrame					= 0;
+	uint32_t											framesInFlight					= GAME_FRAMES_IN_FLIGHT;
+	PresentProfile										presentProfile					= PRESENT_PROFILE_HIGH_THROUGHPUT;
+	bool												presentProfileChanged			= false;
+	double												lastPresentTime					= 0.0;
+	double												presentIntervalSum				= 0.0;
+	double												presentIntervalSquareSum		= 0.0;
+	double												presentIntervalMax				= 0.0;
+	uint32_t											presentIntervalCount			= 0;
+	double												fenceWaitTime					= 0.0;
 	bool												framebufferResized				= false;
 	clock_t												current_ticks, delta_ticks;
 	clock_t												fps								= 0;
@@ -160,24 +316,42 @@ private:
 	VkDeviceMemory										textureImageMemory;
 	VkImageView											textureImageView;
 	VkSampler											textureSampler;
-	VkDescriptorPool									lightingDescriptorPool;
-	VkImage												depthImage;
-	VkDeviceMemory										depthImageMemory;
-	VkImageView											depthImageView;
+	UniqueDescriptorPool								lightingDescriptorPool;
+	UniqueDescriptorPool								deferredDescriptorPool;
+	UniqueImage											depthImage;
+	UniqueDeviceMemory									depthImageMemory;
+	UniqueImageView										depthImageView;
 	VkSampleCountFlagBits								msaaSamples						= VK_SAMPLE_COUNT_64_BIT;
-	VkImage												colorImage;
-	VkDeviceMemory										colorImageMemory;
-	VkImageView											colorImageView;
+	UniqueImage											colorImage;
+	UniqueDeviceMemory									colorImageMemory;
+	UniqueImageView										colorImageView;
 	const float											maxFPS							= 60.0f;
-	const float											maxPeriod						= 1.0f / maxFPS; 
+	const double										unfocusedFPS					= 10.0;
+	const double										idleTimeout						= 0.5;
+	FramePacer											framePacer;
+	double												targetFrameRate					= 0.0;
+	std::atomic< bool >									renderOnDemand					{ false };
+	std::atomic< bool >									redrawRequested					{ true };
+	double												lastRenderTime					= 0.0;
+	bool												windowFocused					= true;
+	bool												windowIconified					= false;
 
 	Pipeline											objectPipeline;
 	Pipeline											lightingPipeline;
+	Pipeline											deferredPipeline;					// lighting subpass of the deferred path, one full screen triangle
 
-	Object*												chalet;
-	Object*												lightingCube;
+	Object*												loadedChalet;
+	ObjectHandle										chalet;
+	ObjectHandle										lightingCube;
+	MaterialHandle										objectMaterial;
+	MaterialHandle										lightingMaterial;
+	Entity												chaletEntity;
+	Entity												lightingCubeEntity;
 
-	std::vector< std::unique_ptr< Object > >			objects;
+	HandlePool< std::unique_ptr< Object > >				objects;
+	HandlePool< Pipeline* >								materials;
+
+	Simulation											simulation;
 
 	irrklang::ISoundEngine*								audioEngine;
 	irrklang::ISound*									bgmusic;
@@ -207,22 +381,53 @@ private:
 	void createSurface(void);
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device_);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device_);
+	bool isDeviceExtensionSupported(VkPhysicalDevice device_, const char* extensionName_);
+	bool checkTimelineSemaphoreSupport(VkPhysicalDevice device_);
+	bool checkDescriptorIndexingSupport(VkPhysicalDevice device_);
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device_);
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector< VkSurfaceFormatKHR >& availableFormats_);
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector< VkPresentModeKHR > availablePresentModes_);
+	uint32_t chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities_, VkPresentModeKHR presentMode_);
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilites_);
-	void createSwapChain(void);
+	void createSwapChain(VkSwapchainKHR oldSwapChain_ = VK_NULL_HANDLE);
+	void applyPresentProfile(void);
+	uint32_t getFramesInFlight(PresentProfile profile_);
 	void createImageViews(void);
 	VkShaderModule createShaderModule(const std::vector< char >& code_);
 	void createPipelines(void);
 	void createRenderPass(void);
+	void createDeferredRenderPass(void);
 	void createFramebuffers(void);
 	void createCommandPool(void);
-	void recordCommandBuffers(void);
+	void createFrameCommandPools(void);
+	void allocatePrimaryCommandBuffers(void);
+	void recordCommandBuffers(uint32_t frame_, uint32_t imageIndex_);
+	void recordSecondaryCommandBuffer(
+
+		uint32_t				frame_,
+		uint32_t				slot_,
+		size_t					first_,
+		size_t					last_,
+		bool					late_
+
+	);
+	void createEntityBuffers(void);
+	bool reserveEntityBuffer(uint32_t frame_, size_t count_);
+	void writeEntityBufferDescriptors(uint32_t frame_);
+	void createMaterialTable(void);
+	void writeMaterialTableDescriptor(uint32_t frame_);
+	void createLights(void);
+	void writeLightingDescriptors(uint32_t frame_);
+	void updateEntityBuffer(uint32_t frame_);
+	void updateSceneBvh(void);
+	void cullScene(uint32_t frame_, const glm::mat4& viewProjection_);
+	void sortVisibleEntities(const glm::mat4& viewProjection_);
+	void cullSceneOnGpu(uint32_t frame_, const glm::mat4& viewProjection_);
 	void createSyncObjects(void);
 	void renderFrame(void);
 	void recreateSwapChain(void);
 	void cleanupSwapChain(void);
+	void retireSwapChain(void);
 	static void framebufferResizeCallback(
 		
 		GLFWwindow*		window_, 
@@ -232,26 +437,12 @@ private:
 	);
 	void createDescriptorSetLayout(void);
 	void createUniformBuffers(void);
-	void updateUniformBuffers(uint32_t currentImage_);
+	void updateUniformBuffers(uint32_t frame_);
 	void createDescriptorPool(void);
 	void createDescriptorSets(void);
 	void createTextureImage(void);
-	void createImage(
-
-		uint32_t					width_,
-		uint32_t					height_,
-		uint32_t					mipLevels_, 
-		VkSampleCountFlagBits		numSamples_,
-		VkFormat					format_,
-		VkImageTiling				tiling_,
-		VkImageUsageFlags			usage_,
-		VkMemoryPropertyFlags		properties_,
-		VkImage&					image_,
-		VkDeviceMemory&				imageMemory_
-
-	);
 	VkCommandBuffer beginSingleTimeCommands(void);
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer_);
+	uint64_t endSingleTimeCommands(VkCommandBuffer commandBuffer_);
 	void transitionImageLayout(
 		
 		VkImage				image_, 
@@ -325,6 +516,19 @@ private:
 		double				yOffset_
 	
 	);
+	static void mouseButtonCallback(
+
+		GLFWwindow*			window_,
+		int					button_,
+		int					action_,
+		int					mods_
+
+	);
+	static void windowFocusCallback(GLFWwindow* window_, int focused_);
+	static void windowIconifyCallback(GLFWwindow* window_, int iconified_);
+	static void windowRefreshCallback(GLFWwindow* window_);
+	void updateFrameRateLimit(void);
+	bool needsRedraw(void);
 	void createCamera(void);
 	void queryKeyboardGLFW(void);
 	void init3DAudio(void);
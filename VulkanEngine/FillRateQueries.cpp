@@ -0,0 +1,260 @@
+/*
+*	File:		FillRateQueries.cpp
+*
+*
+*/
+#include "FillRateQueries.hpp"
+#include "Engine.hpp"
+
+extern Engine engine;
+
+/*
+*	Function:		FillRateQueries()
+*	Purpose:		Default constructor
+*
+*/
+FillRateQueries::FillRateQueries(void) : timestampPeriod(1.0f) {
+
+	resetStats();
+
+}
+
+/*
+*	Function:		void init(
+*
+*						uint32_t					frames_,
+*						bool						timestamps_,
+*						float						timestampPeriod_,
+*						bool						statistics_
+*
+*					)
+*	Purpose:		Creates the query pools for frames_ frames in flight, timestamps_ and statistics_ say what the device supports
+*					timestampPeriod_ is the number of nanoseconds a timestamp tick takes
+*
+*/
+void FillRateQueries::init(
+
+	uint32_t					frames_,
+	bool						timestamps_,
+	float						timestampPeriod_,
+	bool						statistics_
+
+) {
+
+	timestampPeriod								= timestampPeriod_;
+	pending.assign(frames_, false);
+
+	if (timestamps_) {
+
+		VkQueryPoolCreateInfo poolInfo			= {};
+		poolInfo.sType							= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType						= VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount						= 2 * frames_;
+
+		if (vkCreateQueryPool(engine.device, &poolInfo, nullptr, &timestampPool.replace(engine.device)) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to create timestamp query pool!");
+
+		}
+
+	}
+
+	if (statistics_) {
+
+		VkQueryPoolCreateInfo poolInfo			= {};
+		poolInfo.sType							= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType						= VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount						= frames_;
+		poolInfo.pipelineStatistics				= VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		if (vkCreateQueryPool(engine.device, &poolInfo, nullptr, &statisticsPool.replace(engine.device)) != VK_SUCCESS) {
+
+			logger.log(ERROR_LOG, "Failed to create pipeline statistics query pool!");
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		void begin(VkCommandBuffer commandBuffer_, uint32_t frame_)
+*	Purpose:		Resets the queries of frame_ and starts measuring, recorded outside of any render pass before the frame's first command
+*
+*/
+void FillRateQueries::begin(VkCommandBuffer commandBuffer_, uint32_t frame_) {
+
+	if (timestampPool != VK_NULL_HANDLE) {
+
+		vkCmdResetQueryPool(commandBuffer_, timestampPool, 2 * frame_, 2);
+		vkCmdWriteTimestamp(commandBuffer_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, 2 * frame_);
+
+	}
+
+	if (statisticsPool != VK_NULL_HANDLE) {
+
+		vkCmdResetQueryPool(commandBuffer_, statisticsPool, frame_, 1);
+		vkCmdBeginQuery(commandBuffer_, statisticsPool, frame_, 0);
+
+	}
+
+}
+
+/*
+*	Function:		void end(VkCommandBuffer commandBuffer_, uint32_t frame_)
+*	Purpose:		Stops measuring, recorded outside of any render pass after the frame's last command
+*
+*/
+void FillRateQueries::end(VkCommandBuffer commandBuffer_, uint32_t frame_) {
+
+	if (statisticsPool != VK_NULL_HANDLE) {
+
+		vkCmdEndQuery(commandBuffer_, statisticsPool, frame_);
+
+	}
+
+	if (timestampPool != VK_NULL_HANDLE) {
+
+		vkCmdWriteTimestamp(commandBuffer_, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 2 * frame_ + 1);
+
+	}
+
+}
+
+/*
+*	Function:		void submitted(uint32_t frame_)
+*	Purpose:		Marks the queries of frame_ as written by a submission, until then they hold nothing to read
+*
+*/
+void FillRateQueries::submitted(uint32_t frame_) {
+
+	pending[frame_] = timestampPool != VK_NULL_HANDLE || statisticsPool != VK_NULL_HANDLE;
+
+}
+
+/*
+*	Function:		void collect(uint32_t frame_)
+*	Purpose:		Adds the results of the last submission of frame_ to the stats, only call it once that submission finished
+*
+*/
+void FillRateQueries::collect(uint32_t frame_) {
+
+	if (!pending[frame_]) {
+
+		return;
+
+	}
+	pending[frame_] = false;
+
+	if (timestampPool != VK_NULL_HANDLE) {
+
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(
+
+			engine.device,
+			timestampPool,
+			2 * frame_,
+			2,
+			sizeof(timestamps),
+			timestamps,
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT
+
+		) == VK_SUCCESS) {
+
+			totalGpuTime		+= 1e-9 * timestampPeriod * static_cast< double >(timestamps[1] - timestamps[0]);
+
+		}
+
+	}
+
+	if (statisticsPool != VK_NULL_HANDLE) {
+
+		uint64_t fragments;
+		if (vkGetQueryPoolResults(
+
+			engine.device,
+			statisticsPool,
+			frame_,
+			1,
+			sizeof(fragments),
+			&fragments,
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT
+
+		) == VK_SUCCESS) {
+
+			totalFragments		+= static_cast< double >(fragments);
+
+		}
+
+	}
+
+	statFrames++;
+
+}
+
+/*
+*	Function:		VkQueryPipelineStatisticFlags getInheritedStatistics()
+*	Purpose:		Returns the statistics the secondary command buffers have to declare, they run while the statistics query is active
+*
+*/
+VkQueryPipelineStatisticFlags FillRateQueries::getInheritedStatistics(void) const {
+
+	return statisticsPool != VK_NULL_HANDLE ? VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT : 0;
+
+}
+
+/*
+*	Function:		FillRateStats getStats()
+*	Purpose:		Returns the averages since the last resetStats()
+*
+*/
+FillRateStats FillRateQueries::getStats(void) const {
+
+	double count				= statFrames > 0 ? static_cast< double >(statFrames) : 1.0;
+
+	FillRateStats stats;
+	stats.averageGpuTime		= totalGpuTime / count;
+	stats.averageFragments		= totalFragments / count;
+	stats.frames				= statFrames;
+	return stats;
+
+}
+
+/*
+*	Function:		void resetStats()
+*	Purpose:		Starts a new measuring period
+*
+*/
+void FillRateQueries::resetStats(void) {
+
+	totalGpuTime		= 0.0;
+	totalFragments		= 0.0;
+	statFrames			= 0;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the query pools
+*
+*/
+void FillRateQueries::destroy(void) {
+
+	timestampPool.reset();
+	statisticsPool.reset();
+	pending.clear();
+
+}
+
+/*
+*	Function:		~FillRateQueries()
+*	Purpose:		Default destructor
+*
+*/
+FillRateQueries::~FillRateQueries() {
+
+
+
+}
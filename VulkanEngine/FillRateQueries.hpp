@@ -0,0 +1,62 @@
+/*
+*	File:		FillRateQueries.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "VulkanHandle.hpp"
+
+struct FillRateStats {
+
+	double			averageGpuTime;				// seconds from the first to the last command of a frame on the GPU
+	double			averageFragments;			// fragment shader invocations per frame, 0 without pipeline statistics queries
+	uint64_t		frames;
+
+};
+
+/*
+*	Class:			FillRateQueries
+*	Purpose:		Measures what a frame costs the GPU, timestamps around the whole frame and the fragment shader invocations of its render passes
+*					Every frame in flight has its own queries, they are read back once the frame's wait on the timeline returned, so reading never stalls
+*
+*/
+class FillRateQueries {
+public:
+	FillRateQueries(void);
+	void init(
+
+		uint32_t					frames_,
+		bool						timestamps_,
+		float						timestampPeriod_,
+		bool						statistics_
+
+	);
+	void begin(VkCommandBuffer commandBuffer_, uint32_t frame_);
+	void end(VkCommandBuffer commandBuffer_, uint32_t frame_);
+	void submitted(uint32_t frame_);
+	void collect(uint32_t frame_);
+	VkQueryPipelineStatisticFlags getInheritedStatistics(void) const;
+	FillRateStats getStats(void) const;
+	void resetStats(void);
+	void destroy(void);
+	~FillRateQueries();
+private:
+	UniqueQueryPool						timestampPool;			// two timestamps per frame in flight
+	UniqueQueryPool						statisticsPool;			// one fragment invocation count per frame in flight
+	float								timestampPeriod;
+	std::vector< bool >					pending;
+	double								totalGpuTime;
+	double								totalFragments;
+	uint64_t							statFrames;
+
+};
@@ -0,0 +1,218 @@
+/*
+*	File:		FramePacer.cpp
+*
+*
+*/
+#include "FramePacer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#if defined _WIN32
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+/*
+*	Weight of the newest sample in the moving averages
+*/
+static const double SMOOTHING			= 0.1;
+
+/*
+*	Never trust the sleep to come closer than this to the wake-up time
+*/
+static const double MIN_SPIN_TIME		= 0.0002;
+
+/*
+*	Function:		FramePacer()
+*	Purpose:		Default constructor
+*
+*/
+FramePacer::FramePacer(void) : targetPeriod(0.0), nextDeadline(0.0), frameStart(0.0), predictedWorkTime(0.0), workVariance(0.0), overshootMean(0.001), overshootVariance(0.0) {
+
+#if defined _WIN32
+	// default scheduler granularity is ~15.6 ms, which would leave most of a 60 Hz frame to spinning
+	timeBeginPeriod(1);
+#endif
+	resetStats();
+
+}
+
+/*
+*	Function:		void setTargetRate(double framesPerSecond_)
+*	Purpose:		Sets the frame rate limit, 0 disables it
+*
+*/
+void FramePacer::setTargetRate(double framesPerSecond_) {
+
+	targetPeriod	= framesPerSecond_ > 0.0 ? 1.0 / framesPerSecond_ : 0.0;
+	nextDeadline	= 0.0;
+
+}
+
+/*
+*	Function:		double getTargetRate()
+*	Purpose:		Returns the frame rate limit, 0 if uncapped
+*
+*/
+double FramePacer::getTargetRate(void) {
+
+	return targetPeriod > 0.0 ? 1.0 / targetPeriod : 0.0;
+
+}
+
+/*
+*	Function:		void waitForNextFrame()
+*	Purpose:		Blocks until the next frame has to start so that it finishes right at its deadline
+*
+*/
+void FramePacer::waitForNextFrame(void) {
+
+	double currentTime = now();
+	if (targetPeriod <= 0.0) {
+
+		frameStart = currentTime;
+		return;
+
+	}
+	if (nextDeadline == 0.0 || currentTime > nextDeadline + targetPeriod) {
+
+		// first frame or too far behind to catch up, start a fresh schedule
+		nextDeadline = currentTime + targetPeriod;
+
+	}
+
+	// start as late as possible while still finishing in time with a margin of two standard deviations
+	double workMargin		= predictedWorkTime + 2.0 * std::sqrt(workVariance);
+	double wakeTime			= std::max(nextDeadline - workMargin, nextDeadline - targetPeriod);
+
+	double sleepStart		= now();
+	double sleepMargin		= std::max(overshootMean + 2.0 * std::sqrt(overshootVariance), MIN_SPIN_TIME);
+	double sleepTime		= wakeTime - sleepStart - sleepMargin;
+	if (sleepTime > 0.0) {
+
+		sleepFor(sleepTime);
+
+	}
+
+	double spinStart = now();
+	while (now() < wakeTime) {
+
+		std::this_thread::yield();
+
+	}
+
+	frameStart		= now();
+	totalSleepTime	+= spinStart - sleepStart;
+	totalSpinTime	+= frameStart - spinStart;
+
+}
+
+/*
+*	Function:		void endFrame()
+*	Purpose:		Records how long the frame took and schedules the next deadline
+*
+*/
+void FramePacer::endFrame(void) {
+
+	double currentTime	= now();
+	double workTime		= currentTime - frameStart;
+	double deviation	= workTime - predictedWorkTime;
+	predictedWorkTime	+= SMOOTHING * deviation;
+	workVariance		= (1.0 - SMOOTHING) * (workVariance + SMOOTHING * deviation * deviation);
+	frames++;
+
+	if (targetPeriod <= 0.0) {
+
+		return;
+
+	}
+	if (currentTime > nextDeadline) {
+
+		missedDeadlines++;
+		totalLateness += currentTime - nextDeadline;
+
+	}
+	nextDeadline += targetPeriod;
+
+}
+
+/*
+*	Function:		FramePacerStats getStats()
+*	Purpose:		Returns the pacing statistics since the last reset
+*
+*/
+FramePacerStats FramePacer::getStats(void) {
+
+	double frameCount			= static_cast< double >(std::max< uint64_t >(frames, 1));
+
+	FramePacerStats stats		= {};
+	stats.targetPeriod			= targetPeriod;
+	stats.predictedWorkTime		= predictedWorkTime;
+	stats.sleepOvershoot		= overshootMean;
+	stats.averageSleepTime		= totalSleepTime / frameCount;
+	stats.averageSpinTime		= totalSpinTime / frameCount;
+	stats.averageLateness		= totalLateness / std::max(static_cast< double >(missedDeadlines), 1.0);
+	stats.missedDeadlines		= missedDeadlines;
+	stats.frames				= frames;
+	return stats;
+
+}
+
+/*
+*	Function:		void resetStats()
+*	Purpose:		Clears the accumulated statistics, the calibration is kept
+*
+*/
+void FramePacer::resetStats(void) {
+
+	totalSleepTime		= 0.0;
+	totalSpinTime		= 0.0;
+	totalLateness		= 0.0;
+	missedDeadlines		= 0;
+	frames				= 0;
+
+}
+
+/*
+*	Function:		~FramePacer()
+*	Purpose:		Default destructor
+*
+*/
+FramePacer::~FramePacer() {
+
+#if defined _WIN32
+	timeEndPeriod(1);
+#endif
+
+}
+
+/*
+*	Function:		void sleepFor(double seconds_)
+*	Purpose:		Sleeps and updates the overshoot estimate from how late the thread actually woke up
+*
+*/
+void FramePacer::sleepFor(double seconds_) {
+
+	double start		= now();
+	std::this_thread::sleep_for(std::chrono::duration< double >(seconds_));
+	double overshoot	= std::max(now() - start - seconds_, 0.0);
+	double deviation	= overshoot - overshootMean;
+	overshootMean		+= SMOOTHING * deviation;
+	overshootVariance	= (1.0 - SMOOTHING) * (overshootVariance + SMOOTHING * deviation * deviation);
+
+}
+
+/*
+*	Function:		double now()
+*	Purpose:		Returns a monotonic time in seconds
+*
+*/
+double FramePacer::now(void) {
+
+	return std::chrono::duration< double >(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
@@ -0,0 +1,55 @@
+/*
+*	File:		FramePacer.hpp
+*
+*
+*/
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+struct FramePacerStats {
+
+	double			targetPeriod;				// seconds, 0 when uncapped
+	double			predictedWorkTime;			// seconds the next frame is expected to take
+	double			sleepOvershoot;				// seconds the OS sleep is expected to overshoot by
+	double			averageSleepTime;			// seconds spent sleeping per frame
+	double			averageSpinTime;			// seconds spent spinning per frame
+	double			averageLateness;			// seconds frames finished past their deadline
+	uint64_t		missedDeadlines;
+	uint64_t		frames;
+
+};
+
+/*
+*	Class:			FramePacer
+*	Purpose:		Limits the frame rate by sleeping until shortly before a frame is due and spinning for the rest
+*
+*/
+class FramePacer {
+public:
+	FramePacer(void);
+	void setTargetRate(double framesPerSecond_);
+	double getTargetRate(void);
+	void waitForNextFrame(void);
+	void endFrame(void);
+	FramePacerStats getStats(void);
+	void resetStats(void);
+	~FramePacer();
+private:
+	double			targetPeriod;
+	double			nextDeadline;
+	double			frameStart;
+	double			predictedWorkTime;
+	double			workVariance;
+	double			overshootMean;
+	double			overshootVariance;
+	double			totalSleepTime;
+	double			totalSpinTime;
+	double			totalLateness;
+	uint64_t		missedDeadlines;
+	uint64_t		frames;
+
+	void sleepFor(double seconds_);
+	static double now(void);
+
+};
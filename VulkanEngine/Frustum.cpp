@@ -0,0 +1,69 @@
+/*
+*	File:		Frustum.cpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "Bounds.cpp"
+
+/*
+*	Six inward facing planes (normal, distance) of a view frustum, a point p is inside a plane if dot(normal, p) + distance >= 0
+*/
+struct Frustum {
+
+	glm::vec4		planes[6];
+
+	/*
+	*	Gribb-Hartmann extraction for Vulkan clip space, where depth runs from 0 to w
+	*/
+	static Frustum fromViewProjection(const glm::mat4& viewProjection_) {
+
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+
+			rows[i] = glm::vec4(viewProjection_[0][i], viewProjection_[1][i], viewProjection_[2][i], viewProjection_[3][i]);
+
+		}
+
+		Frustum result;
+		result.planes[0]	= rows[3] + rows[0];
+		result.planes[1]	= rows[3] - rows[0];
+		result.planes[2]	= rows[3] + rows[1];
+		result.planes[3]	= rows[3] - rows[1];
+		result.planes[4]	= rows[2];
+		result.planes[5]	= rows[3] - rows[2];
+
+		for (auto& plane : result.planes) {
+
+			plane /= glm::length(glm::vec3(plane));
+
+		}
+		return result;
+
+	}
+
+	/*
+	*	Conservative test, bounds are only rejected if the box or the sphere lies completely behind one plane
+	*/
+	bool intersects(const Bounds& bounds_) const {
+
+		for (const auto& plane : planes) {
+
+			glm::vec3 normal	= glm::vec3(plane);
+			float distance		= glm::dot(normal, bounds_.center) + plane.w;
+			float boxRadius		= glm::dot(glm::abs(normal), bounds_.extents);
+			if (distance + glm::min(boxRadius, bounds_.radius) < 0.0f) {
+
+				return false;
+
+			}
+
+		}
+		return true;
+
+	}
+
+};
@@ -0,0 +1,257 @@
+/*
+*	File:		GBuffer.cpp
+*
+*
+*/
+#include "GBuffer.hpp"
+#include "Engine.hpp"
+
+extern Engine engine;
+
+/*
+*	Function:		GBuffer()
+*	Purpose:		Default constructor
+*
+*/
+GBuffer::GBuffer(void) : depthFormat(VK_FORMAT_UNDEFINED), albedoFormat(VK_FORMAT_R8G8B8A8_UNORM), normalFormat(VK_FORMAT_R16G16_SNORM) {
+
+	memoryProperties = {};
+
+}
+
+/*
+*	Function:		void init(VkPhysicalDevice physicalDevice_, VkFormat depthFormat_)
+*	Purpose:		Picks the attachment formats, the normal falls back to half floats where snorm can not be rendered to
+*					The lighting subpass reads depth through a depth only view, so a format without stencil is preferred over depthFormat_
+*
+*/
+void GBuffer::init(VkPhysicalDevice physicalDevice_, VkFormat depthFormat_) {
+
+	depthFormat					= depthFormat_;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &memoryProperties);
+
+	for (VkFormat candidate : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32 }) {
+
+		VkFormatProperties depthProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice_, candidate, &depthProperties);
+		if ((depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0) {
+
+			depthFormat			= candidate;
+			break;
+
+		}
+
+	}
+
+	VkFormatProperties normalProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice_, VK_FORMAT_R16G16_SNORM, &normalProperties);
+
+	normalFormat				= (normalProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT) != 0 ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R16G16_SFLOAT;
+
+}
+
+/*
+*	Function:		void create(VkExtent2D extent_)
+*	Purpose:		Creates the attachments for the swapchain size extent_, replacing the previous ones
+*
+*/
+void GBuffer::create(VkExtent2D extent_) {
+
+	VkImageUsageFlags usage		= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	createAttachment(depth, depthFormat, usage | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, extent_);
+	createAttachment(albedo, albedoFormat, usage | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, extent_);
+	createAttachment(normal, normalFormat, usage | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, extent_);
+
+}
+
+/*
+*	Function:		VkFormat getDepthFormat()
+*	Purpose:		Returns the format of the depth attachment
+*
+*/
+VkFormat GBuffer::getDepthFormat(void) const {
+
+	return depthFormat;
+
+}
+
+/*
+*	Function:		VkFormat getAlbedoFormat()
+*	Purpose:		Returns the format of the albedo and roughness attachment
+*
+*/
+VkFormat GBuffer::getAlbedoFormat(void) const {
+
+	return albedoFormat;
+
+}
+
+/*
+*	Function:		VkFormat getNormalFormat()
+*	Purpose:		Returns the format of the octahedral normal attachment
+*
+*/
+VkFormat GBuffer::getNormalFormat(void) const {
+
+	return normalFormat;
+
+}
+
+/*
+*	Function:		VkImageView getDepthView()
+*	Purpose:		Returns the depth attachment
+*
+*/
+VkImageView GBuffer::getDepthView(void) const {
+
+	return depth.view;
+
+}
+
+/*
+*	Function:		VkImageView getAlbedoView()
+*	Purpose:		Returns the albedo and roughness attachment
+*
+*/
+VkImageView GBuffer::getAlbedoView(void) const {
+
+	return albedo.view;
+
+}
+
+/*
+*	Function:		VkImageView getNormalView()
+*	Purpose:		Returns the octahedral normal attachment
+*
+*/
+VkImageView GBuffer::getNormalView(void) const {
+
+	return normal.view;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the attachments
+*
+*/
+void GBuffer::destroy(void) {
+
+	for (Attachment* attachment : { &depth, &albedo, &normal }) {
+
+		attachment->view.reset();
+		attachment->image.reset();
+		attachment->memory.reset();
+
+	}
+
+}
+
+/*
+*	Function:		~GBuffer()
+*	Purpose:		Default destructor
+*
+*/
+GBuffer::~GBuffer() {
+
+
+
+}
+
+/*
+*	Function:		void createAttachment(
+*
+*						Attachment&					attachment_,
+*						VkFormat					format_,
+*						VkImageUsageFlags			usage_,
+*						VkImageAspectFlags			aspect_,
+*						VkExtent2D					extent_
+*
+*					)
+*	Purpose:		Creates one single sampled attachment, in lazily allocated memory if the image may live there
+*
+*/
+void GBuffer::createAttachment(
+
+	Attachment&					attachment_,
+	VkFormat					format_,
+	VkImageUsageFlags			usage_,
+	VkImageAspectFlags			aspect_,
+	VkExtent2D					extent_
+
+) {
+
+	VkImageCreateInfo imageInfo					= {};
+	imageInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType							= VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width						= extent_.width;
+	imageInfo.extent.height						= extent_.height;
+	imageInfo.extent.depth						= 1;
+	imageInfo.mipLevels							= 1;
+	imageInfo.arrayLayers						= 1;
+	imageInfo.format							= format_;
+	imageInfo.tiling							= VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout						= VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage								= usage_;
+	imageInfo.samples							= VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode						= VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(engine.device, &imageInfo, nullptr, &attachment_.image.replace(engine.device)) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create G-buffer image!");
+
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(engine.device, attachment_.image, &memRequirements);
+
+	// desktop GPUs usually have no lazily allocated memory, the attachment is then an ordinary device local image
+	uint32_t memoryType							= UINT32_MAX;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+
+		if ((memRequirements.memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0) {
+
+			memoryType = i;
+			break;
+
+		}
+
+	}
+	if (memoryType == UINT32_MAX) {
+
+		memoryType = engine.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	}
+
+	VkMemoryAllocateInfo allocInfo				= {};
+	allocInfo.sType								= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize					= memRequirements.size;
+	allocInfo.memoryTypeIndex					= memoryType;
+
+	if (vkAllocateMemory(engine.device, &allocInfo, nullptr, &attachment_.memory.replace(engine.device)) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to allocate G-buffer memory!");
+
+	}
+
+	vkBindImageMemory(engine.device, attachment_.image, attachment_.memory, 0);
+
+	VkImageViewCreateInfo viewInfo				= {};
+	viewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image								= attachment_.image;
+	viewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format								= format_;
+	viewInfo.subresourceRange.aspectMask		= aspect_;
+	viewInfo.subresourceRange.baseMipLevel		= 0;
+	viewInfo.subresourceRange.levelCount		= 1;
+	viewInfo.subresourceRange.baseArrayLayer	= 0;
+	viewInfo.subresourceRange.layerCount		= 1;
+
+	if (vkCreateImageView(engine.device, &viewInfo, nullptr, &attachment_.view.replace(engine.device)) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create G-buffer image view!");
+
+	}
+
+}
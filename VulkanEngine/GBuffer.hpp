@@ -0,0 +1,65 @@
+/*
+*	File:		GBuffer.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+#include "VulkanHandle.hpp"
+
+/*
+*	Class:			GBuffer
+*	Purpose:		Attachments of the deferred render pass, the geometry subpass writes them and the lighting subpass reads them as input attachments
+*					Albedo with roughness in alpha, an octahedral normal in two channels and depth, nothing else is kept per pixel
+*					They never leave the render pass, so they are transient and lazily allocated where the device has such memory, tile-based GPUs then keep them on chip
+*
+*/
+class GBuffer {
+public:
+	GBuffer(void);
+	void init(VkPhysicalDevice physicalDevice_, VkFormat depthFormat_);
+	void create(VkExtent2D extent_);
+	VkFormat getDepthFormat(void) const;
+	VkFormat getAlbedoFormat(void) const;
+	VkFormat getNormalFormat(void) const;
+	VkImageView getDepthView(void) const;
+	VkImageView getAlbedoView(void) const;
+	VkImageView getNormalView(void) const;
+	void destroy(void);
+	~GBuffer();
+private:
+	struct Attachment {
+
+		UniqueImage					image;
+		UniqueDeviceMemory			memory;
+		UniqueImageView				view;
+
+	};
+
+	VkPhysicalDeviceMemoryProperties			memoryProperties;
+	VkFormat									depthFormat;
+	VkFormat									albedoFormat;
+	VkFormat									normalFormat;
+	Attachment									depth;
+	Attachment									albedo;
+	Attachment									normal;
+
+	void createAttachment(
+
+		Attachment&					attachment_,
+		VkFormat					format_,
+		VkImageUsageFlags			usage_,
+		VkImageAspectFlags			aspect_,
+		VkExtent2D					extent_
+
+	);
+
+};
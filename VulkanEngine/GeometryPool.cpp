@@ -0,0 +1,454 @@
+/*
+*	File:		GeometryPool.cpp
+*
+*
+*/
+#include "GeometryPool.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+extern Engine engine;
+
+/*
+*	Size of the buffers when the first mesh is uploaded, the chalet alone takes about 12 MB of vertices
+*/
+static const VkDeviceSize INITIAL_VERTEX_BUFFER_SIZE		= 32 * 1024 * 1024;
+static const VkDeviceSize INITIAL_INDEX_BUFFER_SIZE			= 8 * 1024 * 1024;
+
+/*
+*	Buffer usages, the pool copies out of its own buffers when it grows or compacts
+*/
+static const VkBufferUsageFlags VERTEX_BUFFER_USAGE			= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static const VkBufferUsageFlags INDEX_BUFFER_USAGE			= VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+/*
+*	Function:		GeometryPool()
+*	Purpose:		Default constructor, the buffers are created with the first upload
+*
+*/
+GeometryPool::GeometryPool(void) : version(0) {
+
+
+
+}
+
+/*
+*	Function:		GeometryHandle upload(
+*
+*						const void*					vertices_,
+*						uint32_t					vertexCount_,
+*						uint32_t					vertexStride_,
+*						const uint32_t*				indices_,
+*						uint32_t					indexCount_
+*
+*					)
+*	Purpose:		Copies a mesh into the pool and returns its handle, a null handle for a mesh without vertices
+*					indices_ may be nullptr with indexCount_ 0 for meshes drawn without an index buffer
+*
+*/
+GeometryHandle GeometryPool::upload(
+
+	const void*					vertices_,
+	uint32_t					vertexCount_,
+	uint32_t					vertexStride_,
+	const uint32_t*				indices_,
+	uint32_t					indexCount_
+
+) {
+
+	if (vertexCount_ == 0) {
+
+		return GeometryHandle();
+
+	}
+
+	uint64_t vertexSize			= static_cast< uint64_t >(vertexCount_) * vertexStride_;
+	uint64_t indexSize			= static_cast< uint64_t >(indexCount_) * sizeof(uint32_t);
+
+	GeometryRange range;
+	range.vertexStride			= vertexStride_;
+	if (!allocate(vertexSize, vertexStride_, indexSize, range)) {
+
+		// compacting only helps if there is enough free space, just not in one piece
+		if (vertexAllocator.getFreeSize() >= vertexSize + vertexStride_ && indexAllocator.getFreeSize() >= indexSize + sizeof(uint32_t)) {
+
+			compact();
+
+		}
+		if (!allocate(vertexSize, vertexStride_, indexSize, range)) {
+
+			grow(vertexSize + vertexStride_, indexSize + sizeof(uint32_t));
+			if (!allocate(vertexSize, vertexStride_, indexSize, range)) {
+
+				logger.log(ERROR_LOG, "Failed to allocate geometry pool range!");
+
+			}
+
+		}
+
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	engine.createBuffer(
+
+		vertexSize + indexSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory
+
+	);
+
+	void* data;
+	vkMapMemory(
+
+		engine.device,
+		stagingBufferMemory,
+		0,
+		vertexSize + indexSize,
+		0,
+		&data
+
+	);
+	memcpy(data, vertices_, static_cast< size_t >(vertexSize));
+	if (indexSize > 0) {
+
+		memcpy(static_cast< char* >(data) + vertexSize, indices_, static_cast< size_t >(indexSize));
+
+	}
+	vkUnmapMemory(engine.device, stagingBufferMemory);
+
+	engine.copyBuffer(stagingBuffer, vertexBuffer, { { 0, range.vertexOffset, vertexSize } });
+	if (indexSize > 0) {
+
+		engine.copyBuffer(stagingBuffer, indexBuffer, { { vertexSize, range.indexOffset, indexSize } });
+
+	}
+
+	// the copies are still in flight, the staging buffer goes once they completed
+	engine.retire([=] () {
+
+		vkDestroyBuffer(
+
+			engine.device,
+			stagingBuffer,
+			nullptr
+
+		);
+		vkFreeMemory(
+
+			engine.device,
+			stagingBufferMemory,
+			nullptr
+
+		);
+
+	});
+
+	return ranges.insert(range);
+
+}
+
+/*
+*	Function:		void free(GeometryHandle geometry_)
+*	Purpose:		Gives the ranges of geometry_ back, only call once no frame in flight draws it anymore; stale handles are ignored
+*
+*/
+void GeometryPool::free(GeometryHandle geometry_) {
+
+	GeometryRange* range = ranges.get(geometry_);
+	if (range == nullptr) {
+
+		return;
+
+	}
+
+	vertexAllocator.free(range->vertexOffset, range->vertexSize);
+	indexAllocator.free(range->indexOffset, range->indexSize);
+	ranges.remove(geometry_);
+
+}
+
+/*
+*	Function:		void compact()
+*	Purpose:		Moves all meshes to the front of new buffers of the same size, leaving all free space in one range at the end
+*
+*/
+void GeometryPool::compact(void) {
+
+	if (vertexBuffer == VK_NULL_HANDLE) {
+
+		return;
+
+	}
+
+	// packed in dense order, every range only needs less than one stride of padding
+	std::vector< VkBufferCopy > vertexCopies;
+	std::vector< VkBufferCopy > indexCopies;
+	std::vector< GeometryRange > packed;
+	uint64_t vertexEnd				= 0;
+	uint64_t indexEnd				= 0;
+	for (const GeometryRange& range : ranges) {
+
+		GeometryRange moved			= range;
+		moved.vertexOffset			= (vertexEnd + range.vertexStride - 1) / range.vertexStride * range.vertexStride;
+		moved.indexOffset			= indexEnd;
+		vertexEnd					= moved.vertexOffset + range.vertexSize;
+		indexEnd					= moved.indexOffset + range.indexSize;
+		vertexCopies.push_back({ range.vertexOffset, moved.vertexOffset, range.vertexSize });
+		if (range.indexSize > 0) {
+
+			indexCopies.push_back({ range.indexOffset, moved.indexOffset, range.indexSize });
+
+		}
+		packed.push_back(moved);
+
+	}
+
+	uint64_t vertexSize				= std::max(vertexAllocator.getSize(), vertexEnd);
+	uint64_t indexSize				= std::max(indexAllocator.getSize(), indexEnd);
+	UniqueBuffer newVertexBuffer;
+	UniqueDeviceMemory newVertexBufferMemory;
+	UniqueBuffer newIndexBuffer;
+	UniqueDeviceMemory newIndexBufferMemory;
+	createBuffer(vertexSize, VERTEX_BUFFER_USAGE, newVertexBuffer, newVertexBufferMemory);
+	createBuffer(indexSize, INDEX_BUFFER_USAGE, newIndexBuffer, newIndexBufferMemory);
+	if (!vertexCopies.empty()) {
+
+		engine.copyBuffer(vertexBuffer, newVertexBuffer, vertexCopies);
+
+	}
+	if (!indexCopies.empty()) {
+
+		engine.copyBuffer(indexBuffer, newIndexBuffer, indexCopies);
+
+	}
+
+	// the old buffers are retired, frames still in flight keep drawing from them
+	vertexBuffer					= std::move(newVertexBuffer);
+	vertexBufferMemory				= std::move(newVertexBufferMemory);
+	indexBuffer						= std::move(newIndexBuffer);
+	indexBufferMemory				= std::move(newIndexBufferMemory);
+
+	vertexAllocator.reset(vertexSize);
+	indexAllocator.reset(indexSize);
+	size_t i						= 0;
+	for (GeometryRange& range : ranges) {
+
+		range						= packed[i++];
+		uint64_t offset;
+		vertexAllocator.allocate(range.vertexSize, range.vertexStride, offset);
+		if (range.indexSize > 0) {
+
+			indexAllocator.allocate(range.indexSize, sizeof(uint32_t), offset);
+
+		}
+
+	}
+
+	version++;
+	logger.log(EVENT_LOG, "Compacted geometry pool to " + std::to_string(vertexEnd) + " vertex bytes and " + std::to_string(indexEnd) + " index bytes");
+
+}
+
+/*
+*	Function:		uint32_t getFirstVertex(GeometryHandle geometry_)
+*	Purpose:		Returns the first vertex of geometry_ in vertices of its stride, the vertexOffset of indexed draws
+*
+*/
+uint32_t GeometryPool::getFirstVertex(GeometryHandle geometry_) {
+
+	GeometryRange* range = ranges.get(geometry_);
+	return range != nullptr ? static_cast< uint32_t >(range->vertexOffset / range->vertexStride) : 0;
+
+}
+
+/*
+*	Function:		uint32_t getFirstIndex(GeometryHandle geometry_)
+*	Purpose:		Returns the first index of geometry_ in the index buffer
+*
+*/
+uint32_t GeometryPool::getFirstIndex(GeometryHandle geometry_) {
+
+	GeometryRange* range = ranges.get(geometry_);
+	return range != nullptr ? static_cast< uint32_t >(range->indexOffset / sizeof(uint32_t)) : 0;
+
+}
+
+/*
+*	Function:		VkBuffer getVertexBuffer()
+*	Purpose:		Returns the vertex buffer all meshes are drawn from
+*
+*/
+VkBuffer GeometryPool::getVertexBuffer(void) const {
+
+	return vertexBuffer;
+
+}
+
+/*
+*	Function:		VkBuffer getIndexBuffer()
+*	Purpose:		Returns the index buffer all indexed meshes are drawn from
+*
+*/
+VkBuffer GeometryPool::getIndexBuffer(void) const {
+
+	return indexBuffer;
+
+}
+
+/*
+*	Function:		uint64_t getVersion()
+*	Purpose:		Returns a counter that changes every time the buffers were replaced, recorded draws and offsets read before are stale then
+*
+*/
+uint64_t GeometryPool::getVersion(void) const {
+
+	return version;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the buffers and forgets all meshes
+*
+*/
+void GeometryPool::destroy(void) {
+
+	vertexBuffer.reset();
+	vertexBufferMemory.reset();
+	indexBuffer.reset();
+	indexBufferMemory.reset();
+	ranges.clear();
+	vertexAllocator.reset(0);
+	indexAllocator.reset(0);
+	version++;
+
+}
+
+/*
+*	Function:		~GeometryPool()
+*	Purpose:		Default destructor
+*
+*/
+GeometryPool::~GeometryPool() {
+
+
+
+}
+
+/*
+*	Function:		bool allocate(uint64_t vertexSize_, uint64_t alignment_, uint64_t indexSize_, GeometryRange& range_)
+*	Purpose:		Allocates the vertex and index ranges of one mesh, either both or neither
+*
+*/
+bool GeometryPool::allocate(uint64_t vertexSize_, uint64_t alignment_, uint64_t indexSize_, GeometryRange& range_) {
+
+	range_.vertexSize	= vertexSize_;
+	range_.indexSize	= indexSize_;
+	range_.indexOffset	= 0;
+	if (!vertexAllocator.allocate(vertexSize_, alignment_, range_.vertexOffset)) {
+
+		return false;
+
+	}
+	if (indexSize_ > 0 && !indexAllocator.allocate(indexSize_, sizeof(uint32_t), range_.indexOffset)) {
+
+		vertexAllocator.free(range_.vertexOffset, vertexSize_);
+		return false;
+
+	}
+	return true;
+
+}
+
+/*
+*	Function:		void grow(uint64_t vertexSize_, uint64_t indexSize_)
+*	Purpose:		Makes room for at least vertexSize_ and indexSize_ more bytes, doubling the buffers that are too small
+*					Live ranges keep their offsets, so only the buffer handles change
+*
+*/
+void GeometryPool::grow(uint64_t vertexSize_, uint64_t indexSize_) {
+
+	struct Growth {
+
+		RangeAllocator&			allocator;
+		UniqueBuffer&			buffer;
+		UniqueDeviceMemory&		memory;
+		VkBufferUsageFlags		usage;
+		VkDeviceSize			initialSize;
+		uint64_t				needed;
+
+	};
+	Growth growths[] = {
+
+		{ vertexAllocator, vertexBuffer, vertexBufferMemory, VERTEX_BUFFER_USAGE, INITIAL_VERTEX_BUFFER_SIZE, vertexSize_ },
+		{ indexAllocator, indexBuffer, indexBufferMemory, INDEX_BUFFER_USAGE, INITIAL_INDEX_BUFFER_SIZE, indexSize_ }
+
+	};
+
+	for (Growth& growth : growths) {
+
+		uint64_t oldSize		= growth.allocator.getSize();
+		if (growth.buffer != VK_NULL_HANDLE && growth.allocator.getLargestFreeRange() >= growth.needed) {
+
+			continue;
+
+		}
+
+		uint64_t newSize		= std::max(std::max(oldSize * 2, oldSize + growth.needed), growth.initialSize);
+		UniqueBuffer newBuffer;
+		UniqueDeviceMemory newMemory;
+		createBuffer(newSize, growth.usage, newBuffer, newMemory);
+		if (oldSize > 0 && growth.buffer != VK_NULL_HANDLE) {
+
+			engine.copyBuffer(growth.buffer, newBuffer, { { 0, 0, oldSize } });
+
+		}
+
+		growth.buffer			= std::move(newBuffer);
+		growth.memory			= std::move(newMemory);
+		growth.allocator.grow(newSize);
+
+	}
+
+	version++;
+
+}
+
+/*
+*	Function:		void createBuffer(
+*
+*						VkDeviceSize				size_,
+*						VkBufferUsageFlags			usage_,
+*						UniqueBuffer&				buffer_,
+*						UniqueDeviceMemory&			memory_
+*
+*					)
+*	Purpose:		Creates a device local buffer of the pool
+*
+*/
+void GeometryPool::createBuffer(
+
+	VkDeviceSize				size_,
+	VkBufferUsageFlags			usage_,
+	UniqueBuffer&				buffer_,
+	UniqueDeviceMemory&			memory_
+
+) {
+
+	engine.createBuffer(
+
+		size_,
+		usage_,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		buffer_.replace(engine.device),
+		memory_.replace(engine.device)
+
+	);
+
+}
@@ -0,0 +1,85 @@
+/*
+*	File:		GeometryPool.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+#include "VulkanHandle.hpp"
+#include "HandlePool.hpp"
+#include "RangeAllocator.hpp"
+
+/*
+*	Where a mesh lives in the pool, offsets and sizes in bytes
+*	The vertex offset is a multiple of the mesh's vertex stride, so it can be passed to draws in vertices of that stride
+*/
+struct GeometryRange {
+
+	uint64_t		vertexOffset;
+	uint64_t		vertexSize;
+	uint32_t		vertexStride;
+	uint64_t		indexOffset;
+	uint64_t		indexSize;
+
+};
+
+typedef Handle< GeometryRange > GeometryHandle;
+
+/*
+*	Class:			GeometryPool
+*	Purpose:		One device local vertex buffer and one 32-bit index buffer holding the geometry of all meshes, so every draw shares one bind
+*					Meshes are placed by a range allocator, when it runs out the pool is compacted if that makes enough room and grown otherwise
+*					Both replace the buffers and may move ranges, which is announced by a new version; frames in flight keep the old buffers
+*
+*/
+class GeometryPool {
+public:
+	GeometryPool(void);
+	GeometryHandle upload(
+
+		const void*					vertices_,
+		uint32_t					vertexCount_,
+		uint32_t					vertexStride_,
+		const uint32_t*				indices_,
+		uint32_t					indexCount_
+
+	);
+	void free(GeometryHandle geometry_);
+	void compact(void);
+	uint32_t getFirstVertex(GeometryHandle geometry_);
+	uint32_t getFirstIndex(GeometryHandle geometry_);
+	VkBuffer getVertexBuffer(void) const;
+	VkBuffer getIndexBuffer(void) const;
+	uint64_t getVersion(void) const;
+	void destroy(void);
+	~GeometryPool();
+private:
+	UniqueBuffer								vertexBuffer;
+	UniqueDeviceMemory							vertexBufferMemory;
+	UniqueBuffer								indexBuffer;
+	UniqueDeviceMemory							indexBufferMemory;
+	RangeAllocator								vertexAllocator;
+	RangeAllocator								indexAllocator;
+	HandlePool< GeometryRange >					ranges;
+	uint64_t									version;
+
+	bool allocate(uint64_t vertexSize_, uint64_t alignment_, uint64_t indexSize_, GeometryRange& range_);
+	void grow(uint64_t vertexSize_, uint64_t indexSize_);
+	void createBuffer(
+
+		VkDeviceSize				size_,
+		VkBufferUsageFlags			usage_,
+		UniqueBuffer&				buffer_,
+		UniqueDeviceMemory&			memory_
+
+	);
+
+};
@@ -0,0 +1,1024 @@
+/*
+*	File:		GpuCulling.cpp
+*
+*
+*/
+#include "GpuCulling.hpp"
+#include "DepthPyramid.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+
+extern Engine engine;
+
+/*
+*	Instances and batches are allocated in multiples of these, which keeps every buffer range 256 byte aligned
+*/
+static const size_t INSTANCE_GRANULARITY		= 1024;
+static const size_t BATCH_GRANULARITY			= 64;
+
+/*
+*	The uniforms and the visible counter each get a 256 byte block at the start of the upload buffer, the draw templates follow
+*/
+static const VkDeviceSize UNIFORM_OFFSET		= 0;
+static const VkDeviceSize STATS_OFFSET			= 256;
+static const VkDeviceSize TEMPLATE_OFFSET		= 512;
+
+/*
+*	Matches local_size_x of the culling shader
+*/
+static const uint32_t WORKGROUP_SIZE			= 64;
+
+/*
+*	Entities per job when writing the culling input
+*/
+static const size_t UPLOAD_GRAIN_SIZE			= 4096;
+
+/*
+*	Laid out like the std140 uniform block of the culling shader
+*/
+struct CullingUniforms {
+
+	glm::mat4		viewProjection;
+	glm::vec4		planes[6];
+	glm::vec2		depthSize;
+	uint32_t		instanceCount;
+	uint32_t		batchCount;
+
+};
+
+/*
+*	Laid out like the push constant block of the culling shader
+*	Phase 0 culls and draws early, 1 compacts the draws starting at drawBase, 2 culls against the depth pyramid and draws late
+*/
+struct CullingPushConstants {
+
+	uint32_t		phase;
+	uint32_t		drawBase;
+
+};
+
+/*
+*	Function:		VkDeviceSize getInstanceOffset(size_t batchCapacity_, uint32_t phaseCount_)
+*	Purpose:		Returns where the culling input starts in the upload buffer, behind one set of draw templates per phase
+*
+*/
+static inline VkDeviceSize getInstanceOffset(size_t batchCapacity_, uint32_t phaseCount_) {
+
+	return TEMPLATE_OFFSET + sizeof(GpuDrawCommand) * batchCapacity_ * phaseCount_;
+
+}
+
+/*
+*	Function:		VkDeviceSize getCountOffset(size_t batchCapacity_, uint32_t phaseCount_)
+*	Purpose:		Returns where the per-run draw counts start in the draw buffer, behind the draws and the compacted draws
+*
+*/
+static inline VkDeviceSize getCountOffset(size_t batchCapacity_, uint32_t phaseCount_) {
+
+	return 2 * sizeof(GpuDrawCommand) * batchCapacity_ * phaseCount_;
+
+}
+
+/*
+*	Function:		VkDeviceSize getInstanceIndexOffset(size_t batchCapacity_, uint32_t phaseCount_)
+*	Purpose:		Returns where the instance to entity indices start in the draw buffer
+*
+*/
+static inline VkDeviceSize getInstanceIndexOffset(size_t batchCapacity_, uint32_t phaseCount_) {
+
+	return getCountOffset(batchCapacity_, phaseCount_) + sizeof(uint32_t) * batchCapacity_ * phaseCount_;
+
+}
+
+/*
+*	Function:		GpuCulling()
+*	Purpose:		Default constructor
+*
+*/
+GpuCulling::GpuCulling(void) : drawIndirectCount(false), multiDrawIndirect(false), depthPyramid(nullptr), phaseCount(1), batchGeneration(0), batchVersion(0), lateInstanceBase(0), visibilityCapacity(0), visibilityVersion(0) {
+
+
+
+}
+
+/*
+*	Function:		void init(bool drawIndirectCount_, bool multiDrawIndirect_, DepthPyramid* depthPyramid_)
+*	Purpose:		Creates the culling pipeline and the per-frame buffers, the flags tell which of the optional draw paths the device enabled
+*					Entities are also tested against depthPyramid_ if it is not nullptr, it has to be created already
+*
+*/
+void GpuCulling::init(bool drawIndirectCount_, bool multiDrawIndirect_, DepthPyramid* depthPyramid_) {
+
+	drawIndirectCount		= false;
+	multiDrawIndirect		= multiDrawIndirect_;
+	depthPyramid			= depthPyramid_;
+	phaseCount				= depthPyramid != nullptr ? 2 : 1;
+
+#if defined VK_KHR_draw_indirect_count
+	if (drawIndirectCount_) {
+
+		cmdDrawIndexedIndirectCount		= reinterpret_cast< PFN_vkCmdDrawIndexedIndirectCountKHR >(vkGetDeviceProcAddr(engine.device, "vkCmdDrawIndexedIndirectCountKHR"));
+		cmdDrawIndirectCount			= reinterpret_cast< PFN_vkCmdDrawIndirectCountKHR >(vkGetDeviceProcAddr(engine.device, "vkCmdDrawIndirectCountKHR"));
+		drawIndirectCount				= cmdDrawIndexedIndirectCount != nullptr && cmdDrawIndirectCount != nullptr;
+
+	}
+#endif
+
+	createPipeline();
+
+	std::vector< VkDescriptorPoolSize > poolSizes(2);
+	poolSizes[0].type										= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount							= engine.MAX_FRAMES_IN_FLIGHT;
+	poolSizes[1].type										= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount							= (depthPyramid != nullptr ? 7 : 6) * engine.MAX_FRAMES_IN_FLIGHT;
+	if (depthPyramid != nullptr) {
+
+		VkDescriptorPoolSize samplerSize					= {};
+		samplerSize.type									= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		samplerSize.descriptorCount							= engine.MAX_FRAMES_IN_FLIGHT;
+		poolSizes.push_back(samplerSize);
+
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo						= {};
+	poolInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount									= static_cast< uint32_t >(poolSizes.size());
+	poolInfo.pPoolSizes										= poolSizes.data();
+	poolInfo.maxSets										= engine.MAX_FRAMES_IN_FLIGHT;
+
+	if (vkCreateDescriptorPool(
+
+		engine.device,
+		&poolInfo,
+		nullptr,
+		&descriptorPool.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create culling descriptor pool!");
+
+	}
+
+	std::vector< VkDescriptorSetLayout > layouts(engine.MAX_FRAMES_IN_FLIGHT, descriptorSetLayout.get());
+	std::vector< VkDescriptorSet > descriptorSets(engine.MAX_FRAMES_IN_FLIGHT);
+
+	VkDescriptorSetAllocateInfo allocInfo					= {};
+	allocInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool								= descriptorPool;
+	allocInfo.descriptorSetCount							= static_cast< uint32_t >(layouts.size());
+	allocInfo.pSetLayouts									= layouts.data();
+
+	if (vkAllocateDescriptorSets(
+
+		engine.device,
+		&allocInfo,
+		descriptorSets.data()
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to allocate culling descriptor sets!");
+
+	}
+
+	frames.resize(engine.MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < engine.MAX_FRAMES_IN_FLIGHT; i++) {
+
+		frames[i].uploadMapped			= nullptr;
+		frames[i].descriptorSet			= descriptorSets[i];
+		frames[i].instanceCapacity		= 0;
+		frames[i].batchCapacity			= 0;
+		frames[i].instanceCount			= 0;
+		frames[i].batchVersion			= 0;
+		frames[i].transformVersion		= 0;
+		frames[i].visibilityVersion		= 0;
+		frames[i].pyramidVersion		= 0;
+		reserve(i, INSTANCE_GRANULARITY, BATCH_GRANULARITY);
+
+	}
+
+}
+
+/*
+*	Function:		bool update(
+*
+*						uint32_t				frame_,
+*						const Scene&			scene_,
+*						uint64_t				sceneGeneration_,
+*						const glm::mat4&		viewProjection_
+*
+*					)
+*	Purpose:		Writes the culling input of frame_, returns true if its buffers were reallocated and the descriptors pointing at them have to be rewritten
+*					Also true if the culling descriptors were rewritten for a new depth pyramid or visibility buffer, the recorded commands are stale then too
+*
+*/
+bool GpuCulling::update(
+
+	uint32_t				frame_,
+	const Scene&			scene_,
+	uint64_t				sceneGeneration_,
+	const glm::mat4&		viewProjection_
+
+) {
+
+	// batches only change with the scene structure, everything recorded depends on them
+	if (batchGeneration != sceneGeneration_) {
+
+		rebuildBatches(scene_);
+		batchGeneration = sceneGeneration_;
+
+	}
+
+	size_t instanceCount			= scene_.size();
+	bool reallocated				= reserve(frame_, instanceCount, drawTemplates.size());
+	FrameResources& frame			= frames[frame_];
+	frame.instanceCount				= static_cast< uint32_t >(instanceCount);
+
+	// the pyramid or the shared visibility buffer may have been replaced while this frame's descriptors still point at the old ones
+	if (depthPyramid != nullptr && (frame.visibilityVersion != visibilityVersion || frame.pyramidVersion != depthPyramid->getVersion())) {
+
+		writeDescriptors(frame_);
+		reallocated					= true;
+
+	}
+
+	Frustum frustum					= Frustum::fromViewProjection(viewProjection_);
+	VkExtent2D depthExtent			= depthPyramid != nullptr ? depthPyramid->getDepthExtent() : VkExtent2D{ 0, 0 };
+
+	CullingUniforms uniforms;
+	uniforms.viewProjection			= viewProjection_;
+	std::copy(frustum.planes, frustum.planes + 6, uniforms.planes);
+	uniforms.depthSize				= glm::vec2(depthExtent.width, depthExtent.height);
+	uniforms.instanceCount			= frame.instanceCount;
+	uniforms.batchCount				= static_cast< uint32_t >(drawTemplates.size());
+	memcpy(frame.uploadMapped + UNIFORM_OFFSET, &uniforms, sizeof(CullingUniforms));
+
+	if (drawTemplates.empty()) {
+
+		// nothing gets dispatched, so nothing would reset the counter either
+		memset(frame.uploadMapped + STATS_OFFSET, 0, sizeof(uint32_t));
+
+	}
+
+	if (frame.batchVersion != batchVersion) {
+
+		if (!drawTemplates.empty()) {
+
+			memcpy(frame.uploadMapped + TEMPLATE_OFFSET, drawTemplates.data(), sizeof(GpuDrawCommand) * drawTemplates.size());
+
+		}
+
+		// the late draws are the same, only their instances go behind the ones of the early draws
+		GpuDrawCommand* lateTemplates	= reinterpret_cast< GpuDrawCommand* >(frame.uploadMapped + TEMPLATE_OFFSET) + frame.batchCapacity;
+		for (size_t b = 0; phaseCount > 1 && b < drawTemplates.size(); b++) {
+
+			GpuDrawCommand command		= drawTemplates[b];
+			command.instanceBase		+= lateInstanceBase;
+			if (runs[command.run].mesh->indexCount > 0) {
+
+				command.firstInstance	+= lateInstanceBase;
+
+			}
+			else {
+
+				command.vertexOffset	+= static_cast< int32_t >(lateInstanceBase);
+
+			}
+			lateTemplates[b]			= command;
+
+		}
+		frame.batchVersion			= batchVersion;
+		frame.transformVersion		= 0;
+
+	}
+
+	if (frame.transformVersion != scene_.getTransformVersion() && instanceCount > 0) {
+
+		const Bounds* bounds		= scene_.getWorldBounds();
+		const uint32_t* batches		= entityBatches.data();
+		GpuInstance* instances		= reinterpret_cast< GpuInstance* >(frame.uploadMapped + getInstanceOffset(frame.batchCapacity, phaseCount));
+
+		JobCounter uploadCounter;
+		engine.jobSystem.parallelFor(0, instanceCount, UPLOAD_GRAIN_SIZE, [=] (size_t first_, size_t last_) {
+
+			for (size_t i = first_; i < last_; i++) {
+
+				GpuInstance instance;
+				instance.center		= bounds[i].center;
+				instance.radius		= bounds[i].radius;
+				instance.extents	= bounds[i].extents;
+				instance.batch		= batches[i];
+				instances[i]		= instance;
+
+			}
+
+		}, &uploadCounter);
+		engine.jobSystem.wait(&uploadCounter);
+
+	}
+	frame.transformVersion			= scene_.getTransformVersion();
+
+	return reallocated;
+
+}
+
+/*
+*	Function:		void recordCulling(VkCommandBuffer commandBuffer_, uint32_t frame_)
+*	Purpose:		Records the culling pass of frame_, has to go before the render pass drawing its results
+*					With occlusion culling this is the early phase, only entities visible last frame are drawn
+*
+*/
+void GpuCulling::recordCulling(VkCommandBuffer commandBuffer_, uint32_t frame_) {
+
+	const FrameResources& frame		= frames[frame_];
+	uint32_t batchCount				= static_cast< uint32_t >(drawTemplates.size());
+	if (frame.instanceCount == 0 || batchCount == 0) {
+
+		return;
+
+	}
+
+	// fresh draws with no instances, and zeroed counters
+	std::array< VkBufferCopy, 2 > templateCopies	= {};
+	for (uint32_t i = 0; i < phaseCount; i++) {
+
+		templateCopies[i].srcOffset		= TEMPLATE_OFFSET + sizeof(GpuDrawCommand) * frame.batchCapacity * i;
+		templateCopies[i].dstOffset		= sizeof(GpuDrawCommand) * frame.batchCapacity * i;
+		templateCopies[i].size			= sizeof(GpuDrawCommand) * batchCount;
+
+	}
+	vkCmdCopyBuffer(commandBuffer_, frame.uploadBuffer, frame.drawBuffer, phaseCount, templateCopies.data());
+	vkCmdFillBuffer(commandBuffer_, frame.uploadBuffer, STATS_OFFSET, sizeof(uint32_t), 0);
+	if (drawIndirectCount) {
+
+		vkCmdFillBuffer(commandBuffer_, frame.drawBuffer, getCountOffset(frame.batchCapacity, phaseCount), sizeof(uint32_t) * frame.batchCapacity * phaseCount, 0);
+
+	}
+
+	// the previous frame's late phase may still be writing the visibility buffer
+	VkMemoryBarrier barrier			= {};
+	barrier.sType					= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask			= VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask			= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer_, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	recordPhase(commandBuffer_, frame_, 0, 0);
+
+}
+
+/*
+*	Function:		void recordOcclusionCulling(VkCommandBuffer commandBuffer_, uint32_t frame_)
+*	Purpose:		Records the late phase of frame_, after the depth pyramid was built from what the early phase drew
+*					Every entity is tested against the pyramid, the ones that are visible but were not drawn early get the late draws
+*
+*/
+void GpuCulling::recordOcclusionCulling(VkCommandBuffer commandBuffer_, uint32_t frame_) {
+
+	const FrameResources& frame		= frames[frame_];
+	if (depthPyramid == nullptr || frame.instanceCount == 0 || drawTemplates.empty()) {
+
+		return;
+
+	}
+
+	// the visible counter and the visibility buffer are still being written by the early phase
+	VkMemoryBarrier barrier			= {};
+	barrier.sType					= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask			= VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask			= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	recordPhase(commandBuffer_, frame_, 2, static_cast< uint32_t >(frame.batchCapacity));
+
+}
+
+/*
+*	Function:		void recordDraws(
+*
+*						VkCommandBuffer			commandBuffer_,
+*						uint32_t				frame_,
+*						size_t					firstRun_,
+*						size_t					lastRun_,
+*						bool					late_
+*
+*					)
+*	Purpose:		Records one indirect draw per run from firstRun_ to lastRun_, or one per batch if the device can only draw one command at a time
+*					late_ selects the draws filled by the late phase of occlusion culling
+*
+*/
+void GpuCulling::recordDraws(
+
+	VkCommandBuffer			commandBuffer_,
+	uint32_t				frame_,
+	size_t					firstRun_,
+	size_t					lastRun_,
+	bool					late_
+
+) {
+
+	const FrameResources& frame		= frames[frame_];
+	size_t drawBase					= late_ ? frame.batchCapacity : 0;
+	VkDeviceSize countOffset		= getCountOffset(frame.batchCapacity, phaseCount) + sizeof(uint32_t) * drawBase;
+	VkDeviceSize compactedOffset	= sizeof(GpuDrawCommand) * frame.batchCapacity * phaseCount;
+	uint32_t stride					= sizeof(GpuDrawCommand);
+	Pipeline* boundPipeline			= nullptr;
+	VkBuffer vertexBuffer			= engine.geometryPool.getVertexBuffer();
+	VkDeviceSize offsets[]			= { 0 };
+
+	// every mesh lives in the geometry pool, the draws only differ in their offsets into it
+	if (firstRun_ < lastRun_ && vertexBuffer != VK_NULL_HANDLE) {
+
+		vkCmdBindVertexBuffers(commandBuffer_, 0, 1, &vertexBuffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer_, engine.geometryPool.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+	}
+
+	for (size_t r = firstRun_; r < lastRun_; r++) {
+
+		const GpuDrawRun& run		= runs[r];
+		bool indexed				= run.mesh->indexCount > 0;
+		VkDeviceSize drawOffset		= sizeof(GpuDrawCommand) * (drawBase + run.firstBatch);
+
+		if (run.pipeline != boundPipeline) {
+
+			boundPipeline = run.pipeline;
+			boundPipeline->bind(commandBuffer_, &boundPipeline->descriptorSets[frame_]);
+
+		}
+
+#if defined VK_KHR_draw_indirect_count
+		if (drawIndirectCount) {
+
+			if (indexed) {
+
+				cmdDrawIndexedIndirectCount(commandBuffer_, frame.drawBuffer, compactedOffset + drawOffset, frame.drawBuffer, countOffset + sizeof(uint32_t) * r, run.batchCount, stride);
+
+			}
+			else {
+
+				cmdDrawIndirectCount(commandBuffer_, frame.drawBuffer, compactedOffset + drawOffset, frame.drawBuffer, countOffset + sizeof(uint32_t) * r, run.batchCount, stride);
+
+			}
+			continue;
+
+		}
+#endif
+
+		// without a count the empty batches are drawn too, with no instances they cost next to nothing
+		uint32_t drawCount			= multiDrawIndirect ? run.batchCount : 1;
+		for (uint32_t b = 0; b < run.batchCount; b += drawCount) {
+
+			if (indexed) {
+
+				vkCmdDrawIndexedIndirect(commandBuffer_, frame.drawBuffer, drawOffset + stride * b, drawCount, stride);
+
+			}
+			else {
+
+				vkCmdDrawIndirect(commandBuffer_, frame.drawBuffer, drawOffset + stride * b, drawCount, stride);
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		size_t getRunCount()
+*	Purpose:		Returns the number of draw runs, which is what recording has to be split over
+*
+*/
+size_t GpuCulling::getRunCount(void) const {
+
+	return runs.size();
+
+}
+
+/*
+*	Function:		uint32_t getVisibleCount(uint32_t frame_)
+*	Purpose:		Returns how many entities passed culling the last time frame_ was rendered, only valid once that frame finished
+*
+*/
+uint32_t GpuCulling::getVisibleCount(uint32_t frame_) const {
+
+	uint32_t visibleCount;
+	memcpy(&visibleCount, frames[frame_].uploadMapped + STATS_OFFSET, sizeof(uint32_t));
+	return visibleCount;
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getInstanceIndexBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the range the culling pass writes the entity index of every drawn instance to, the vertex shaders read it with gl_InstanceIndex
+*
+*/
+VkDescriptorBufferInfo GpuCulling::getInstanceIndexBufferInfo(uint32_t frame_) const {
+
+	const FrameResources& frame		= frames[frame_];
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frame.drawBuffer;
+	bufferInfo.offset					= getInstanceIndexOffset(frame.batchCapacity, phaseCount);
+	bufferInfo.range					= sizeof(uint32_t) * frame.instanceCapacity * phaseCount;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the pipeline and all buffers
+*
+*/
+void GpuCulling::destroy(void) {
+
+	for (auto& frame : frames) {
+
+		if (frame.uploadMapped != nullptr) {
+
+			vkUnmapMemory(engine.device, frame.uploadMemory);
+
+		}
+		frame.uploadBuffer.reset();
+		frame.uploadMemory.reset();
+		frame.drawBuffer.reset();
+		frame.drawMemory.reset();
+
+	}
+	frames.clear();
+
+	visibilityBuffer.reset();
+	visibilityMemory.reset();
+	pipeline.reset();
+	pipelineLayout.reset();
+	descriptorPool.reset();
+	descriptorSetLayout.reset();
+
+}
+
+/*
+*	Function:		~GpuCulling()
+*	Purpose:		Default destructor
+*
+*/
+GpuCulling::~GpuCulling() {
+
+
+
+}
+
+/*
+*	Function:		void createPipeline()
+*	Purpose:		Creates the descriptor set layout and the compute pipeline of the culling shader
+*
+*/
+void GpuCulling::createPipeline(void) {
+
+	// 0 uniforms, 1 instances, 2 draws, 3 instance indices, 4 compacted draws, 5 draw counts, 6 visible counter, occlusion culling adds 7 depth pyramid, 8 visibility
+	std::vector< VkDescriptorSetLayoutBinding > bindings(depthPyramid != nullptr ? 9 : 7);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+
+		bindings[i].binding										= i;
+		bindings[i].descriptorCount								= 1;
+		bindings[i].descriptorType								= i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : i == 7 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].pImmutableSamplers							= nullptr;
+		bindings[i].stageFlags									= VK_SHADER_STAGE_COMPUTE_BIT;
+
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo					= {};
+	layoutInfo.sType											= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount										= static_cast< uint32_t >(bindings.size());
+	layoutInfo.pBindings										= bindings.data();
+
+	if (vkCreateDescriptorSetLayout(
+
+		engine.device,
+		&layoutInfo,
+		nullptr,
+		&descriptorSetLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create culling descriptor set layout!");
+
+	}
+
+	VkPushConstantRange pushConstantRange						= {};
+	pushConstantRange.stageFlags								= VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset									= 0;
+	pushConstantRange.size										= sizeof(CullingPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo				= {};
+	pipelineLayoutInfo.sType									= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount							= 1;
+	pipelineLayoutInfo.pSetLayouts								= descriptorSetLayout.address();
+	pipelineLayoutInfo.pushConstantRangeCount					= 1;
+	pipelineLayoutInfo.pPushConstantRanges						= &pushConstantRange;
+
+	if (vkCreatePipelineLayout(
+
+		engine.device,
+		&pipelineLayoutInfo,
+		nullptr,
+		&pipelineLayout.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create culling pipeline layout!");
+
+	}
+
+	ShaderModule computeShaderModule							= ShaderModule(depthPyramid != nullptr ? "shaders/cullingShaders/occlusion.spv" : "shaders/cullingShaders/comp.spv");
+
+	VkPipelineShaderStageCreateInfo stageInfo					= {};
+	stageInfo.sType												= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage												= VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module											= computeShaderModule.getModule();
+	stageInfo.pName												= "main";
+
+	VkComputePipelineCreateInfo pipelineInfo					= {};
+	pipelineInfo.sType											= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage											= stageInfo;
+	pipelineInfo.layout											= pipelineLayout;
+
+	if (vkCreateComputePipelines(
+
+		engine.device,
+		VK_NULL_HANDLE,
+		1,
+		&pipelineInfo,
+		nullptr,
+		&pipeline.replace(engine.device)
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to create culling pipeline!");
+
+	}
+
+	vkDestroyShaderModule(
+
+		engine.device,
+		computeShaderModule.getModule(),
+		nullptr
+
+	);
+
+}
+
+/*
+*	Function:		void recordPhase(
+*
+*						VkCommandBuffer			commandBuffer_,
+*						uint32_t				frame_,
+*						uint32_t				phase_,
+*						uint32_t				drawBase_
+*
+*					)
+*	Purpose:		Records one culling phase over all entities, followed by the compaction of the draws it filled, which start at drawBase_
+*
+*/
+void GpuCulling::recordPhase(
+
+	VkCommandBuffer			commandBuffer_,
+	uint32_t				frame_,
+	uint32_t				phase_,
+	uint32_t				drawBase_
+
+) {
+
+	const FrameResources& frame		= frames[frame_];
+	uint32_t batchCount				= static_cast< uint32_t >(drawTemplates.size());
+
+	vkCmdBindPipeline(commandBuffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+
+	// tests every entity and appends the visible ones to their batch
+	CullingPushConstants constants	= { phase_, drawBase_ };
+	vkCmdPushConstants(commandBuffer_, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstants), &constants);
+	vkCmdDispatch(commandBuffer_, (frame.instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier barrier			= {};
+	barrier.sType					= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+	// phase 1 packs the draws with instances to the front of their run, which draw-indirect-count then reads up to the run's count
+	if (drawIndirectCount) {
+
+		barrier.srcAccessMask		= VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask		= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		constants.phase				= 1;
+		vkCmdPushConstants(commandBuffer_, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstants), &constants);
+		vkCmdDispatch(commandBuffer_, (batchCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	}
+
+	// the host reads the visible counter back once the frame finished
+	barrier.srcAccessMask			= VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask			= VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(
+
+		commandBuffer_,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+
+	);
+
+}
+
+/*
+*	Function:		void rebuildBatches(const Scene& scene_)
+*	Purpose:		Groups the entities into batches of the same material and mesh and lays out their draws and instance ranges
+*
+*/
+void GpuCulling::rebuildBatches(const Scene& scene_) {
+
+	struct Batch {
+
+		Pipeline*			pipeline;
+		const MeshInfo*		mesh;
+		uint32_t			instanceCount;
+
+	};
+
+	size_t entityCount							= scene_.size();
+	const ObjectHandle* meshes					= scene_.getMeshes();
+	const MaterialHandle* materials				= scene_.getMaterials();
+	std::unordered_map< uint64_t, uint32_t >	batchIndices;
+	std::vector< Batch >						batches;
+
+	entityBatches.assign(entityCount, UINT32_MAX);
+	for (size_t i = 0; i < entityCount; i++) {
+
+		Object* mesh			= engine.getObject(meshes[i]);
+		Pipeline* material		= engine.getMaterial(materials[i]);
+		if (mesh == nullptr || material == nullptr) {
+
+			continue;
+
+		}
+
+		uint64_t key			= (static_cast< uint64_t >(materials[i].index) << 32) | meshes[i].index;
+		auto inserted			= batchIndices.emplace(key, static_cast< uint32_t >(batches.size()));
+		if (inserted.second) {
+
+			batches.push_back({ material, &mesh->getMeshInfo(), 0 });
+
+		}
+		entityBatches[i]		= inserted.first->second;
+		batches[inserted.first->second].instanceCount++;
+
+	}
+
+	// all meshes share the geometry pool buffers, so batches of one pipeline form one indexed and one non-indexed run
+	std::vector< uint32_t > order(batches.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&batches] (uint32_t a_, uint32_t b_) {
+
+		const Batch& a = batches[a_];
+		const Batch& b = batches[b_];
+		if (a.pipeline != b.pipeline) {
+
+			return std::less< Pipeline* >()(a.pipeline, b.pipeline);
+
+		}
+		return (a.mesh->indexCount > 0) < (b.mesh->indexCount > 0);
+
+	});
+
+	std::vector< uint32_t > remap(batches.size());
+	drawTemplates.clear();
+	runs.clear();
+	uint32_t instanceBase = 0;
+	for (uint32_t b = 0; b < order.size(); b++) {
+
+		const Batch& batch		= batches[order[b]];
+		bool indexed			= batch.mesh->indexCount > 0;
+		remap[order[b]]			= b;
+
+		if (runs.empty()
+			|| runs.back().pipeline != batch.pipeline
+			|| (runs.back().mesh->indexCount > 0) != indexed) {
+
+			runs.push_back({ batch.pipeline, batch.mesh, b, 0 });
+
+		}
+		runs.back().batchCount++;
+
+		GpuDrawCommand command	= {};
+		command.count			= indexed ? batch.mesh->indexCount : batch.mesh->vertexCount;
+		command.instanceCount	= 0;
+		command.first			= indexed ? batch.mesh->firstIndex : batch.mesh->firstVertex;
+		command.vertexOffset	= indexed ? static_cast< int32_t >(batch.mesh->firstVertex) : static_cast< int32_t >(instanceBase);
+		command.firstInstance	= indexed ? instanceBase : 0;
+		command.run				= static_cast< uint32_t >(runs.size() - 1);
+		command.runFirst		= runs.back().firstBatch;
+		command.instanceBase	= instanceBase;
+		drawTemplates.push_back(command);
+
+		instanceBase			+= batch.instanceCount;
+
+	}
+	lateInstanceBase = instanceBase;
+
+	for (auto& batch : entityBatches) {
+
+		if (batch != UINT32_MAX) {
+
+			batch = remap[batch];
+
+		}
+
+	}
+
+	batchVersion++;
+
+}
+
+/*
+*	Function:		bool reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_)
+*	Purpose:		Grows the buffers of frame_ to hold at least instanceCount_ entities and batchCount_ batches, returns true if they were reallocated
+*
+*/
+bool GpuCulling::reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_) {
+
+	FrameResources& frame		= frames[frame_];
+	if (instanceCount_ <= frame.instanceCapacity && batchCount_ <= frame.batchCapacity) {
+
+		return false;
+
+	}
+
+	size_t instanceCapacity		= frame.instanceCapacity;
+	if (instanceCount_ > instanceCapacity) {
+
+		instanceCapacity		= std::max(instanceCount_, instanceCapacity * 2);
+		instanceCapacity		= (instanceCapacity + INSTANCE_GRANULARITY - 1) / INSTANCE_GRANULARITY * INSTANCE_GRANULARITY;
+
+	}
+
+	size_t batchCapacity		= frame.batchCapacity;
+	if (batchCount_ > batchCapacity) {
+
+		batchCapacity			= std::max(batchCount_, batchCapacity * 2);
+		batchCapacity			= (batchCapacity + BATCH_GRANULARITY - 1) / BATCH_GRANULARITY * BATCH_GRANULARITY;
+
+	}
+
+	VkDeviceSize uploadSize		= getInstanceOffset(batchCapacity, phaseCount) + sizeof(GpuInstance) * instanceCapacity;
+	VkDeviceSize drawSize		= getInstanceIndexOffset(batchCapacity, phaseCount) + sizeof(uint32_t) * instanceCapacity * phaseCount;
+
+	// retired, the frames still in flight keep using the old buffers
+	frame.uploadBuffer.reset();
+	frame.uploadMemory.reset();
+	frame.drawBuffer.reset();
+	frame.drawMemory.reset();
+
+	engine.createBuffer(
+
+		uploadSize,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame.uploadBuffer.replace(engine.device),
+		frame.uploadMemory.replace(engine.device)
+
+	);
+
+	engine.createBuffer(
+
+		drawSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		frame.drawBuffer.replace(engine.device),
+		frame.drawMemory.replace(engine.device)
+
+	);
+
+	void* data;
+	vkMapMemory(
+
+		engine.device,
+		frame.uploadMemory,
+		0,
+		uploadSize,
+		0,
+		&data
+
+	);
+	frame.uploadMapped			= static_cast< uint8_t* >(data);
+	memset(frame.uploadMapped + STATS_OFFSET, 0, sizeof(uint32_t));
+
+	frame.instanceCapacity		= instanceCapacity;
+	frame.batchCapacity			= batchCapacity;
+	frame.batchVersion			= 0;
+	frame.transformVersion		= 0;
+
+	// shared by all frames, every frame's late phase leaves it for the next frame's early phase
+	if (depthPyramid != nullptr && instanceCapacity > visibilityCapacity) {
+
+		// the new contents are undefined, which only decides what gets drawn early for one frame
+		engine.createBuffer(
+
+			sizeof(uint32_t) * instanceCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			visibilityBuffer.replace(engine.device),
+			visibilityMemory.replace(engine.device)
+
+		);
+		visibilityCapacity		= instanceCapacity;
+		visibilityVersion++;
+
+	}
+
+	writeDescriptors(frame_);
+
+	return true;
+
+}
+
+/*
+*	Function:		void writeDescriptors(uint32_t frame_)
+*	Purpose:		Points the culling descriptor set of frame_ at its buffers, and at the depth pyramid and the visibility buffer with occlusion culling
+*
+*/
+void GpuCulling::writeDescriptors(uint32_t frame_) {
+
+	FrameResources& frame									= frames[frame_];
+	VkDeviceSize drawRange									= sizeof(GpuDrawCommand) * frame.batchCapacity * phaseCount;
+
+	std::array< VkDescriptorBufferInfo, 9 > bufferInfos		= {};
+	bufferInfos[0].buffer									= frame.uploadBuffer;
+	bufferInfos[0].offset									= UNIFORM_OFFSET;
+	bufferInfos[0].range									= sizeof(CullingUniforms);
+	bufferInfos[1].buffer									= frame.uploadBuffer;
+	bufferInfos[1].offset									= getInstanceOffset(frame.batchCapacity, phaseCount);
+	bufferInfos[1].range									= sizeof(GpuInstance) * frame.instanceCapacity;
+	bufferInfos[2].buffer									= frame.drawBuffer;
+	bufferInfos[2].offset									= 0;
+	bufferInfos[2].range									= drawRange;
+	bufferInfos[3]											= getInstanceIndexBufferInfo(frame_);
+	bufferInfos[4].buffer									= frame.drawBuffer;
+	bufferInfos[4].offset									= drawRange;
+	bufferInfos[4].range									= drawRange;
+	bufferInfos[5].buffer									= frame.drawBuffer;
+	bufferInfos[5].offset									= getCountOffset(frame.batchCapacity, phaseCount);
+	bufferInfos[5].range									= sizeof(uint32_t) * frame.batchCapacity * phaseCount;
+	bufferInfos[6].buffer									= frame.uploadBuffer;
+	bufferInfos[6].offset									= STATS_OFFSET;
+	bufferInfos[6].range									= sizeof(uint32_t);
+	bufferInfos[8].buffer									= visibilityBuffer;
+	bufferInfos[8].offset									= 0;
+	bufferInfos[8].range									= sizeof(uint32_t) * visibilityCapacity;
+
+	std::vector< VkWriteDescriptorSet > descriptorWrites(depthPyramid != nullptr ? 9 : 7);
+	for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+
+		descriptorWrites[i].sType							= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet							= frame.descriptorSet;
+		descriptorWrites[i].dstBinding						= i;
+		descriptorWrites[i].dstArrayElement					= 0;
+		descriptorWrites[i].descriptorType					= i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount					= 1;
+		descriptorWrites[i].pBufferInfo						= &bufferInfos[i];
+
+	}
+
+	VkDescriptorImageInfo pyramidInfo						= {};
+	if (depthPyramid != nullptr) {
+
+		pyramidInfo											= depthPyramid->getImageInfo();
+		descriptorWrites[7].descriptorType					= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[7].pBufferInfo						= nullptr;
+		descriptorWrites[7].pImageInfo						= &pyramidInfo;
+		frame.visibilityVersion								= visibilityVersion;
+		frame.pyramidVersion								= depthPyramid->getVersion();
+
+	}
+
+	vkUpdateDescriptorSets(
+
+		engine.device,
+		static_cast< uint32_t >(descriptorWrites.size()),
+		descriptorWrites.data(),
+		0,
+		nullptr
+
+	);
+
+}
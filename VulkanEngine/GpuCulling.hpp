@@ -0,0 +1,165 @@
+/*
+*	File:		GpuCulling.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.cpp"
+#include "Object.hpp"
+#include "VulkanHandle.hpp"
+
+class DepthPyramid;
+class Pipeline;
+class Scene;
+
+/*
+*	Culling input of one entity, laid out like the Instance struct of the culling shader
+*	batch is UINT32_MAX for entities without a valid mesh or material
+*/
+struct GpuInstance {
+
+	glm::vec3		center;
+	float			radius;
+	glm::vec3		extents;
+	uint32_t		batch;
+
+};
+
+/*
+*	Indirect draw of one batch, the first five words are a VkDrawIndexedIndirectCommand
+*	Meshes without indices use the first four words as a VkDrawIndirectCommand, so vertexOffset holds the first instance there
+*/
+struct GpuDrawCommand {
+
+	uint32_t		count;
+	uint32_t		instanceCount;			// counted up by the culling shader
+	uint32_t		first;
+	int32_t			vertexOffset;
+	uint32_t		firstInstance;
+	uint32_t		run;					// draw run the batch belongs to
+	uint32_t		runFirst;				// first batch of that run, where its compacted draws start
+	uint32_t		instanceBase;			// first slot of the batch in the instance index buffer
+
+};
+
+/*
+*	Consecutive batches that share a pipeline and are all indexed or all not, drawn by one indirect call out of the geometry pool
+*/
+struct GpuDrawRun {
+
+	Pipeline*			pipeline;
+	const MeshInfo*		mesh;
+	uint32_t			firstBatch;
+	uint32_t			batchCount;
+
+};
+
+/*
+*	Class:			GpuCulling
+*	Purpose:		GPU-driven submission: a compute pass culls every entity against the view frustum and fills indirect draw commands
+*					Entities are grouped into batches by material and mesh, every visible entity adds one instance to its batch
+*					Recording only depends on the number of draw runs, not on the number of entities or on what is visible
+*					With a depth pyramid, culling runs in two phases: the early phase draws what was visible last frame, the late phase
+*					tests everything against the pyramid built from that and draws what became visible, with its own set of draws
+*
+*/
+class GpuCulling {
+public:
+	GpuCulling(void);
+	void init(bool drawIndirectCount_, bool multiDrawIndirect_, DepthPyramid* depthPyramid_);
+	bool update(
+
+		uint32_t				frame_,
+		const Scene&			scene_,
+		uint64_t				sceneGeneration_,
+		const glm::mat4&		viewProjection_
+
+	);
+	void recordCulling(VkCommandBuffer commandBuffer_, uint32_t frame_);
+	void recordOcclusionCulling(VkCommandBuffer commandBuffer_, uint32_t frame_);
+	void recordDraws(
+
+		VkCommandBuffer			commandBuffer_,
+		uint32_t				frame_,
+		size_t					firstRun_,
+		size_t					lastRun_,
+		bool					late_
+
+	);
+	size_t getRunCount(void) const;
+	uint32_t getVisibleCount(uint32_t frame_) const;
+	VkDescriptorBufferInfo getInstanceIndexBufferInfo(uint32_t frame_) const;
+	void destroy(void);
+	~GpuCulling();
+private:
+	/*
+	*	Per-frame buffers, the upload buffer is written by the CPU, the draw buffer only by the GPU
+	*/
+	struct FrameResources {
+
+		UniqueBuffer			uploadBuffer;
+		UniqueDeviceMemory		uploadMemory;
+		uint8_t*				uploadMapped;
+		UniqueBuffer			drawBuffer;
+		UniqueDeviceMemory		drawMemory;
+		VkDescriptorSet			descriptorSet;
+		size_t					instanceCapacity;
+		size_t					batchCapacity;
+		uint32_t				instanceCount;
+		uint64_t				batchVersion;
+		uint64_t				transformVersion;
+		uint64_t				visibilityVersion;
+		uint64_t				pyramidVersion;
+
+	};
+
+	bool										drawIndirectCount;
+	bool										multiDrawIndirect;
+	DepthPyramid*								depthPyramid;			// nullptr without occlusion culling
+	uint32_t									phaseCount;				// sets of draws per frame, one per culling phase that draws
+	UniqueDescriptorSetLayout					descriptorSetLayout;
+	UniqueDescriptorPool						descriptorPool;
+	UniquePipelineLayout						pipelineLayout;
+	UniquePipeline								pipeline;
+	std::vector< FrameResources >				frames;
+	std::vector< uint32_t >						entityBatches;
+	std::vector< GpuDrawCommand >				drawTemplates;
+	std::vector< GpuDrawRun >					runs;
+	uint64_t									batchGeneration;
+	uint64_t									batchVersion;
+	uint32_t									lateInstanceBase;		// where the instance ranges of the late draws start
+	UniqueBuffer								visibilityBuffer;		// one word per entity, whether it passed the late phase last frame
+	UniqueDeviceMemory							visibilityMemory;
+	size_t										visibilityCapacity;
+	uint64_t									visibilityVersion;
+#if defined VK_KHR_draw_indirect_count
+	PFN_vkCmdDrawIndexedIndirectCountKHR		cmdDrawIndexedIndirectCount;
+	PFN_vkCmdDrawIndirectCountKHR				cmdDrawIndirectCount;
+#endif
+
+	void createPipeline(void);
+	void recordPhase(
+
+		VkCommandBuffer			commandBuffer_,
+		uint32_t				frame_,
+		uint32_t				phase_,
+		uint32_t				drawBase_
+
+	);
+	void rebuildBatches(const Scene& scene_);
+	bool reserve(uint32_t frame_, size_t instanceCount_, size_t batchCount_);
+	void writeDescriptors(uint32_t frame_);
+
+};
@@ -0,0 +1,409 @@
+/*
+*	File:		GpuTimeline.cpp
+*
+*
+*/
+#include "GpuTimeline.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <limits>
+
+extern Logger logger;
+
+/*
+*	Function:		GpuTimeline()
+*	Purpose:		Default constructor
+*
+*/
+GpuTimeline::GpuTimeline(void) : device(VK_NULL_HANDLE), timelineSemaphore(false), semaphore(VK_NULL_HANDLE), lastSubmittedValue(0), completedValue(0) {
+
+
+
+}
+
+/*
+*	Function:		void init(VkDevice device_, bool useTimelineSemaphore_)
+*	Purpose:		Creates the timeline semaphore, useTimelineSemaphore_ requires the extension and feature to be enabled on device_
+*
+*/
+void GpuTimeline::init(VkDevice device_, bool useTimelineSemaphore_) {
+
+	device				= device_;
+	timelineSemaphore	= false;
+
+#if defined VK_KHR_timeline_semaphore
+	if (useTimelineSemaphore_) {
+
+		getSemaphoreCounterValue	= reinterpret_cast< PFN_vkGetSemaphoreCounterValueKHR >(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+		waitSemaphores				= reinterpret_cast< PFN_vkWaitSemaphoresKHR >(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+
+		VkSemaphoreTypeCreateInfoKHR typeInfo		= {};
+		typeInfo.sType								= VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType						= VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeInfo.initialValue						= 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo			= {};
+		semaphoreInfo.sType							= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext							= &typeInfo;
+
+		if (getSemaphoreCounterValue != nullptr && waitSemaphores != nullptr && vkCreateSemaphore(
+
+			device,
+			&semaphoreInfo,
+			nullptr,
+			&semaphore
+
+		) == VK_SUCCESS) {
+
+			timelineSemaphore = true;
+
+		}
+		else {
+
+			logger.log(ERROR_LOG, "Failed to create timeline semaphore, falling back to fences!");
+
+		}
+
+	}
+#endif
+
+}
+
+/*
+*	Function:		uint64_t submit(
+*
+*						VkQueue						queue_,
+*						const VkSubmitInfo&			submitInfo_,
+*						GpuTimeline*				waitTimeline_,
+*						uint64_t					waitValue_,
+*						VkPipelineStageFlags		waitStage_
+*
+*					)
+*	Purpose:		Submits to queue_ and returns the value signaled once the work completed
+*					Optionally waits for waitTimeline_ to reach waitValue_ first, e.g. for work produced on another queue
+*					Requires the same external synchronization as the queue itself
+*
+*/
+uint64_t GpuTimeline::submit(
+
+	VkQueue						queue_,
+	const VkSubmitInfo&			submitInfo_,
+	GpuTimeline*				waitTimeline_,
+	uint64_t					waitValue_,
+	VkPipelineStageFlags		waitStage_
+
+) {
+
+	uint64_t value						= lastSubmittedValue + 1;
+	VkSubmitInfo submitInfo				= submitInfo_;
+
+	std::vector< VkSemaphore > waitSemaphoreList(submitInfo_.pWaitSemaphores, submitInfo_.pWaitSemaphores + submitInfo_.waitSemaphoreCount);
+	std::vector< VkPipelineStageFlags > waitStageList(submitInfo_.pWaitDstStageMask, submitInfo_.pWaitDstStageMask + submitInfo_.waitSemaphoreCount);
+	std::vector< uint64_t > waitValueList(submitInfo_.waitSemaphoreCount, 0);
+	std::vector< VkSemaphore > signalSemaphoreList(submitInfo_.pSignalSemaphores, submitInfo_.pSignalSemaphores + submitInfo_.signalSemaphoreCount);
+	std::vector< uint64_t > signalValueList(submitInfo_.signalSemaphoreCount, 0);
+
+	if (waitTimeline_ != nullptr && !waitTimeline_->isComplete(waitValue_)) {
+
+		if (timelineSemaphore && waitTimeline_->usesTimelineSemaphore()) {
+
+			waitSemaphoreList.push_back(waitTimeline_->getSemaphore());
+			waitStageList.push_back(waitStage_);
+			waitValueList.push_back(waitValue_);
+
+		}
+		else {
+
+			// fences cannot be waited on by the GPU
+			waitTimeline_->wait(waitValue_);
+
+		}
+
+	}
+
+	submitInfo.waitSemaphoreCount		= static_cast< uint32_t >(waitSemaphoreList.size());
+	submitInfo.pWaitSemaphores			= waitSemaphoreList.data();
+	submitInfo.pWaitDstStageMask		= waitStageList.data();
+
+	VkFence fence						= VK_NULL_HANDLE;
+
+#if defined VK_KHR_timeline_semaphore
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo		= {};
+	if (timelineSemaphore) {
+
+		signalSemaphoreList.push_back(semaphore);
+		signalValueList.push_back(value);
+
+		// values for binary semaphores in the lists are ignored
+		timelineInfo.sType								= VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.pNext								= submitInfo_.pNext;
+		timelineInfo.waitSemaphoreValueCount			= static_cast< uint32_t >(waitValueList.size());
+		timelineInfo.pWaitSemaphoreValues				= waitValueList.data();
+		timelineInfo.signalSemaphoreValueCount			= static_cast< uint32_t >(signalValueList.size());
+		timelineInfo.pSignalSemaphoreValues				= signalValueList.data();
+		submitInfo.pNext								= &timelineInfo;
+
+	}
+#endif
+
+	submitInfo.signalSemaphoreCount		= static_cast< uint32_t >(signalSemaphoreList.size());
+	submitInfo.pSignalSemaphores		= signalSemaphoreList.data();
+
+	std::lock_guard< std::mutex > lock(fenceMutex);
+	if (!timelineSemaphore) {
+
+		if (!freeFences.empty()) {
+
+			fence = freeFences.back();
+			freeFences.pop_back();
+
+		}
+		else {
+
+			VkFenceCreateInfo fenceInfo		= {};
+			fenceInfo.sType					= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			vkCreateFence(device, &fenceInfo, nullptr, &fence);
+
+		}
+
+	}
+
+	if (vkQueueSubmit(
+
+		queue_,
+		1,
+		&submitInfo,
+		fence
+
+	) != VK_SUCCESS) {
+
+		logger.log(ERROR_LOG, "Failed to submit to timeline!");
+		if (fence != VK_NULL_HANDLE) {
+
+			freeFences.push_back(fence);
+
+		}
+		return lastSubmittedValue;
+
+	}
+
+	if (fence != VK_NULL_HANDLE) {
+
+		pendingFences.push_back({ value, fence });
+
+	}
+	lastSubmittedValue = value;
+	return value;
+
+}
+
+/*
+*	Function:		bool isComplete(uint64_t value_)
+*	Purpose:		Returns true if the GPU has finished the submission that signals value_, never blocks
+*
+*/
+bool GpuTimeline::isComplete(uint64_t value_) {
+
+	if (value_ <= completedValue.load(std::memory_order_acquire)) {
+
+		return true;
+
+	}
+
+#if defined VK_KHR_timeline_semaphore
+	if (timelineSemaphore) {
+
+		uint64_t counterValue = 0;
+		getSemaphoreCounterValue(device, semaphore, &counterValue);
+		updateCompletedValue(counterValue);
+		return value_ <= counterValue;
+
+	}
+#endif
+
+	std::lock_guard< std::mutex > lock(fenceMutex);
+	retireFences(0);
+	return value_ <= completedValue.load(std::memory_order_acquire);
+
+}
+
+/*
+*	Function:		void wait(uint64_t value_)
+*	Purpose:		Blocks until the GPU has finished the submission that signals value_
+*
+*/
+void GpuTimeline::wait(uint64_t value_) {
+
+	// waiting for a value that was never submitted would never return
+	value_ = std::min(value_, lastSubmittedValue.load());
+	if (value_ <= completedValue.load(std::memory_order_acquire)) {
+
+		return;
+
+	}
+
+#if defined VK_KHR_timeline_semaphore
+	if (timelineSemaphore) {
+
+		VkSemaphoreWaitInfoKHR waitInfo		= {};
+		waitInfo.sType						= VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount				= 1;
+		waitInfo.pSemaphores				= &semaphore;
+		waitInfo.pValues					= &value_;
+
+		waitSemaphores(device, &waitInfo, std::numeric_limits< uint64_t >::max());
+		updateCompletedValue(value_);
+		return;
+
+	}
+#endif
+
+	std::lock_guard< std::mutex > lock(fenceMutex);
+	retireFences(value_);
+
+}
+
+/*
+*	Function:		void waitIdle()
+*	Purpose:		Blocks until everything submitted so far has finished
+*
+*/
+void GpuTimeline::waitIdle(void) {
+
+	wait(lastSubmittedValue);
+
+}
+
+/*
+*	Function:		uint64_t getLastSubmittedValue()
+*	Purpose:		Returns the value signaled by the most recent submission
+*
+*/
+uint64_t GpuTimeline::getLastSubmittedValue(void) {
+
+	return lastSubmittedValue;
+
+}
+
+/*
+*	Function:		uint64_t getCompletedValue()
+*	Purpose:		Returns the highest value the GPU is known to have reached
+*
+*/
+uint64_t GpuTimeline::getCompletedValue(void) {
+
+	isComplete(lastSubmittedValue);
+	return completedValue;
+
+}
+
+/*
+*	Function:		bool usesTimelineSemaphore()
+*	Purpose:		Returns false if the timeline is emulated with fences
+*
+*/
+bool GpuTimeline::usesTimelineSemaphore(void) {
+
+	return timelineSemaphore;
+
+}
+
+/*
+*	Function:		VkSemaphore getSemaphore()
+*	Purpose:		Returns the timeline semaphore for cross-queue waits, VK_NULL_HANDLE when emulated with fences
+*
+*/
+VkSemaphore GpuTimeline::getSemaphore(void) {
+
+	return semaphore;
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Waits for all submissions and destroys the semaphore and fences
+*
+*/
+void GpuTimeline::destroy(void) {
+
+	if (device == VK_NULL_HANDLE) {
+
+		return;
+
+	}
+
+	waitIdle();
+
+	std::lock_guard< std::mutex > lock(fenceMutex);
+	for (auto& pending : pendingFences) {
+
+		vkDestroyFence(device, pending.fence, nullptr);
+
+	}
+	for (auto& fence : freeFences) {
+
+		vkDestroyFence(device, fence, nullptr);
+
+	}
+	pendingFences.clear();
+	freeFences.clear();
+
+	if (semaphore != VK_NULL_HANDLE) {
+
+		vkDestroySemaphore(device, semaphore, nullptr);
+		semaphore = VK_NULL_HANDLE;
+
+	}
+	device = VK_NULL_HANDLE;
+
+}
+
+/*
+*	Function:		~GpuTimeline()
+*	Purpose:		Default destructor
+*
+*/
+GpuTimeline::~GpuTimeline() {
+
+
+
+}
+
+/*
+*	Function:		void updateCompletedValue(uint64_t value_)
+*	Purpose:		Raises the cached completed value, which may be updated from several threads
+*
+*/
+void GpuTimeline::updateCompletedValue(uint64_t value_) {
+
+	uint64_t current = completedValue.load(std::memory_order_relaxed);
+	while (current < value_ && !completedValue.compare_exchange_weak(current, value_, std::memory_order_acq_rel)) {}
+
+}
+
+/*
+*	Function:		void retireFences(uint64_t waitValue_)
+*	Purpose:		Recycles signaled fences in submission order, blocking on them until waitValue_ is reached; fenceMutex must be held
+*
+*/
+void GpuTimeline::retireFences(uint64_t waitValue_) {
+
+	while (!pendingFences.empty()) {
+
+		PendingFence& pending = pendingFences.front();
+		if (pending.value > waitValue_ && vkGetFenceStatus(device, pending.fence) != VK_SUCCESS) {
+
+			break;
+
+		}
+
+		vkWaitForFences(device, 1, &pending.fence, VK_TRUE, std::numeric_limits< uint64_t >::max());
+		vkResetFences(device, 1, &pending.fence);
+		freeFences.push_back(pending.fence);
+		updateCompletedValue(pending.value);
+		pendingFences.pop_front();
+
+	}
+
+}
@@ -0,0 +1,67 @@
+/*
+*	File:		GpuTimeline.hpp
+*
+*
+*/
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/*
+*	Class:			GpuTimeline
+*	Purpose:		Monotonic progress counter of one queue: every submission signals the next value, anyone can wait on or test a value
+*					Backed by a timeline semaphore if VK_KHR_timeline_semaphore is available, by a ring of fences otherwise
+*
+*/
+class GpuTimeline {
+public:
+	GpuTimeline(void);
+	void init(VkDevice device_, bool useTimelineSemaphore_);
+	uint64_t submit(
+
+		VkQueue						queue_,
+		const VkSubmitInfo&			submitInfo_,
+		GpuTimeline*				waitTimeline_			= nullptr,
+		uint64_t					waitValue_				= 0,
+		VkPipelineStageFlags		waitStage_				= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+
+	);
+	bool isComplete(uint64_t value_);
+	void wait(uint64_t value_);
+	void waitIdle(void);
+	uint64_t getLastSubmittedValue(void);
+	uint64_t getCompletedValue(void);
+	bool usesTimelineSemaphore(void);
+	VkSemaphore getSemaphore(void);
+	void destroy(void);
+	~GpuTimeline();
+private:
+	struct PendingFence {
+
+		uint64_t		value;
+		VkFence			fence;
+
+	};
+
+	VkDevice									device;
+	bool										timelineSemaphore;
+	VkSemaphore									semaphore;
+	std::atomic< uint64_t >						lastSubmittedValue;
+	std::atomic< uint64_t >						completedValue;
+	std::mutex									fenceMutex;
+	std::deque< PendingFence >					pendingFences;
+	std::vector< VkFence >						freeFences;
+#if defined VK_KHR_timeline_semaphore
+	PFN_vkGetSemaphoreCounterValueKHR			getSemaphoreCounterValue;
+	PFN_vkWaitSemaphoresKHR						waitSemaphores;
+#endif
+
+	void updateCompletedValue(uint64_t value_);
+	void retireFences(uint64_t waitValue_);
+
+};
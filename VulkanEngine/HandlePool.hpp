@@ -0,0 +1,191 @@
+/*
+*	File:		HandlePool.hpp
+*
+*
+*/
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+/*
+*	Reference into a HandlePool, stays detectably stale after the element was removed
+*	A generation of 0 is never handed out, so a default constructed handle is always invalid
+*/
+template< typename T >
+struct Handle {
+
+	uint32_t		index				= 0;
+	uint32_t		generation			= 0;
+
+	bool isNull(void) const {
+
+		return generation == 0;
+
+	}
+
+	bool operator==(const Handle& other_) const {
+
+		return index == other_.index && generation == other_.generation;
+
+	}
+
+	bool operator!=(const Handle& other_) const {
+
+		return !(*this == other_);
+
+	}
+
+};
+
+/*
+*	Class:			HandlePool
+*	Purpose:		Owns elements in one dense array and hands out generational handles to them
+*					Lookup and validation are O(1), removal swaps the last element into the gap, so iteration order is not stable
+*
+*/
+template< typename T >
+class HandlePool {
+public:
+	typedef typename std::vector< T >::iterator iterator;
+	typedef typename std::vector< T >::const_iterator const_iterator;
+
+	/*
+	*	Function:		Handle< T > insert(T value_)
+	*	Purpose:		Moves value_ into the pool and returns its handle
+	*
+	*/
+	Handle< T > insert(T value_) {
+
+		uint32_t slotIndex;
+		if (!freeSlots.empty()) {
+
+			slotIndex = freeSlots.back();
+			freeSlots.pop_back();
+
+		}
+		else {
+
+			slotIndex = static_cast< uint32_t >(slots.size());
+			slots.push_back({ 0, 1 });
+
+		}
+
+		slots[slotIndex].denseIndex = static_cast< uint32_t >(dense.size());
+		dense.push_back(std::move(value_));
+		denseToSlot.push_back(slotIndex);
+
+		Handle< T > handle;
+		handle.index		= slotIndex;
+		handle.generation	= slots[slotIndex].generation;
+		return handle;
+
+	}
+
+	/*
+	*	Function:		bool isValid(Handle< T > handle_)
+	*	Purpose:		Returns true if handle_ still refers to an element of this pool
+	*
+	*/
+	bool isValid(Handle< T > handle_) const {
+
+		return handle_.index < slots.size() && slots[handle_.index].generation == handle_.generation;
+
+	}
+
+	/*
+	*	Function:		T* get(Handle< T > handle_)
+	*	Purpose:		Returns the element handle_ refers to, nullptr if the handle is stale
+	*
+	*/
+	T* get(Handle< T > handle_) {
+
+		return isValid(handle_) ? &dense[slots[handle_.index].denseIndex] : nullptr;
+
+	}
+
+	/*
+	*	Function:		bool remove(Handle< T > handle_)
+	*	Purpose:		Destroys the element handle_ refers to and invalidates all copies of the handle
+	*
+	*/
+	bool remove(Handle< T > handle_) {
+
+		if (!isValid(handle_)) {
+
+			return false;
+
+		}
+
+		Slot& slot				= slots[handle_.index];
+		uint32_t denseIndex		= slot.denseIndex;
+		uint32_t lastIndex		= static_cast< uint32_t >(dense.size() - 1);
+		if (denseIndex != lastIndex) {
+
+			dense[denseIndex]						= std::move(dense[lastIndex]);
+			denseToSlot[denseIndex]					= denseToSlot[lastIndex];
+			slots[denseToSlot[denseIndex]].denseIndex	= denseIndex;
+
+		}
+		dense.pop_back();
+		denseToSlot.pop_back();
+
+		// skip 0 on wrap-around, it marks null handles
+		slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+		freeSlots.push_back(handle_.index);
+		return true;
+
+	}
+
+	/*
+	*	Function:		Handle< T > getHandle(size_t denseIndex_)
+	*	Purpose:		Returns the handle of the element at denseIndex_ in iteration order
+	*
+	*/
+	Handle< T > getHandle(size_t denseIndex_) const {
+
+		Handle< T > handle;
+		handle.index		= denseToSlot[denseIndex_];
+		handle.generation	= slots[handle.index].generation;
+		return handle;
+
+	}
+
+	/*
+	*	Function:		void clear()
+	*	Purpose:		Destroys all elements and invalidates all handles
+	*
+	*/
+	void clear(void) {
+
+		while (!dense.empty()) {
+
+			remove(getHandle(dense.size() - 1));
+
+		}
+
+	}
+
+	size_t size(void) const { return dense.size(); }
+	bool empty(void) const { return dense.empty(); }
+	T* data(void) { return dense.data(); }
+	T& operator[](size_t denseIndex_) { return dense[denseIndex_]; }
+	iterator begin(void) { return dense.begin(); }
+	iterator end(void) { return dense.end(); }
+	const_iterator begin(void) const { return dense.begin(); }
+	const_iterator end(void) const { return dense.end(); }
+
+private:
+	struct Slot {
+
+		uint32_t		denseIndex;
+		uint32_t		generation;
+
+	};
+
+	std::vector< T >							dense;
+	std::vector< uint32_t >						denseToSlot;
+	std::vector< Slot >							slots;
+	std::vector< uint32_t >						freeSlots;
+
+};
@@ -4,9 +4,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 #include "Vertex.cpp"
+#include "MaterialBufferObject.cpp"
 /*
 *	Namespace:		std
-*	Purpose:		Hash function for mesh rendering
+*	Purpose:		Hash functions for mesh rendering and material deduplication
 *
 */
 namespace std {
@@ -23,4 +24,20 @@ namespace std {
 
 	};
 
+	template<> struct hash< MaterialBufferObject > {
+
+		size_t operator()(MaterialBufferObject const& material) const {
+
+			size_t seed = hash< glm::vec3 >()(material.ambient);
+			glm::detail::hash_combine(seed, hash< glm::vec3 >()(material.diffuse));
+			glm::detail::hash_combine(seed, hash< glm::vec3 >()(material.specular));
+			glm::detail::hash_combine(seed, hash< float >()(material.shininess));
+			glm::detail::hash_combine(seed, hash< uint32_t >()(material.texture));
+			glm::detail::hash_combine(seed, hash< uint32_t >()(material.sampler));
+			return seed;
+
+		}
+
+	};
+
 }
\ No newline at end of file
@@ -0,0 +1,484 @@
+/*
+*	File:		JobSystem.cpp
+*
+*
+*/
+#include "JobSystem.hpp"
+#include <algorithm>
+
+/*
+*	Index of the worker owning the calling thread, UINT32_MAX on threads that are not part of the job system
+*/
+static thread_local uint32_t currentWorkerIndex = UINT32_MAX;
+
+/*
+*	Function:		JobCounter()
+*	Purpose:		Default constructor
+*
+*/
+JobCounter::JobCounter(void) : value(0) {
+
+
+
+}
+
+/*
+*	Function:		bool isDone()
+*	Purpose:		Returns true once every job associated with the counter has finished
+*
+*/
+bool JobCounter::isDone(void) {
+
+	return value.load(std::memory_order_acquire) == 0;
+
+}
+
+/*
+*	Function:		~JobCounter()
+*	Purpose:		Default destructor
+*
+*/
+JobCounter::~JobCounter() {
+
+
+
+}
+
+/*
+*	Function:		WorkStealingQueue(uint32_t capacity_)
+*	Purpose:		Constructor, capacity_ is rounded up to the next power of two
+*
+*/
+WorkStealingQueue::WorkStealingQueue(uint32_t capacity_) : top(0), bottom(0) {
+
+	uint32_t capacity = 1;
+	while (capacity < capacity_) capacity <<= 1;
+	buffer	= std::unique_ptr< std::atomic< Job* >[] >(new std::atomic< Job* >[capacity]);
+	mask	= capacity - 1;
+
+}
+
+/*
+*	Function:		bool push(Job* job_)
+*	Purpose:		Pushes a job to the bottom of the queue, may only be called by the owning worker
+*
+*/
+bool WorkStealingQueue::push(Job* job_) {
+
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t > mask) return false;
+	buffer[b & mask].store(job_, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+
+}
+
+/*
+*	Function:		Job* pop()
+*	Purpose:		Pops the most recently pushed job, may only be called by the owning worker
+*
+*/
+Job* WorkStealingQueue::pop(void) {
+
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	Job* job = nullptr;
+	if (t <= b) {
+
+		job = buffer[b & mask].load(std::memory_order_relaxed);
+		if (t == b) {
+
+			// last job in the queue, race against thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+
+				job = nullptr;
+
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+
+		}
+
+	}
+	else {
+
+		bottom.store(b + 1, std::memory_order_relaxed);
+
+	}
+	return job;
+
+}
+
+/*
+*	Function:		Job* steal()
+*	Purpose:		Takes the oldest job from the queue, may be called from any thread
+*
+*/
+Job* WorkStealingQueue::steal(void) {
+
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t < b) {
+
+		Job* job = buffer[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+
+			return nullptr;
+
+		}
+		return job;
+
+	}
+	return nullptr;
+
+}
+
+/*
+*	Function:		~WorkStealingQueue()
+*	Purpose:		Default destructor
+*
+*/
+WorkStealingQueue::~WorkStealingQueue() {
+
+
+
+}
+
+/*
+*	Function:		JobSystem()
+*	Purpose:		Default constructor
+*
+*/
+JobSystem::JobSystem(void) : pendingJobs(0), sleepingWorkers(0), running(false) {
+
+
+
+}
+
+/*
+*	Function:		void init(uint32_t numWorkers_)
+*	Purpose:		Creates the worker threads; the calling thread becomes worker 0 and only runs jobs while waiting
+*
+*/
+void JobSystem::init(uint32_t numWorkers_) {
+
+	uint32_t numWorkers = std::max(numWorkers_, 1u);
+	for (uint32_t i = 0; i < numWorkers; i++) {
+
+		queues.push_back(std::make_unique< WorkStealingQueue >());
+
+	}
+	currentWorkerIndex	= 0;
+	running				= true;
+	for (uint32_t i = 1; i < numWorkers; i++) {
+
+		workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+
+	}
+
+}
+
+/*
+*	Function:		void run(
+*
+*						std::function< void() >		function_,
+*						JobCounter*					counter_,
+*						JobCounter*					dependency_
+*
+*					)
+*	Purpose:		Schedules a job; counter_ is incremented until it finished, it will not start before dependency_ is done
+*
+*/
+void JobSystem::run(
+
+	std::function< void() >		function_,
+	JobCounter*					counter_,
+	JobCounter*					dependency_
+
+) {
+
+	Job* job		= new Job;
+	job->function	= std::move(function_);
+	job->counter	= counter_;
+	if (counter_ != nullptr) counter_->value.fetch_add(1, std::memory_order_relaxed);
+
+	if (dependency_ != nullptr) {
+
+		std::lock_guard< std::mutex > lock(dependency_->continuationMutex);
+		if (dependency_->value.load(std::memory_order_acquire) > 0) {
+
+			dependency_->continuations.push_back(job);
+			return;
+
+		}
+
+	}
+	submit(job);
+
+}
+
+/*
+*	Function:		void parallelFor(
+*
+*						size_t											begin_,
+*						size_t											end_,
+*						size_t											grainSize_,
+*						std::function< void(size_t, size_t) >			function_,
+*						JobCounter*										counter_
+*
+*					)
+*	Purpose:		Splits [begin_, end_) into chunks of at most grainSize_ elements and runs function_(first, last) for each
+*
+*/
+void JobSystem::parallelFor(
+
+	size_t												begin_,
+	size_t												end_,
+	size_t												grainSize_,
+	std::function< void(size_t, size_t) >				function_,
+	JobCounter*											counter_
+
+) {
+
+	if (grainSize_ == 0) {
+
+		// default to a few chunks per worker so stealing can balance uneven ranges
+		grainSize_ = std::max< size_t >((end_ - begin_) / (getNumWorkers() * 4), 1);
+
+	}
+	for (size_t first = begin_; first < end_; first += grainSize_) {
+
+		size_t last = std::min(first + grainSize_, end_);
+		run([=] () { function_(first, last); }, counter_);
+
+	}
+
+}
+
+/*
+*	Function:		void wait(JobCounter* counter_)
+*	Purpose:		Blocks until counter_ reaches zero, executing other jobs in the meantime
+*
+*/
+void JobSystem::wait(JobCounter* counter_) {
+
+	while (!counter_->isDone()) {
+
+		Job* job = findJob();
+		if (job != nullptr) {
+
+			execute(job);
+
+		}
+		else {
+
+			std::this_thread::yield();
+
+		}
+
+	}
+	std::lock_guard< std::mutex > lock(counter_->continuationMutex);
+
+}
+
+/*
+*	Function:		uint32_t getNumWorkers()
+*	Purpose:		Returns the number of workers including the main thread
+*
+*/
+uint32_t JobSystem::getNumWorkers(void) {
+
+	return static_cast< uint32_t >(queues.size());
+
+}
+
+/*
+*	Function:		uint32_t getWorkerIndex()
+*	Purpose:		Returns the worker index of the calling thread, UINT32_MAX for foreign threads
+*
+*/
+uint32_t JobSystem::getWorkerIndex(void) {
+
+	return currentWorkerIndex;
+
+}
+
+/*
+*	Function:		void shutdown()
+*	Purpose:		Drains the remaining jobs and joins the worker threads
+*
+*/
+void JobSystem::shutdown(void) {
+
+	if (!running) return;
+	while (pendingJobs.load(std::memory_order_acquire) > 0) {
+
+		Job* job = findJob();
+		if (job != nullptr) execute(job);
+		else std::this_thread::yield();
+
+	}
+	{
+
+		std::lock_guard< std::mutex > lock(wakeMutex);
+		running = false;
+
+	}
+	wakeCondition.notify_all();
+	for (auto& worker : workers) {
+
+		worker.join();
+
+	}
+	workers.clear();
+	queues.clear();
+
+}
+
+/*
+*	Function:		~JobSystem()
+*	Purpose:		Default destructor
+*
+*/
+JobSystem::~JobSystem() {
+
+	shutdown();
+
+}
+
+/*
+*	Function:		void workerLoop(uint32_t workerIndex_)
+*	Purpose:		Main function of the worker threads
+*
+*/
+void JobSystem::workerLoop(uint32_t workerIndex_) {
+
+	currentWorkerIndex = workerIndex_;
+	while (running) {
+
+		Job* job = findJob();
+		if (job != nullptr) {
+
+			execute(job);
+			continue;
+
+		}
+
+		std::unique_lock< std::mutex > lock(wakeMutex);
+		sleepingWorkers++;
+		wakeCondition.wait(lock, [this] () { return pendingJobs.load(std::memory_order_acquire) > 0 || !running; });
+		sleepingWorkers--;
+
+	}
+
+}
+
+/*
+*	Function:		void submit(Job* job_)
+*	Purpose:		Makes a job available for execution
+*
+*/
+void JobSystem::submit(Job* job_) {
+
+	pendingJobs++;
+	uint32_t index = currentWorkerIndex;
+	if (index >= queues.size() || !queues[index]->push(job_)) {
+
+		// foreign threads and full queues go through the shared injection queue
+		std::lock_guard< std::mutex > lock(injectionMutex);
+		injectionQueue.push_back(job_);
+
+	}
+	if (sleepingWorkers > 0) {
+
+		{ std::lock_guard< std::mutex > lock(wakeMutex); }
+		wakeCondition.notify_one();
+
+	}
+
+}
+
+/*
+*	Function:		Job* findJob()
+*	Purpose:		Returns a job from the own queue, the injection queue or another worker's queue
+*
+*/
+Job* JobSystem::findJob(void) {
+
+	uint32_t index	= currentWorkerIndex;
+	Job* job		= nullptr;
+	if (index < queues.size()) {
+
+		job = queues[index]->pop();
+
+	}
+	if (job == nullptr) {
+
+		std::lock_guard< std::mutex > lock(injectionMutex);
+		if (!injectionQueue.empty()) {
+
+			job = injectionQueue.back();
+			injectionQueue.pop_back();
+
+		}
+
+	}
+	if (job == nullptr) {
+
+		uint32_t numQueues	= static_cast< uint32_t >(queues.size());
+		uint32_t start		= index < numQueues ? index + 1 : 0;
+		for (uint32_t i = 0; i < numQueues && job == nullptr; i++) {
+
+			uint32_t victim = (start + i) % numQueues;
+			if (victim == index) continue;
+			job = queues[victim]->steal();
+
+		}
+
+	}
+	if (job != nullptr) pendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+	return job;
+
+}
+
+/*
+*	Function:		void execute(Job* job_)
+*	Purpose:		Runs a job and signals its counter
+*
+*/
+void JobSystem::execute(Job* job_) {
+
+	job_->function();
+	JobCounter* counter = job_->counter;
+	delete job_;
+	if (counter != nullptr) finish(counter);
+
+}
+
+/*
+*	Function:		void finish(JobCounter* counter_)
+*	Purpose:		Decrements counter_ and releases the jobs that depend on it once it reaches zero
+*
+*/
+void JobSystem::finish(JobCounter* counter_) {
+
+	// the counter is only touched under its mutex so a waiter can safely destroy it once wait() returns
+	std::vector< Job* > continuations;
+	{
+
+		std::lock_guard< std::mutex > lock(counter_->continuationMutex);
+		if (counter_->value.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		continuations.swap(counter_->continuations);
+
+	}
+	for (Job* job : continuations) {
+
+		submit(job);
+
+	}
+
+}
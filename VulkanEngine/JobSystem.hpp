@@ -0,0 +1,109 @@
+/*
+*	File:		JobSystem.hpp
+*
+*
+*/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+/*
+*	Class:			JobCounter
+*	Purpose:		Counts unfinished jobs; jobs can be made to depend on a counter reaching zero
+*
+*/
+class JobCounter {
+public:
+	JobCounter(void);
+	bool isDone(void);
+	~JobCounter();
+private:
+	friend class JobSystem;
+
+	std::atomic< int32_t >							value;
+	std::mutex										continuationMutex;
+	std::vector< Job* >								continuations;
+};
+
+struct Job {
+
+	std::function< void() >		function;
+	JobCounter*					counter;
+
+};
+
+/*
+*	Class:			WorkStealingQueue
+*	Purpose:		Chase-Lev deque: the owning worker pushes and pops at the bottom, other workers steal from the top
+*
+*/
+class WorkStealingQueue {
+public:
+	WorkStealingQueue(uint32_t capacity_ = 4096);
+	bool push(Job* job_);
+	Job* pop(void);
+	Job* steal(void);
+	~WorkStealingQueue();
+private:
+	std::atomic< int64_t >							top;
+	std::atomic< int64_t >							bottom;
+	std::unique_ptr< std::atomic< Job* >[] >		buffer;
+	int64_t											mask;
+};
+
+/*
+*	Class:			JobSystem
+*	Purpose:		Fixed pool of worker threads executing jobs from per-worker work-stealing queues
+*
+*/
+class JobSystem {
+public:
+	JobSystem(void);
+	void init(uint32_t numWorkers_);
+	void run(
+
+		std::function< void() >		function_,
+		JobCounter*					counter_			= nullptr,
+		JobCounter*					dependency_			= nullptr
+
+	);
+	void parallelFor(
+
+		size_t												begin_,
+		size_t												end_,
+		size_t												grainSize_,
+		std::function< void(size_t, size_t) >				function_,
+		JobCounter*											counter_
+
+	);
+	void wait(JobCounter* counter_);
+	uint32_t getNumWorkers(void);
+	uint32_t getWorkerIndex(void);
+	void shutdown(void);
+	~JobSystem();
+private:
+	std::vector< std::unique_ptr< WorkStealingQueue > >		queues;
+	std::vector< std::thread >								workers;
+	std::mutex												injectionMutex;
+	std::vector< Job* >										injectionQueue;
+	std::mutex												wakeMutex;
+	std::condition_variable									wakeCondition;
+	std::atomic< int32_t >									pendingJobs;
+	std::atomic< int32_t >									sleepingWorkers;
+	std::atomic< bool >										running;
+
+	void workerLoop(uint32_t workerIndex_);
+	void submit(Job* job_);
+	Job* findJob(void);
+	void execute(Job* job_);
+	void finish(JobCounter* counter_);
+
+};
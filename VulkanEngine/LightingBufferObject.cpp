@@ -4,11 +4,15 @@
 
 #include <array>
 
+/*
+*	Laid out like the std140 LightingUniformBuffer of the object fragment shader, every member takes a full vec4
+*	The lights themselves are in the storage buffers of ClusteredLighting
+*/
 struct LightingBufferObject {
 
-	glm::vec3 lightColor;
-	glm::vec3 objectColor;
-	glm::vec3 lightPos;
-	glm::vec3 viewPos;
+	glm::vec4 ambientColor;
+	glm::vec4 viewPos;
+	glm::vec4 clusterScale;			// x and y are clusters per pixel, the depth slice is log(depth) * z + w
+	glm::uvec4 clusterCounts;		// clusters along x, y and z
 
-};
\ No newline at end of file
+};
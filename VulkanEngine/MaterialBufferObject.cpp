@@ -1,10 +1,27 @@
 #pragma once
 #include <glm/glm.hpp>
+
+#include <cstdint>
+
+/*
+*	One entry of the material table, tightly packed like the std430 MaterialBuffer of the object fragment shader
+*	Every vec3 is followed by a scalar, so the 48 bytes contain no padding and can be hashed and compared as a whole
+*/
 struct MaterialBufferObject {
 
 	glm::vec3 ambient;
+	float shininess;
 	glm::vec3 diffuse;
+	uint32_t texture;				// descriptor heap index, DESCRIPTOR_HEAP_NONE for an untextured material
 	glm::vec3 specular;
-	float shininess;
+	uint32_t sampler;
+
+};
+
+inline bool operator==(const MaterialBufferObject& a_, const MaterialBufferObject& b_) {
+
+	return a_.ambient == b_.ambient && a_.shininess == b_.shininess
+		&& a_.diffuse == b_.diffuse && a_.texture == b_.texture
+		&& a_.specular == b_.specular && a_.sampler == b_.sampler;
 
-};
\ No newline at end of file
+}
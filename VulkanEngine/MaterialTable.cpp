@@ -0,0 +1,305 @@
+/*
+*	File:		MaterialTable.cpp
+*
+*
+*/
+#include "MaterialTable.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+extern Engine engine;
+
+/*
+*	Entries every buffer has room for from the start
+*/
+static const size_t INITIAL_CAPACITY		= 256;
+
+/*
+*	Function:		MaterialTable()
+*	Purpose:		Default constructor
+*
+*/
+MaterialTable::MaterialTable(void) {
+
+
+
+}
+
+/*
+*	Function:		void init(uint32_t frames_)
+*	Purpose:		Creates one buffer per frame in flight, so they can be bound before the first material is added
+*
+*/
+void MaterialTable::init(uint32_t frames_) {
+
+	frames.resize(frames_);
+	for (FrameBuffer& frame : frames) {
+
+		frame.mapped		= nullptr;
+		frame.capacity		= 0;
+		frame.dirtyFirst	= 0;
+		frame.dirtyLast		= 0;
+		reserve(frame, INITIAL_CAPACITY);
+
+	}
+
+}
+
+/*
+*	Function:		uint32_t add(const MaterialBufferObject& material_)
+*	Purpose:		Returns the index of an entry holding material_, an existing one if the same material has been added before
+*					Every add() needs a release() once the index is not used anymore
+*
+*/
+uint32_t MaterialTable::add(const MaterialBufferObject& material_) {
+
+	auto existing = lookup.find(material_);
+	if (existing != lookup.end()) {
+
+		references[existing->second]++;
+		return existing->second;
+
+	}
+
+	uint32_t index;
+	if (!freeIndices.empty()) {
+
+		index = freeIndices.back();
+		freeIndices.pop_back();
+
+	}
+	else {
+
+		index = static_cast< uint32_t >(materials.size());
+		materials.push_back(material_);
+		references.push_back(0);
+
+	}
+
+	materials[index]	= material_;
+	references[index]	= 1;
+	lookup[material_]	= index;
+	markDirty(index);
+	return index;
+
+}
+
+/*
+*	Function:		void set(uint32_t index_, const MaterialBufferObject& material_)
+*	Purpose:		Changes the entry index_ in place, every draw referring to it sees the change
+*
+*/
+void MaterialTable::set(uint32_t index_, const MaterialBufferObject& material_) {
+
+	if (index_ >= materials.size() || references[index_] == 0) {
+
+		return;
+
+	}
+
+	auto existing = lookup.find(materials[index_]);
+	if (existing != lookup.end() && existing->second == index_) {
+
+		lookup.erase(existing);
+
+	}
+
+	// an entry with the same content keeps being the one add() hands out, the two are not merged
+	materials[index_] = material_;
+	lookup.emplace(material_, index_);
+	markDirty(index_);
+
+}
+
+/*
+*	Function:		void release(uint32_t index_)
+*	Purpose:		Drops one reference to index_, the entry is reused once none are left
+*					Frames in flight keep their own copy of the table, so reuse never changes what they draw
+*
+*/
+void MaterialTable::release(uint32_t index_) {
+
+	if (index_ >= materials.size() || references[index_] == 0) {
+
+		return;
+
+	}
+
+	if (--references[index_] > 0) {
+
+		return;
+
+	}
+
+	auto existing = lookup.find(materials[index_]);
+	if (existing != lookup.end() && existing->second == index_) {
+
+		lookup.erase(existing);
+
+	}
+	freeIndices.push_back(index_);
+
+}
+
+/*
+*	Function:		const MaterialBufferObject& get(uint32_t index_)
+*	Purpose:		Returns the entry index_
+*
+*/
+const MaterialBufferObject& MaterialTable::get(uint32_t index_) const {
+
+	return materials[index_];
+
+}
+
+/*
+*	Function:		bool update(uint32_t frame_)
+*	Purpose:		Copies the entries changed since frame_ last used its buffer, call once the frame is done on the GPU
+*					Returns true if the buffer had to grow, its descriptor has to be rewritten then
+*
+*/
+bool MaterialTable::update(uint32_t frame_) {
+
+	FrameBuffer& frame		= frames[frame_];
+	bool reallocated		= false;
+	if (materials.size() > frame.capacity) {
+
+		reserve(frame, materials.size());
+		frame.dirtyFirst	= 0;
+		frame.dirtyLast		= static_cast< uint32_t >(materials.size());
+		reallocated			= true;
+
+	}
+
+	if (frame.dirtyFirst < frame.dirtyLast) {
+
+		memcpy(
+
+			frame.mapped + frame.dirtyFirst,
+			materials.data() + frame.dirtyFirst,
+			sizeof(MaterialBufferObject) * (frame.dirtyLast - frame.dirtyFirst)
+
+		);
+
+	}
+	frame.dirtyFirst		= 0;
+	frame.dirtyLast			= 0;
+	return reallocated;
+
+}
+
+/*
+*	Function:		VkDescriptorBufferInfo getBufferInfo(uint32_t frame_)
+*	Purpose:		Returns the buffer of frame_, for the material binding of the object pipeline
+*
+*/
+VkDescriptorBufferInfo MaterialTable::getBufferInfo(uint32_t frame_) const {
+
+	VkDescriptorBufferInfo bufferInfo	= {};
+	bufferInfo.buffer					= frames[frame_].buffer;
+	bufferInfo.offset					= 0;
+	bufferInfo.range					= sizeof(MaterialBufferObject) * frames[frame_].capacity;
+	return bufferInfo;
+
+}
+
+/*
+*	Function:		size_t size()
+*	Purpose:		Returns the number of entries, including released ones waiting for reuse
+*
+*/
+size_t MaterialTable::size(void) const {
+
+	return materials.size();
+
+}
+
+/*
+*	Function:		void destroy()
+*	Purpose:		Retires the buffers and forgets all entries
+*
+*/
+void MaterialTable::destroy(void) {
+
+	frames.clear();
+	materials.clear();
+	references.clear();
+	freeIndices.clear();
+	lookup.clear();
+
+}
+
+/*
+*	Function:		~MaterialTable()
+*	Purpose:		Default destructor
+*
+*/
+MaterialTable::~MaterialTable() {
+
+
+
+}
+
+/*
+*	Function:		void markDirty(uint32_t index_)
+*	Purpose:		Adds index_ to the range every frame copies on its next update
+*
+*/
+void MaterialTable::markDirty(uint32_t index_) {
+
+	for (FrameBuffer& frame : frames) {
+
+		if (frame.dirtyFirst == frame.dirtyLast) {
+
+			frame.dirtyFirst	= index_;
+			frame.dirtyLast		= index_ + 1;
+
+		}
+		else {
+
+			frame.dirtyFirst	= std::min(frame.dirtyFirst, index_);
+			frame.dirtyLast		= std::max(frame.dirtyLast, index_ + 1);
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		void reserve(FrameBuffer& frame_, size_t count_)
+*	Purpose:		Replaces the buffer of a frame by one with room for at least count_ entries, the old one is retired
+*
+*/
+void MaterialTable::reserve(FrameBuffer& frame_, size_t count_) {
+
+	size_t capacity				= std::max(std::max(count_, frame_.capacity * 2), INITIAL_CAPACITY);
+	VkDeviceSize bufferSize		= sizeof(MaterialBufferObject) * capacity;
+
+	engine.createBuffer(
+
+		bufferSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame_.buffer.replace(engine.device),
+		frame_.memory.replace(engine.device)
+
+	);
+
+	void* data;
+	vkMapMemory(
+
+		engine.device,
+		frame_.memory,
+		0,
+		bufferSize,
+		0,
+		&data
+
+	);
+	frame_.mapped				= static_cast< MaterialBufferObject* >(data);
+	frame_.capacity				= capacity;
+
+}
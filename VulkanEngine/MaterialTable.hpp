@@ -0,0 +1,63 @@
+/*
+*	File:		MaterialTable.hpp
+*
+*
+*/
+#pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "VulkanHandle.hpp"
+#include "Hash.cpp"
+#include "MaterialBufferObject.cpp"
+
+/*
+*	Class:			MaterialTable
+*	Purpose:		All material parameters in one storage buffer, draws pick their entry by the material index of their entity
+*					Identical materials share one entry, found through a hash of their content and reference counted
+*					Every frame in flight has its own copy of the buffer, which is only patched where entries changed since that frame last used it
+*
+*/
+class MaterialTable {
+public:
+	MaterialTable(void);
+	void init(uint32_t frames_);
+	uint32_t add(const MaterialBufferObject& material_);
+	void set(uint32_t index_, const MaterialBufferObject& material_);
+	void release(uint32_t index_);
+	const MaterialBufferObject& get(uint32_t index_) const;
+	bool update(uint32_t frame_);
+	VkDescriptorBufferInfo getBufferInfo(uint32_t frame_) const;
+	size_t size(void) const;
+	void destroy(void);
+	~MaterialTable();
+private:
+	struct FrameBuffer {
+
+		UniqueBuffer					buffer;
+		UniqueDeviceMemory				memory;
+		MaterialBufferObject*			mapped;
+		size_t							capacity;
+		uint32_t						dirtyFirst;				// range of entries changed since the frame's last update
+		uint32_t						dirtyLast;
+
+	};
+
+	std::vector< MaterialBufferObject >							materials;
+	std::vector< uint32_t >										references;
+	std::vector< uint32_t >										freeIndices;
+	std::unordered_map< MaterialBufferObject, uint32_t >		lookup;
+	std::vector< FrameBuffer >									frames;
+
+	void markDirty(uint32_t index_);
+	void reserve(FrameBuffer& frame_, size_t count_);
+
+};
@@ -7,11 +7,11 @@
 
 
 /*
-*	Function:		Model(const std::string fileName_, Pipeline* pipeline_)
+*	Function:		Model(const std::string fileName_, bool deferUpload_)
 *	Purpose:		Constructor
 *
 */
-Model::Model(const std::string fileName_, Pipeline* pipeline_) : Object(fileName_, pipeline_){
+Model::Model(const std::string fileName_, bool deferUpload_) : Object(fileName_, false, deferUpload_){
 
 	
 
@@ -9,7 +9,7 @@ class Model
 	: public Object
 {
 public:
-	Model(const std::string fileName_, Pipeline* pipeline_);
+	Model(const std::string fileName_, bool deferUpload_ = false);
 	~Model();
 };
 
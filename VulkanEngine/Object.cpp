@@ -7,6 +7,8 @@
 #include <tiny_obj_loader.h>
 #include "Engine.hpp"
 
+#include <limits>
+
 /*
 *	Function:		Object()
 *	Purpose:		Default constructor
@@ -14,7 +16,7 @@
 */
 Object::Object(void) {
 
-
+	occluder			= false;
 
 }
 
@@ -22,126 +24,102 @@ Object::Object(void) {
 *	Function:		Object(
 *	
 *						const std::string		fileName_, 
-*						Pipeline*				pipeline_,
-*						bool					hasTextures_
+*						bool					hasTextures_,
+*						bool					deferUpload_
 *	
 *					)
-*	Purpose:		Constructor
+*	Purpose:		Constructor, with deferUpload_ set only the file is parsed and upload() has to be called on the main thread
 *	
 */
 Object::Object(
 	
 	const std::string		fileName_, 
-	Pipeline*				pipeline_,
-	bool					hasTextures_
+	bool					hasTextures_,
+	bool					deferUpload_
 
 ) {
 
-	pipeline			= pipeline_;
 	hasTextures			= hasTextures_;
+	occluder			= false;
 #if defined GAME_USE_TINY_OBJ
 	loadwithtinyobjloader(fileName_);
 #elif !defined GAME_USE_TINY_OBJ
 	load(fileName_);
 #endif
-	createVertexBuffer();
-	createIndexBuffer();
+	if (!deferUpload_) {
+
+		upload();
+
+	}
 
 }
 
 /*
-*	Function:		virtual void draw(
-*	
-*						VkCommandBuffer			commandBuffer_, 
-*						VkDeviceSize*			vertexOffsets_,
-*						VkDeviceSize			indexOffset_,
-*						VkIndexType				indexType_,
-*						uint32_t				descriptorSetIndex_
-*
-*					)
-*	Purpose:		Binds appropriate buffers and draws to the command buffer
+*	Function:		void upload()
+*	Purpose:		Copies the parsed geometry into the geometry pool and drops the CPU copy
 *
 */
-void Object::draw(
-	
-	VkCommandBuffer			commandBuffer_, 
-	VkDeviceSize*			vertexOffsets_,
-	VkDeviceSize			indexOffset_,
-	VkIndexType				indexType_,
-	uint32_t				descriptorSetIndex_
+void Object::upload(void) {
 
-) {
+	geometry				= engine.geometryPool.upload(
 
-	pipeline->bind(commandBuffer_, &(pipeline->descriptorSets[descriptorSetIndex_]));
+		vertices.data(),
+		static_cast< uint32_t >(vertices.size()),
+		sizeof(Vertex),
+		indices.data(),
+		static_cast< uint32_t >(indices.size())
 
-	bindVBO(commandBuffer_, vertexOffsets_);
-	bindIBO(
-		
-		commandBuffer_,
-		indexOffset_, 
-		indexType_
-	
 	);
-	
-	vkCmdDrawIndexed(
-	
-		commandBuffer_,
-		static_cast< uint32_t >(indices.size()),
-		1,
-		0,
-		0,
-		0
 
-	);
+	glm::vec3 min(std::numeric_limits< float >::max());
+	glm::vec3 max(-std::numeric_limits< float >::max());
+	for (const auto& vertex : vertices) {
 
-}
+		min = glm::min(min, vertex.pos);
+		max = glm::max(max, vertex.pos);
 
-/*
-*	Function:		void bindVBO(VkCommandBuffer commandBuffer_, VkDeviceSize* offsets_)
-*	Purpose:		Binds the vertex buffer to the command buffer
-*
-*/
-void Object::bindVBO(VkCommandBuffer commandBuffer_, VkDeviceSize* offsets_) {
+	}
 
-	vkCmdBindVertexBuffers(
-	
-		commandBuffer_,
-		0,
-		1,
-		&vertexBuffer,
-		offsets_
-	
-	);
+	meshInfo.vertexCount	= static_cast< uint32_t >(vertices.size());
+	meshInfo.indexCount		= static_cast< uint32_t >(indices.size());
+	updateMeshInfo();
+	meshInfo.bounds			= vertices.empty() ? Bounds() : Bounds::fromMinMax(min, max);
 
-}
+	// the sphere around the box center is usually much tighter than the one around the box
+	float radiusSquared		= 0.0f;
+	for (const auto& vertex : vertices) {
 
-/*
-*	Function:		void bindIBO(
-*
-*						VkCommandBuffer			commandBuffer_,
-*						VkDeviceSize			offset_, 
-*						VkIndexType				indexType_
-*
-*					)
-*	Purpose:		Binds the index buffer to the command buffer
-*
-*/
-void Object::bindIBO(
-	
-	VkCommandBuffer			commandBuffer_,
-	VkDeviceSize			offset_, 
-	VkIndexType				indexType_
+		glm::vec3 offset	= vertex.pos - meshInfo.bounds.center;
+		radiusSquared		= std::max(radiusSquared, glm::dot(offset, offset));
 
-) {
+	}
+	meshInfo.bounds.radius	= std::sqrt(radiusSquared);
 
-	vkCmdBindIndexBuffer(
-	
-		commandBuffer_,
-		indexBuffer,
-		offset_,
-		indexType_
-	
-	);
+	// occluders keep their positions, the software occlusion buffer is drawn on the CPU
+	if (occluder && occluderMesh.indices.empty()) {
+
+		occluderMesh.positions.reserve(vertices.size());
+		for (const auto& vertex : vertices) {
+
+			occluderMesh.positions.push_back(vertex.pos);
+
+		}
+		occluderMesh.indices = indices;
+		if (occluderMesh.indices.empty()) {
+
+			for (uint32_t i = 0; i < static_cast< uint32_t >(vertices.size()); i++) {
+
+				occluderMesh.indices.push_back(i);
+
+			}
+
+		}
+
+	}
+
+	// only the GPU copy is drawn from, keeping the geometry would just take memory next to the render state
+	std::vector< Vertex >().swap(vertices);
+	std::vector< uint32_t >().swap(indices);
 
 }
 
@@ -243,195 +221,75 @@ void Object::load(const std::string fileName_) {
 }
 
 /*
-*	Function:		virtual void createVertexBuffer()
-*	Purpose:		Creates a valid VkBuffer handle with correct layout from the vertices vector
+*	Function:		void destroy()
+*	Purpose:		Destroys all allocated resources per object once the frames in flight are done with them
 *
 */
-void Object::createVertexBuffer() {
-
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-	VkBuffer					stagingBuffer;
-	VkDeviceMemory				stagingBufferMemory;
-
-	engine.createBuffer(
-
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory
-
-	);
-
-	void* data;
-	vkMapMemory(
-
-		engine.device,
-		stagingBufferMemory,
-		0,
-		bufferSize,
-		0,
-		&data
-
-	);
-	memcpy(
-
-		data,
-		vertices.data(),
-		(size_t)bufferSize
-
-	);
-	vkUnmapMemory(engine.device, stagingBufferMemory);
-
-	engine.createBuffer(
-
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBuffer,
-		vertexBufferMemory
-
-	);
-
-	engine.copyBuffer(
-
-		stagingBuffer,
-		vertexBuffer,
-		bufferSize
-
-	);
-
-	vkDestroyBuffer(
-
-		engine.device,
-		stagingBuffer,
-		nullptr
+void Object::destroy() {
 
-	);
-	vkFreeMemory(
+	// the ranges may only be reused once no frame in flight draws from them anymore
+	GeometryHandle retired	= geometry;
+	geometry				= GeometryHandle();
+	engine.retire([=] () {
 
-		engine.device,
-		stagingBufferMemory,
-		nullptr
+		engine.geometryPool.free(retired);
 
-	);
+	});
 
 }
 
 /*
-*	Function:		void createIndexBuffer()
-*	Purpose:		Creates a valid VkBuffer handle with correct layout from the vertices vector
+*	Function:		void updateMeshInfo()
+*	Purpose:		Reads where the geometry pool keeps the mesh, needed again after the pool was compacted
 *
 */
-void Object::createIndexBuffer() {
-
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	engine.createBuffer(
-
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory
-
-	);
-
-	void* data;
-	vkMapMemory(
-
-		engine.device,
-		stagingBufferMemory,
-		0,
-		bufferSize,
-		0,
-		&data
-
-	);
-
-	memcpy(
-
-		data,
-		indices.data(),
-		(size_t)bufferSize
-
-	);
-
-	vkUnmapMemory(engine.device, stagingBufferMemory);
-
-	engine.createBuffer(
+void Object::updateMeshInfo(void) {
 
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer,
-		indexBufferMemory
-
-	);
-
-	engine.copyBuffer(
-
-		stagingBuffer,
-		indexBuffer,
-		bufferSize
-
-	);
-
-	vkDestroyBuffer(
-
-		engine.device,
-		stagingBuffer,
-		nullptr
-
-	);
-	vkFreeMemory(
-
-		engine.device,
-		stagingBufferMemory,
-		nullptr
-
-	);
+	meshInfo.firstVertex	= engine.geometryPool.getFirstVertex(geometry);
+	meshInfo.firstIndex		= engine.geometryPool.getFirstIndex(geometry);
 
 }
 
 /*
-*	Function:		void destroy()
-*	Purpose:		Destroys all allocated resources per object
+*	Function:		const MeshInfo& getMeshInfo()
+*	Purpose:		Returns buffers, counts and bounds of the uploaded geometry
 *
 */
-void Object::destroy() {
+const MeshInfo& Object::getMeshInfo(void) const {
 
-	vkDestroyBuffer(
+	return meshInfo;
 
-		engine.device,
-		vertexBuffer,
-		nullptr
+}
 
-	);
-	vkFreeMemory(
+/*
+*	Function:		void setOccluder(bool occluder_)
+*	Purpose:		Marks the object as an occluder of the software occlusion culling, has to be called before upload() to keep the mesh as occluder
+*
+*/
+void Object::setOccluder(bool occluder_) {
 
-		engine.device,
-		vertexBufferMemory,
-		nullptr
+	occluder = occluder_;
 
-	);
+}
 
-	vkDestroyBuffer(
+/*
+*	Function:		void setOccluderMesh(const OccluderMesh& mesh_)
+*	Purpose:		Replaces the occluder geometry by a low-poly proxy, which has to lie inside the mesh
+*
+*/
+void Object::setOccluderMesh(const OccluderMesh& mesh_) {
 
-		engine.device,
-		indexBuffer,
-		nullptr
+	occluderMesh = mesh_;
 
-	);
-	vkFreeMemory(
+}
 
-		engine.device,
-		indexBufferMemory,
-		nullptr
+/*
+*	Function:		const OccluderMesh* getOccluder()
+*	Purpose:		Returns the occluder geometry, nullptr unless the object is an occluder with geometry
+*
+*/
+const OccluderMesh* Object::getOccluder(void) const {
 
-	);
+	return occluder && !occluderMesh.indices.empty() ? &occluderMesh : nullptr;
 
 }
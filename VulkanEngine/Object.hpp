@@ -5,6 +5,7 @@
 #pragma once
 #include <vector>
 #include <unordered_map>
+#include <memory>
 
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -13,53 +14,59 @@
 #include "Texture.cpp"
 #include "Logger.hpp"
 #include "Pipeline.hpp"
+#include "VulkanHandle.hpp"
+#include "HandlePool.hpp"
+#include "Bounds.cpp"
+#include "OccluderMesh.cpp"
+#include "GeometryPool.hpp"
 
 extern Logger logger;
 
+/*
+*	Everything needed to draw an uploaded mesh out of the geometry pool buffers, recording never has to touch the object itself
+*	An index count of 0 means the mesh is drawn without an index buffer, firstVertex is the vertexOffset of indexed draws
+*/
+struct MeshInfo {
+
+	uint32_t		firstVertex			= 0;
+	uint32_t		firstIndex			= 0;
+	uint32_t		vertexCount			= 0;
+	uint32_t		indexCount			= 0;
+	Bounds			bounds;
+
+};
+
 class Object {
 public:
 	Object(void);
 	Object(
 
 		const std::string		fileName_,
-		Pipeline*				pipeline_,
-		bool					hasTextures_		= false
+		bool					hasTextures_		= false,
+		bool					deferUpload_		= false
 	
 	);
-	virtual void draw(
-		
-		VkCommandBuffer			commandBuffer_,
-		VkDeviceSize*			vertexOffsets_,
-		VkDeviceSize			indexOffset_,
-		VkIndexType				indexType_,
-		uint32_t				descriptorSetIndex_
-
-	);
+	void upload(void);
 	void destroy(void);
+	void updateMeshInfo(void);
+	const MeshInfo& getMeshInfo(void) const;
+	void setOccluder(bool occluder_);
+	void setOccluderMesh(const OccluderMesh& mesh_);
+	const OccluderMesh* getOccluder(void) const;
 	virtual ~Object();
 protected:
 	std::vector< Vertex >					vertices;
-	VkBuffer								vertexBuffer;
-	VkDeviceMemory							vertexBufferMemory;
 	std::vector< uint32_t >					indices;
-	VkBuffer								indexBuffer;
-	VkDeviceMemory							indexBufferMemory;
+	GeometryHandle							geometry;
 	std::vector< Texture >					textures;
 	bool									hasTextures;
-	Pipeline*								pipeline;
+	MeshInfo								meshInfo;
+	bool									occluder;
+	OccluderMesh							occluderMesh;			// geometry drawn into the software occlusion buffer, the mesh itself unless a proxy was set
 
 	void loadwithtinyobjloader(const std::string fileName_);
 	void load(const std::string fileName_);
-	virtual void createVertexBuffer(void);
-	void createIndexBuffer(void);
-	void bindVBO(VkCommandBuffer commandBuffer_, VkDeviceSize* offsets_);
-	void bindIBO(
-
-		VkCommandBuffer			commandBuffer_,
-		VkDeviceSize			offset_,
-		VkIndexType				indexType_
-
-	);
 
 };
 
+typedef Handle< std::unique_ptr< Object > > ObjectHandle;
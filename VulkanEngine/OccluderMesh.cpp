@@ -0,0 +1,57 @@
+/*
+*	File:		OccluderMesh.cpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/*
+*	Low-poly stand-in for a mesh in the software occlusion buffer, three indices per triangle
+*	It has to lie inside the mesh it stands for, anything it covers is assumed to be hidden behind that mesh
+*/
+struct OccluderMesh {
+
+	std::vector< glm::vec3 >		positions;
+	std::vector< uint32_t >			indices;
+
+	static OccluderMesh fromBox(const glm::vec3& min_, const glm::vec3& max_) {
+
+		OccluderMesh result;
+		for (int i = 0; i < 8; i++) {
+
+			result.positions.push_back(glm::vec3((i & 1) ? max_.x : min_.x, (i & 2) ? max_.y : min_.y, (i & 4) ? max_.z : min_.z));
+
+		}
+
+		// two triangles per face, the rasteriser does not care about winding
+		const uint32_t faces[6][4] = {
+
+			{ 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+			{ 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 }
+
+		};
+		for (const auto& face : faces) {
+
+			result.indices.insert(result.indices.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+
+		}
+		return result;
+
+	}
+
+};
+
+/*
+*	One occluder in the world, the mesh has to stay alive until the occlusion buffer is rendered
+*/
+struct OccluderInstance {
+
+	const OccluderMesh*		mesh;
+	glm::mat4				world;
+
+};
@@ -76,21 +76,26 @@ Pipeline::Pipeline(
 	vertShaderStageInfo.stage											= VK_SHADER_STAGE_VERTEX_BIT;
 	vertShaderStageInfo.module											= vertShaderModule.getModule();
 	vertShaderStageInfo.pName											= "main";
+	vertShaderStageInfo.pSpecializationInfo								= engine.descriptorHeap.getSpecializationInfo();
 
 	fragShaderStageInfo													= {};
 	fragShaderStageInfo.sType											= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderStageInfo.stage											= VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragShaderStageInfo.module											= fragShaderModule.getModule();
 	fragShaderStageInfo.pName											= "main";
+	fragShaderStageInfo.pSpecializationInfo								= engine.descriptorHeap.getSpecializationInfo();
 
 	VkPipelineShaderStageCreateInfo shaderStages[]						= { vertShaderStageInfo, fragShaderStageInfo };
 
 	createDescriptorSets(bindings_, descriptorPool_);
 
+	// the descriptor heap is set 0 of every pipeline, so it stays bound when the pipeline changes
+	VkDescriptorSetLayout setLayouts[]									= { engine.descriptorHeap.getSetLayout(), descriptorSetLayout };
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo						= {};
 	pipelineLayoutInfo.sType											= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount									= 1;
-	pipelineLayoutInfo.pSetLayouts										= &descriptorSetLayout;
+	pipelineLayoutInfo.setLayoutCount									= 2;
+	pipelineLayoutInfo.pSetLayouts										= setLayouts;
 
 	if (vkCreatePipelineLayout(
 
@@ -142,7 +147,6 @@ Pipeline::Pipeline(
 	if (usesLBO_) {
 
 		createLightingBuffer();
-		createMaterialBuffer();
 
 	}
 
@@ -160,18 +164,18 @@ void Pipeline::descriptorSetWrites(std::function< void() > descriptorWritesFunc_
 }
 
 /*
-*	Function:		void updateUBOs(uint32_t imageIndex_)
+*	Function:		void updateUBOs(uint32_t frame_)
 *	Purpose:		Updates uniforms and sends them to the shaders
 *
 */
-void Pipeline::updateUBOs(uint32_t imageIndex_) {
+void Pipeline::updateUBOs(uint32_t frame_) {
 
 	void* data;
 
 	vkMapMemory(
 
 		engine.device,
-		uniformBufferMemory[imageIndex_],
+		uniformBufferMemory[frame_],
 		0,
 		sizeof(ubo),
 		0,
@@ -187,24 +191,24 @@ void Pipeline::updateUBOs(uint32_t imageIndex_) {
 
 	);
 
-	vkUnmapMemory(engine.device, uniformBufferMemory[imageIndex_]);
+	vkUnmapMemory(engine.device, uniformBufferMemory[frame_]);
 
 }
 
 /*
-*	Function:		void updateLBOs(uint32_t imageIndex_)
+*	Function:		void updateLBOs(uint32_t frame_)
 *	Purpose:		Updates the lighting uniform buffers
 *
 */
-void Pipeline::updateLBOs(uint32_t imageIndex_) {
+void Pipeline::updateLBOs(uint32_t frame_) {
 
 	void* data;
 
 	vkMapMemory(
 
 		engine.device,
-		lightingBuffersMemory[imageIndex_],
-		sizeof(float),
+		lightingBuffersMemory[frame_],
+		0,
 		sizeof(lbo),
 		0,
 		&data
@@ -219,46 +223,14 @@ void Pipeline::updateLBOs(uint32_t imageIndex_) {
 
 	);
 
-	vkUnmapMemory(engine.device, lightingBuffersMemory[imageIndex_]);
-
-
-}
-
-/*
-*	Function:		void updateMBOs(uint32_t imageIndex_)
-*	Purpose:		Updates the material uniform buffers
-*
-*/
-void Pipeline::updateMBOs(uint32_t imageIndex_) {
-
-	void* data;
-
-	vkMapMemory(
-	
-		engine.device,
-		materialBuffersMemory[imageIndex_],
-		sizeof(float),
-		sizeof(mbo),
-		0,
-		&data
-
-	);
-
-	memcpy(
-	
-		data,
-		&mbo,
-		sizeof(mbo)
-
-	);
+	vkUnmapMemory(engine.device, lightingBuffersMemory[frame_]);
 
-	vkUnmapMemory(engine.device, materialBuffersMemory[imageIndex_]);
 
 }
 
 /*
 *	Function:		void bind(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorSet)
-*	Purpose:		Binds a pipeline
+*	Purpose:		Binds a pipeline and its descriptor set
 *
 */
 
@@ -278,7 +250,7 @@ void Pipeline::bind(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorS
 
 /*
 *	Function:		void bindDescriptorSets(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorSet_)
-*	Purpose:		Binds descriptor sets
+*	Purpose:		Binds the pipeline's own descriptor set as set 1, set 0 is the descriptor heap
 *
 */
 void Pipeline::bindDescriptorSets(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorSet_) {
@@ -288,7 +260,7 @@ void Pipeline::bindDescriptorSets(VkCommandBuffer commandBuffer_, VkDescriptorSe
 		commandBuffer_,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
 		pipelineLayout,
-		0,
+		1,
 		1,
 		descriptorSet_,
 		0,
@@ -300,86 +272,85 @@ void Pipeline::bindDescriptorSets(VkCommandBuffer commandBuffer_, VkDescriptorSe
 
 /*
 *	Function:		void destroy()
-*	Purpose:		Destroys all resources used by pipeline
+*	Purpose:		Destroys all resources used by pipeline once the frames in flight are done with them
 *
 */
 void Pipeline::destroy(void) {
 
-	vkDestroyDescriptorSetLayout(
-	
-		engine.device,
-		descriptorSetLayout,
-		nullptr
-	
-	);
-
-	vkDestroyPipeline(
-
-		engine.device,
-		pipeline,
-		nullptr
+	// copied, since the members get overwritten when the pipeline is recreated while frames are still in flight
+	VkDescriptorSetLayout oldDescriptorSetLayout					= descriptorSetLayout;
+	VkPipeline oldPipeline											= pipeline;
+	VkPipelineLayout oldPipelineLayout								= pipelineLayout;
+	std::vector< VkBuffer > oldUniformBuffers						= uniformBuffers;
+	std::vector< VkDeviceMemory > oldUniformBufferMemory			= uniformBufferMemory;
+	std::vector< VkBuffer > oldLightingBuffers						= lightingBuffers;
+	std::vector< VkDeviceMemory > oldLightingBuffersMemory			= lightingBuffersMemory;
+	bool lbo														= usesLBO;
 
-	);
-	vkDestroyPipelineLayout(
+	engine.retire([=] () {
 
-		engine.device,
-		pipelineLayout,
-		nullptr
-
-	);
-
-	for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
+		vkDestroyDescriptorSetLayout(
+	
+			engine.device,
+			oldDescriptorSetLayout,
+			nullptr
+	
+		);
 
-		vkDestroyBuffer(
+		vkDestroyPipeline(
 
 			engine.device,
-			uniformBuffers[i],
+			oldPipeline,
 			nullptr
 
 		);
-		vkFreeMemory(
+		vkDestroyPipelineLayout(
 
 			engine.device,
-			uniformBufferMemory[i],
+			oldPipelineLayout,
 			nullptr
 
 		);
 
-		if (usesLBO) {
+		for (size_t i = 0; i < engine.MAX_FRAMES_IN_FLIGHT; i++) {
 
 			vkDestroyBuffer(
 
 				engine.device,
-				lightingBuffers[i],
+				oldUniformBuffers[i],
 				nullptr
 
 			);
 			vkFreeMemory(
 
 				engine.device,
-				lightingBuffersMemory[i],
+				oldUniformBufferMemory[i],
 				nullptr
 
 			);
 
-			vkDestroyBuffer(
+			if (lbo) {
 
-				engine.device,
-				materialBuffers[i],
-				nullptr
+				vkDestroyBuffer(
 
-			);
-			vkFreeMemory(
+					engine.device,
+					oldLightingBuffers[i],
+					nullptr
 
-				engine.device,
-				materialBuffersMemory[i],
-				nullptr
+				);
+				vkFreeMemory(
 
-			);
+					engine.device,
+					oldLightingBuffersMemory[i],
+					nullptr
+
+				);
+
+			}
 
 		}
 
-	}
+	});
 
 }
 
@@ -462,14 +433,14 @@ void Pipeline::createDescriptorSets(const std::vector< VkDescriptorSetLayoutBind
 
 	}
 
-	std::vector< VkDescriptorSetLayout > layouts(engine.swapChainImages.size(), descriptorSetLayout);
+	std::vector< VkDescriptorSetLayout > layouts(engine.MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
 	VkDescriptorSetAllocateInfo allocInfo			= {};
 	allocInfo.sType									= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool						= descriptorPool_;
-	allocInfo.descriptorSetCount					= static_cast< uint32_t >(engine.swapChainImages.size());
+	allocInfo.descriptorSetCount					= static_cast< uint32_t >(engine.MAX_FRAMES_IN_FLIGHT);
 	allocInfo.pSetLayouts							= layouts.data();
 
-	descriptorSets.resize(engine.swapChainImages.size());
+	descriptorSets.resize(engine.MAX_FRAMES_IN_FLIGHT);
 
 	if (vkAllocateDescriptorSets(
 
@@ -494,10 +465,10 @@ void Pipeline::createUniformBuffer() {
 
 	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-	uniformBuffers.resize(engine.swapChainImages.size());
-	uniformBufferMemory.resize(engine.swapChainImages.size());
+	uniformBuffers.resize(engine.MAX_FRAMES_IN_FLIGHT);
+	uniformBufferMemory.resize(engine.MAX_FRAMES_IN_FLIGHT);
 
-	for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
+	for (size_t i = 0; i < engine.MAX_FRAMES_IN_FLIGHT; i++) {
 
 		engine.createBuffer(
 
@@ -522,10 +493,10 @@ void Pipeline::createLightingBuffer(void) {
 
 	VkDeviceSize bufferSize = sizeof(LightingBufferObject);
 
-	lightingBuffers.resize(engine.swapChainImages.size());
-	lightingBuffersMemory.resize(engine.swapChainImages.size());
+	lightingBuffers.resize(engine.MAX_FRAMES_IN_FLIGHT);
+	lightingBuffersMemory.resize(engine.MAX_FRAMES_IN_FLIGHT);
 
-	for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
+	for (size_t i = 0; i < engine.MAX_FRAMES_IN_FLIGHT; i++) {
 
 		engine.createBuffer(
 
@@ -540,31 +511,3 @@ void Pipeline::createLightingBuffer(void) {
 	}
 
 }
-
-/*
-*	Function:		void createMaterialBuffer()
-*	Purpose:		Initializes the material uniform buffer
-*
-*/
-void Pipeline::createMaterialBuffer() {
-
-	VkDeviceSize bufferSize = sizeof(MaterialBufferObject);
-
-	materialBuffers.resize(engine.swapChainImages.size());
-	materialBuffersMemory.resize(engine.swapChainImages.size());
-
-	for (size_t i = 0; i < engine.swapChainImages.size(); i++) {
-
-		engine.createBuffer(
-
-			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			materialBuffers[i],
-			materialBuffersMemory[i]
-
-		);
-
-	}
-
-}
@@ -3,6 +3,9 @@
 *
 */
 #pragma once
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
 #include <Windows.h>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -15,7 +18,7 @@
 #include "ShaderModule.hpp"
 #include "UniformBufferObject.cpp"
 #include "LightingBufferObject.cpp"
-#include "MaterialBufferObject.cpp"
+#include "DescriptorHeap.hpp"
 
 class Pipeline {
 public:
@@ -27,9 +30,6 @@ public:
 	std::vector< VkDeviceMemory >								lightingBuffersMemory;
 	LightingBufferObject										lbo;
 	bool														usesLBO;
-	std::vector< VkBuffer >										materialBuffers;
-	std::vector< VkDeviceMemory >								materialBuffersMemory;
-	MaterialBufferObject										mbo;
 
 
 	Pipeline();
@@ -56,9 +56,8 @@ public:
 
 	);
 	void descriptorSetWrites(std::function< void() > descriptorWritesFunc_);
-	void updateUBOs(uint32_t imageIndex_);
-	void updateLBOs(uint32_t imageIndex_);
-	void updateMBOs(uint32_t imageIndex_);
+	void updateUBOs(uint32_t frame_);
+	void updateLBOs(uint32_t frame_);
 	void bind(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorSet_);
 	void bindDescriptorSets(VkCommandBuffer commandBuffer_, VkDescriptorSet* descriptorSet_);
 	void destroy(void);
@@ -79,7 +78,6 @@ private:
 	void createDescriptorSets(const std::vector< VkDescriptorSetLayoutBinding >* bindings_, VkDescriptorPool descriptorPool_);
 	void createUniformBuffer(void);
 	void createLightingBuffer(void);
-	void createMaterialBuffer(void);
 
 };
 
@@ -0,0 +1,15 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+*	One light of the clustered light list, laid out like the std430 LightBuffer of the object fragment shader
+*	The light fades out smoothly towards radius, so it can be left out of every cluster farther away than that
+*/
+struct PointLight {
+
+	glm::vec3 position;				// world space
+	float radius;
+	glm::vec3 color;
+	float intensity;
+
+};
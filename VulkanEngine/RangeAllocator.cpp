@@ -0,0 +1,200 @@
+/*
+*	File:		RangeAllocator.cpp
+*
+*
+*/
+#include "RangeAllocator.hpp"
+
+#include <algorithm>
+
+/*
+*	Function:		RangeAllocator()
+*	Purpose:		Default constructor, the address space is empty until reset() or grow()
+*
+*/
+RangeAllocator::RangeAllocator(void) : size(0), freeSize(0) {
+
+
+
+}
+
+/*
+*	Function:		void reset(uint64_t size_)
+*	Purpose:		Frees everything and sets the size of the address space
+*
+*/
+void RangeAllocator::reset(uint64_t size_) {
+
+	freeRanges.clear();
+	size		= size_;
+	freeSize	= size_;
+	if (size_ > 0) {
+
+		freeRanges[0] = size_;
+
+	}
+
+}
+
+/*
+*	Function:		void grow(uint64_t size_)
+*	Purpose:		Extends the address space to size_, live ranges keep their offsets
+*
+*/
+void RangeAllocator::grow(uint64_t size_) {
+
+	if (size_ <= size) {
+
+		return;
+
+	}
+
+	uint64_t oldSize = size;
+	size = size_;
+	free(oldSize, size_ - oldSize);
+
+}
+
+/*
+*	Function:		bool allocate(uint64_t size_, uint64_t alignment_, uint64_t& offset_)
+*	Purpose:		Finds the smallest free range that fits size_ at a multiple of alignment_, which does not have to be a power of two
+*					Returns false if none does, the padding in front of the aligned offset stays free
+*
+*/
+bool RangeAllocator::allocate(uint64_t size_, uint64_t alignment_, uint64_t& offset_) {
+
+	alignment_		= std::max< uint64_t >(alignment_, 1);
+	auto best		= freeRanges.end();
+	uint64_t bestOffset	= 0;
+	for (auto range = freeRanges.begin(); range != freeRanges.end(); range++) {
+
+		uint64_t aligned	= (range->first + alignment_ - 1) / alignment_ * alignment_;
+		uint64_t padding	= aligned - range->first;
+		if (padding + size_ > range->second || (best != freeRanges.end() && range->second >= best->second)) {
+
+			continue;
+
+		}
+
+		best				= range;
+		bestOffset			= aligned;
+		if (padding + size_ == range->second) {
+
+			break;
+
+		}
+
+	}
+
+	if (best == freeRanges.end()) {
+
+		return false;
+
+	}
+
+	uint64_t rangeOffset	= best->first;
+	uint64_t rangeEnd		= best->first + best->second;
+	freeRanges.erase(best);
+	if (bestOffset > rangeOffset) {
+
+		freeRanges[rangeOffset] = bestOffset - rangeOffset;
+
+	}
+	if (bestOffset + size_ < rangeEnd) {
+
+		freeRanges[bestOffset + size_] = rangeEnd - bestOffset - size_;
+
+	}
+
+	freeSize				-= size_;
+	offset_					= bestOffset;
+	return true;
+
+}
+
+/*
+*	Function:		void free(uint64_t offset_, uint64_t size_)
+*	Purpose:		Returns a range handed out by allocate(), merging it with the free ranges around it
+*
+*/
+void RangeAllocator::free(uint64_t offset_, uint64_t size_) {
+
+	if (size_ == 0) {
+
+		return;
+
+	}
+
+	freeSize				+= size_;
+	auto next				= freeRanges.lower_bound(offset_);
+	if (next != freeRanges.begin()) {
+
+		auto previous		= std::prev(next);
+		if (previous->first + previous->second == offset_) {
+
+			offset_			= previous->first;
+			size_			+= previous->second;
+			freeRanges.erase(previous);
+
+		}
+
+	}
+	if (next != freeRanges.end() && offset_ + size_ == next->first) {
+
+		size_				+= next->second;
+		freeRanges.erase(next);
+
+	}
+	freeRanges[offset_]		= size_;
+
+}
+
+/*
+*	Function:		uint64_t getSize()
+*	Purpose:		Returns the size of the address space
+*
+*/
+uint64_t RangeAllocator::getSize(void) const {
+
+	return size;
+
+}
+
+/*
+*	Function:		uint64_t getFreeSize()
+*	Purpose:		Returns the sum of all free ranges
+*
+*/
+uint64_t RangeAllocator::getFreeSize(void) const {
+
+	return freeSize;
+
+}
+
+/*
+*	Function:		uint64_t getLargestFreeRange()
+*	Purpose:		Returns the size of the largest free range, compared to getFreeSize() a measure of fragmentation
+*
+*/
+uint64_t RangeAllocator::getLargestFreeRange(void) const {
+
+	uint64_t largest = 0;
+	for (const auto& range : freeRanges) {
+
+		largest = std::max(largest, range.second);
+
+	}
+	return largest;
+
+}
+
+/*
+*	Function:		~RangeAllocator()
+*	Purpose:		Default destructor
+*
+*/
+RangeAllocator::~RangeAllocator() {
+
+
+
+}
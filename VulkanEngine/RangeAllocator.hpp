@@ -0,0 +1,32 @@
+/*
+*	File:		RangeAllocator.hpp
+*
+*
+*/
+#pragma once
+#include <cstdint>
+#include <map>
+
+/*
+*	Class:			RangeAllocator
+*	Purpose:		Hands out ranges of a linear address space, like a buffer, best fit out of a list of free ranges ordered by offset
+*					Freed ranges merge with their free neighbours, moving live ranges together is up to the owner of the memory
+*
+*/
+class RangeAllocator {
+public:
+	RangeAllocator(void);
+	void reset(uint64_t size_);
+	void grow(uint64_t size_);
+	bool allocate(uint64_t size_, uint64_t alignment_, uint64_t& offset_);
+	void free(uint64_t offset_, uint64_t size_);
+	uint64_t getSize(void) const;
+	uint64_t getFreeSize(void) const;
+	uint64_t getLargestFreeRange(void) const;
+	~RangeAllocator();
+private:
+	std::map< uint64_t, uint64_t >				freeRanges;				// offset to size
+	uint64_t									size;
+	uint64_t									freeSize;
+
+};
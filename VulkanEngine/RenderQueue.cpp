@@ -0,0 +1,218 @@
+/*
+*	File:		RenderQueue.cpp
+*
+*
+*/
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/*
+*	Mantissa bits of the view depth kept in the key
+*	Coarse buckets only reorder draws when they moved noticeably, every new order re-records the command buffers
+*/
+static const uint32_t DEPTH_MANTISSA_BITS	= 4;
+
+/*
+*	Bits per radix sort pass
+*/
+static const uint32_t RADIX_BITS			= 8;
+static const uint32_t RADIX_SIZE			= 1 << RADIX_BITS;
+static const uint32_t RADIX_PASSES			= 64 / RADIX_BITS;
+
+/*
+*	Function:		RenderQueue()
+*	Purpose:		Default constructor
+*
+*/
+RenderQueue::RenderQueue(void) {
+
+
+
+}
+
+/*
+*	Function:		void clear()
+*	Purpose:		Removes all draws, the state ids stay assigned
+*
+*/
+void RenderQueue::clear(void) {
+
+	items.clear();
+
+}
+
+/*
+*	Function:		void push(uint64_t key_, uint32_t entity_)
+*	Purpose:		Adds a draw of entity_ with the sort key key_
+*
+*/
+void RenderQueue::push(uint64_t key_, uint32_t entity_) {
+
+	items.push_back({ key_, entity_ });
+
+}
+
+/*
+*	Function:		void sort()
+*	Purpose:		Sorts the draws by key with a stable least significant digit radix sort
+*					All digit histograms are counted in one pass, digits every key shares are skipped
+*
+*/
+void RenderQueue::sort(void) {
+
+	size_t count = items.size();
+	if (count < 2) {
+
+		return;
+
+	}
+
+	uint32_t histograms[RADIX_PASSES][RADIX_SIZE];
+	std::memset(histograms, 0, sizeof(histograms));
+	for (const RenderItem& item : items) {
+
+		for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+
+			histograms[pass][(item.key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+
+		}
+
+	}
+
+	scratch.resize(count);
+	RenderItem* source		= items.data();
+	RenderItem* destination	= scratch.data();
+	for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+
+		uint32_t shift		= pass * RADIX_BITS;
+		uint32_t* histogram	= histograms[pass];
+		if (histogram[(source[0].key >> shift) & (RADIX_SIZE - 1)] == count) {
+
+			continue;
+
+		}
+
+		uint32_t offset		= 0;
+		for (uint32_t digit = 0; digit < RADIX_SIZE; digit++) {
+
+			uint32_t digitCount	= histogram[digit];
+			histogram[digit]	= offset;
+			offset				+= digitCount;
+
+		}
+		for (size_t i = 0; i < count; i++) {
+
+			destination[histogram[(source[i].key >> shift) & (RADIX_SIZE - 1)]++] = source[i];
+
+		}
+		std::swap(source, destination);
+
+	}
+
+	if (source != items.data()) {
+
+		items.swap(scratch);
+
+	}
+
+}
+
+/*
+*	Function:		size_t size()
+*	Purpose:		Returns the number of draws
+*
+*/
+size_t RenderQueue::size(void) const {
+
+	return items.size();
+
+}
+
+/*
+*	Function:		const RenderItem* data()
+*	Purpose:		Returns the draws, in key order after sort()
+*
+*/
+const RenderItem* RenderQueue::data(void) const {
+
+	return items.data();
+
+}
+
+/*
+*	Function:		uint32_t getStateId(const void* state_)
+*	Purpose:		Returns a small id for state_, the same one every frame, so keys of unchanged draws do not change
+*					Meant for the few pipelines of a scene, the lookup is linear
+*
+*/
+uint32_t RenderQueue::getStateId(const void* state_) {
+
+	for (size_t i = 0; i < states.size(); i++) {
+
+		if (states[i] == state_) {
+
+			return static_cast< uint32_t >(i);
+
+		}
+
+	}
+	states.push_back(state_);
+	return static_cast< uint32_t >(states.size() - 1);
+
+}
+
+/*
+*	Function:		uint64_t makeKey(
+*
+*						RenderQueuePass				pass_,
+*						uint32_t					pipeline_,
+*						uint32_t					material_,
+*						uint32_t					mesh_,
+*						float						depth_
+*
+*					)
+*	Purpose:		Packs the draw state into a sort key, ids are cut to their field width
+*					depth_ is the view depth, negative depths count as 0
+*
+*/
+uint64_t RenderQueue::makeKey(
+
+	RenderQueuePass				pass_,
+	uint32_t					pipeline_,
+	uint32_t					material_,
+	uint32_t					mesh_,
+	float						depth_
+
+) {
+
+	// positive floats order like their bit patterns, exponent and the top of the mantissa make a logarithmic bucket
+	uint32_t depthBits;
+	float depth				= std::max(depth_, 0.0f);
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t depthKey		= std::min< uint32_t >(depthBits >> (23 - DEPTH_MANTISSA_BITS), 0xffff);
+	if (pass_ == RENDER_QUEUE_PASS_TRANSPARENT) {
+
+		depthKey			= 0xffff - depthKey;
+
+	}
+
+	return (static_cast< uint64_t >(pass_ & 0x3) << 62)
+		| (static_cast< uint64_t >(pipeline_ & 0x3fff) << 48)
+		| (static_cast< uint64_t >(material_ & 0xffff) << 32)
+		| (static_cast< uint64_t >(mesh_ & 0xffff) << 16)
+		| depthKey;
+
+}
+
+/*
+*	Function:		~RenderQueue()
+*	Purpose:		Default destructor
+*
+*/
+RenderQueue::~RenderQueue() {
+
+
+
+}
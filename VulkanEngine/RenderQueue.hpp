@@ -0,0 +1,58 @@
+/*
+*	File:		RenderQueue.hpp
+*
+*
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum RenderQueuePass {
+
+	RENDER_QUEUE_PASS_OPAQUE			= 0,		// front to back, so early depth testing rejects what is hidden
+	RENDER_QUEUE_PASS_TRANSPARENT		= 1			// back to front, after all opaque draws
+
+};
+
+/*
+*	One draw of the queue, entity is a dense scene index
+*/
+struct RenderItem {
+
+	uint64_t		key;
+	uint32_t		entity;
+
+};
+
+/*
+*	Class:			RenderQueue
+*	Purpose:		Orders the draws of a frame by a packed 64-bit key, so draws sharing state are recorded next to each other
+*					From the most significant bits: pass (2), pipeline (14), material (16), mesh (16), depth (16)
+*
+*/
+class RenderQueue {
+public:
+	RenderQueue(void);
+	void clear(void);
+	void push(uint64_t key_, uint32_t entity_);
+	void sort(void);
+	size_t size(void) const;
+	const RenderItem* data(void) const;
+	uint32_t getStateId(const void* state_);
+	static uint64_t makeKey(
+
+		RenderQueuePass				pass_,
+		uint32_t					pipeline_,
+		uint32_t					material_,
+		uint32_t					mesh_,
+		float						depth_
+
+	);
+	~RenderQueue();
+private:
+	std::vector< RenderItem >					items;
+	std::vector< RenderItem >					scratch;
+	std::vector< const void* >					states;
+
+};
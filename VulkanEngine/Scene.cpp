@@ -0,0 +1,706 @@
+/*
+*	File:		Scene.cpp
+*
+*
+*/
+#include "Scene.hpp"
+#include "SimdMath.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+/*
+*	Entities per job when updating transforms, small enough to balance and large enough to amortize the scheduling
+*/
+static const size_t TRANSFORM_GRAIN_SIZE		= 2048;
+
+/*
+*	Marks a dense index that does not exist
+*/
+static const uint32_t INVALID_INDEX				= UINT32_MAX;
+
+/*
+*	Function:		Scene()
+*	Purpose:		Default constructor
+*
+*/
+Scene::Scene(void) : firstDirtyLevel(INVALID_INDEX), lastDirtyLevel(INVALID_INDEX), transformVersion(0), structureVersion(0), materialVersion(0) {
+
+
+
+}
+
+/*
+*	Function:		Entity createEntity(
+*
+*						ObjectHandle				mesh_,
+*						MaterialHandle				material_,
+*						const Bounds&				localBounds_,
+*						const Transform&			transform_,
+*						Entity						parent_
+*
+*					)
+*	Purpose:		Adds an entity drawing mesh_ with material_, localBounds_ are the bounds of the mesh in model space
+*					transform_ is relative to parent_, a null or stale parent makes the entity a root
+*					Entities are reordered to keep the breadth-first layout, so dense indices change
+*
+*/
+Entity Scene::createEntity(
+
+	ObjectHandle				mesh_,
+	MaterialHandle				material_,
+	const Bounds&				localBounds_,
+	const Transform&			transform_,
+	Entity						parent_
+
+) {
+
+	uint32_t parentIndex	= parent_.isNull() ? INVALID_INDEX : getIndex(parent_);
+	uint32_t level			= parentIndex == INVALID_INDEX ? 0 : getLevel(parentIndex) + 1;
+
+	uint32_t slotIndex;
+	if (!freeSlots.empty()) {
+
+		slotIndex = freeSlots.back();
+		freeSlots.pop_back();
+
+	}
+	else {
+
+		slotIndex = static_cast< uint32_t >(slots.size());
+		slots.push_back({ INVALID_INDEX, 1 });
+
+	}
+
+	uint32_t index				= insertAtLevel(level);
+	slots[slotIndex].denseIndex	= index;
+
+	denseToSlot[index]			= slotIndex;
+	parents[index]				= parentIndex == INVALID_INDEX ? INVALID_INDEX : parent_.index;
+	positions[index]			= transform_.position;
+	rotations[index]			= transform_.rotation;
+	scales[index]				= transform_.scale;
+	changed[index]				= 0;
+	localMatrices[index]		= glm::mat4(1.0f);
+	localBounds[index]			= localBounds_;
+	worldMatrices[index]		= glm::mat4(1.0f);
+	normalMatrices[index]		= glm::mat4(1.0f);
+	worldBounds[index]			= localBounds_;
+	meshes[index]				= mesh_;
+	materials[index]			= material_;
+	materialIndices[index]		= 0;
+	markDirty(index);
+
+	Entity entity;
+	entity.index		= slotIndex;
+	entity.generation	= slots[slotIndex].generation;
+	return entity;
+
+}
+
+/*
+*	Function:		void destroyEntity(Entity entity_)
+*	Purpose:		Removes the entity with all its descendants and invalidates all copies of their handles, stale handles are ignored
+*
+*/
+void Scene::destroyEntity(Entity entity_) {
+
+	uint32_t index = getIndex(entity_);
+	if (index == INVALID_INDEX) {
+
+		return;
+
+	}
+
+	// descendants only live in deeper levels and come after their parents in breadth-first order
+	std::vector< uint8_t > inSubtree(slots.size(), 0);
+	std::vector< uint32_t > subtree						= { entity_.index };
+	inSubtree[entity_.index]							= 1;
+	for (size_t i = levelEnds[getLevel(index)]; i < denseToSlot.size(); i++) {
+
+		if (parents[i] != INVALID_INDEX && inSubtree[parents[i]]) {
+
+			inSubtree[denseToSlot[i]] = 1;
+			subtree.push_back(denseToSlot[i]);
+
+		}
+
+	}
+
+	// deepest first, so removing a node never moves one of the nodes still to be removed into a level it does not belong to
+	for (auto it = subtree.rbegin(); it != subtree.rend(); ++it) {
+
+		uint32_t denseIndex		= slots[*it].denseIndex;
+		removeAtLevel(denseIndex, getLevel(denseIndex));
+
+		Slot& slot				= slots[*it];
+		slot.denseIndex			= INVALID_INDEX;
+		slot.generation			= slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+		freeSlots.push_back(*it);
+
+	}
+	transformVersion++;
+
+}
+
+/*
+*	Function:		bool isAlive(Entity entity_)
+*	Purpose:		Returns true if entity_ has not been destroyed
+*
+*/
+bool Scene::isAlive(Entity entity_) const {
+
+	return getIndex(entity_) != INVALID_INDEX;
+
+}
+
+/*
+*	Function:		void setTransform(Entity entity_, const Transform& transform_)
+*	Purpose:		Moves the entity relative to its parent, its subtree follows with the next updateTransforms()
+*
+*/
+void Scene::setTransform(Entity entity_, const Transform& transform_) {
+
+	uint32_t index = getIndex(entity_);
+	if (index == INVALID_INDEX) {
+
+		return;
+
+	}
+
+	// static entities are set to the same transform every frame, they must not cost a matrix rebuild
+	if (positions[index] == transform_.position && rotations[index] == transform_.rotation && scales[index] == transform_.scale) {
+
+		return;
+
+	}
+
+	positions[index]	= transform_.position;
+	rotations[index]	= transform_.rotation;
+	scales[index]		= transform_.scale;
+	markDirty(index);
+
+}
+
+/*
+*	Function:		Transform getTransform(Entity entity_)
+*	Purpose:		Returns the local transform of the entity
+*
+*/
+Transform Scene::getTransform(Entity entity_) const {
+
+	Transform transform;
+	uint32_t index = getIndex(entity_);
+	if (index != INVALID_INDEX) {
+
+		transform.position	= positions[index];
+		transform.rotation	= rotations[index];
+		transform.scale		= scales[index];
+
+	}
+	return transform;
+
+}
+
+/*
+*	Function:		Entity getParent(Entity entity_)
+*	Purpose:		Returns the parent of the entity, a null handle for roots and stale handles
+*
+*/
+Entity Scene::getParent(Entity entity_) const {
+
+	Entity parent;
+	uint32_t index = getIndex(entity_);
+	if (index != INVALID_INDEX && parents[index] != INVALID_INDEX) {
+
+		parent.index		= parents[index];
+		parent.generation	= slots[parent.index].generation;
+
+	}
+	return parent;
+
+}
+
+/*
+*	Function:		void setMesh(Entity entity_, ObjectHandle mesh_, const Bounds& localBounds_)
+*	Purpose:		Switches the mesh the entity draws
+*
+*/
+void Scene::setMesh(Entity entity_, ObjectHandle mesh_, const Bounds& localBounds_) {
+
+	uint32_t index = getIndex(entity_);
+	if (index == INVALID_INDEX) {
+
+		return;
+
+	}
+
+	meshes[index]		= mesh_;
+	localBounds[index]	= localBounds_;
+	markDirty(index);
+
+}
+
+/*
+*	Function:		void setMaterial(Entity entity_, MaterialHandle material_)
+*	Purpose:		Switches the material the entity is drawn with
+*
+*/
+void Scene::setMaterial(Entity entity_, MaterialHandle material_) {
+
+	uint32_t index = getIndex(entity_);
+	if (index != INVALID_INDEX) {
+
+		materials[index] = material_;
+
+	}
+
+}
+
+/*
+*	Function:		void setMaterialIndex(Entity entity_, uint32_t materialIndex_)
+*	Purpose:		Switches the material table entry the entity is shaded with, new entities use entry 0
+*
+*/
+void Scene::setMaterialIndex(Entity entity_, uint32_t materialIndex_) {
+
+	uint32_t index = getIndex(entity_);
+	if (index != INVALID_INDEX) {
+
+		materialIndices[index] = materialIndex_;
+		materialVersion++;
+
+	}
+
+}
+
+/*
+*	Function:		void updateTransforms(JobSystem& jobSystem_)
+*	Purpose:		Rebuilds world matrices and world bounds of all moved entities and their descendants
+*					Levels are processed in order, the entities of one level in parallel, untouched levels above are skipped
+*
+*/
+void Scene::updateTransforms(JobSystem& jobSystem_) {
+
+	if (firstDirtyLevel == INVALID_INDEX) {
+
+		return;
+
+	}
+
+	for (uint32_t level = firstDirtyLevel; level < levelEnds.size(); level++) {
+
+		// parents above the first dirty level did not change, their flags may be left over from an earlier update
+		bool checkParents					= level > firstDirtyLevel;
+		std::atomic< bool > levelChanged(false);
+
+		JobCounter counter;
+		jobSystem_.parallelFor(level == 0 ? 0 : levelEnds[level - 1], levelEnds[level], TRANSFORM_GRAIN_SIZE, [this, level, checkParents, &levelChanged] (size_t first_, size_t last_) {
+
+			// flag everything that needs a new world matrix first, then hand contiguous runs to the batch kernels
+			bool anyChanged = false;
+			for (size_t i = first_; i < last_; i++) {
+
+				bool parentChanged			= checkParents && changed[slots[parents[i]].denseIndex];
+				changed[i]					= dirty[i] || parentChanged ? 1 : 0;
+				anyChanged					= anyChanged || changed[i];
+
+			}
+
+			if (!anyChanged) {
+
+				return;
+
+			}
+			levelChanged = true;
+
+			thread_local std::vector< glm::mat4 > parentMatrices;
+			size_t runStart = first_;
+			while (runStart < last_) {
+
+				if (!changed[runStart]) {
+
+					runStart++;
+					continue;
+
+				}
+
+				size_t runEnd = runStart;
+				while (runEnd < last_ && changed[runEnd]) {
+
+					runEnd++;
+
+				}
+				size_t count = runEnd - runStart;
+
+				// entities that only follow their parent did not move locally, recomposing them is cheaper than splitting the run
+				SimdMath::composeTRS(&positions[runStart], &rotations[runStart], &scales[runStart], &localMatrices[runStart], count);
+				if (level == 0) {
+
+					std::copy(&localMatrices[runStart], &localMatrices[runStart] + count, &worldMatrices[runStart]);
+
+				}
+				else {
+
+					parentMatrices.resize(count);
+					for (size_t i = 0; i < count; i++) {
+
+						parentMatrices[i] = worldMatrices[slots[parents[runStart + i]].denseIndex];
+
+					}
+					SimdMath::multiply(parentMatrices.data(), &localMatrices[runStart], &worldMatrices[runStart], count);
+
+				}
+				SimdMath::normalMatrices(&worldMatrices[runStart], &normalMatrices[runStart], count);
+				SimdMath::transformBounds(&localBounds[runStart], &worldMatrices[runStart], &worldBounds[runStart], count);
+				std::fill(&dirty[runStart], &dirty[runStart] + count, 0);
+
+				runStart = runEnd;
+
+			}
+
+		}, &counter);
+		jobSystem_.wait(&counter);
+
+		// nothing below can have changed, static subtrees stay untouched
+		if (!levelChanged && level >= lastDirtyLevel) {
+
+			break;
+
+		}
+
+	}
+
+	firstDirtyLevel		= INVALID_INDEX;
+	lastDirtyLevel		= INVALID_INDEX;
+
+}
+
+/*
+*	Function:		uint64_t getTransformVersion()
+*	Purpose:		Returns a counter that changes whenever a world matrix changes or entities are reordered
+*
+*/
+uint64_t Scene::getTransformVersion(void) const {
+
+	return transformVersion;
+
+}
+
+/*
+*	Function:		uint64_t getStructureVersion()
+*	Purpose:		Returns a counter that changes whenever entities are added, removed or reordered, which invalidates dense indices
+*
+*/
+uint64_t Scene::getStructureVersion(void) const {
+
+	return structureVersion;
+
+}
+
+/*
+*	Function:		uint64_t getMaterialVersion()
+*	Purpose:		Returns a counter that changes whenever a material index changes or entities are reordered
+*
+*/
+uint64_t Scene::getMaterialVersion(void) const {
+
+	return materialVersion;
+
+}
+
+/*
+*	Function:		void clear()
+*	Purpose:		Destroys all entities
+*
+*/
+void Scene::clear(void) {
+
+	for (uint32_t slotIndex : denseToSlot) {
+
+		Slot& slot			= slots[slotIndex];
+		slot.denseIndex		= INVALID_INDEX;
+		slot.generation		= slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+		freeSlots.push_back(slotIndex);
+
+	}
+
+	resizeComponents(0);
+	levelEnds.clear();
+	transformVersion++;
+	firstDirtyLevel		= INVALID_INDEX;
+	lastDirtyLevel		= INVALID_INDEX;
+
+}
+
+/*
+*	Function:		size_t size()
+*	Purpose:		Returns the number of entities, which is the length of every component array
+*
+*/
+size_t Scene::size(void) const {
+
+	return denseToSlot.size();
+
+}
+
+/*
+*	Function:		Entity getEntity(size_t index_)
+*	Purpose:		Returns the handle of the entity at dense index index_
+*
+*/
+Entity Scene::getEntity(size_t index_) const {
+
+	Entity entity;
+	entity.index		= denseToSlot[index_];
+	entity.generation	= slots[entity.index].generation;
+	return entity;
+
+}
+
+/*
+*	Function:		const glm::mat4* getWorldMatrices()
+*	Purpose:		Returns the world matrices in dense order, valid after updateTransforms()
+*
+*/
+const glm::mat4* Scene::getWorldMatrices(void) const {
+
+	return worldMatrices.data();
+
+}
+
+/*
+*	Function:		const glm::mat4* getNormalMatrices()
+*	Purpose:		Returns the inverse transpose of every world matrix in dense order, valid after updateTransforms()
+*
+*/
+const glm::mat4* Scene::getNormalMatrices(void) const {
+
+	return normalMatrices.data();
+
+}
+
+/*
+*	Function:		const Bounds* getWorldBounds()
+*	Purpose:		Returns the world space bounds in dense order, valid after updateTransforms()
+*
+*/
+const Bounds* Scene::getWorldBounds(void) const {
+
+	return worldBounds.data();
+
+}
+
+/*
+*	Function:		const ObjectHandle* getMeshes()
+*	Purpose:		Returns the mesh of every entity in dense order
+*
+*/
+const ObjectHandle* Scene::getMeshes(void) const {
+
+	return meshes.data();
+
+}
+
+/*
+*	Function:		const MaterialHandle* getMaterials()
+*	Purpose:		Returns the material of every entity in dense order
+*
+*/
+const MaterialHandle* Scene::getMaterials(void) const {
+
+	return materials.data();
+
+}
+
+/*
+*	Function:		const uint32_t* getMaterialIndices()
+*	Purpose:		Returns the material table entry of every entity in dense order
+*
+*/
+const uint32_t* Scene::getMaterialIndices(void) const {
+
+	return materialIndices.data();
+
+}
+
+/*
+*	Function:		~Scene()
+*	Purpose:		Default destructor
+*
+*/
+Scene::~Scene() {
+
+
+
+}
+
+/*
+*	Function:		uint32_t getIndex(Entity entity_)
+*	Purpose:		Returns the dense index of entity_, INVALID_INDEX if it is stale
+*
+*/
+uint32_t Scene::getIndex(Entity entity_) const {
+
+	if (entity_.index >= slots.size() || slots[entity_.index].generation != entity_.generation) {
+
+		return INVALID_INDEX;
+
+	}
+	return slots[entity_.index].denseIndex;
+
+}
+
+/*
+*	Function:		uint32_t getLevel(uint32_t index_)
+*	Purpose:		Returns the depth of the entity at dense index index_ in the hierarchy
+*
+*/
+uint32_t Scene::getLevel(uint32_t index_) const {
+
+	return static_cast< uint32_t >(std::upper_bound(levelEnds.begin(), levelEnds.end(), index_) - levelEnds.begin());
+
+}
+
+/*
+*	Function:		void markDirty(uint32_t index_)
+*	Purpose:		Flags the entity at dense index index_ for the next updateTransforms() and widens the range of levels to visit
+*
+*/
+void Scene::markDirty(uint32_t index_) {
+
+	uint32_t level		= getLevel(index_);
+	dirty[index_]		= 1;
+	transformVersion++;
+	if (firstDirtyLevel == INVALID_INDEX) {
+
+		firstDirtyLevel		= level;
+		lastDirtyLevel		= level;
+
+	}
+	else {
+
+		firstDirtyLevel		= std::min(firstDirtyLevel, level);
+		lastDirtyLevel		= std::max(lastDirtyLevel, level);
+
+	}
+
+}
+
+/*
+*	Function:		uint32_t insertAtLevel(uint32_t level_)
+*	Purpose:		Opens a gap at the end of level level_ by moving the first entity of every deeper level to its end, returns the index of the gap
+*
+*/
+uint32_t Scene::insertAtLevel(uint32_t level_) {
+
+	uint32_t hole = static_cast< uint32_t >(denseToSlot.size());
+	resizeComponents(denseToSlot.size() + 1);
+
+	if (level_ == levelEnds.size()) {
+
+		levelEnds.push_back(hole);
+
+	}
+
+	for (uint32_t level = static_cast< uint32_t >(levelEnds.size()) - 1; level > level_; level--) {
+
+		uint32_t start = levelEnds[level - 1];
+		if (start != hole) {
+
+			moveEntity(start, hole);
+
+		}
+		hole = start;
+		levelEnds[level]++;
+
+	}
+	levelEnds[level_]++;
+
+	return hole;
+
+}
+
+/*
+*	Function:		void removeAtLevel(uint32_t index_, uint32_t level_)
+*	Purpose:		Closes the gap left by the entity at index_ by moving the last entity of its level and of every deeper level up
+*
+*/
+void Scene::removeAtLevel(uint32_t index_, uint32_t level_) {
+
+	uint32_t hole = index_;
+	for (uint32_t level = level_; level < levelEnds.size(); level++) {
+
+		uint32_t last = levelEnds[level] - 1;
+		if (last != hole) {
+
+			moveEntity(last, hole);
+
+		}
+		hole = last;
+		levelEnds[level]--;
+
+	}
+
+	resizeComponents(denseToSlot.size() - 1);
+	while (!levelEnds.empty() && levelEnds.back() == (levelEnds.size() > 1 ? levelEnds[levelEnds.size() - 2] : 0)) {
+
+		levelEnds.pop_back();
+
+	}
+
+}
+
+/*
+*	Function:		void moveEntity(uint32_t from_, uint32_t to_)
+*	Purpose:		Copies every component of the entity at from_ to to_ and points its slot at the new index
+*
+*/
+void Scene::moveEntity(uint32_t from_, uint32_t to_) {
+
+	denseToSlot[to_]				= denseToSlot[from_];
+	parents[to_]					= parents[from_];
+	positions[to_]					= positions[from_];
+	rotations[to_]					= rotations[from_];
+	scales[to_]						= scales[from_];
+	dirty[to_]						= dirty[from_];
+	changed[to_]					= changed[from_];
+	localMatrices[to_]				= localMatrices[from_];
+	localBounds[to_]				= localBounds[from_];
+	worldMatrices[to_]				= worldMatrices[from_];
+	normalMatrices[to_]				= normalMatrices[from_];
+	worldBounds[to_]				= worldBounds[from_];
+	meshes[to_]						= meshes[from_];
+	materials[to_]					= materials[from_];
+	materialIndices[to_]			= materialIndices[from_];
+	slots[denseToSlot[to_]].denseIndex	= to_;
+
+}
+
+/*
+*	Function:		void resizeComponents(size_t size_)
+*	Purpose:		Resizes every component array to size_ entities
+*
+*/
+void Scene::resizeComponents(size_t size_) {
+
+	structureVersion++;
+	materialVersion++;
+	denseToSlot.resize(size_);
+	parents.resize(size_);
+	positions.resize(size_);
+	rotations.resize(size_);
+	scales.resize(size_);
+	dirty.resize(size_);
+	changed.resize(size_);
+	localMatrices.resize(size_);
+	localBounds.resize(size_);
+	worldMatrices.resize(size_);
+	normalMatrices.resize(size_);
+	worldBounds.resize(size_);
+	meshes.resize(size_);
+	materials.resize(size_);
+	materialIndices.resize(size_);
+
+}
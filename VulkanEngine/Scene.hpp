@@ -0,0 +1,108 @@
+/*
+*	File:		Scene.hpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "HandlePool.hpp"
+#include "Bounds.cpp"
+#include "Object.hpp"
+#include "Simulation.hpp"
+#include "JobSystem.hpp"
+
+struct EntityTag {};
+
+typedef Handle< EntityTag > Entity;
+typedef Handle< Pipeline* > MaterialHandle;
+
+/*
+*	Class:			Scene
+*	Purpose:		Entity-component store, every component lives in its own dense array indexed by the same dense entity index
+*					Entities form a transform hierarchy and are kept in breadth-first order, every depth is one contiguous range
+*					Only moved entities and their descendants get new world matrices, one depth after the other
+*
+*/
+class Scene {
+public:
+	Scene(void);
+	Entity createEntity(
+
+		ObjectHandle				mesh_,
+		MaterialHandle				material_,
+		const Bounds&				localBounds_,
+		const Transform&			transform_				= Transform(),
+		Entity						parent_					= Entity()
+
+	);
+	void destroyEntity(Entity entity_);
+	bool isAlive(Entity entity_) const;
+	void setTransform(Entity entity_, const Transform& transform_);
+	Transform getTransform(Entity entity_) const;
+	Entity getParent(Entity entity_) const;
+	void setMesh(Entity entity_, ObjectHandle mesh_, const Bounds& localBounds_);
+	void setMaterial(Entity entity_, MaterialHandle material_);
+	void setMaterialIndex(Entity entity_, uint32_t materialIndex_);
+	void updateTransforms(JobSystem& jobSystem_);
+	uint64_t getTransformVersion(void) const;
+	uint64_t getStructureVersion(void) const;
+	uint64_t getMaterialVersion(void) const;
+	void clear(void);
+	size_t size(void) const;
+	Entity getEntity(size_t index_) const;
+	const glm::mat4* getWorldMatrices(void) const;
+	const glm::mat4* getNormalMatrices(void) const;
+	const Bounds* getWorldBounds(void) const;
+	const ObjectHandle* getMeshes(void) const;
+	const MaterialHandle* getMaterials(void) const;
+	const uint32_t* getMaterialIndices(void) const;
+	~Scene();
+private:
+	struct Slot {
+
+		uint32_t		denseIndex;
+		uint32_t		generation;
+
+	};
+
+	std::vector< Slot >							slots;
+	std::vector< uint32_t >						freeSlots;
+	std::vector< uint32_t >						denseToSlot;
+	std::vector< uint32_t >						levelEnds;
+	uint32_t									firstDirtyLevel;
+	uint32_t									lastDirtyLevel;
+	uint64_t									transformVersion;
+	uint64_t									structureVersion;
+	uint64_t									materialVersion;
+
+	// components, one entry per entity in dense order
+	std::vector< uint32_t >						parents;
+	std::vector< glm::vec3 >					positions;
+	std::vector< glm::quat >					rotations;
+	std::vector< glm::vec3 >					scales;
+	std::vector< uint8_t >						dirty;
+	std::vector< uint8_t >						changed;
+	std::vector< glm::mat4 >					localMatrices;
+	std::vector< Bounds >						localBounds;
+	std::vector< glm::mat4 >					worldMatrices;
+	std::vector< glm::mat4 >					normalMatrices;
+	std::vector< Bounds >						worldBounds;
+	std::vector< ObjectHandle >					meshes;
+	std::vector< MaterialHandle >				materials;
+	std::vector< uint32_t >						materialIndices;			// entry of the engine's material table
+
+	uint32_t getIndex(Entity entity_) const;
+	uint32_t getLevel(uint32_t index_) const;
+	void markDirty(uint32_t index_);
+	uint32_t insertAtLevel(uint32_t level_);
+	void removeAtLevel(uint32_t index_, uint32_t level_);
+	void moveEntity(uint32_t from_, uint32_t to_);
+	void resizeComponents(size_t size_);
+
+};
@@ -0,0 +1,1442 @@
+/*
+*	File:		SimdMath.cpp
+*
+*
+*/
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+	#define SIMD_MATH_X86
+	#include <immintrin.h>
+	#if defined _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#elif defined _M_ARM64 || defined __aarch64__
+	#define SIMD_MATH_NEON
+	#include <arm_neon.h>
+#endif
+
+/*
+*	Function table of one instruction set
+*/
+struct SimdKernels {
+
+	void (*multiply)(const glm::mat4*, const glm::mat4*, glm::mat4*, size_t);
+	void (*composeTRS)(const glm::vec3*, const glm::quat*, const glm::vec3*, glm::mat4*, size_t);
+	void (*normalMatrices)(const glm::mat4*, glm::mat4*, size_t);
+	void (*transformBounds)(const Bounds*, const glm::mat4*, Bounds*, size_t);
+	void (*cullBounds)(const Frustum&, const Bounds*, uint8_t*, size_t);
+
+};
+
+/*
+*	Scalar kernels, plain GLM, also the reference for the benchmark
+*/
+static void multiplyScalar(const glm::mat4* a_, const glm::mat4* b_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		result_[i] = a_[i] * b_[i];
+
+	}
+
+}
+
+static void composeTRSScalar(const glm::vec3* positions_, const glm::quat* rotations_, const glm::vec3* scales_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		glm::mat4 matrix	= glm::mat4_cast(rotations_[i]);
+		matrix[0]			*= scales_[i].x;
+		matrix[1]			*= scales_[i].y;
+		matrix[2]			*= scales_[i].z;
+		matrix[3]			= glm::vec4(positions_[i], 1.0f);
+		result_[i]			= matrix;
+
+	}
+
+}
+
+static void normalMatricesScalar(const glm::mat4* matrices_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		result_[i] = glm::mat4(glm::transpose(glm::inverse(glm::mat3(matrices_[i]))));
+
+	}
+
+}
+
+static void transformBoundsScalar(const Bounds* bounds_, const glm::mat4* matrices_, Bounds* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		result_[i] = bounds_[i].transform(matrices_[i]);
+
+	}
+
+}
+
+static void cullBoundsScalar(const Frustum& frustum_, const Bounds* bounds_, uint8_t* visible_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		visible_[i] = frustum_.intersects(bounds_[i]) ? 1 : 0;
+
+	}
+
+}
+
+static const SimdKernels scalarKernels = {
+
+	multiplyScalar,
+	composeTRSScalar,
+	normalMatricesScalar,
+	transformBoundsScalar,
+	cullBoundsScalar
+
+};
+
+#if defined SIMD_MATH_X86
+/*
+*	SSE2 kernels, baseline of every x64 CPU
+*	Matrix products and bounds work on one element with a column per register, TRS composition on four elements with one lane each
+*/
+static inline __m128 loadVec3(const glm::vec3& v_) {
+
+	return _mm_setr_ps(v_.x, v_.y, v_.z, 0.0f);
+
+}
+
+static inline void storeVec3(glm::vec3& v_, __m128 value_) {
+
+	alignas(16) float values[4];
+	_mm_store_ps(values, value_);
+	v_ = glm::vec3(values[0], values[1], values[2]);
+
+}
+
+static inline __m128 combineSse2(__m128 weights_, __m128 c0_, __m128 c1_, __m128 c2_, __m128 c3_) {
+
+	__m128 result	= _mm_mul_ps(_mm_shuffle_ps(weights_, weights_, 0x00), c0_);
+	result			= _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(weights_, weights_, 0x55), c1_));
+	result			= _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(weights_, weights_, 0xAA), c2_));
+	return _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(weights_, weights_, 0xFF), c3_));
+
+}
+
+static inline __m128 crossSse2(__m128 a_, __m128 b_) {
+
+	__m128 aYzx		= _mm_shuffle_ps(a_, a_, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 bYzx		= _mm_shuffle_ps(b_, b_, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 result	= _mm_sub_ps(_mm_mul_ps(a_, bYzx), _mm_mul_ps(aYzx, b_));
+	return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+
+}
+
+static void multiplySse2(const glm::mat4* a_, const glm::mat4* b_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* a		= &a_[i][0][0];
+		const float* b		= &b_[i][0][0];
+		float* result		= &result_[i][0][0];
+
+		__m128 a0			= _mm_loadu_ps(a);
+		__m128 a1			= _mm_loadu_ps(a + 4);
+		__m128 a2			= _mm_loadu_ps(a + 8);
+		__m128 a3			= _mm_loadu_ps(a + 12);
+		__m128 b0			= _mm_loadu_ps(b);
+		__m128 b1			= _mm_loadu_ps(b + 4);
+		__m128 b2			= _mm_loadu_ps(b + 8);
+		__m128 b3			= _mm_loadu_ps(b + 12);
+
+		_mm_storeu_ps(result, combineSse2(b0, a0, a1, a2, a3));
+		_mm_storeu_ps(result + 4, combineSse2(b1, a0, a1, a2, a3));
+		_mm_storeu_ps(result + 8, combineSse2(b2, a0, a1, a2, a3));
+		_mm_storeu_ps(result + 12, combineSse2(b3, a0, a1, a2, a3));
+
+	}
+
+}
+
+static inline void storeColumnSse2(glm::mat4* result_, int column_, __m128 r0_, __m128 r1_, __m128 r2_, __m128 r3_) {
+
+	// rows of four matrices in, one column of every matrix out
+	_MM_TRANSPOSE4_PS(r0_, r1_, r2_, r3_);
+	_mm_storeu_ps(&result_[0][column_][0], r0_);
+	_mm_storeu_ps(&result_[1][column_][0], r1_);
+	_mm_storeu_ps(&result_[2][column_][0], r2_);
+	_mm_storeu_ps(&result_[3][column_][0], r3_);
+
+}
+
+static void composeTRSSse2(const glm::vec3* positions_, const glm::quat* rotations_, const glm::vec3* scales_, glm::mat4* result_, size_t count_) {
+
+	const __m128 one	= _mm_set1_ps(1.0f);
+	const __m128 two	= _mm_set1_ps(2.0f);
+	const __m128 zero	= _mm_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 4 <= count_; i += 4) {
+
+		const glm::quat* q	= rotations_ + i;
+		const glm::vec3* p	= positions_ + i;
+		const glm::vec3* s	= scales_ + i;
+
+		__m128 qx			= _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x);
+		__m128 qy			= _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+		__m128 qz			= _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z);
+		__m128 qw			= _mm_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w);
+
+		__m128 x2			= _mm_mul_ps(qx, two);
+		__m128 y2			= _mm_mul_ps(qy, two);
+		__m128 z2			= _mm_mul_ps(qz, two);
+		__m128 xx			= _mm_mul_ps(qx, x2);
+		__m128 yy			= _mm_mul_ps(qy, y2);
+		__m128 zz			= _mm_mul_ps(qz, z2);
+		__m128 xy			= _mm_mul_ps(qx, y2);
+		__m128 xz			= _mm_mul_ps(qx, z2);
+		__m128 yz			= _mm_mul_ps(qy, z2);
+		__m128 wx			= _mm_mul_ps(qw, x2);
+		__m128 wy			= _mm_mul_ps(qw, y2);
+		__m128 wz			= _mm_mul_ps(qw, z2);
+
+		__m128 sx			= _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+		__m128 sy			= _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+		__m128 sz			= _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z);
+
+		storeColumnSse2(
+
+			result_ + i,
+			0,
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+			_mm_mul_ps(_mm_add_ps(xy, wz), sx),
+			_mm_mul_ps(_mm_sub_ps(xz, wy), sx),
+			zero
+
+		);
+		storeColumnSse2(
+
+			result_ + i,
+			1,
+			_mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+			_mm_mul_ps(_mm_add_ps(yz, wx), sy),
+			zero
+
+		);
+		storeColumnSse2(
+
+			result_ + i,
+			2,
+			_mm_mul_ps(_mm_add_ps(xz, wy), sz),
+			_mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+			zero
+
+		);
+		storeColumnSse2(
+
+			result_ + i,
+			3,
+			_mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x),
+			_mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y),
+			_mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z),
+			one
+
+		);
+
+	}
+
+	composeTRSScalar(positions_ + i, rotations_ + i, scales_ + i, result_ + i, count_ - i);
+
+}
+
+static void normalMatricesSse2(const glm::mat4* matrices_, glm::mat4* result_, size_t count_) {
+
+	const __m128 xyzMask	= _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 one		= _mm_set1_ps(1.0f);
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* m		= &matrices_[i][0][0];
+		float* result		= &result_[i][0][0];
+
+		__m128 c0			= _mm_and_ps(_mm_loadu_ps(m), xyzMask);
+		__m128 c1			= _mm_and_ps(_mm_loadu_ps(m + 4), xyzMask);
+		__m128 c2			= _mm_and_ps(_mm_loadu_ps(m + 8), xyzMask);
+
+		// the columns of the inverse transpose are the cross products of the other two columns over the determinant
+		__m128 n0			= crossSse2(c1, c2);
+		__m128 n1			= crossSse2(c2, c0);
+		__m128 n2			= crossSse2(c0, c1);
+
+		__m128 det			= _mm_mul_ps(c0, n0);
+		det					= _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+		det					= _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+		__m128 invDet		= _mm_div_ps(one, det);
+
+		_mm_storeu_ps(result, _mm_mul_ps(n0, invDet));
+		_mm_storeu_ps(result + 4, _mm_mul_ps(n1, invDet));
+		_mm_storeu_ps(result + 8, _mm_mul_ps(n2, invDet));
+		_mm_storeu_ps(result + 12, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+
+	}
+
+}
+
+static void transformBoundsSse2(const Bounds* bounds_, const glm::mat4* matrices_, Bounds* result_, size_t count_) {
+
+	const __m128 absMask	= _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* m		= &matrices_[i][0][0];
+		__m128 m0			= _mm_loadu_ps(m);
+		__m128 m1			= _mm_loadu_ps(m + 4);
+		__m128 m2			= _mm_loadu_ps(m + 8);
+		__m128 m3			= _mm_loadu_ps(m + 12);
+		__m128 center		= loadVec3(bounds_[i].center);
+		__m128 extents		= loadVec3(bounds_[i].extents);
+
+		__m128 newCenter	= combineSse2(center, m0, m1, m2, m3);
+		newCenter			= _mm_add_ps(newCenter, m3);
+		__m128 newExtents	= combineSse2(extents, _mm_and_ps(m0, absMask), _mm_and_ps(m1, absMask), _mm_and_ps(m2, absMask), m3);
+
+		// squared column lengths by transposing the squared columns, the zero fourth column keeps the maximum of the first three
+		__m128 s0			= _mm_mul_ps(m0, m0);
+		__m128 s1			= _mm_mul_ps(m1, m1);
+		__m128 s2			= _mm_mul_ps(m2, m2);
+		__m128 s3			= _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+		__m128 lengths		= _mm_add_ps(_mm_add_ps(s0, s1), s2);
+		lengths				= _mm_max_ps(lengths, _mm_shuffle_ps(lengths, lengths, 0xB1));
+		lengths				= _mm_max_ps(lengths, _mm_shuffle_ps(lengths, lengths, 0x4E));
+
+		storeVec3(result_[i].center, newCenter);
+		storeVec3(result_[i].extents, newExtents);
+		result_[i].radius	= bounds_[i].radius * _mm_cvtss_f32(_mm_sqrt_ss(lengths));
+
+	}
+
+}
+
+/*
+*	Frustum planes broadcast once per call, shared by the SSE2 and AVX2 culling kernels
+*/
+struct CullingPlanes {
+
+	float		nx[6];
+	float		ny[6];
+	float		nz[6];
+	float		ax[6];
+	float		ay[6];
+	float		az[6];
+	float		d[6];
+
+	explicit CullingPlanes(const Frustum& frustum_) {
+
+		for (int p = 0; p < 6; p++) {
+
+			nx[p]	= frustum_.planes[p].x;
+			ny[p]	= frustum_.planes[p].y;
+			nz[p]	= frustum_.planes[p].z;
+			ax[p]	= std::fabs(nx[p]);
+			ay[p]	= std::fabs(ny[p]);
+			az[p]	= std::fabs(nz[p]);
+			d[p]	= frustum_.planes[p].w;
+
+		}
+
+	}
+
+};
+
+static void cullBoundsSse2(const Frustum& frustum_, const Bounds* bounds_, uint8_t* visible_, size_t count_) {
+
+	CullingPlanes planes(frustum_);
+
+	size_t i = 0;
+	for (; i + 4 <= count_; i += 4) {
+
+		const Bounds* b		= bounds_ + i;
+		__m128 cx			= _mm_setr_ps(b[0].center.x, b[1].center.x, b[2].center.x, b[3].center.x);
+		__m128 cy			= _mm_setr_ps(b[0].center.y, b[1].center.y, b[2].center.y, b[3].center.y);
+		__m128 cz			= _mm_setr_ps(b[0].center.z, b[1].center.z, b[2].center.z, b[3].center.z);
+		__m128 ex			= _mm_setr_ps(b[0].extents.x, b[1].extents.x, b[2].extents.x, b[3].extents.x);
+		__m128 ey			= _mm_setr_ps(b[0].extents.y, b[1].extents.y, b[2].extents.y, b[3].extents.y);
+		__m128 ez			= _mm_setr_ps(b[0].extents.z, b[1].extents.z, b[2].extents.z, b[3].extents.z);
+		__m128 radius		= _mm_setr_ps(b[0].radius, b[1].radius, b[2].radius, b[3].radius);
+
+		__m128 outside		= _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+
+			__m128 distance	= _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes.nx[p])), _mm_mul_ps(cy, _mm_set1_ps(planes.ny[p]))), _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes.nz[p])), _mm_set1_ps(planes.d[p])));
+			__m128 box		= _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(planes.ax[p])), _mm_mul_ps(ey, _mm_set1_ps(planes.ay[p]))), _mm_mul_ps(ez, _mm_set1_ps(planes.az[p])));
+			outside			= _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, _mm_min_ps(box, radius)), _mm_setzero_ps()));
+
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++) {
+
+			visible_[i + k] = ((mask >> k) & 1) ? 0 : 1;
+
+		}
+
+	}
+
+	cullBoundsScalar(frustum_, bounds_ + i, visible_ + i, count_ - i);
+
+}
+
+static const SimdKernels sse2Kernels = {
+
+	multiplySse2,
+	composeTRSSse2,
+	normalMatricesSse2,
+	transformBoundsSse2,
+	cullBoundsSse2
+
+};
+
+/*
+*	AVX2 kernels, two columns or two elements per register and fused multiply-add
+*/
+SIMD_TARGET_AVX2 static inline __m256 loadPairAvx2(const float* low_, const float* high_) {
+
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low_)), _mm_loadu_ps(high_), 1);
+
+}
+
+SIMD_TARGET_AVX2 static inline __m256 combineAvx2(__m256 weights_, __m256 c0_, __m256 c1_, __m256 c2_, __m256 c3_) {
+
+	__m256 result	= _mm256_mul_ps(_mm256_permute_ps(weights_, 0x00), c0_);
+	result			= _mm256_fmadd_ps(_mm256_permute_ps(weights_, 0x55), c1_, result);
+	result			= _mm256_fmadd_ps(_mm256_permute_ps(weights_, 0xAA), c2_, result);
+	return _mm256_fmadd_ps(_mm256_permute_ps(weights_, 0xFF), c3_, result);
+
+}
+
+SIMD_TARGET_AVX2 static inline __m256 crossAvx2(__m256 a_, __m256 b_) {
+
+	__m256 aYzx		= _mm256_permute_ps(a_, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256 bYzx		= _mm256_permute_ps(b_, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256 result	= _mm256_fmsub_ps(a_, bYzx, _mm256_mul_ps(aYzx, b_));
+	return _mm256_permute_ps(result, _MM_SHUFFLE(3, 0, 2, 1));
+
+}
+
+SIMD_TARGET_AVX2 static void multiplyAvx2(const glm::mat4* a_, const glm::mat4* b_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* a		= &a_[i][0][0];
+		const float* b		= &b_[i][0][0];
+		float* result		= &result_[i][0][0];
+
+		__m256 a0			= _mm256_broadcast_ps(reinterpret_cast< const __m128* >(a));
+		__m256 a1			= _mm256_broadcast_ps(reinterpret_cast< const __m128* >(a + 4));
+		__m256 a2			= _mm256_broadcast_ps(reinterpret_cast< const __m128* >(a + 8));
+		__m256 a3			= _mm256_broadcast_ps(reinterpret_cast< const __m128* >(a + 12));
+		__m256 b01			= _mm256_loadu_ps(b);
+		__m256 b23			= _mm256_loadu_ps(b + 8);
+
+		_mm256_storeu_ps(result, combineAvx2(b01, a0, a1, a2, a3));
+		_mm256_storeu_ps(result + 8, combineAvx2(b23, a0, a1, a2, a3));
+
+	}
+
+}
+
+SIMD_TARGET_AVX2 static inline void storeColumnAvx2(glm::mat4* result_, int column_, __m256 r0_, __m256 r1_, __m256 r2_, __m256 r3_) {
+
+	// rows of eight matrices in, the low lanes hold matrices 0 to 3 and the high lanes 4 to 7
+	__m256 t0		= _mm256_unpacklo_ps(r0_, r1_);
+	__m256 t1		= _mm256_unpackhi_ps(r0_, r1_);
+	__m256 t2		= _mm256_unpacklo_ps(r2_, r3_);
+	__m256 t3		= _mm256_unpackhi_ps(r2_, r3_);
+	__m256 c0		= _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 c1		= _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 c2		= _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 c3		= _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+	_mm_storeu_ps(&result_[0][column_][0], _mm256_castps256_ps128(c0));
+	_mm_storeu_ps(&result_[1][column_][0], _mm256_castps256_ps128(c1));
+	_mm_storeu_ps(&result_[2][column_][0], _mm256_castps256_ps128(c2));
+	_mm_storeu_ps(&result_[3][column_][0], _mm256_castps256_ps128(c3));
+	_mm_storeu_ps(&result_[4][column_][0], _mm256_extractf128_ps(c0, 1));
+	_mm_storeu_ps(&result_[5][column_][0], _mm256_extractf128_ps(c1, 1));
+	_mm_storeu_ps(&result_[6][column_][0], _mm256_extractf128_ps(c2, 1));
+	_mm_storeu_ps(&result_[7][column_][0], _mm256_extractf128_ps(c3, 1));
+
+}
+
+SIMD_TARGET_AVX2 static void composeTRSAvx2(const glm::vec3* positions_, const glm::quat* rotations_, const glm::vec3* scales_, glm::mat4* result_, size_t count_) {
+
+	const __m256 one	= _mm256_set1_ps(1.0f);
+	const __m256 two	= _mm256_set1_ps(2.0f);
+	const __m256 zero	= _mm256_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 8 <= count_; i += 8) {
+
+		const glm::quat* q	= rotations_ + i;
+		const glm::vec3* p	= positions_ + i;
+		const glm::vec3* s	= scales_ + i;
+
+		__m256 qx			= _mm256_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x, q[4].x, q[5].x, q[6].x, q[7].x);
+		__m256 qy			= _mm256_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y, q[4].y, q[5].y, q[6].y, q[7].y);
+		__m256 qz			= _mm256_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z, q[4].z, q[5].z, q[6].z, q[7].z);
+		__m256 qw			= _mm256_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w, q[4].w, q[5].w, q[6].w, q[7].w);
+
+		__m256 x2			= _mm256_mul_ps(qx, two);
+		__m256 y2			= _mm256_mul_ps(qy, two);
+		__m256 z2			= _mm256_mul_ps(qz, two);
+		__m256 xx			= _mm256_mul_ps(qx, x2);
+		__m256 yy			= _mm256_mul_ps(qy, y2);
+		__m256 zz			= _mm256_mul_ps(qz, z2);
+		__m256 xy			= _mm256_mul_ps(qx, y2);
+		__m256 xz			= _mm256_mul_ps(qx, z2);
+		__m256 yz			= _mm256_mul_ps(qy, z2);
+		__m256 wx			= _mm256_mul_ps(qw, x2);
+		__m256 wy			= _mm256_mul_ps(qw, y2);
+		__m256 wz			= _mm256_mul_ps(qw, z2);
+
+		__m256 sx			= _mm256_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x, s[4].x, s[5].x, s[6].x, s[7].x);
+		__m256 sy			= _mm256_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y, s[4].y, s[5].y, s[6].y, s[7].y);
+		__m256 sz			= _mm256_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z, s[4].z, s[5].z, s[6].z, s[7].z);
+
+		storeColumnAvx2(
+
+			result_ + i,
+			0,
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+			_mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+			_mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+			zero
+
+		);
+		storeColumnAvx2(
+
+			result_ + i,
+			1,
+			_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+			zero
+
+		);
+		storeColumnAvx2(
+
+			result_ + i,
+			2,
+			_mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+			_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+			zero
+
+		);
+		storeColumnAvx2(
+
+			result_ + i,
+			3,
+			_mm256_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x, p[4].x, p[5].x, p[6].x, p[7].x),
+			_mm256_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y, p[4].y, p[5].y, p[6].y, p[7].y),
+			_mm256_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z, p[4].z, p[5].z, p[6].z, p[7].z),
+			one
+
+		);
+
+	}
+
+	composeTRSSse2(positions_ + i, rotations_ + i, scales_ + i, result_ + i, count_ - i);
+
+}
+
+SIMD_TARGET_AVX2 static void normalMatricesAvx2(const glm::mat4* matrices_, glm::mat4* result_, size_t count_) {
+
+	const __m256 xyzMask	= _mm256_castsi256_ps(_mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0));
+	const __m256 one		= _mm256_set1_ps(1.0f);
+	const __m256 lastColumn	= _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+	size_t i = 0;
+	for (; i + 2 <= count_; i += 2) {
+
+		const float* m0		= &matrices_[i][0][0];
+		const float* m1		= &matrices_[i + 1][0][0];
+
+		__m256 c0			= _mm256_and_ps(loadPairAvx2(m0, m1), xyzMask);
+		__m256 c1			= _mm256_and_ps(loadPairAvx2(m0 + 4, m1 + 4), xyzMask);
+		__m256 c2			= _mm256_and_ps(loadPairAvx2(m0 + 8, m1 + 8), xyzMask);
+
+		__m256 n0			= crossAvx2(c1, c2);
+		__m256 n1			= crossAvx2(c2, c0);
+		__m256 n2			= crossAvx2(c0, c1);
+
+		__m256 det			= _mm256_mul_ps(c0, n0);
+		det					= _mm256_add_ps(det, _mm256_permute_ps(det, _MM_SHUFFLE(2, 3, 0, 1)));
+		det					= _mm256_add_ps(det, _mm256_permute_ps(det, _MM_SHUFFLE(1, 0, 3, 2)));
+		__m256 invDet		= _mm256_div_ps(one, det);
+
+		n0					= _mm256_mul_ps(n0, invDet);
+		n1					= _mm256_mul_ps(n1, invDet);
+		n2					= _mm256_mul_ps(n2, invDet);
+
+		float* r0			= &result_[i][0][0];
+		float* r1			= &result_[i + 1][0][0];
+		_mm256_storeu_ps(r0, _mm256_permute2f128_ps(n0, n1, 0x20));
+		_mm256_storeu_ps(r0 + 8, _mm256_permute2f128_ps(n2, lastColumn, 0x20));
+		_mm256_storeu_ps(r1, _mm256_permute2f128_ps(n0, n1, 0x31));
+		_mm256_storeu_ps(r1 + 8, _mm256_permute2f128_ps(n2, lastColumn, 0x31));
+
+	}
+
+	normalMatricesSse2(matrices_ + i, result_ + i, count_ - i);
+
+}
+
+SIMD_TARGET_AVX2 static void transformBoundsAvx2(const Bounds* bounds_, const glm::mat4* matrices_, Bounds* result_, size_t count_) {
+
+	const __m256 absMask	= _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+	size_t i = 0;
+	for (; i + 2 <= count_; i += 2) {
+
+		const float* ma		= &matrices_[i][0][0];
+		const float* mb		= &matrices_[i + 1][0][0];
+		__m256 m0			= loadPairAvx2(ma, mb);
+		__m256 m1			= loadPairAvx2(ma + 4, mb + 4);
+		__m256 m2			= loadPairAvx2(ma + 8, mb + 8);
+		__m256 m3			= loadPairAvx2(ma + 12, mb + 12);
+
+		const Bounds& a		= bounds_[i];
+		const Bounds& b		= bounds_[i + 1];
+		__m256 center		= _mm256_setr_ps(a.center.x, a.center.y, a.center.z, 0.0f, b.center.x, b.center.y, b.center.z, 0.0f);
+		__m256 extents		= _mm256_setr_ps(a.extents.x, a.extents.y, a.extents.z, 0.0f, b.extents.x, b.extents.y, b.extents.z, 0.0f);
+
+		__m256 newCenter	= _mm256_add_ps(combineAvx2(center, m0, m1, m2, m3), m3);
+		__m256 newExtents	= combineAvx2(extents, _mm256_and_ps(m0, absMask), _mm256_and_ps(m1, absMask), _mm256_and_ps(m2, absMask), m3);
+
+		// in-lane transpose of the squared columns, same as the SSE2 kernel for both elements at once
+		__m256 s0			= _mm256_mul_ps(m0, m0);
+		__m256 s1			= _mm256_mul_ps(m1, m1);
+		__m256 s2			= _mm256_mul_ps(m2, m2);
+		__m256 t0			= _mm256_unpacklo_ps(s0, s1);
+		__m256 t1			= _mm256_unpackhi_ps(s0, s1);
+		__m256 t2			= _mm256_unpacklo_ps(s2, _mm256_setzero_ps());
+		__m256 t3			= _mm256_unpackhi_ps(s2, _mm256_setzero_ps());
+		__m256 lengths		= _mm256_add_ps(_mm256_add_ps(_mm256_shuffle_ps(t0, t2, 0x44), _mm256_shuffle_ps(t0, t2, 0xEE)), _mm256_shuffle_ps(t1, t3, 0x44));
+		lengths				= _mm256_max_ps(lengths, _mm256_permute_ps(lengths, 0xB1));
+		lengths				= _mm256_sqrt_ps(_mm256_max_ps(lengths, _mm256_permute_ps(lengths, 0x4E)));
+
+		alignas(32) float centers[8];
+		alignas(32) float sizes[8];
+		alignas(32) float scales[8];
+		_mm256_store_ps(centers, newCenter);
+		_mm256_store_ps(sizes, newExtents);
+		_mm256_store_ps(scales, lengths);
+		result_[i].center			= glm::vec3(centers[0], centers[1], centers[2]);
+		result_[i].extents			= glm::vec3(sizes[0], sizes[1], sizes[2]);
+		result_[i].radius			= a.radius * scales[0];
+		result_[i + 1].center		= glm::vec3(centers[4], centers[5], centers[6]);
+		result_[i + 1].extents		= glm::vec3(sizes[4], sizes[5], sizes[6]);
+		result_[i + 1].radius		= b.radius * scales[4];
+
+	}
+
+	transformBoundsSse2(bounds_ + i, matrices_ + i, result_ + i, count_ - i);
+
+}
+
+SIMD_TARGET_AVX2 static void cullBoundsAvx2(const Frustum& frustum_, const Bounds* bounds_, uint8_t* visible_, size_t count_) {
+
+	CullingPlanes planes(frustum_);
+
+	// Bounds are seven floats, gathering with that stride turns eight of them into one register per member
+	const int stride		= static_cast< int >(sizeof(Bounds) / sizeof(float));
+	const __m256i offsets	= _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+
+	size_t i = 0;
+	for (; i + 8 <= count_; i += 8) {
+
+		const float* base	= &bounds_[i].center.x;
+		__m256 cx			= _mm256_i32gather_ps(base, offsets, 4);
+		__m256 cy			= _mm256_i32gather_ps(base + 1, offsets, 4);
+		__m256 cz			= _mm256_i32gather_ps(base + 2, offsets, 4);
+		__m256 ex			= _mm256_i32gather_ps(base + 3, offsets, 4);
+		__m256 ey			= _mm256_i32gather_ps(base + 4, offsets, 4);
+		__m256 ez			= _mm256_i32gather_ps(base + 5, offsets, 4);
+		__m256 radius		= _mm256_i32gather_ps(base + 6, offsets, 4);
+
+		__m256 outside		= _mm256_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+
+			__m256 distance	= _mm256_fmadd_ps(cx, _mm256_set1_ps(planes.nx[p]), _mm256_fmadd_ps(cy, _mm256_set1_ps(planes.ny[p]), _mm256_fmadd_ps(cz, _mm256_set1_ps(planes.nz[p]), _mm256_set1_ps(planes.d[p]))));
+			__m256 box		= _mm256_fmadd_ps(ex, _mm256_set1_ps(planes.ax[p]), _mm256_fmadd_ps(ey, _mm256_set1_ps(planes.ay[p]), _mm256_mul_ps(ez, _mm256_set1_ps(planes.az[p]))));
+			outside			= _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, _mm256_min_ps(box, radius)), _mm256_setzero_ps(), _CMP_LT_OQ));
+
+		}
+
+		int mask = _mm256_movemask_ps(outside);
+		for (int k = 0; k < 8; k++) {
+
+			visible_[i + k] = ((mask >> k) & 1) ? 0 : 1;
+
+		}
+
+	}
+
+	cullBoundsSse2(frustum_, bounds_ + i, visible_ + i, count_ - i);
+
+}
+
+static const SimdKernels avx2Kernels = {
+
+	multiplyAvx2,
+	composeTRSAvx2,
+	normalMatricesAvx2,
+	transformBoundsAvx2,
+	cullBoundsAvx2
+
+};
+#endif
+
+#if defined SIMD_MATH_NEON
+/*
+*	NEON kernels, part of every ARMv8 CPU, same layout as the SSE2 kernels
+*/
+static inline float32x4_t loadVec3(const glm::vec3& v_) {
+
+	float values[4] = { v_.x, v_.y, v_.z, 0.0f };
+	return vld1q_f32(values);
+
+}
+
+static inline void storeVec3(glm::vec3& v_, float32x4_t value_) {
+
+	v_ = glm::vec3(vgetq_lane_f32(value_, 0), vgetq_lane_f32(value_, 1), vgetq_lane_f32(value_, 2));
+
+}
+
+static inline float32x4_t combineNeon(float32x4_t weights_, float32x4_t c0_, float32x4_t c1_, float32x4_t c2_, float32x4_t c3_) {
+
+	float32x4_t result	= vmulq_laneq_f32(c0_, weights_, 0);
+	result				= vfmaq_laneq_f32(result, c1_, weights_, 1);
+	result				= vfmaq_laneq_f32(result, c2_, weights_, 2);
+	return vfmaq_laneq_f32(result, c3_, weights_, 3);
+
+}
+
+static inline float32x4_t shuffleYzxNeon(float32x4_t v_) {
+
+	float32x4_t result	= vsetq_lane_f32(vgetq_lane_f32(v_, 0), vextq_f32(v_, v_, 1), 2);
+	return vsetq_lane_f32(vgetq_lane_f32(v_, 3), result, 3);
+
+}
+
+static inline float32x4_t crossNeon(float32x4_t a_, float32x4_t b_) {
+
+	float32x4_t result	= vfmsq_f32(vmulq_f32(a_, shuffleYzxNeon(b_)), shuffleYzxNeon(a_), b_);
+	return shuffleYzxNeon(result);
+
+}
+
+static void multiplyNeon(const glm::mat4* a_, const glm::mat4* b_, glm::mat4* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* a		= &a_[i][0][0];
+		const float* b		= &b_[i][0][0];
+		float* result		= &result_[i][0][0];
+
+		float32x4_t a0		= vld1q_f32(a);
+		float32x4_t a1		= vld1q_f32(a + 4);
+		float32x4_t a2		= vld1q_f32(a + 8);
+		float32x4_t a3		= vld1q_f32(a + 12);
+		float32x4_t b0		= vld1q_f32(b);
+		float32x4_t b1		= vld1q_f32(b + 4);
+		float32x4_t b2		= vld1q_f32(b + 8);
+		float32x4_t b3		= vld1q_f32(b + 12);
+
+		vst1q_f32(result, combineNeon(b0, a0, a1, a2, a3));
+		vst1q_f32(result + 4, combineNeon(b1, a0, a1, a2, a3));
+		vst1q_f32(result + 8, combineNeon(b2, a0, a1, a2, a3));
+		vst1q_f32(result + 12, combineNeon(b3, a0, a1, a2, a3));
+
+	}
+
+}
+
+static inline void storeColumnNeon(glm::mat4* result_, int column_, float32x4_t r0_, float32x4_t r1_, float32x4_t r2_, float32x4_t r3_) {
+
+	float32x4x2_t t01	= vtrnq_f32(r0_, r1_);
+	float32x4x2_t t23	= vtrnq_f32(r2_, r3_);
+	vst1q_f32(&result_[0][column_][0], vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+	vst1q_f32(&result_[1][column_][0], vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+	vst1q_f32(&result_[2][column_][0], vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+	vst1q_f32(&result_[3][column_][0], vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+
+}
+
+static void composeTRSNeon(const glm::vec3* positions_, const glm::quat* rotations_, const glm::vec3* scales_, glm::mat4* result_, size_t count_) {
+
+	const float32x4_t one	= vdupq_n_f32(1.0f);
+	const float32x4_t zero	= vdupq_n_f32(0.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= count_; i += 4) {
+
+		const glm::quat* q	= rotations_ + i;
+		const glm::vec3* p	= positions_ + i;
+		const glm::vec3* s	= scales_ + i;
+
+		float lanes[10][4]	= {
+
+			{ q[0].x, q[1].x, q[2].x, q[3].x },
+			{ q[0].y, q[1].y, q[2].y, q[3].y },
+			{ q[0].z, q[1].z, q[2].z, q[3].z },
+			{ q[0].w, q[1].w, q[2].w, q[3].w },
+			{ s[0].x, s[1].x, s[2].x, s[3].x },
+			{ s[0].y, s[1].y, s[2].y, s[3].y },
+			{ s[0].z, s[1].z, s[2].z, s[3].z },
+			{ p[0].x, p[1].x, p[2].x, p[3].x },
+			{ p[0].y, p[1].y, p[2].y, p[3].y },
+			{ p[0].z, p[1].z, p[2].z, p[3].z }
+
+		};
+
+		float32x4_t qx		= vld1q_f32(lanes[0]);
+		float32x4_t qy		= vld1q_f32(lanes[1]);
+		float32x4_t qz		= vld1q_f32(lanes[2]);
+		float32x4_t qw		= vld1q_f32(lanes[3]);
+		float32x4_t sx		= vld1q_f32(lanes[4]);
+		float32x4_t sy		= vld1q_f32(lanes[5]);
+		float32x4_t sz		= vld1q_f32(lanes[6]);
+
+		float32x4_t x2		= vaddq_f32(qx, qx);
+		float32x4_t y2		= vaddq_f32(qy, qy);
+		float32x4_t z2		= vaddq_f32(qz, qz);
+		float32x4_t xx		= vmulq_f32(qx, x2);
+		float32x4_t yy		= vmulq_f32(qy, y2);
+		float32x4_t zz		= vmulq_f32(qz, z2);
+		float32x4_t xy		= vmulq_f32(qx, y2);
+		float32x4_t xz		= vmulq_f32(qx, z2);
+		float32x4_t yz		= vmulq_f32(qy, z2);
+		float32x4_t wx		= vmulq_f32(qw, x2);
+		float32x4_t wy		= vmulq_f32(qw, y2);
+		float32x4_t wz		= vmulq_f32(qw, z2);
+
+		storeColumnNeon(
+
+			result_ + i,
+			0,
+			vmulq_f32(vsubq_f32(one, vaddq_f32(yy, zz)), sx),
+			vmulq_f32(vaddq_f32(xy, wz), sx),
+			vmulq_f32(vsubq_f32(xz, wy), sx),
+			zero
+
+		);
+		storeColumnNeon(
+
+			result_ + i,
+			1,
+			vmulq_f32(vsubq_f32(xy, wz), sy),
+			vmulq_f32(vsubq_f32(one, vaddq_f32(xx, zz)), sy),
+			vmulq_f32(vaddq_f32(yz, wx), sy),
+			zero
+
+		);
+		storeColumnNeon(
+
+			result_ + i,
+			2,
+			vmulq_f32(vaddq_f32(xz, wy), sz),
+			vmulq_f32(vsubq_f32(yz, wx), sz),
+			vmulq_f32(vsubq_f32(one, vaddq_f32(xx, yy)), sz),
+			zero
+
+		);
+		storeColumnNeon(
+
+			result_ + i,
+			3,
+			vld1q_f32(lanes[7]),
+			vld1q_f32(lanes[8]),
+			vld1q_f32(lanes[9]),
+			one
+
+		);
+
+	}
+
+	composeTRSScalar(positions_ + i, rotations_ + i, scales_ + i, result_ + i, count_ - i);
+
+}
+
+static void normalMatricesNeon(const glm::mat4* matrices_, glm::mat4* result_, size_t count_) {
+
+	const float lastColumn[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* m		= &matrices_[i][0][0];
+		float* result		= &result_[i][0][0];
+
+		float32x4_t c0		= vsetq_lane_f32(0.0f, vld1q_f32(m), 3);
+		float32x4_t c1		= vsetq_lane_f32(0.0f, vld1q_f32(m + 4), 3);
+		float32x4_t c2		= vsetq_lane_f32(0.0f, vld1q_f32(m + 8), 3);
+
+		float32x4_t n0		= crossNeon(c1, c2);
+		float32x4_t n1		= crossNeon(c2, c0);
+		float32x4_t n2		= crossNeon(c0, c1);
+		float invDet		= 1.0f / vaddvq_f32(vmulq_f32(c0, n0));
+
+		vst1q_f32(result, vmulq_n_f32(n0, invDet));
+		vst1q_f32(result + 4, vmulq_n_f32(n1, invDet));
+		vst1q_f32(result + 8, vmulq_n_f32(n2, invDet));
+		vst1q_f32(result + 12, vld1q_f32(lastColumn));
+
+	}
+
+}
+
+static void transformBoundsNeon(const Bounds* bounds_, const glm::mat4* matrices_, Bounds* result_, size_t count_) {
+
+	for (size_t i = 0; i < count_; i++) {
+
+		const float* m		= &matrices_[i][0][0];
+		float32x4_t m0		= vld1q_f32(m);
+		float32x4_t m1		= vld1q_f32(m + 4);
+		float32x4_t m2		= vld1q_f32(m + 8);
+		float32x4_t m3		= vld1q_f32(m + 12);
+		float32x4_t center	= loadVec3(bounds_[i].center);
+		float32x4_t extents	= loadVec3(bounds_[i].extents);
+
+		float32x4_t newCenter	= vaddq_f32(combineNeon(center, m0, m1, m2, m3), m3);
+		float32x4_t newExtents	= combineNeon(extents, vabsq_f32(m0), vabsq_f32(m1), vabsq_f32(m2), m3);
+
+		// horizontal adds of the squared columns, with the w lane cleared
+		float maxScale			= std::max(std::max(vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(m0, m0), 3)), vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(m1, m1), 3))), vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(m2, m2), 3)));
+
+		storeVec3(result_[i].center, newCenter);
+		storeVec3(result_[i].extents, newExtents);
+		result_[i].radius		= bounds_[i].radius * std::sqrt(maxScale);
+
+	}
+
+}
+
+static void cullBoundsNeon(const Frustum& frustum_, const Bounds* bounds_, uint8_t* visible_, size_t count_) {
+
+	size_t i = 0;
+	for (; i + 4 <= count_; i += 4) {
+
+		// Bounds are seven floats, vld4 does not fit, the members are collected into lanes one by one
+		const Bounds* b			= bounds_ + i;
+		alignas(16) float members[7][4];
+		for (int k = 0; k < 4; k++) {
+
+			members[0][k]		= b[k].center.x;
+			members[1][k]		= b[k].center.y;
+			members[2][k]		= b[k].center.z;
+			members[3][k]		= b[k].extents.x;
+			members[4][k]		= b[k].extents.y;
+			members[5][k]		= b[k].extents.z;
+			members[6][k]		= b[k].radius;
+
+		}
+		float32x4_t cx			= vld1q_f32(members[0]);
+		float32x4_t cy			= vld1q_f32(members[1]);
+		float32x4_t cz			= vld1q_f32(members[2]);
+		float32x4_t ex			= vld1q_f32(members[3]);
+		float32x4_t ey			= vld1q_f32(members[4]);
+		float32x4_t ez			= vld1q_f32(members[5]);
+		float32x4_t radius		= vld1q_f32(members[6]);
+
+		uint32x4_t outside		= vdupq_n_u32(0);
+		for (const auto& plane : frustum_.planes) {
+
+			float32x4_t distance	= vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.w), cx, plane.x), cy, plane.y), cz, plane.z);
+			float32x4_t box			= vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(ex, std::fabs(plane.x)), ey, std::fabs(plane.y)), ez, std::fabs(plane.z));
+			outside					= vorrq_u32(outside, vcltq_f32(vaddq_f32(distance, vminq_f32(box, radius)), vdupq_n_f32(0.0f)));
+
+		}
+
+		alignas(16) uint32_t mask[4];
+		vst1q_u32(mask, outside);
+		for (int k = 0; k < 4; k++) {
+
+			visible_[i + k] = mask[k] ? 0 : 1;
+
+		}
+
+	}
+
+	cullBoundsScalar(frustum_, bounds_ + i, visible_ + i, count_ - i);
+
+}
+
+static const SimdKernels neonKernels = {
+
+	multiplyNeon,
+	composeTRSNeon,
+	normalMatricesNeon,
+	transformBoundsNeon,
+	cullBoundsNeon
+
+};
+#endif
+
+#if defined SIMD_MATH_X86
+/*
+*	Function:		void cpuid(int info_[4], int leaf_, int subLeaf_)
+*	Purpose:		Portable wrapper around the cpuid instruction
+*
+*/
+static void cpuid(int info_[4], int leaf_, int subLeaf_) {
+
+#if defined _MSC_VER
+	__cpuidex(info_, leaf_, subLeaf_);
+#else
+	unsigned int eax, ebx, ecx, edx;
+	__cpuid_count(leaf_, subLeaf_, eax, ebx, ecx, edx);
+	info_[0] = static_cast< int >(eax);
+	info_[1] = static_cast< int >(ebx);
+	info_[2] = static_cast< int >(ecx);
+	info_[3] = static_cast< int >(edx);
+#endif
+
+}
+
+/*
+*	Function:		uint64_t getEnabledXStateFeatures()
+*	Purpose:		Returns XCR0, which tells whether the OS saves the AVX registers on context switches
+*
+*/
+static uint64_t getEnabledXStateFeatures(void) {
+
+#if defined _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast< uint64_t >(edx) << 32) | eax;
+#endif
+
+}
+#endif
+
+/*
+*	Function:		SimdPath detectPath()
+*	Purpose:		Returns the widest path the CPU and OS support
+*
+*/
+static SimdPath detectPath(void) {
+
+#if defined SIMD_MATH_X86
+	int info[4] = { 0 };
+	cpuid(info, 0, 0);
+	int maxLeaf = info[0];
+
+	cpuid(info, 1, 0);
+	bool fma		= (info[2] & (1 << 12)) != 0;
+	bool osxsave	= (info[2] & (1 << 27)) != 0;
+	bool avx		= (info[2] & (1 << 28)) != 0;
+
+	if (maxLeaf >= 7 && fma && osxsave && avx && (getEnabledXStateFeatures() & 0x6) == 0x6) {
+
+		cpuid(info, 7, 0);
+		if ((info[1] & (1 << 5)) != 0) {
+
+			return SIMD_PATH_AVX2;
+
+		}
+
+	}
+	return SIMD_PATH_SSE2;
+#elif defined SIMD_MATH_NEON
+	return SIMD_PATH_NEON;
+#else
+	return SIMD_PATH_SCALAR;
+#endif
+
+}
+
+/*
+*	Function:		const SimdKernels* getKernels(SimdPath path_)
+*	Purpose:		Returns the function table of path_
+*
+*/
+static const SimdKernels* getKernels(SimdPath path_) {
+
+	switch (path_) {
+#if defined SIMD_MATH_X86
+	case SIMD_PATH_SSE2:
+		return &sse2Kernels;
+	case SIMD_PATH_AVX2:
+		return &avx2Kernels;
+#endif
+#if defined SIMD_MATH_NEON
+	case SIMD_PATH_NEON:
+		return &neonKernels;
+#endif
+	default:
+		return &scalarKernels;
+	}
+
+}
+
+static const SimdPath		bestPath		= detectPath();
+static SimdPath				activePath		= bestPath;
+static const SimdKernels*	kernels			= getKernels(bestPath);
+
+/*
+*	Function:		SimdPath getPath()
+*	Purpose:		Returns the path the kernels currently dispatch to
+*
+*/
+SimdPath SimdMath::getPath(void) {
+
+	return activePath;
+
+}
+
+/*
+*	Function:		SimdPath getBestPath()
+*	Purpose:		Returns the widest path this CPU supports
+*
+*/
+SimdPath SimdMath::getBestPath(void) {
+
+	return bestPath;
+
+}
+
+/*
+*	Function:		const char* getPathName(SimdPath path_)
+*	Purpose:		Returns a printable name of path_
+*
+*/
+const char* SimdMath::getPathName(SimdPath path_) {
+
+	switch (path_) {
+	case SIMD_PATH_SSE2:
+		return "SSE2";
+	case SIMD_PATH_AVX2:
+		return "AVX2";
+	case SIMD_PATH_NEON:
+		return "NEON";
+	default:
+		return "scalar";
+	}
+
+}
+
+/*
+*	Function:		void setPath(SimdPath path_)
+*	Purpose:		Forces a path, paths the CPU lacks fall back to scalar; not thread safe, meant for benchmarks and debugging
+*
+*/
+void SimdMath::setPath(SimdPath path_) {
+
+	bool supported = path_ == SIMD_PATH_SCALAR || path_ == bestPath;
+#if defined SIMD_MATH_X86
+	supported = supported || path_ == SIMD_PATH_SSE2;
+#endif
+
+	activePath		= supported ? path_ : SIMD_PATH_SCALAR;
+	kernels			= getKernels(activePath);
+
+}
+
+/*
+*	Function:		void multiply(
+*
+*						const glm::mat4*			a_,
+*						const glm::mat4*			b_,
+*						glm::mat4*					result_,
+*						size_t						count_
+*
+*					)
+*	Purpose:		result_[i] = a_[i] * b_[i]
+*
+*/
+void SimdMath::multiply(
+
+	const glm::mat4*			a_,
+	const glm::mat4*			b_,
+	glm::mat4*					result_,
+	size_t						count_
+
+) {
+
+	kernels->multiply(a_, b_, result_, count_);
+
+}
+
+/*
+*	Function:		void composeTRS(
+*
+*						const glm::vec3*			positions_,
+*						const glm::quat*			rotations_,
+*						const glm::vec3*			scales_,
+*						glm::mat4*					result_,
+*						size_t						count_
+*
+*					)
+*	Purpose:		result_[i] = translate(positions_[i]) * mat4_cast(rotations_[i]) * scale(scales_[i])
+*
+*/
+void SimdMath::composeTRS(
+
+	const glm::vec3*			positions_,
+	const glm::quat*			rotations_,
+	const glm::vec3*			scales_,
+	glm::mat4*					result_,
+	size_t						count_
+
+) {
+
+	kernels->composeTRS(positions_, rotations_, scales_, result_, count_);
+
+}
+
+/*
+*	Function:		void normalMatrices(
+*
+*						const glm::mat4*			matrices_,
+*						glm::mat4*					result_,
+*						size_t						count_
+*
+*					)
+*	Purpose:		result_[i] = mat4(transpose(inverse(mat3(matrices_[i])))), the matrix that keeps normals perpendicular under non-uniform scale
+*
+*/
+void SimdMath::normalMatrices(
+
+	const glm::mat4*			matrices_,
+	glm::mat4*					result_,
+	size_t						count_
+
+) {
+
+	kernels->normalMatrices(matrices_, result_, count_);
+
+}
+
+/*
+*	Function:		void transformBounds(
+*
+*						const Bounds*				bounds_,
+*						const glm::mat4*			matrices_,
+*						Bounds*						result_,
+*						size_t						count_
+*
+*					)
+*	Purpose:		result_[i] = bounds_[i].transform(matrices_[i])
+*
+*/
+void SimdMath::transformBounds(
+
+	const Bounds*				bounds_,
+	const glm::mat4*			matrices_,
+	Bounds*						result_,
+	size_t						count_
+
+) {
+
+	kernels->transformBounds(bounds_, matrices_, result_, count_);
+
+}
+
+/*
+*	Function:		void cullBounds(
+*
+*						const Frustum&				frustum_,
+*						const Bounds*				bounds_,
+*						uint8_t*					visible_,
+*						size_t						count_
+*
+*					)
+*	Purpose:		visible_[i] = frustum_.intersects(bounds_[i]), 4 bounds per step on SSE2 and NEON, 8 on AVX2
+*
+*/
+void SimdMath::cullBounds(
+
+	const Frustum&				frustum_,
+	const Bounds*				bounds_,
+	uint8_t*					visible_,
+	size_t						count_
+
+) {
+
+	kernels->cullBounds(frustum_, bounds_, visible_, count_);
+
+}
+
+/*
+*	Function:		double measure(size_t count_, F kernel_)
+*	Purpose:		Returns the average time in nanoseconds per element of several runs of kernel_ over count_ elements
+*
+*/
+template< typename F >
+static double measure(size_t count_, F kernel_) {
+
+	// roughly the same amount of work for every size, at least a few runs
+	size_t runs = std::max< size_t >(4000000 / count_, 4);
+	kernel_();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t run = 0; run < runs; run++) {
+
+		kernel_();
+
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration< double, std::nano >(end - start).count() / static_cast< double >(runs * count_);
+
+}
+
+/*
+*	Function:		float maxDifference(const float* a_, const float* b_, size_t count_)
+*	Purpose:		Returns the largest absolute difference of two float arrays
+*
+*/
+static float maxDifference(const float* a_, const float* b_, size_t count_) {
+
+	float difference = 0.0f;
+	for (size_t i = 0; i < count_; i++) {
+
+		difference = std::max(difference, std::fabs(a_[i] - b_[i]));
+
+	}
+	return difference;
+
+}
+
+/*
+*	Function:		void benchmark()
+*	Purpose:		Times every kernel of the best path against the GLM implementation and prints the results
+*
+*/
+void SimdMath::benchmark(void) {
+
+	SimdPath previousPath	= activePath;
+	SimdPath simdPath		= bestPath;
+	const size_t counts[]	= { 1000, 10000, 100000 };
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution< float > distribution(-1.0f, 1.0f);
+	std::uniform_real_distribution< float > scaleDistribution(0.5f, 2.0f);
+
+	std::cout << "SIMD benchmark, GLM against " << getPathName(simdPath) << ", nanoseconds per transform" << std::endl;
+
+	for (size_t count : counts) {
+
+		std::vector< glm::vec3 > positions(count);
+		std::vector< glm::quat > rotations(count);
+		std::vector< glm::vec3 > scales(count);
+		std::vector< Bounds > bounds(count);
+		for (size_t i = 0; i < count; i++) {
+
+			positions[i]			= glm::vec3(distribution(random), distribution(random), distribution(random)) * 100.0f;
+			rotations[i]			= glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random)));
+			scales[i]				= glm::vec3(scaleDistribution(random), scaleDistribution(random), scaleDistribution(random));
+			bounds[i].center		= glm::vec3(distribution(random), distribution(random), distribution(random));
+			bounds[i].extents		= glm::vec3(scaleDistribution(random), scaleDistribution(random), scaleDistribution(random));
+			bounds[i].radius		= glm::length(bounds[i].extents);
+
+		}
+
+		std::vector< glm::mat4 > parents(count);
+		std::vector< glm::mat4 > locals(count);
+		std::vector< glm::mat4 > reference(count);
+		std::vector< glm::mat4 > result(count);
+		std::vector< Bounds > referenceBounds(count);
+		std::vector< Bounds > resultBounds(count);
+		std::vector< uint8_t > referenceVisible(count);
+		std::vector< uint8_t > resultVisible(count);
+		composeTRSScalar(positions.data(), rotations.data(), scales.data(), locals.data(), count);
+		std::reverse_copy(locals.begin(), locals.end(), parents.begin());
+
+		struct Timing {
+
+			const char*		name;
+			double			glm;
+			double			simd;
+			float			difference;
+
+		};
+		Timing timings[5];
+
+		setPath(SIMD_PATH_SCALAR);
+		timings[0].glm = measure(count, [&] () { multiply(parents.data(), locals.data(), reference.data(), count); });
+		setPath(simdPath);
+		timings[0].simd = measure(count, [&] () { multiply(parents.data(), locals.data(), result.data(), count); });
+		timings[0].name = "mat4 x mat4";
+		timings[0].difference = maxDifference(&reference[0][0][0], &result[0][0][0], count * 16);
+
+		setPath(SIMD_PATH_SCALAR);
+		timings[1].glm = measure(count, [&] () { composeTRS(positions.data(), rotations.data(), scales.data(), reference.data(), count); });
+		setPath(simdPath);
+		timings[1].simd = measure(count, [&] () { composeTRS(positions.data(), rotations.data(), scales.data(), result.data(), count); });
+		timings[1].name = "TRS";
+		timings[1].difference = maxDifference(&reference[0][0][0], &result[0][0][0], count * 16);
+
+		setPath(SIMD_PATH_SCALAR);
+		timings[2].glm = measure(count, [&] () { normalMatrices(locals.data(), reference.data(), count); });
+		setPath(simdPath);
+		timings[2].simd = measure(count, [&] () { normalMatrices(locals.data(), result.data(), count); });
+		timings[2].name = "inverse transpose";
+		timings[2].difference = maxDifference(&reference[0][0][0], &result[0][0][0], count * 16);
+
+		setPath(SIMD_PATH_SCALAR);
+		timings[3].glm = measure(count, [&] () { transformBounds(bounds.data(), locals.data(), referenceBounds.data(), count); });
+		setPath(simdPath);
+		timings[3].simd = measure(count, [&] () { transformBounds(bounds.data(), locals.data(), resultBounds.data(), count); });
+		timings[3].name = "AABB";
+		timings[3].difference = maxDifference(&referenceBounds[0].center.x, &resultBounds[0].center.x, count * (sizeof(Bounds) / sizeof(float)));
+
+		// a camera in the middle of the scattered bounds sees roughly a quarter of them
+		Frustum frustum = Frustum::fromViewProjection(glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+		transformBoundsScalar(bounds.data(), locals.data(), referenceBounds.data(), count);
+		setPath(SIMD_PATH_SCALAR);
+		timings[4].glm = measure(count, [&] () { cullBounds(frustum, referenceBounds.data(), referenceVisible.data(), count); });
+		setPath(simdPath);
+		timings[4].simd = measure(count, [&] () { cullBounds(frustum, referenceBounds.data(), resultVisible.data(), count); });
+		timings[4].name = "frustum cull";
+		timings[4].difference = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+
+			// bounds exactly on a plane may fall either way with fused multiply-add, counted as errors
+			timings[4].difference += referenceVisible[i] != resultVisible[i] ? 1.0f : 0.0f;
+
+		}
+
+		for (const Timing& timing : timings) {
+
+			std::cout << "  " << count << "\t" << timing.name << ":\t" << timing.glm << " / " << timing.simd
+				<< " (x" << timing.glm / timing.simd << ", max error " << timing.difference << ")" << std::endl;
+
+		}
+
+	}
+
+	setPath(previousPath);
+
+}
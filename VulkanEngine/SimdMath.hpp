@@ -0,0 +1,87 @@
+/*
+*	File:		SimdMath.hpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bounds.cpp"
+#include "Frustum.cpp"
+
+// MSVC accepts AVX2 intrinsics in any function, GCC and Clang need the instruction set enabled per function
+#if defined _MSC_VER
+	#define SIMD_TARGET_AVX2
+#else
+	#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+enum SimdPath {
+
+	SIMD_PATH_SCALAR		= 0,
+	SIMD_PATH_SSE2			= 1,
+	SIMD_PATH_AVX2			= 2,
+	SIMD_PATH_NEON			= 3
+
+};
+
+/*
+*	Class:			SimdMath
+*	Purpose:		Batched matrix and bounds kernels over component arrays, the widest instruction set the CPU supports is picked at startup
+*					Results are written after all inputs of an element have been read, so result_ may alias the inputs
+*
+*/
+class SimdMath {
+public:
+	static SimdPath getPath(void);
+	static SimdPath getBestPath(void);
+	static const char* getPathName(SimdPath path_);
+	static void setPath(SimdPath path_);
+	static void multiply(
+
+		const glm::mat4*			a_,
+		const glm::mat4*			b_,
+		glm::mat4*					result_,
+		size_t						count_
+
+	);
+	static void composeTRS(
+
+		const glm::vec3*			positions_,
+		const glm::quat*			rotations_,
+		const glm::vec3*			scales_,
+		glm::mat4*					result_,
+		size_t						count_
+
+	);
+	static void normalMatrices(
+
+		const glm::mat4*			matrices_,
+		glm::mat4*					result_,
+		size_t						count_
+
+	);
+	static void transformBounds(
+
+		const Bounds*				bounds_,
+		const glm::mat4*			matrices_,
+		Bounds*						result_,
+		size_t						count_
+
+	);
+	static void cullBounds(
+
+		const Frustum&				frustum_,
+		const Bounds*				bounds_,
+		uint8_t*					visible_,
+		size_t						count_
+
+	);
+	static void benchmark(void);
+
+};
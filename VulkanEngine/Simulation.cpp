@@ -0,0 +1,403 @@
+/*
+*	File:		Simulation.cpp
+*
+*
+*/
+#include "Simulation.hpp"
+#include <algorithm>
+
+/*
+*	Function:		Camera getCamera()
+*	Purpose:		Rebuilds a camera from the state to derive view and projection from
+*
+*/
+Camera SimulationState::getCamera(void) const {
+
+	Camera result(cameraPosition, cameraWorldUp, cameraYaw, cameraPitch);
+	result.zoom = cameraZoom;
+	return result;
+
+}
+
+/*
+*	Function:		bool equals(const SimulationState& other_)
+*	Purpose:		Returns true if rendering other_ would produce the same image
+*
+*/
+bool SimulationState::equals(const SimulationState& other_) const {
+
+	return cameraPosition == other_.cameraPosition
+		&& cameraWorldUp == other_.cameraWorldUp
+		&& cameraYaw == other_.cameraYaw
+		&& cameraPitch == other_.cameraPitch
+		&& cameraZoom == other_.cameraZoom
+		&& lightPosition == other_.lightPosition
+		&& objectTransform.position == other_.objectTransform.position
+		&& objectTransform.rotation == other_.objectTransform.rotation
+		&& objectTransform.scale == other_.objectTransform.scale
+		&& lightingTransform.position == other_.lightingTransform.position
+		&& lightingTransform.rotation == other_.lightingTransform.rotation
+		&& lightingTransform.scale == other_.lightingTransform.scale;
+
+}
+
+/*
+*	Function:		SimulationState interpolate(
+*
+*						const SimulationState&		a_,
+*						const SimulationState&		b_,
+*						float						alpha_
+*
+*					)
+*	Purpose:		Blends two consecutive ticks
+*
+*/
+SimulationState SimulationState::interpolate(
+
+	const SimulationState&		a_,
+	const SimulationState&		b_,
+	float						alpha_
+
+) {
+
+	SimulationState result;
+	result.cameraPosition		= glm::mix(a_.cameraPosition, b_.cameraPosition, alpha_);
+	result.cameraWorldUp		= b_.cameraWorldUp;
+	result.cameraYaw			= glm::mix(a_.cameraYaw, b_.cameraYaw, alpha_);
+	result.cameraPitch			= glm::mix(a_.cameraPitch, b_.cameraPitch, alpha_);
+	result.cameraZoom			= glm::mix(a_.cameraZoom, b_.cameraZoom, alpha_);
+	result.lightPosition		= glm::mix(a_.lightPosition, b_.lightPosition, alpha_);
+	result.objectTransform		= Transform::interpolate(a_.objectTransform, b_.objectTransform, alpha_);
+	result.lightingTransform	= Transform::interpolate(a_.lightingTransform, b_.lightingTransform, alpha_);
+	return result;
+
+}
+
+/*
+*	Function:		Simulation()
+*	Purpose:		Default constructor
+*
+*/
+Simulation::Simulation(void) : camera(nullptr), tickInterval(1.0 / GAME_SIMULATION_TICK_RATE), simulationTime(0.0), tickCount(0), running(false), lastChangeTime(0.0) {
+
+
+
+}
+
+/*
+*	Function:		void start(Camera* camera_, uint32_t tickRate_)
+*	Purpose:		Publishes the initial state and starts the simulation thread, which owns camera_ from now on
+*
+*/
+void Simulation::start(Camera* camera_, uint32_t tickRate_) {
+
+	camera				= camera_;
+	tickInterval		= 1.0 / std::max(tickRate_, 1u);
+	simulationTime		= 0.0;
+	tickCount			= 0;
+	lastState			= captureState();
+	lastChangeTime		= now();
+	publish(lastState);
+
+	// a dedicated thread rather than a job: the loop sleeps between ticks and would otherwise block a worker for the whole game
+	running				= true;
+	thread				= std::thread(&Simulation::loop, this);
+
+}
+
+/*
+*	Function:		void stop()
+*	Purpose:		Stops and joins the simulation thread
+*
+*/
+void Simulation::stop(void) {
+
+	if (!running) return;
+	running = false;
+	thread.join();
+
+}
+
+/*
+*	Function:		void setMovement(CameraMovement direction_, bool active_)
+*	Purpose:		Records whether a movement key is held
+*
+*/
+void Simulation::setMovement(CameraMovement direction_, bool active_) {
+
+	std::lock_guard< std::mutex > lock(inputMutex);
+	pendingInput.movement[direction_] = active_;
+
+}
+
+/*
+*	Function:		void addMouseMovement(float xOffset_, float yOffset_)
+*	Purpose:		Accumulates mouse movement until the next tick
+*
+*/
+void Simulation::addMouseMovement(float xOffset_, float yOffset_) {
+
+	std::lock_guard< std::mutex > lock(inputMutex);
+	if (pendingInput.inputEnabled) {
+
+		pendingInput.mouseOffsetX += xOffset_;
+		pendingInput.mouseOffsetY += yOffset_;
+
+	}
+
+}
+
+/*
+*	Function:		void addMouseScroll(float yOffset_)
+*	Purpose:		Accumulates scrolling until the next tick
+*
+*/
+void Simulation::addMouseScroll(float yOffset_) {
+
+	std::lock_guard< std::mutex > lock(inputMutex);
+	if (pendingInput.inputEnabled) {
+
+		pendingInput.scrollOffset += yOffset_;
+
+	}
+
+}
+
+/*
+*	Function:		void setInputEnabled(bool enabled_)
+*	Purpose:		Enables or disables camera control
+*
+*/
+void Simulation::setInputEnabled(bool enabled_) {
+
+	std::lock_guard< std::mutex > lock(inputMutex);
+	pendingInput.inputEnabled = enabled_;
+
+}
+
+/*
+*	Function:		SimulationState sample()
+*	Purpose:		Returns the state to render now, interpolated between the two latest ticks; render thread only
+*
+*/
+SimulationState Simulation::sample(void) {
+
+	snapshots.update();
+	const FrameSnapshot& snapshot	= snapshots.front();
+	float alpha						= static_cast< float >((now() - snapshot.publishTime) / tickInterval);
+	alpha							= std::min(std::max(alpha, 0.0f), 1.0f);
+	return SimulationState::interpolate(snapshot.previous, snapshot.current, alpha);
+
+}
+
+/*
+*	Function:		double getTickInterval()
+*	Purpose:		Returns the fixed simulation timestep in seconds
+*
+*/
+double Simulation::getTickInterval(void) {
+
+	return tickInterval;
+
+}
+
+/*
+*	Function:		void setChangeCallback(std::function< void() > callback_)
+*	Purpose:		Sets a function the simulation thread calls whenever a tick changed the scene, must be set before start()
+*
+*/
+void Simulation::setChangeCallback(std::function< void() > callback_) {
+
+	changeCallback = callback_;
+
+}
+
+/*
+*	Function:		bool hasChangedSince(double time_)
+*	Purpose:		Returns true if a frame rendered at time_ may not show the latest state, including interpolation towards it
+*
+*/
+bool Simulation::hasChangedSince(double time_) {
+
+	return lastChangeTime.load(std::memory_order_acquire) + tickInterval >= time_;
+
+}
+
+/*
+*	Function:		~Simulation()
+*	Purpose:		Default destructor
+*
+*/
+Simulation::~Simulation() {
+
+	stop();
+
+}
+
+/*
+*	Function:		void loop()
+*	Purpose:		Runs ticks at the fixed rate, catching up after stalls but never more than a few ticks at once
+*
+*/
+void Simulation::loop(void) {
+
+	const uint32_t maxCatchUpTicks	= 5;
+	double nextTick					= now() + tickInterval;
+
+	while (running) {
+
+		double currentTime = now();
+		if (currentTime < nextTick) {
+
+			std::this_thread::sleep_for(std::chrono::duration< double >(nextTick - currentTime));
+			continue;
+
+		}
+
+		uint32_t ticks = 0;
+		while (currentTime >= nextTick && ticks < maxCatchUpTicks) {
+
+			tick();
+			nextTick += tickInterval;
+			ticks++;
+
+		}
+		if (currentTime >= nextTick) {
+
+			// too far behind, drop the backlog instead of spiralling
+			nextTick = currentTime + tickInterval;
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		void tick()
+*	Purpose:		Advances the simulation by exactly one timestep and publishes the result
+*
+*/
+void Simulation::tick(void) {
+
+	SimulationInput input;
+	{
+
+		std::lock_guard< std::mutex > lock(inputMutex);
+		input							= pendingInput;
+		pendingInput.mouseOffsetX		= 0.0f;
+		pendingInput.mouseOffsetY		= 0.0f;
+		pendingInput.scrollOffset		= 0.0f;
+
+	}
+
+	float deltaTime = static_cast< float >(tickInterval);
+	if (input.inputEnabled) {
+
+		camera->enableInput();
+
+	}
+	else {
+
+		camera->disableInput();
+
+	}
+	for (uint32_t direction = FORWARD; direction <= RIGHT; direction++) {
+
+		if (input.movement[direction]) {
+
+			camera->processKeyboard(static_cast< CameraMovement >(direction), deltaTime);
+
+		}
+
+	}
+	if (input.mouseOffsetX != 0.0f || input.mouseOffsetY != 0.0f) {
+
+		camera->processMouseMovement(input.mouseOffsetX, input.mouseOffsetY);
+
+	}
+	if (input.scrollOffset != 0.0f) {
+
+		camera->processMouseScroll(input.scrollOffset);
+
+	}
+
+	simulationTime	+= tickInterval;
+	tickCount++;
+
+	SimulationState state = captureState();
+	publish(state);
+
+}
+
+/*
+*	Function:		SimulationState captureState()
+*	Purpose:		Evaluates the scene at the current simulation time
+*
+*/
+SimulationState Simulation::captureState(void) {
+
+	float time						= static_cast< float >(simulationTime);
+	glm::quat upright				= glm::angleAxis(glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+	SimulationState state;
+	state.cameraPosition			= camera->position;
+	state.cameraWorldUp				= camera->worldUp;
+	state.cameraYaw					= camera->yaw;
+	state.cameraPitch				= camera->pitch;
+	state.cameraZoom				= camera->zoom;
+
+	float lightRadius				= 10;
+	state.lightPosition				= glm::vec3(glm::sin(time) * lightRadius, 20.0f, glm::cos(time) * 3.0f * lightRadius);
+
+	state.objectTransform.rotation	= upright * glm::angleAxis(time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	// the light cube is placed in the upright model space, so its position is rotated along with it
+	state.lightingTransform.position	= upright * state.lightPosition;
+	state.lightingTransform.rotation	= upright * glm::angleAxis(time * glm::radians(-30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	state.lightingTransform.scale		= glm::vec3(0.4f);
+
+	return state;
+
+}
+
+/*
+*	Function:		void publish(const SimulationState& state_)
+*	Purpose:		Hands the two latest states to the render thread
+*
+*/
+void Simulation::publish(const SimulationState& state_) {
+
+	double publishTime			= now();
+	FrameSnapshot& snapshot		= snapshots.back();
+	snapshot.previous			= lastState;
+	snapshot.current			= state_;
+	snapshot.publishTime		= publishTime;
+	snapshot.tick				= tickCount;
+	snapshots.publish();
+	bool changed				= !state_.equals(lastState);
+	lastState					= state_;
+
+	if (changed) {
+
+		lastChangeTime.store(publishTime, std::memory_order_release);
+		if (changeCallback) {
+
+			changeCallback();
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		double now()
+*	Purpose:		Returns a monotonic time in seconds
+*
+*/
+double Simulation::now(void) {
+
+	return std::chrono::duration< double >(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
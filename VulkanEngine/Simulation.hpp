@@ -0,0 +1,134 @@
+/*
+*	File:		Simulation.hpp
+*
+*
+*/
+#pragma once
+#include "VERSION.cpp"
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Camera.hpp"
+#include "TripleBuffer.hpp"
+
+#if !defined GAME_SIMULATION_TICK_RATE
+#define GAME_SIMULATION_TICK_RATE 120
+#endif
+
+struct Transform {
+
+	glm::vec3		position		= glm::vec3(0.0f);
+	glm::quat		rotation		= glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3		scale			= glm::vec3(1.0f);
+
+	glm::mat4 getMatrix(void) const {
+
+		return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+
+	}
+
+	static Transform interpolate(const Transform& a_, const Transform& b_, float alpha_) {
+
+		Transform result;
+		result.position		= glm::mix(a_.position, b_.position, alpha_);
+		result.rotation		= glm::slerp(a_.rotation, b_.rotation, alpha_);
+		result.scale		= glm::mix(a_.scale, b_.scale, alpha_);
+		return result;
+
+	}
+
+};
+
+/*
+*	Everything the renderer needs from one simulation tick
+*/
+struct SimulationState {
+
+	glm::vec3		cameraPosition;
+	glm::vec3		cameraWorldUp;
+	float			cameraYaw;
+	float			cameraPitch;
+	float			cameraZoom;
+	glm::vec3		lightPosition;
+	Transform		objectTransform;
+	Transform		lightingTransform;
+
+	Camera getCamera(void) const;
+	bool equals(const SimulationState& other_) const;
+	static SimulationState interpolate(const SimulationState& a_, const SimulationState& b_, float alpha_);
+
+};
+
+/*
+*	Immutable once published: the last two ticks and the time the newer one was produced
+*/
+struct FrameSnapshot {
+
+	SimulationState		previous;
+	SimulationState		current;
+	double				publishTime;
+	uint64_t			tick;
+
+};
+
+/*
+*	Input gathered on the main thread since the last tick
+*/
+struct SimulationInput {
+
+	bool			movement[4]			= { false, false, false, false };
+	float			mouseOffsetX		= 0.0f;
+	float			mouseOffsetY		= 0.0f;
+	float			scrollOffset		= 0.0f;
+	bool			inputEnabled		= true;
+
+};
+
+/*
+*	Class:			Simulation
+*	Purpose:		Updates camera, transforms and lights at a fixed tick on its own thread
+*
+*/
+class Simulation {
+public:
+	Simulation(void);
+	void start(Camera* camera_, uint32_t tickRate_ = GAME_SIMULATION_TICK_RATE);
+	void stop(void);
+	void setMovement(CameraMovement direction_, bool active_);
+	void addMouseMovement(float xOffset_, float yOffset_);
+	void addMouseScroll(float yOffset_);
+	void setInputEnabled(bool enabled_);
+	SimulationState sample(void);
+	double getTickInterval(void);
+	void setChangeCallback(std::function< void() > callback_);
+	bool hasChangedSince(double time_);
+	static double now(void);
+	~Simulation();
+private:
+	Camera*										camera;
+	double										tickInterval;
+	double										simulationTime;
+	uint64_t									tickCount;
+	SimulationState								lastState;
+	std::thread									thread;
+	std::atomic< bool >							running;
+	std::mutex									inputMutex;
+	SimulationInput								pendingInput;
+	TripleBuffer< FrameSnapshot >				snapshots;
+	std::atomic< double >						lastChangeTime;
+	std::function< void() >						changeCallback;
+
+	void loop(void);
+	void tick(void);
+	SimulationState captureState(void);
+	void publish(const SimulationState& state_);
+
+};
@@ -0,0 +1,835 @@
+/*
+*	File:		SoftwareOcclusion.cpp
+*
+*
+*/
+#include "SoftwareOcclusion.hpp"
+#include "SimdMath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+	#define SOFTWARE_OCCLUSION_X86
+	#include <immintrin.h>
+#endif
+
+/*
+*	Default buffer size, a sixth of 1080p is plenty for large occluders
+*/
+static const uint32_t DEFAULT_WIDTH			= 320;
+static const uint32_t DEFAULT_HEIGHT		= 180;
+
+/*
+*	Tile size in pixels, a tile row is a multiple of every vector width
+*/
+static const uint32_t TILE_WIDTH			= 32;
+static const uint32_t TILE_HEIGHT			= 8;
+
+/*
+*	Occluders and bounds per job when transforming and testing
+*/
+static const size_t OCCLUDER_GRAIN_SIZE		= 16;
+static const size_t TEST_GRAIN_SIZE			= 256;
+
+/*
+*	Vertices closer to the camera plane than this are not projected, their triangles are dropped
+*/
+static const float MIN_W					= 0.0001f;
+
+/*
+*	Row kernels of one instruction set
+*	rasterizeRow writes the nearer depth into the pixels [minX, maxX) of the row whose centers are inside the triangle
+*	anyFarther returns whether a pixel in [minX, maxX) of the row lies at or behind depth
+*/
+struct OcclusionKernels {
+
+	void (*rasterizeRow)(const float*, const float*, float, int32_t, int32_t, float*);
+	bool (*anyFarther)(const float*, int32_t, int32_t, float);
+
+};
+
+/*
+*	Edge and depth values of a row are A * x + rowC, rowC holds B * y + C of the three edges and the depth plane
+*	edgeA_ holds the three edge slopes and the depth slope
+*/
+static void rasterizeRowScalar(const float* edgeA_, const float* rowC_, float maxDepth_, int32_t minX_, int32_t maxX_, float* row_) {
+
+	for (int32_t x = minX_; x < maxX_; x++) {
+
+		float px	= static_cast< float >(x) + 0.5f;
+		float e0	= edgeA_[0] * px + rowC_[0];
+		float e1	= edgeA_[1] * px + rowC_[1];
+		float e2	= edgeA_[2] * px + rowC_[2];
+		if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+
+			float z		= std::min(edgeA_[3] * px + rowC_[3], maxDepth_);
+			row_[x]		= std::min(row_[x], z);
+
+		}
+
+	}
+
+}
+
+static bool anyFartherScalar(const float* row_, int32_t minX_, int32_t maxX_, float depth_) {
+
+	for (int32_t x = minX_; x < maxX_; x++) {
+
+		if (row_[x] >= depth_) {
+
+			return true;
+
+		}
+
+	}
+	return false;
+
+}
+
+static const OcclusionKernels scalarKernels = {
+
+	rasterizeRowScalar,
+	anyFartherScalar
+
+};
+
+#if defined SOFTWARE_OCCLUSION_X86
+/*
+*	SSE2 kernels, four pixels per step
+*	The first step starts on a multiple of four, pixels left and right of the triangle's bounding box always fail the edge test
+*/
+static void rasterizeRowSse2(const float* edgeA_, const float* rowC_, float maxDepth_, int32_t minX_, int32_t maxX_, float* row_) {
+
+	const __m128 zero		= _mm_setzero_ps();
+	const __m128 a0			= _mm_set1_ps(edgeA_[0]);
+	const __m128 a1			= _mm_set1_ps(edgeA_[1]);
+	const __m128 a2			= _mm_set1_ps(edgeA_[2]);
+	const __m128 az			= _mm_set1_ps(edgeA_[3]);
+	const __m128 c0			= _mm_set1_ps(rowC_[0]);
+	const __m128 c1			= _mm_set1_ps(rowC_[1]);
+	const __m128 c2			= _mm_set1_ps(rowC_[2]);
+	const __m128 cz			= _mm_set1_ps(rowC_[3]);
+	const __m128 maxDepth	= _mm_set1_ps(maxDepth_);
+	const __m128 step		= _mm_set1_ps(4.0f);
+
+	int32_t x				= minX_ & ~3;
+	__m128 px				= _mm_add_ps(_mm_set1_ps(static_cast< float >(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+	for (; x < maxX_; x += 4) {
+
+		__m128 inside		= _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), c0), zero);
+		inside				= _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), c1), zero));
+		inside				= _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), c2), zero));
+		if (_mm_movemask_ps(inside) != 0) {
+
+			__m128 depth	= _mm_loadu_ps(row_ + x);
+			__m128 z		= _mm_min_ps(_mm_min_ps(_mm_add_ps(_mm_mul_ps(az, px), cz), maxDepth), depth);
+			_mm_storeu_ps(row_ + x, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, depth)));
+
+		}
+		px					= _mm_add_ps(px, step);
+
+	}
+
+}
+
+static bool anyFartherSse2(const float* row_, int32_t minX_, int32_t maxX_, float depth_) {
+
+	const __m128 depth		= _mm_set1_ps(depth_);
+	const __m128 minX		= _mm_set1_ps(static_cast< float >(minX_));
+	const __m128 maxX		= _mm_set1_ps(static_cast< float >(maxX_));
+	const __m128 step		= _mm_set1_ps(4.0f);
+
+	int32_t x				= minX_ & ~3;
+	__m128 px				= _mm_add_ps(_mm_set1_ps(static_cast< float >(x)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+	for (; x < maxX_; x += 4) {
+
+		__m128 farther		= _mm_cmpge_ps(_mm_loadu_ps(row_ + x), depth);
+		farther				= _mm_and_ps(farther, _mm_and_ps(_mm_cmpge_ps(px, minX), _mm_cmplt_ps(px, maxX)));
+		if (_mm_movemask_ps(farther) != 0) {
+
+			return true;
+
+		}
+		px					= _mm_add_ps(px, step);
+
+	}
+	return false;
+
+}
+
+static const OcclusionKernels sse2Kernels = {
+
+	rasterizeRowSse2,
+	anyFartherSse2
+
+};
+
+/*
+*	AVX2 kernels, eight pixels per step
+*/
+SIMD_TARGET_AVX2 static void rasterizeRowAvx2(const float* edgeA_, const float* rowC_, float maxDepth_, int32_t minX_, int32_t maxX_, float* row_) {
+
+	const __m256 zero		= _mm256_setzero_ps();
+	const __m256 a0			= _mm256_set1_ps(edgeA_[0]);
+	const __m256 a1			= _mm256_set1_ps(edgeA_[1]);
+	const __m256 a2			= _mm256_set1_ps(edgeA_[2]);
+	const __m256 az			= _mm256_set1_ps(edgeA_[3]);
+	const __m256 c0			= _mm256_set1_ps(rowC_[0]);
+	const __m256 c1			= _mm256_set1_ps(rowC_[1]);
+	const __m256 c2			= _mm256_set1_ps(rowC_[2]);
+	const __m256 cz			= _mm256_set1_ps(rowC_[3]);
+	const __m256 maxDepth	= _mm256_set1_ps(maxDepth_);
+	const __m256 step		= _mm256_set1_ps(8.0f);
+
+	int32_t x				= minX_ & ~7;
+	__m256 px				= _mm256_add_ps(_mm256_set1_ps(static_cast< float >(x)), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+	for (; x < maxX_; x += 8) {
+
+		__m256 inside		= _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), c0), zero, _CMP_GE_OQ);
+		inside				= _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), c1), zero, _CMP_GE_OQ));
+		inside				= _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), c2), zero, _CMP_GE_OQ));
+		if (_mm256_movemask_ps(inside) != 0) {
+
+			__m256 depth	= _mm256_loadu_ps(row_ + x);
+			__m256 z		= _mm256_min_ps(_mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(az, px), cz), maxDepth), depth);
+			_mm256_storeu_ps(row_ + x, _mm256_blendv_ps(depth, z, inside));
+
+		}
+		px					= _mm256_add_ps(px, step);
+
+	}
+
+}
+
+SIMD_TARGET_AVX2 static bool anyFartherAvx2(const float* row_, int32_t minX_, int32_t maxX_, float depth_) {
+
+	const __m256 depth		= _mm256_set1_ps(depth_);
+	const __m256 minX		= _mm256_set1_ps(static_cast< float >(minX_));
+	const __m256 maxX		= _mm256_set1_ps(static_cast< float >(maxX_));
+	const __m256 step		= _mm256_set1_ps(8.0f);
+
+	int32_t x				= minX_ & ~7;
+	__m256 px				= _mm256_add_ps(_mm256_set1_ps(static_cast< float >(x)), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+	for (; x < maxX_; x += 8) {
+
+		__m256 farther		= _mm256_cmp_ps(_mm256_loadu_ps(row_ + x), depth, _CMP_GE_OQ);
+		farther				= _mm256_and_ps(farther, _mm256_and_ps(_mm256_cmp_ps(px, minX, _CMP_GE_OQ), _mm256_cmp_ps(px, maxX, _CMP_LT_OQ)));
+		if (_mm256_movemask_ps(farther) != 0) {
+
+			return true;
+
+		}
+		px					= _mm256_add_ps(px, step);
+
+	}
+	return false;
+
+}
+
+static const OcclusionKernels avx2Kernels = {
+
+	rasterizeRowAvx2,
+	anyFartherAvx2
+
+};
+#endif
+
+/*
+*	Function:		const OcclusionKernels& getKernels()
+*	Purpose:		Returns the kernels of the path SimdMath runs on, there are no NEON kernels yet so ARM uses scalar
+*
+*/
+static const OcclusionKernels& getKernels(void) {
+
+#if defined SOFTWARE_OCCLUSION_X86
+	switch (SimdMath::getPath()) {
+
+	case SIMD_PATH_AVX2:
+		return avx2Kernels;
+	case SIMD_PATH_SSE2:
+		return sse2Kernels;
+	default:
+		break;
+
+	}
+#endif
+	return scalarKernels;
+
+}
+
+/*
+*	Function:		SoftwareOcclusion()
+*	Purpose:		Default constructor
+*
+*/
+SoftwareOcclusion::SoftwareOcclusion(void) : viewProjection(1.0f) {
+
+	resize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	resetStats();
+
+}
+
+/*
+*	Function:		void resize(uint32_t width_, uint32_t height_)
+*	Purpose:		Sets the buffer size, rounded up to whole tiles, and clears it
+*
+*/
+void SoftwareOcclusion::resize(uint32_t width_, uint32_t height_) {
+
+	tilesX		= std::max((width_ + TILE_WIDTH - 1) / TILE_WIDTH, 1u);
+	tilesY		= std::max((height_ + TILE_HEIGHT - 1) / TILE_HEIGHT, 1u);
+	width		= tilesX * TILE_WIDTH;
+	height		= tilesY * TILE_HEIGHT;
+	depth.assign(static_cast< size_t >(width) * height, 1.0f);
+	tileMaxDepth.assign(static_cast< size_t >(tilesX) * tilesY, 1.0f);
+
+}
+
+/*
+*	Function:		void render(
+*
+*						JobSystem&						jobSystem_,
+*						const glm::mat4&				viewProjection_,
+*						const OccluderInstance*			occluders_,
+*						size_t							count_
+*
+*					)
+*	Purpose:		Clears the buffer and rasterises the occluders into it as seen through viewProjection_
+*					The occluders are projected in parallel first, then every worker rasterises all triangles into its own tile rows
+*
+*/
+void SoftwareOcclusion::render(
+
+	JobSystem&						jobSystem_,
+	const glm::mat4&				viewProjection_,
+	const OccluderInstance*			occluders_,
+	size_t							count_
+
+) {
+
+	auto start			= std::chrono::high_resolution_clock::now();
+	viewProjection		= viewProjection_;
+
+	// every occluder writes its triangles to its own range, no locking needed
+	triangleOffsets.resize(count_ + 1);
+	triangleOffsets[0]	= 0;
+	for (size_t i = 0; i < count_; i++) {
+
+		triangleOffsets[i + 1] = triangleOffsets[i] + occluders_[i].mesh->indices.size() / 3;
+
+	}
+	triangles.resize(triangleOffsets[count_]);
+
+	JobCounter setupCounter;
+	jobSystem_.parallelFor(0, count_, OCCLUDER_GRAIN_SIZE, [this, occluders_] (size_t first_, size_t last_) {
+
+		for (size_t i = first_; i < last_; i++) {
+
+			setupTriangles(occluders_[i], triangles.data() + triangleOffsets[i]);
+
+		}
+
+	}, &setupCounter);
+	jobSystem_.wait(&setupCounter);
+
+	// one contiguous set of tile rows per worker, no two workers ever touch the same pixel
+	size_t rowsPerWorker	= std::max< size_t >((tilesY + jobSystem_.getNumWorkers() - 1) / jobSystem_.getNumWorkers(), 1);
+	JobCounter rasterCounter;
+	jobSystem_.parallelFor(0, tilesY, rowsPerWorker, [this] (size_t first_, size_t last_) {
+
+		rasterizeTileRows(static_cast< uint32_t >(first_), static_cast< uint32_t >(last_));
+
+	}, &rasterCounter);
+	jobSystem_.wait(&rasterCounter);
+
+	auto end			= std::chrono::high_resolution_clock::now();
+	totalTriangles		+= static_cast< double >(triangles.size());
+	totalRasterTime		+= std::chrono::duration< double >(end - start).count();
+	frames++;
+
+}
+
+/*
+*	Function:		void setupTriangles(const OccluderInstance& occluder_, Triangle* triangles_)
+*	Purpose:		Projects the triangles of one occluder and writes their edge functions, depth planes and pixel bounds
+*					Triangles reaching behind the camera plane are dropped instead of clipped, losing an occluder only costs culling
+*
+*/
+void SoftwareOcclusion::setupTriangles(const OccluderInstance& occluder_, Triangle* triangles_) const {
+
+	const OccluderMesh& mesh	= *occluder_.mesh;
+	glm::mat4 worldViewProjection	= viewProjection * occluder_.world;
+
+	std::vector< glm::vec4 > projected(mesh.positions.size());
+	for (size_t i = 0; i < mesh.positions.size(); i++) {
+
+		glm::vec4 clip		= worldViewProjection * glm::vec4(mesh.positions[i], 1.0f);
+		if (clip.w <= MIN_W || clip.z < 0.0f) {
+
+			// w marks a vertex that cannot be projected
+			projected[i]	= glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			continue;
+
+		}
+		// the projection already flips y, so normalized device coordinates map to pixels directly
+		projected[i]		= glm::vec4(
+
+			(clip.x / clip.w * 0.5f + 0.5f) * width,
+			(clip.y / clip.w * 0.5f + 0.5f) * height,
+			clip.z / clip.w,
+			1.0f
+
+		);
+
+	}
+
+	for (size_t t = 0; t < mesh.indices.size() / 3; t++) {
+
+		Triangle& triangle	= triangles_[t];
+		triangle.minX		= 0;
+		triangle.maxX		= 0;
+		triangle.minY		= 0;
+		triangle.maxY		= 0;
+
+		glm::vec4 v0		= projected[mesh.indices[3 * t]];
+		glm::vec4 v1		= projected[mesh.indices[3 * t + 1]];
+		glm::vec4 v2		= projected[mesh.indices[3 * t + 2]];
+		if (v0.w < 0.0f || v1.w < 0.0f || v2.w < 0.0f) {
+
+			continue;
+
+		}
+
+		// both windings are rasterised, swap to make the area positive
+		float area			= (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (area < 0.0f) {
+
+			std::swap(v1, v2);
+			area			= -area;
+
+		}
+		if (area < 1e-6f) {
+
+			continue;
+
+		}
+
+		triangle.minX		= std::max(static_cast< int32_t >(std::floor(std::min(std::min(v0.x, v1.x), v2.x))), 0);
+		triangle.maxX		= std::min(static_cast< int32_t >(std::ceil(std::max(std::max(v0.x, v1.x), v2.x))), static_cast< int32_t >(width));
+		triangle.minY		= std::max(static_cast< int32_t >(std::floor(std::min(std::min(v0.y, v1.y), v2.y))), 0);
+		triangle.maxY		= std::min(static_cast< int32_t >(std::ceil(std::max(std::max(v0.y, v1.y), v2.y))), static_cast< int32_t >(height));
+		if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) {
+
+			triangle.maxX	= triangle.minX;
+			triangle.maxY	= triangle.minY;
+			continue;
+
+		}
+
+		// the edge from vi to vj is positive on the side of the third vertex
+		const glm::vec4* vertices[3] = { &v0, &v1, &v2 };
+		for (int e = 0; e < 3; e++) {
+
+			const glm::vec4& vi	= *vertices[e];
+			const glm::vec4& vj	= *vertices[(e + 1) % 3];
+			triangle.edgeA[e]	= vi.y - vj.y;
+			triangle.edgeB[e]	= vj.x - vi.x;
+			triangle.edgeC[e]	= (vj.y - vi.y) * vi.x - (vj.x - vi.x) * vi.y;
+
+		}
+
+		triangle.depthA		= ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		triangle.depthB		= ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		triangle.depthC		= v0.z - triangle.depthA * v0.x - triangle.depthB * v0.y;
+		triangle.maxDepth	= std::max(std::max(v0.z, v1.z), v2.z);
+
+	}
+
+}
+
+/*
+*	Function:		void rasterizeTileRows(uint32_t firstTileRow_, uint32_t lastTileRow_)
+*	Purpose:		Clears the tile rows [firstTileRow_, lastTileRow_), rasterises every triangle overlapping them and updates their tile depths
+*
+*/
+void SoftwareOcclusion::rasterizeTileRows(uint32_t firstTileRow_, uint32_t lastTileRow_) {
+
+	const OcclusionKernels& kernels = getKernels();
+	int32_t firstRow	= static_cast< int32_t >(firstTileRow_ * TILE_HEIGHT);
+	int32_t lastRow		= static_cast< int32_t >(lastTileRow_ * TILE_HEIGHT);
+	std::fill(depth.begin() + static_cast< size_t >(firstRow) * width, depth.begin() + static_cast< size_t >(lastRow) * width, 1.0f);
+
+	for (const Triangle& triangle : triangles) {
+
+		int32_t minY	= std::max(triangle.minY, firstRow);
+		int32_t maxY	= std::min(triangle.maxY, lastRow);
+		if (minY >= maxY || triangle.minX >= triangle.maxX) {
+
+			continue;
+
+		}
+
+		float edgeA[4]	= { triangle.edgeA[0], triangle.edgeA[1], triangle.edgeA[2], triangle.depthA };
+		for (int32_t y = minY; y < maxY; y++) {
+
+			float py		= static_cast< float >(y) + 0.5f;
+			float rowC[4]	= {
+
+				triangle.edgeB[0] * py + triangle.edgeC[0],
+				triangle.edgeB[1] * py + triangle.edgeC[1],
+				triangle.edgeB[2] * py + triangle.edgeC[2],
+				triangle.depthB * py + triangle.depthC
+
+			};
+			kernels.rasterizeRow(edgeA, rowC, triangle.maxDepth, triangle.minX, triangle.maxX, depth.data() + static_cast< size_t >(y) * width);
+
+		}
+
+	}
+
+	for (uint32_t tileY = firstTileRow_; tileY < lastTileRow_; tileY++) {
+
+		for (uint32_t tileX = 0; tileX < tilesX; tileX++) {
+
+			float maxDepth = 0.0f;
+			for (uint32_t y = tileY * TILE_HEIGHT; y < (tileY + 1) * TILE_HEIGHT; y++) {
+
+				const float* row = depth.data() + static_cast< size_t >(y) * width + tileX * TILE_WIDTH;
+				maxDepth = std::max(maxDepth, *std::max_element(row, row + TILE_WIDTH));
+
+			}
+			tileMaxDepth[tileY * tilesX + tileX] = maxDepth;
+
+		}
+
+	}
+
+}
+
+/*
+*	Function:		bool isOccluded(const Bounds& bounds_)
+*	Purpose:		Returns whether the screen rectangle of bounds_ lies behind the occluders everywhere
+*					Tiles whose farthest depth is nearer than the bounds are passed without looking at their pixels
+*
+*/
+bool SoftwareOcclusion::isOccluded(const Bounds& bounds_) const {
+
+	glm::vec2 minCorner		= glm::vec2(1.0f);
+	glm::vec2 maxCorner		= glm::vec2(-1.0f);
+	float minDepth			= 1.0f;
+	for (int i = 0; i < 8; i++) {
+
+		glm::vec3 corner	= bounds_.center + bounds_.extents * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		glm::vec4 clip		= viewProjection * glm::vec4(corner, 1.0f);
+		if (clip.w <= MIN_W || clip.z < 0.0f) {
+
+			return false;
+
+		}
+
+		glm::vec3 ndc		= glm::vec3(clip) / clip.w;
+		minCorner			= glm::min(minCorner, glm::vec2(ndc));
+		maxCorner			= glm::max(maxCorner, glm::vec2(ndc));
+		minDepth			= std::min(minDepth, ndc.z);
+
+	}
+
+	int32_t minX			= std::max(static_cast< int32_t >(std::floor((minCorner.x * 0.5f + 0.5f) * width)), 0);
+	int32_t maxX			= std::min(static_cast< int32_t >(std::ceil((maxCorner.x * 0.5f + 0.5f) * width)), static_cast< int32_t >(width));
+	int32_t minY			= std::max(static_cast< int32_t >(std::floor((minCorner.y * 0.5f + 0.5f) * height)), 0);
+	int32_t maxY			= std::min(static_cast< int32_t >(std::ceil((maxCorner.y * 0.5f + 0.5f) * height)), static_cast< int32_t >(height));
+	if (minX >= maxX || minY >= maxY) {
+
+		// off screen, that is for the frustum test to decide
+		return false;
+
+	}
+
+	const OcclusionKernels& kernels = getKernels();
+	for (int32_t tileY = minY / static_cast< int32_t >(TILE_HEIGHT); tileY <= (maxY - 1) / static_cast< int32_t >(TILE_HEIGHT); tileY++) {
+
+		for (int32_t tileX = minX / static_cast< int32_t >(TILE_WIDTH); tileX <= (maxX - 1) / static_cast< int32_t >(TILE_WIDTH); tileX++) {
+
+			if (tileMaxDepth[tileY * tilesX + tileX] < minDepth) {
+
+				continue;
+
+			}
+
+			int32_t firstX	= std::max(minX, tileX * static_cast< int32_t >(TILE_WIDTH));
+			int32_t lastX	= std::min(maxX, (tileX + 1) * static_cast< int32_t >(TILE_WIDTH));
+			int32_t firstY	= std::max(minY, tileY * static_cast< int32_t >(TILE_HEIGHT));
+			int32_t lastY	= std::min(maxY, (tileY + 1) * static_cast< int32_t >(TILE_HEIGHT));
+			for (int32_t y = firstY; y < lastY; y++) {
+
+				if (kernels.anyFarther(depth.data() + static_cast< size_t >(y) * width, firstX, lastX, minDepth)) {
+
+					return false;
+
+				}
+
+			}
+
+		}
+
+	}
+	return true;
+
+}
+
+/*
+*	Function:		uint32_t cull(
+*
+*						JobSystem&						jobSystem_,
+*						const Bounds*					bounds_,
+*						std::vector< uint32_t >&		items_
+*
+*					)
+*	Purpose:		Removes the items whose bounds_ are occluded, keeping the order of the rest, and returns how many were removed
+*
+*/
+uint32_t SoftwareOcclusion::cull(
+
+	JobSystem&						jobSystem_,
+	const Bounds*					bounds_,
+	std::vector< uint32_t >&		items_
+
+) {
+
+	auto start			= std::chrono::high_resolution_clock::now();
+	occluded.resize(items_.size());
+
+	JobCounter counter;
+	jobSystem_.parallelFor(0, items_.size(), TEST_GRAIN_SIZE, [this, bounds_, &items_] (size_t first_, size_t last_) {
+
+		for (size_t i = first_; i < last_; i++) {
+
+			occluded[i] = isOccluded(bounds_[items_[i]]) ? 1 : 0;
+
+		}
+
+	}, &counter);
+	jobSystem_.wait(&counter);
+
+	size_t kept			= 0;
+	for (size_t i = 0; i < items_.size(); i++) {
+
+		if (!occluded[i]) {
+
+			items_[kept++] = items_[i];
+
+		}
+
+	}
+	uint32_t removed	= static_cast< uint32_t >(items_.size() - kept);
+	totalTested			+= static_cast< double >(items_.size());
+	totalOccluded		+= static_cast< double >(removed);
+	items_.resize(kept);
+
+	auto end			= std::chrono::high_resolution_clock::now();
+	totalTestTime		+= std::chrono::duration< double >(end - start).count();
+	return removed;
+
+}
+
+/*
+*	Function:		uint32_t getWidth()
+*	Purpose:		Returns the width of the buffer in pixels
+*
+*/
+uint32_t SoftwareOcclusion::getWidth(void) const {
+
+	return width;
+
+}
+
+/*
+*	Function:		uint32_t getHeight()
+*	Purpose:		Returns the height of the buffer in pixels
+*
+*/
+uint32_t SoftwareOcclusion::getHeight(void) const {
+
+	return height;
+
+}
+
+/*
+*	Function:		const float* getDepth()
+*	Purpose:		Returns the row major depth buffer of the last render, 1.0 where no occluder was drawn
+*
+*/
+const float* SoftwareOcclusion::getDepth(void) const {
+
+	return depth.data();
+
+}
+
+/*
+*	Function:		SoftwareOcclusionStats getStats()
+*	Purpose:		Returns the per frame averages since the last resetStats()
+*
+*/
+SoftwareOcclusionStats SoftwareOcclusion::getStats(void) const {
+
+	SoftwareOcclusionStats stats;
+	double count			= frames > 0 ? static_cast< double >(frames) : 1.0;
+	stats.averageTriangles	= totalTriangles / count;
+	stats.averageTested		= totalTested / count;
+	stats.averageOccluded	= totalOccluded / count;
+	stats.averageRasterTime	= totalRasterTime / count;
+	stats.averageTestTime	= totalTestTime / count;
+	stats.frames			= frames;
+	return stats;
+
+}
+
+/*
+*	Function:		void resetStats()
+*	Purpose:		Starts a new measuring period
+*
+*/
+void SoftwareOcclusion::resetStats(void) {
+
+	totalTriangles		= 0.0;
+	totalTested			= 0.0;
+	totalOccluded		= 0.0;
+	totalRasterTime		= 0.0;
+	totalTestTime		= 0.0;
+	frames				= 0;
+
+}
+
+/*
+*	Function:		void benchmark(JobSystem& jobSystem_)
+*	Purpose:		Renders a wall of box occluders and tests scattered boxes behind and in front of it on every path the CPU supports
+*					Prints rasterisation and test cost, the culling rate and how many results differ from the scalar path
+*
+*/
+void SoftwareOcclusion::benchmark(JobSystem& jobSystem_) {
+
+	SimdPath previousPath	= SimdMath::getPath();
+	const size_t counts[]	= { 1000, 10000, 100000 };
+	const SimdPath paths[]	= { SIMD_PATH_SCALAR, SIMD_PATH_SSE2, SIMD_PATH_AVX2 };
+	const int runs			= 20;
+
+	// same camera as the SimdMath benchmark, looking down +x with z up
+	glm::mat4 projection	= glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	projection[1][1]		*= -1;
+	glm::mat4 cameraViewProjection = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	// a wall of boxes at x = 20 with a few holes, covering most of the view
+	OccluderMesh box		= OccluderMesh::fromBox(glm::vec3(-0.5f), glm::vec3(0.5f));
+	std::vector< OccluderInstance > occluders;
+	for (int y = -8; y <= 8; y++) {
+
+		for (int z = -5; z <= 5; z++) {
+
+			if ((y + z) % 5 == 0) {
+
+				continue;
+
+			}
+			glm::mat4 world = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, y * 3.0f, z * 3.0f)), glm::vec3(1.0f, 3.0f, 3.0f));
+			occluders.push_back({ &box, world });
+
+		}
+
+	}
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution< float > distanceDistribution(2.0f, 60.0f);
+	std::uniform_real_distribution< float > sideDistribution(-0.9f, 0.9f);
+	std::uniform_real_distribution< float > sizeDistribution(0.1f, 1.0f);
+
+	std::cout << "Software occlusion benchmark, " << occluders.size() << " occluders, " << occluders.size() * 12 << " triangles" << std::endl;
+
+	SoftwareOcclusion occlusion;
+	for (size_t count : counts) {
+
+		// scattered inside the view cone, roughly two thirds behind the wall
+		std::vector< Bounds > bounds(count);
+		std::vector< uint32_t > all(count);
+		for (size_t i = 0; i < count; i++) {
+
+			float distance		= distanceDistribution(random);
+			bounds[i]			= Bounds::fromMinMax(glm::vec3(-0.5f), glm::vec3(0.5f));
+			bounds[i].center	= glm::vec3(distance, sideDistribution(random) * distance, sideDistribution(random) * distance * 9.0f / 16.0f);
+			bounds[i].extents	*= sizeDistribution(random);
+			bounds[i].radius	= glm::length(bounds[i].extents);
+			all[i]				= static_cast< uint32_t >(i);
+
+		}
+
+		std::vector< uint8_t > reference(count);
+		for (SimdPath path : paths) {
+
+			// paths the CPU lacks fall back to scalar, which was measured already
+			SimdMath::setPath(path);
+			if (SimdMath::getPath() != path) {
+
+				continue;
+
+			}
+
+			occlusion.resetStats();
+			std::vector< uint32_t > items;
+			for (int run = 0; run < runs; run++) {
+
+				occlusion.render(jobSystem_, cameraViewProjection, occluders.data(), occluders.size());
+				items = all;
+				occlusion.cull(jobSystem_, bounds.data(), items);
+
+			}
+			SoftwareOcclusionStats stats = occlusion.getStats();
+
+			std::vector< uint8_t > visible(count, 0);
+			for (uint32_t item : items) {
+
+				visible[item] = 1;
+
+			}
+			size_t mismatches = 0;
+			if (path == SIMD_PATH_SCALAR) {
+
+				reference = visible;
+
+			}
+			else {
+
+				for (size_t i = 0; i < count; i++) {
+
+					mismatches += reference[i] != visible[i] ? 1 : 0;
+
+				}
+
+			}
+
+			std::cout << "  " << count << "\t" << SimdMath::getPathName(path) << ":\traster " << 1000.0 * stats.averageRasterTime << " ms, test "
+				<< 1e9 * stats.averageTestTime / count << " ns per object, occluded " << 100.0 * stats.averageOccluded / count << "%, "
+				<< mismatches << " differ from scalar" << std::endl;
+
+		}
+
+	}
+
+	SimdMath::setPath(previousPath);
+
+}
+
+/*
+*	Function:		~SoftwareOcclusion()
+*	Purpose:		Default destructor
+*
+*/
+SoftwareOcclusion::~SoftwareOcclusion() {
+
+
+
+}
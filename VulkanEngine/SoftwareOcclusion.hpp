@@ -0,0 +1,104 @@
+/*
+*	File:		SoftwareOcclusion.hpp
+*
+*
+*/
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.cpp"
+#include "OccluderMesh.cpp"
+#include "JobSystem.hpp"
+
+struct SoftwareOcclusionStats {
+
+	double			averageTriangles;			// occluder triangles rasterised per frame
+	double			averageTested;				// bounds tested per frame
+	double			averageOccluded;			// bounds found hidden per frame
+	double			averageRasterTime;			// seconds spent rasterising per frame
+	double			averageTestTime;			// seconds spent testing per frame
+	uint64_t		frames;
+
+};
+
+/*
+*	Class:			SoftwareOcclusion
+*	Purpose:		Low resolution depth buffer the occluders are rasterised into on the CPU, bounds are then tested against it before anything is recorded
+*					The buffer is split into tiles of 32x8 pixels that also keep their farthest depth, so most tests never look at single pixels
+*					Every worker rasterises and owns a contiguous set of tile rows, the widest instruction set SimdMath picked does the pixel work
+*
+*/
+class SoftwareOcclusion {
+public:
+	SoftwareOcclusion(void);
+	void resize(uint32_t width_, uint32_t height_);
+	void render(
+
+		JobSystem&						jobSystem_,
+		const glm::mat4&				viewProjection_,
+		const OccluderInstance*			occluders_,
+		size_t							count_
+
+	);
+	bool isOccluded(const Bounds& bounds_) const;
+	uint32_t cull(
+
+		JobSystem&						jobSystem_,
+		const Bounds*					bounds_,
+		std::vector< uint32_t >&		items_
+
+	);
+	uint32_t getWidth(void) const;
+	uint32_t getHeight(void) const;
+	const float* getDepth(void) const;
+	SoftwareOcclusionStats getStats(void) const;
+	void resetStats(void);
+	static void benchmark(JobSystem& jobSystem_);
+	~SoftwareOcclusion();
+private:
+	/*
+	*	Screen space triangle, the edge functions are non-negative inside and depth is a plane over the pixel centers
+	*	An empty row range marks a triangle that was clipped away
+	*/
+	struct Triangle {
+
+		float			edgeA[3];
+		float			edgeB[3];
+		float			edgeC[3];
+		float			depthA;
+		float			depthB;
+		float			depthC;
+		float			maxDepth;
+		int32_t			minX;
+		int32_t			maxX;
+		int32_t			minY;
+		int32_t			maxY;
+
+	};
+
+	uint32_t									width;
+	uint32_t									height;
+	uint32_t									tilesX;
+	uint32_t									tilesY;
+	glm::mat4									viewProjection;
+	std::vector< float >						depth;
+	std::vector< float >						tileMaxDepth;
+	std::vector< Triangle >						triangles;
+	std::vector< size_t >						triangleOffsets;
+	std::vector< uint8_t >						occluded;
+	double										totalTriangles;
+	double										totalTested;
+	double										totalOccluded;
+	double										totalRasterTime;
+	double										totalTestTime;
+	uint64_t									frames;
+
+	void setupTriangles(const OccluderInstance& occluder_, Triangle* triangles_) const;
+	void rasterizeTileRows(uint32_t firstTileRow_, uint32_t lastTileRow_);
+
+};
@@ -0,0 +1,79 @@
+/*
+*	File:		TripleBuffer.hpp
+*
+*
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/*
+*	Class:			TripleBuffer
+*	Purpose:		Lock-free handoff of values from one writer thread to one reader thread; the reader always sees the latest complete value
+*
+*/
+template< typename T >
+class TripleBuffer {
+public:
+	/*
+	*	Function:		T& back()
+	*	Purpose:		Returns the slot the writer may fill, only to be called by the writer
+	*
+	*/
+	T& back(void) {
+
+		return buffers[backIndex];
+
+	}
+
+	/*
+	*	Function:		void publish()
+	*	Purpose:		Hands the back slot to the reader and takes over the previous middle slot
+	*
+	*/
+	void publish(void) {
+
+		uint8_t previous	= middle.exchange(static_cast< uint8_t >(backIndex | DIRTY_BIT), std::memory_order_acq_rel);
+		backIndex			= previous & INDEX_MASK;
+
+	}
+
+	/*
+	*	Function:		bool update()
+	*	Purpose:		Swaps in the newest published value if there is one, only to be called by the reader
+	*
+	*/
+	bool update(void) {
+
+		if ((middle.load(std::memory_order_relaxed) & DIRTY_BIT) == 0) {
+
+			return false;
+
+		}
+		uint8_t previous	= middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex			= previous & INDEX_MASK;
+		return true;
+
+	}
+
+	/*
+	*	Function:		const T& front()
+	*	Purpose:		Returns the value the reader currently owns
+	*
+	*/
+	const T& front(void) const {
+
+		return buffers[frontIndex];
+
+	}
+
+private:
+	static const uint8_t		INDEX_MASK		= 0x3;
+	static const uint8_t		DIRTY_BIT		= 0x4;
+
+	T							buffers[3];
+	std::atomic< uint8_t >		middle{ 1 };
+	uint8_t						backIndex		= 0;
+	uint8_t						frontIndex		= 2;
+
+};
@@ -3,7 +3,6 @@
 #include <glm/glm.hpp>
 struct UniformBufferObject {
 
-	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
 
@@ -14,4 +14,20 @@
 //#define GAME_USE_FRAMERATE_CAP_60				// use a framerate cap
 //#define GAME_NO_FRAMERATE_CAP					// dont use a framerate cap to prevent screen tearing in borderless window and fullscreen mode
 
+#define GAME_FRAMES_IN_FLIGHT 2				// number of frames the CPU may record ahead of the GPU in the high throughput profile (2 or 3)
+
+//#define GAME_PRESENT_PROFILE_LOW_LATENCY		// start with MAILBOX / IMMEDIATE presentation and one frame in flight
+#define GAME_PRESENT_PROFILE_HIGH_THROUGHPUT	// start with FIFO presentation, three swapchain images and GAME_FRAMES_IN_FLIGHT frames in flight
+#define GAME_SIMULATION_TICK_RATE 120		// fixed number of simulation updates per second
+//#define GAME_RENDER_ON_DEMAND				// only render when input, camera, animation or loading changed the image (viewer / kiosk mode)
+//#define GAME_BENCHMARK_SIMD				// time the SIMD math kernels against GLM at 1k, 10k and 100k transforms on startup
+//#define GAME_GPU_DRIVEN_RENDERING			// cull on the GPU and draw with indirect commands, CPU recording no longer depends on the entity count
+//#define GAME_OCCLUSION_CULLING			// also cull against a hierarchical depth buffer of what was visible last frame (needs GAME_GPU_DRIVEN_RENDERING)
+//#define GAME_SOFTWARE_OCCLUSION_CULLING	// cull against occluders rasterised on the CPU, for the CPU culling path without GPU readback
+//#define GAME_BENCHMARK_OCCLUSION			// time the software occlusion culling at 1k, 10k and 100k objects on startup
+#define GAME_BINDLESS_DESCRIPTORS			// let the descriptor heap use VK_EXT_descriptor_indexing where supported, fixed size arrays otherwise
+//#define GAME_DEMO_LIGHTS 256				// scatter this many point lights around the chalet besides the animated one
+//#define GAME_BENCHMARK_LIGHTING			// time clustered against all-lights shading at 1 to 1024 lights on startup
+//#define GAME_DEFERRED_SHADING				// render through a G-buffer and light every pixel once instead of every fragment, without MSAA and occlusion culling
+
 #define GAME_USE_TINY_OBJ					// sets the importer library to be tiny_obj_loader instead of ASSIMP
\ No newline at end of file
@@ -0,0 +1,20 @@
+/*
+*	File:		VulkanHandle.cpp
+*
+*
+*/
+#include "VulkanHandle.hpp"
+#include "Engine.hpp"
+
+extern Engine engine;
+
+/*
+*	Function:		void retireVulkanHandle(std::function< void() > deleter_)
+*	Purpose:		Hands a destruction to the engine's deletion queue
+*
+*/
+void retireVulkanHandle(std::function< void() > deleter_) {
+
+	engine.retire(deleter_);
+
+}
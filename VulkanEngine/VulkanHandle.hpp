@@ -0,0 +1,158 @@
+/*
+*	File:		VulkanHandle.hpp
+*
+*
+*/
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <functional>
+
+/*
+*	Function:		void retireVulkanHandle(std::function< void() > deleter_)
+*	Purpose:		Hands a destruction to the engine's deletion queue, defined in VulkanHandle.cpp
+*
+*/
+void retireVulkanHandle(std::function< void() > deleter_);
+
+/*
+*	Class:			UniqueHandle
+*	Purpose:		Move-only owner of a non-dispatchable Vulkan handle, destroyed through Destroy once no frame in flight uses it anymore
+*
+*/
+template< typename T, void (VKAPI_PTR* Destroy)(VkDevice, T, const VkAllocationCallbacks*) >
+class UniqueHandle {
+public:
+	UniqueHandle(void) : device(VK_NULL_HANDLE), handle(VK_NULL_HANDLE) {
+
+
+
+	}
+
+	UniqueHandle(VkDevice device_, T handle_) : device(device_), handle(handle_) {
+
+
+
+	}
+
+	UniqueHandle(const UniqueHandle&) = delete;
+	UniqueHandle& operator=(const UniqueHandle&) = delete;
+
+	UniqueHandle(UniqueHandle&& other_) : device(other_.device), handle(other_.release()) {
+
+
+
+	}
+
+	UniqueHandle& operator=(UniqueHandle&& other_) {
+
+		if (this != &other_) {
+
+			reset();
+			device	= other_.device;
+			handle	= other_.release();
+
+		}
+		return *this;
+
+	}
+
+	/*
+	*	Function:		T get()
+	*	Purpose:		Returns the raw handle without giving up ownership
+	*
+	*/
+	T get(void) const {
+
+		return handle;
+
+	}
+
+	/*
+	*	Function:		const T* address()
+	*	Purpose:		Returns a pointer to the raw handle for functions taking arrays of handles
+	*
+	*/
+	const T* address(void) const {
+
+		return &handle;
+
+	}
+
+	operator T(void) const {
+
+		return handle;
+
+	}
+
+	/*
+	*	Function:		T& replace(VkDevice device_)
+	*	Purpose:		Retires the current handle and returns the empty slot to be filled by a create function
+	*
+	*/
+	T& replace(VkDevice device_) {
+
+		reset();
+		device = device_;
+		return handle;
+
+	}
+
+	/*
+	*	Function:		T release()
+	*	Purpose:		Gives up ownership without destroying the handle
+	*
+	*/
+	T release(void) {
+
+		T released	= handle;
+		handle		= VK_NULL_HANDLE;
+		return released;
+
+	}
+
+	/*
+	*	Function:		void reset()
+	*	Purpose:		Retires the handle, it is destroyed once the GPU is done with it
+	*
+	*/
+	void reset(void) {
+
+		if (handle != VK_NULL_HANDLE) {
+
+			VkDevice retiredDevice	= device;
+			T retiredHandle			= handle;
+			retireVulkanHandle([=] () {
+
+				Destroy(retiredDevice, retiredHandle, nullptr);
+
+			});
+			handle = VK_NULL_HANDLE;
+
+		}
+
+	}
+
+	~UniqueHandle() {
+
+		reset();
+
+	}
+
+private:
+	VkDevice		device;
+	T				handle;
+
+};
+
+typedef UniqueHandle< VkBuffer, vkDestroyBuffer >						UniqueBuffer;
+typedef UniqueHandle< VkDeviceMemory, vkFreeMemory >					UniqueDeviceMemory;
+typedef UniqueHandle< VkImage, vkDestroyImage >							UniqueImage;
+typedef UniqueHandle< VkImageView, vkDestroyImageView >					UniqueImageView;
+typedef UniqueHandle< VkSampler, vkDestroySampler >						UniqueSampler;
+typedef UniqueHandle< VkPipeline, vkDestroyPipeline >					UniquePipeline;
+typedef UniqueHandle< VkPipelineLayout, vkDestroyPipelineLayout >		UniquePipelineLayout;
+typedef UniqueHandle< VkDescriptorPool, vkDestroyDescriptorPool >		UniqueDescriptorPool;
+typedef UniqueHandle< VkDescriptorSetLayout, vkDestroyDescriptorSetLayout >	UniqueDescriptorSetLayout;
+typedef UniqueHandle< VkCommandPool, vkDestroyCommandPool >				UniqueCommandPool;
+typedef UniqueHandle< VkQueryPool, vkDestroyQueryPool >					UniqueQueryPool;
@@ -0,0 +1,3 @@
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.comp
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DOCCLUSION_CULLING shader.comp -o occlusion.spv
+pause
\ No newline at end of file
@@ -0,0 +1,3 @@
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.vert
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.frag
+pause
\ No newline at end of file
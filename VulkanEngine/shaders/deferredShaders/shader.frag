@@ -0,0 +1,137 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 1, binding = 0) uniform UniformBufferObject {
+
+	mat4 inverseView;
+	mat4 inverseProj;
+
+} ubo;
+
+layout(set = 1, binding = 1) uniform LightingUniformBuffer {
+
+	vec4 ambientColor;
+	vec4 viewPos;
+	vec4 clusterScale;		// x and y are clusters per pixel, the depth slice is log(depth) * z + w
+	uvec4 clusterCounts;
+
+} lbo;
+
+// the G-buffer of the geometry subpass, read at this very pixel
+layout(input_attachment_index = 0, set = 1, binding = 2) uniform subpassInput gBufferDepth;
+layout(input_attachment_index = 1, set = 1, binding = 3) uniform subpassInput gBufferAlbedo;
+layout(input_attachment_index = 2, set = 1, binding = 4) uniform subpassInput gBufferNormal;
+
+struct PointLight {
+
+	vec3 position;
+	float radius;
+	vec3 color;
+	float intensity;
+
+};
+
+layout(std430, set = 1, binding = 7) readonly buffer PointLightBuffer {
+
+	PointLight lights[];
+
+} pointLights;
+
+// offset into the light indices and light count of every cluster
+layout(std430, set = 1, binding = 8) readonly buffer ClusterBuffer {
+
+	uvec2 clusters[];
+
+} clusterTable;
+
+layout(std430, set = 1, binding = 9) readonly buffer LightIndexBuffer {
+
+	uint indices[];
+
+} lightIndices;
+
+// the G-buffer keeps no specular color, every surface gets the one of the default material
+const vec3 SPECULAR = vec3(0.5);
+
+vec3 decodeOctahedral(vec2 encoded_) {
+
+	vec3 n						= vec3(encoded_, 1.0 - abs(encoded_.x) - abs(encoded_.y));
+	float t						= max(-n.z, 0.0);
+	n.x							+= n.x >= 0.0 ? -t : t;
+	n.y							+= n.y >= 0.0 ? -t : t;
+	return normalize(n);
+
+}
+
+// the same falloff and terms as the forward object shader
+vec3 shadeLight(PointLight light_, vec3 position_, vec3 albedo_, float shininess_, vec3 norm_, vec3 viewDir_) {
+
+	vec3 toLight				= light_.position - position_;
+	float distance				= length(toLight);
+	float ratio					= distance / light_.radius;
+	float falloff				= clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+	vec3 lightDir				= toLight / max(distance, 0.0001);
+
+	float diff					= max(dot(norm_, lightDir), 0.0);
+	vec3 diffuse				= diff * albedo_;
+
+	vec3 reflectDir				= reflect(-lightDir, norm_);
+	float spec					= pow(max(dot(viewDir_, reflectDir), 0.0), shininess_);
+	vec3 specular				= SPECULAR * spec;
+
+	return (diffuse + specular) * light_.color * (light_.intensity * falloff * falloff);
+
+}
+
+void main() {
+
+	float depth					= subpassLoad(gBufferDepth).r;
+	if (depth >= 1.0) {
+
+		outColor				= vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+
+	}
+
+	vec4 albedo					= subpassLoad(gBufferAlbedo);
+	if (albedo.a == 0.0) {
+
+		outColor				= vec4(albedo.rgb, 1.0);
+		return;
+
+	}
+
+	// clusterScale.xy is clusters per pixel, the cluster counts divided by it give the screen size
+	vec2 screenSize				= vec2(lbo.clusterCounts.xy) / lbo.clusterScale.xy;
+	vec4 ndc					= vec4(gl_FragCoord.xy / screenSize * 2.0 - 1.0, depth, 1.0);
+	vec4 viewPosition			= ubo.inverseProj * ndc;
+	viewPosition				/= viewPosition.w;
+	vec3 position				= vec3(ubo.inverseView * viewPosition);
+	float viewDepth				= -viewPosition.z;
+
+	vec3 norm					= decodeOctahedral(subpassLoad(gBufferNormal).xy);
+	vec3 viewDir				= normalize(lbo.viewPos.xyz - position);
+	float shininess				= 2.0 / (albedo.a * albedo.a) - 2.0;
+
+	uvec3 cell					= uvec3(
+
+		min(uint(gl_FragCoord.x * lbo.clusterScale.x), lbo.clusterCounts.x - 1),
+		min(uint(gl_FragCoord.y * lbo.clusterScale.y), lbo.clusterCounts.y - 1),
+		uint(clamp(log(viewDepth) * lbo.clusterScale.z + lbo.clusterScale.w, 0.0, float(lbo.clusterCounts.z - 1)))
+
+	);
+	uvec2 cluster				= clusterTable.clusters[cell.x + lbo.clusterCounts.x * (cell.y + lbo.clusterCounts.y * cell.z)];
+
+	// the default material's ambient equals its diffuse color, the albedo stands in for both
+	vec3 result					= albedo.rgb * lbo.ambientColor.rgb;
+	for (uint i = 0; i < cluster.y; i++) {
+
+		result					+= shadeLight(pointLights.lights[lightIndices.indices[cluster.x + i]], position, albedo.rgb, shininess, norm, viewDir);
+
+	}
+
+	outColor					= vec4(result, 1.0);
+
+}
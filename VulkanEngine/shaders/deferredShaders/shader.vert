@@ -0,0 +1,10 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+void main() {
+
+	// vertices 0, 1 and 2 go to (-1, -1), (3, -1) and (-1, 3), one triangle covering the whole screen
+	vec2 uv				= vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position			= vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+}
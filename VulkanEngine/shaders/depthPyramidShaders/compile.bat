@@ -0,0 +1,3 @@
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.comp -o comp.spv
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DMULTISAMPLED shader.comp -o multisampled.spv
+pause
\ No newline at end of file
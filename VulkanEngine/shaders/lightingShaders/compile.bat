@@ -1,3 +1,4 @@
 C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DGBUFFER shader.frag -o gbuffer.spv
 pause
\ No newline at end of file
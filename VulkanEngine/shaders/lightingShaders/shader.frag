@@ -1,10 +1,21 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#if defined GBUFFER
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec2 outNormal;
+#else
 layout(location = 0) out vec4 outColor;
+#endif
 
 void main() {
 
+#if defined GBUFFER
+	// a roughness of 0 tells the deferred pass to leave the lamp unlit
+	outAlbedo = vec4(1.0, 1.0, 1.0, 0.0);
+	outNormal = vec2(0.0, 0.0);
+#else
     outColor = vec4(1.0, 1.0, 1.0, 1.0);
+#endif
 
 }
\ No newline at end of file
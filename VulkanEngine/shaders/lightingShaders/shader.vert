@@ -1,17 +1,24 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(set = 1, binding = 0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
+layout(std430, set = 1, binding = 1) readonly buffer EntityBuffer {
+    mat4 models[];
+} entities;
+
+layout(std430, set = 1, binding = 2) readonly buffer InstanceBuffer {
+    uint entities[];
+} instances;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 
 void main() {
 
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * entities.models[instances.entities[gl_InstanceIndex]] * vec4(inPosition, 1.0);
 
 }
\ No newline at end of file
@@ -1,3 +1,6 @@
 C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DNONUNIFORM_INDEXING shader.frag -o frag_bindless.spv
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DGBUFFER shader.frag -o gbuffer.spv
+C:/VulkanSDK/1.1.85.0/Bin32/glslangValidator.exe -V -DGBUFFER -DNONUNIFORM_INDEXING shader.frag -o gbuffer_bindless.spv
 pause
\ No newline at end of file
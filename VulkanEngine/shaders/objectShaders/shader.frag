@@ -1,48 +1,197 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#if defined NONUNIFORM_INDEXING
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout(location = 0) in vec3 Normal;
 layout(location = 1) in vec3 FragPos;
 layout(location = 2) in vec3 fragColor;
 layout(location = 3) in vec2 fragTexCoord;
+layout(location = 4) flat in uint fragMaterial;
+layout(location = 5) in float viewDepth;
 
+#if defined GBUFFER
+layout(location = 0) out vec4 outAlbedo;		// roughness in alpha
+layout(location = 1) out vec2 outNormal;		// octahedral
+#else
 layout(location = 0) out vec4 outColor;
+#endif
 
-layout(binding = 1) uniform LightingUniformBuffer {
+// array sizes of the descriptor heap, set by the engine
+layout(constant_id = 0) const uint TEXTURE_COUNT = 16;
+layout(constant_id = 1) const uint SAMPLER_COUNT = 4;
 
-    vec3 lightColor;
-    vec3 objectColor;
-	vec3 lightPos;
-	vec3 viewPos;
+layout(set = 0, binding = 0) uniform texture2D textures[TEXTURE_COUNT];
+layout(set = 0, binding = 1) uniform sampler samplers[SAMPLER_COUNT];
+
+layout(set = 1, binding = 1) uniform LightingUniformBuffer {
+
+	vec4 ambientColor;
+	vec4 viewPos;
+	vec4 clusterScale;		// x and y are clusters per pixel, the depth slice is log(depth) * z + w
+	uvec4 clusterCounts;
 
 } lbo;
 
-layout(binding = 2) uniform MaterialUniformBuffer {
+struct Material {
 
 	vec3 ambient;
+	float shininess;
 	vec3 diffuse;
+	uint textureIndex;
 	vec3 specular;
-	float shininess;
+	uint samplerIndex;
+
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer MaterialBuffer {
+
+	Material materials[];
+
+} materialTable;
+
+struct PointLight {
+
+	vec3 position;
+	float radius;
+	vec3 color;
+	float intensity;
+
+};
+
+layout(std430, set = 1, binding = 7) readonly buffer PointLightBuffer {
+
+	PointLight lights[];
+
+} pointLights;
+
+// offset into the light indices and light count of every cluster
+layout(std430, set = 1, binding = 8) readonly buffer ClusterBuffer {
+
+	uvec2 clusters[];
+
+} clusterTable;
+
+layout(std430, set = 1, binding = 9) readonly buffer LightIndexBuffer {
+
+	uint indices[];
+
+} lightIndices;
+
+// instances of one draw may use different materials, so the texture index is not uniform
+vec3 sampleTexture(uint textureIndex_, uint samplerIndex_) {
+
+#if defined NONUNIFORM_INDEXING
+	return texture(sampler2D(textures[nonuniformEXT(textureIndex_)], samplers[nonuniformEXT(samplerIndex_)]), fragTexCoord).rgb;
+#else
+	// without descriptor indexing the arrays are small enough to only ever index them with constants
+	vec2 dx				= dFdx(fragTexCoord);
+	vec2 dy				= dFdy(fragTexCoord);
+	vec3 color			= vec3(1.0);
+	for (uint i = 0; i < TEXTURE_COUNT; i++) {
+
+		if (i != textureIndex_) {
+
+			continue;
+
+		}
+
+		for (uint j = 0; j < SAMPLER_COUNT; j++) {
 
-} mat;
+			if (j == samplerIndex_) {
+
+				color	= textureGrad(sampler2D(textures[i], samplers[j]), fragTexCoord, dx, dy).rgb;
+
+			}
+
+		}
+
+	}
+	return color;
+#endif
+
+}
+
+// lights fade out smoothly towards their radius, so the ones the cluster does not list contribute nothing
+vec3 shadeLight(PointLight light_, Material mat_, vec3 norm_, vec3 viewDir_) {
+
+	vec3 toLight				= light_.position - FragPos;
+	float distance				= length(toLight);
+	float ratio					= distance / light_.radius;
+	float falloff				= clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+	vec3 lightDir				= toLight / max(distance, 0.0001);
+
+	float diff					= max(dot(norm_, lightDir), 0.0);
+	vec3 diffuse				= diff * mat_.diffuse;
+
+	vec3 reflectDir				= reflect(-lightDir, norm_);
+	float spec					= pow(max(dot(viewDir_, reflectDir), 0.0), mat_.shininess);
+	vec3 specular				= mat_.specular * spec;
+
+	return (diffuse + specular) * light_.color * (light_.intensity * falloff * falloff);
+
+}
+
+// folds the octahedron of the unit normal onto the square [-1, 1]^2, the lower half goes into the corners
+vec2 encodeOctahedral(vec3 normal_) {
+
+	vec3 n						= normal_ / (abs(normal_.x) + abs(normal_.y) + abs(normal_.z));
+	if (n.z < 0.0) {
+
+		return (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+	}
+	return n.xy;
+
+}
 
 void main() {
 
-	vec3 ambient				= mat.ambient * lbo.lightColor;
+	Material mat				= materialTable.materials[fragMaterial];
+
+#if defined GBUFFER
+	// lighting happens once per pixel in the deferred pass, only the surface is written
+	vec3 albedo					= mat.diffuse;
+	if (mat.textureIndex != 0xffffffffu) {
+
+		albedo					*= sampleTexture(mat.textureIndex, mat.samplerIndex);
+
+	}
+
+	// inverse of shininess = 2 / roughness^2 - 2, a roughness of 0 marks unlit surfaces
+	float roughness				= max(sqrt(2.0 / (mat.shininess + 2.0)), 1.0 / 255.0);
+
+	outAlbedo					= vec4(albedo, roughness);
+	outNormal					= encodeOctahedral(normalize(Normal));
+#else
 
 	vec3 norm					= normalize(Normal);
-	vec3 lightDir				= normalize(lbo.lightPos - FragPos);
+	vec3 viewDir				= normalize(lbo.viewPos.xyz - FragPos);
+
+	// the froxel of this fragment, screen tile and exponential depth slice
+	uvec3 cell					= uvec3(
+
+		min(uint(gl_FragCoord.x * lbo.clusterScale.x), lbo.clusterCounts.x - 1),
+		min(uint(gl_FragCoord.y * lbo.clusterScale.y), lbo.clusterCounts.y - 1),
+		uint(clamp(log(viewDepth) * lbo.clusterScale.z + lbo.clusterScale.w, 0.0, float(lbo.clusterCounts.z - 1)))
+
+	);
+	uvec2 cluster				= clusterTable.clusters[cell.x + lbo.clusterCounts.x * (cell.y + lbo.clusterCounts.y * cell.z)];
+
+	vec3 result					= mat.ambient * lbo.ambientColor.rgb;
+	for (uint i = 0; i < cluster.y; i++) {
+
+		result					+= shadeLight(pointLights.lights[lightIndices.indices[cluster.x + i]], mat, norm, viewDir);
 
-	float diff					= max(dot(norm, lightDir), 0.0);
-	vec3 diffuse				= (diff * mat.diffuse) * lbo.lightColor;
+	}
+	if (mat.textureIndex != 0xffffffffu) {
 
-	vec3 viewDir				= normalize(lbo.viewPos - FragPos);
-	vec3 reflectDir				= reflect(-lightDir, norm);
-	float spec					= pow(max(dot(viewDir, reflectDir), 0.0), mat.shininess);
-	vec3 specular				= (mat.specular * spec) * lbo.lightColor;
+		result					*= sampleTexture(mat.textureIndex, mat.samplerIndex);
 
-	vec3 result					= ambient + diffuse + specular;
+	}
 
     outColor					= vec4(result, 1.0);
+#endif
 
-}
\ No newline at end of file
+}
@@ -1,14 +1,37 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 1, binding = 0) uniform UniformBufferObject {
 
-    mat4 model;
     mat4 view;
     mat4 proj;
 
 } ubo;
 
+layout(std430, set = 1, binding = 3) readonly buffer EntityBuffer {
+
+    mat4 models[];
+
+} entities;
+
+layout(std430, set = 1, binding = 4) readonly buffer NormalBuffer {
+
+    mat4 normals[];
+
+} normalMatrices;
+
+layout(std430, set = 1, binding = 5) readonly buffer InstanceBuffer {
+
+    uint entities[];
+
+} instances;
+
+layout(std430, set = 1, binding = 6) readonly buffer MaterialIndexBuffer {
+
+    uint indices[];
+
+} materialIndices;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
@@ -18,13 +41,20 @@ layout(location = 0) out vec3 Normal;
 layout(location = 1) out vec3 FragPos;
 layout(location = 2) out vec3 fragColor;
 layout(location = 3) out vec2 fragTexCoord;
+layout(location = 4) flat out uint fragMaterial;
+layout(location = 5) out float viewDepth;
 
 void main() {
 
-    gl_Position			= ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-	FragPos				= vec3(ubo.model * vec4(inPosition, 1.0));
-	Normal				= mat3(transpose(inverse(ubo.model))) * inNormal;
+	// the instance index goes through the draw's entity list, which is the identity unless the GPU culled the scene
+	uint entity			= instances.entities[gl_InstanceIndex];
+	mat4 model			= entities.models[entity];
+    gl_Position			= ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+	FragPos				= vec3(model * vec4(inPosition, 1.0));
+	viewDepth			= -(ubo.view * vec4(FragPos, 1.0)).z;
+	Normal				= mat3(normalMatrices.normals[entity]) * inNormal;
 	fragColor			= inColor;
 	fragTexCoord		= inTexCoord;
+	fragMaterial		= materialIndices.indices[entity];
 
 }
\ No newline at end of file